@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <pcl/AutoLock.h>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderAccumulator.h"
+
+namespace pcl
+{
+
+EPSFBuilderAccumulator::EPSFBuilderAccumulator(int capacity)
+    : m_capacity(Max(capacity, 1))
+{
+}
+
+void EPSFBuilderAccumulator::Add(int frame, const EPSFBuilderExtraction& extraction)
+{
+    size_type cutoutSize = size_type(extraction.cutoutWidth) * extraction.cutoutHeight;
+
+    volatile AutoLock lock(m_mutex);
+
+    if (extraction.starCount > 0)
+    {
+        if (m_offered == 0)
+        {
+            m_cutoutWidth = extraction.cutoutWidth;
+            m_cutoutHeight = extraction.cutoutHeight;
+        }
+        else if (extraction.cutoutWidth != m_cutoutWidth || extraction.cutoutHeight != m_cutoutHeight)
+            throw Error(String().Format("Frame %d: the cutouts do not have the size of the accumulated stars", frame + 1));
+    }
+
+    for (int i = 0; i < extraction.starCount; i++)
+    {
+        int id[2] = { frame, i };
+        uint64 key = Hash64(id, sizeof(id), 0x6550534641636375ull);
+        if (int(m_heap.size()) == m_capacity)
+        {
+            if (key >= m_heap.front().key)
+                continue;
+            std::pop_heap(m_heap.begin(), m_heap.end());
+            m_heap.pop_back();
+        }
+
+        Entry entry;
+        entry.key = key;
+        entry.frame = frame;
+        entry.index = i;
+        const double* meta = extraction.starMeta.data() + 5 * i;
+        for (int j = 0; j < 5; j++)
+            entry.meta[j] = meta[j];
+        const double* cutout = extraction.starData.data() + i * cutoutSize;
+        entry.data.assign(cutout, cutout + cutoutSize);
+        m_heap.push_back(std::move(entry));
+        std::push_heap(m_heap.begin(), m_heap.end());
+    }
+
+    m_frames++;
+    m_offered += extraction.starCount;
+}
+
+EPSFBuilderExtraction EPSFBuilderAccumulator::Extraction() const
+{
+    volatile AutoLock lock(m_mutex);
+
+    std::vector<const Entry*> entries;
+    entries.reserve(m_heap.size());
+    for (const Entry& entry : m_heap)
+        entries.push_back(&entry);
+    std::sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b)
+    {
+        return (a->frame != b->frame) ? a->frame < b->frame : a->index < b->index;
+    });
+
+    EPSFBuilderExtraction extraction;
+    extraction.starCount = int(entries.size());
+    extraction.cutoutWidth = m_cutoutWidth;
+    extraction.cutoutHeight = m_cutoutHeight;
+    size_type cutoutSize = size_type(m_cutoutWidth) * m_cutoutHeight;
+    extraction.starData.resize(entries.size() * cutoutSize);
+    extraction.starMeta.resize(entries.size() * 5);
+    for (size_type i = 0; i < entries.size(); i++)
+    {
+        std::copy(entries[i]->data.begin(), entries[i]->data.end(), extraction.starData.begin() + i * cutoutSize);
+        std::copy(entries[i]->meta, entries[i]->meta + 5, extraction.starMeta.begin() + i * 5);
+    }
+    return extraction;
+}
+
+int EPSFBuilderAccumulator::Frames() const
+{
+    volatile AutoLock lock(m_mutex);
+    return m_frames;
+}
+
+int EPSFBuilderAccumulator::Offered() const
+{
+    volatile AutoLock lock(m_mutex);
+    return m_offered;
+}
+
+int EPSFBuilderAccumulator::Kept() const
+{
+    volatile AutoLock lock(m_mutex);
+    return int(m_heap.size());
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef __EPSFBuilderAccumulator_h
+#define __EPSFBuilderAccumulator_h
+
+#include <vector>
+#include <pcl/Mutex.h>
+
+#include "EPSFBuilderPython.h"
+
+namespace pcl
+{
+
+// Stars harvested from many registered frames, for a single ePSF built from all of them. Every star
+// gets a pseudo-random key from its frame and index, and only the capacity stars with the smallest
+// keys are kept: memory is bounded by the capacity whatever the number of frames, each frame keeps a
+// share proportional to its stars, and the sample does not depend on the order in which frames
+// processed concurrently are added. The oversampled fit then runs once, on the kept stars, as the
+// iterative algorithm needs every star at each iteration.
+
+class EPSFBuilderAccumulator
+{
+public:
+    EPSFBuilderAccumulator(int capacity);
+
+    // Offers the stars of an extraction of a frame. May be called from any thread.
+    void Add(int frame, const EPSFBuilderExtraction& extraction);
+
+    // The kept stars in the layout of an extraction, ordered by frame and star index
+    EPSFBuilderExtraction Extraction() const;
+
+    int Frames() const;
+    int Offered() const;
+    int Kept() const;
+
+private:
+    struct Entry
+    {
+        uint64 key;
+        int frame;
+        int index;
+        double meta[5];
+        std::vector<double> data;
+
+        bool operator<(const Entry& x) const
+        {
+            return key < x.key;
+        }
+    };
+
+    int m_capacity;
+    int m_cutoutWidth = 0;
+    int m_cutoutHeight = 0;
+    int m_frames = 0;
+    int m_offered = 0;
+    std::vector<Entry> m_heap;      // max-heap on key
+    mutable Mutex m_mutex;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderAccumulator_h
\ No newline at end of file
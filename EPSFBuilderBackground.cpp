@@ -0,0 +1,171 @@
+#include <pcl/AtrousWaveletTransform.h>
+#include <pcl/Math.h>
+#include <pcl/SeparableConvolution.h>
+
+#include "EPSFBuilderBackground.h"
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderParameters.h"
+
+namespace pcl
+{
+
+static const float B3S_hv[] = { 0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f };
+
+EPSFBuilderBackground::EPSFBuilderBackground(int layers)
+    : m_layers(layers)
+    , m_filter(B3S_hv, B3S_hv, 5)
+{
+}
+
+void EPSFBuilderBackground::Remove(ImageVariant& image, pcl_enum mode) const
+{
+    Subtract(image, mode);
+    image.Truncate(-0.001, 1.0);
+    image.Normalize();
+}
+
+void EPSFBuilderBackground::Subtract(ImageVariant& image, pcl_enum mode) const
+{
+    switch (mode)
+    {
+    case EPSFBuilderBackgroundMode::Starlet:
+        {
+            StarletTransform mt(m_filter, m_layers);
+            mt.EnableParallelProcessing(image->IsParallelProcessingEnabled(), image->MaxProcessors());
+            mt << image;
+            mt.DisableLayer(m_layers);
+            mt >> image;
+        }
+        break;
+    case EPSFBuilderBackgroundMode::Multiresolution:
+        Multiresolution(image);
+        break;
+    default:
+    case EPSFBuilderBackgroundMode::Streaming:
+        Streaming(image);
+        break;
+    }
+}
+
+void EPSFBuilderBackground::Streaming(ImageVariant& image) const
+{
+    switch (image.BitsPerSample())
+    {
+    case 32: StreamingImage(static_cast<Image&>(*image)); break;
+    case 64: StreamingImage(static_cast<DImage&>(*image)); break;
+    }
+}
+
+template <class P>
+void EPSFBuilderBackground::StreamingImage(GenericImage<P>& image) const
+{
+    // The smooth plane is 32-bit floating point for every sample type, as the layers of
+    // StarletTransform are, so that both modes agree up to rounding errors
+    Image smooth;
+    smooth.EnableParallelProcessing(image.IsParallelProcessingEnabled(), image.MaxProcessors());
+    smooth.Assign(image);
+    Smooth(smooth, 0, m_layers);
+    image.Apply(smooth, ImageOp::Sub);
+}
+
+void EPSFBuilderBackground::Multiresolution(ImageVariant& image) const
+{
+    switch (image.BitsPerSample())
+    {
+    case 32: MultiresolutionImage(static_cast<Image&>(*image)); break;
+    case 64: MultiresolutionImage(static_cast<DImage&>(*image)); break;
+    }
+}
+
+template <class P>
+void EPSFBuilderBackground::Smooth(GenericImage<P>& image, int firstScale, int lastScale) const
+{
+    // Scale j of the a trous algorithm is the B3 spline dilated by 2^j. The convolution follows the
+    // parallel settings of the image, which standalone builds disable.
+    for (int j = firstScale; j < lastScale; j++)
+    {
+        SeparableConvolution C(m_filter);
+        C.SetInterlacingDistance(1 << j);
+        C.EnableParallelProcessing(image.IsParallelProcessingEnabled(), image.MaxProcessors());
+        C >> image;
+    }
+}
+
+template <class P>
+void EPSFBuilderBackground::MultiresolutionImage(GenericImage<P>& image) const
+{
+    typedef typename P::sample sample;
+
+    // The two largest scales run on the downsampled image, the others are replaced by the box
+    // average of the downsampling
+    int m = m_layers - 2;
+    if (m < 1)
+    {
+        GenericImage<P> smooth;
+        smooth.EnableParallelProcessing(image.IsParallelProcessingEnabled(), image.MaxProcessors());
+        smooth.Assign(image);
+        Smooth(smooth, 0, m_layers);
+        image.Apply(smooth, ImageOp::Sub);
+        return;
+    }
+
+    int d = 1 << m;
+    int width = image.Width();
+    int height = image.Height();
+    int smallWidth = (width + d - 1) / d;
+    int smallHeight = (height + d - 1) / d;
+
+    GenericImage<P> small(smallWidth, smallHeight);
+    small.EnableParallelProcessing(image.IsParallelProcessingEnabled(), image.MaxProcessors());
+    EPSFBuilderParallelFor(size_type(smallHeight), [&](size_type begin, size_type end, int)
+    {
+        for (int sy = int(begin); sy < int(end); sy++)
+        {
+            int y0 = sy * d;
+            int y1 = Min(y0 + d, height);
+            sample* out = small.ScanLine(sy);
+            for (int sx = 0; sx < smallWidth; sx++)
+            {
+                int x0 = sx * d;
+                int x1 = Min(x0 + d, width);
+                double sum = 0;
+                for (int y = y0; y < y1; y++)
+                {
+                    const sample* row = image.ScanLine(y);
+                    for (int x = x0; x < x1; x++)
+                        sum += row[x];
+                }
+                out[sx] = sample(sum / ((x1 - x0) * (y1 - y0)));
+            }
+        }
+    }, 16);
+
+    Smooth(small, 0, m_layers - m);
+
+    // Bilinear interpolation of the residual at the full resolution pixel centers
+    EPSFBuilderParallelFor(size_type(height), [&](size_type begin, size_type end, int)
+    {
+        for (int y = int(begin); y < int(end); y++)
+        {
+            double fy = Range((y + 0.5) / d - 0.5, 0.0, double(smallHeight - 1));
+            int sy0 = int(fy);
+            int sy1 = Min(sy0 + 1, smallHeight - 1);
+            double ty = fy - sy0;
+            const sample* r0 = small.ScanLine(sy0);
+            const sample* r1 = small.ScanLine(sy1);
+            sample* row = image.ScanLine(y);
+            for (int x = 0; x < width; x++)
+            {
+                double fx = Range((x + 0.5) / d - 0.5, 0.0, double(smallWidth - 1));
+                int sx0 = int(fx);
+                int sx1 = Min(sx0 + 1, smallWidth - 1);
+                double tx = fx - sx0;
+                double top = r0[sx0] + tx * (r0[sx1] - r0[sx0]);
+                double bottom = r1[sx0] + tx * (r1[sx1] - r1[sx0]);
+                row[x] = sample(row[x] - (top + ty * (bottom - top)));
+            }
+        }
+    }, 16);
+}
+
+}	// namespace pcl
\ No newline at end of file
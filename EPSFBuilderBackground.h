@@ -0,0 +1,61 @@
+#ifndef __EPSFBuilderBackground_h
+#define __EPSFBuilderBackground_h
+
+#include <pcl/ImageVariant.h>
+#include <pcl/SeparableFilter.h>
+
+namespace pcl
+{
+
+// Background removal of Step 1 without materializing the starlet layers. The sum of the detail
+// layers of a starlet transform is the image minus its residual layer, and the residual is the
+// image smoothed by the B3 spline at every scale in turn. Streaming() walks through the scales
+// keeping only the running smooth plane and yields the same result as the full transform up to
+// rounding errors, which EPSFBuilderBenchmark reports.
+// Multiresolution() runs the first scales on a downsampled copy instead, which is much cheaper
+// for large scales but only approximates it.
+
+class EPSFBuilderBackground
+{
+public:
+    EPSFBuilderBackground(int layers);
+
+    // Removes the background with the given EPSFBuilderBackgroundMode, then rescales the image to
+    // [0,1] as Step 1 does
+    void Remove(ImageVariant& image, pcl_enum mode) const;
+
+    // Subtracts the background without rescaling the result
+    void Subtract(ImageVariant& image, pcl_enum mode) const;
+
+    // Upper bound of the distance in pixels over which the image contributes to the background of a
+    // pixel, in every mode. Pixels farther than this from the edges of a region of the image have
+    // the same background in the region as in the whole image.
+    int Radius() const
+    {
+        return 2 << m_layers;
+    }
+
+    // Subtracts the residual layer of a starlet transform with the given number of layers
+    void Streaming(ImageVariant& image) const;
+
+    // Same as Streaming() with the first scales replaced by a box downsampling of the image; the
+    // residual is interpolated back to full resolution before it is subtracted.
+    void Multiresolution(ImageVariant& image) const;
+
+private:
+    int m_layers;
+    SeparableFilter m_filter;
+
+    template <class P>
+    void Smooth(GenericImage<P>& image, int firstScale, int lastScale) const;
+
+    template <class P>
+    void StreamingImage(GenericImage<P>& image) const;
+
+    template <class P>
+    void MultiresolutionImage(GenericImage<P>& image) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderBackground_h
\ No newline at end of file
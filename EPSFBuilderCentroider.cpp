@@ -0,0 +1,475 @@
+#include <utility>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderCentroider.h"
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderParameters.h"
+
+namespace pcl
+{
+
+static const int GaussianMaxIterations = 50;
+static const int WeightedMaxIterations = 20;
+static const double WeightedAccuracy = 1.0e-4;
+
+// Stars per thread below which a batch is not worth splitting further
+static const size_type ThreadOverhead = 64;
+
+EPSFBuilderCentroider::Batch::Batch(int cutoutSize, size_type count)
+    : size(cutoutSize)
+    , data(size_type(cutoutSize) * cutoutSize * count, 0.0f)
+    , x(count, 0.0)
+    , y(count, 0.0)
+    , valid(count, 0)
+{
+}
+
+EPSFBuilderCentroider::EPSFBuilderCentroider(pcl_enum method, double fwhm)
+    : m_method(method)
+    , m_fwhm(fwhm)
+{
+}
+
+int EPSFBuilderCentroider::BoxSize() const
+{
+    return 2 * Max(2, RoundInt(1.5 * m_fwhm)) + 1;
+}
+
+void EPSFBuilderCentroider::Centroid(Batch& batch) const
+{
+    EPSFBuilderParallelFor(batch.Count(), [&](size_type begin, size_type end, int)
+    {
+        switch (m_method)
+        {
+        case EPSFBuilderCentroidMethod::Moments:
+            CentroidMoments(batch, begin, end);
+            break;
+        case EPSFBuilderCentroidMethod::MarginalGaussian:
+            CentroidMarginals(batch, begin, end);
+            break;
+        case EPSFBuilderCentroidMethod::IterativeWeighted:
+            CentroidWeighted(batch, begin, end);
+            break;
+        default:
+            throw Error("Unsupported centroiding method");
+        }
+    }, ThreadOverhead);
+}
+
+// Mean of the border pixels of every cutout in [begin, end)
+void EPSFBuilderCentroider::Background(const Batch& batch, size_type begin, size_type end, double* background) const
+{
+    const size_type count = batch.Count();
+    const size_type m = end - begin;
+    const int n = batch.size;
+    for (size_type i = 0; i < m; i++)
+        background[i] = 0;
+    auto add = [&](int col, int row)
+    {
+        const float* p = batch.data.data() + (size_type(row) * n + col) * count + begin;
+        for (size_type i = 0; i < m; i++)
+            background[i] += p[i];
+    };
+    for (int c = 0; c < n; c++)
+    {
+        add(c, 0);
+        add(c, n - 1);
+    }
+    for (int r = 1; r < n - 1; r++)
+    {
+        add(0, r);
+        add(n - 1, r);
+    }
+    const double border = 4.0 * n - 4;
+    for (size_type i = 0; i < m; i++)
+        background[i] /= border;
+}
+
+void EPSFBuilderCentroider::CentroidMoments(Batch& batch, size_type begin, size_type end) const
+{
+    const size_type count = batch.Count();
+    const size_type m = end - begin;
+    const int n = batch.size;
+    std::vector<double> background(m), sum(m, 0.0), sx(m, 0.0), sy(m, 0.0);
+    Background(batch, begin, end, background.data());
+
+    for (int r = 0; r < n; r++)
+        for (int c = 0; c < n; c++)
+        {
+            const float* p = batch.data.data() + (size_type(r) * n + c) * count + begin;
+            for (size_type i = 0; i < m; i++)
+            {
+                double v = Max(p[i] - background[i], 0.0);
+                sum[i] += v;
+                sx[i] += v * c;
+                sy[i] += v * r;
+            }
+        }
+
+    for (size_type i = 0; i < m; i++)
+    {
+        batch.valid[begin + i] = sum[i] > 0;
+        if (sum[i] > 0)
+        {
+            batch.x[begin + i] = sx[i] / sum[i];
+            batch.y[begin + i] = sy[i] / sum[i];
+        }
+    }
+}
+
+// Solves the 4x4 system a*x = b by Gaussian elimination with partial pivoting
+static bool Solve4(double a[4][4], double b[4])
+{
+    for (int k = 0; k < 4; k++)
+    {
+        int pivot = k;
+        for (int i = k + 1; i < 4; i++)
+            if (Abs(a[i][k]) > Abs(a[pivot][k]))
+                pivot = i;
+        if (a[pivot][k] == 0)
+            return false;
+        if (pivot != k)
+        {
+            for (int j = 0; j < 4; j++)
+                std::swap(a[k][j], a[pivot][j]);
+            std::swap(b[k], b[pivot]);
+        }
+        for (int i = k + 1; i < 4; i++)
+        {
+            double f = a[i][k] / a[k][k];
+            for (int j = k; j < 4; j++)
+                a[i][j] -= f * a[k][j];
+            b[i] -= f * b[k];
+        }
+    }
+    for (int k = 3; k >= 0; k--)
+    {
+        for (int j = k + 1; j < 4; j++)
+            b[k] -= a[k][j] * b[j];
+        b[k] /= a[k][k];
+    }
+    return true;
+}
+
+// Levenberg-Marquardt fit of amplitude*exp(-(t - center)^2/(2*sigma^2)) + constant to the n values
+// f[0], f[stride], ... Returns false unless a positive Gaussian centered within the data is found.
+static bool FitGaussian1D(const double* f, size_type stride, int n, double sigma, double& center)
+{
+    double low = f[0], high = f[0];
+    for (int t = 1; t < n; t++)
+    {
+        low = Min(low, f[t * stride]);
+        high = Max(high, f[t * stride]);
+    }
+    double sum = 0, st = 0;
+    for (int t = 0; t < n; t++)
+    {
+        sum += f[t * stride] - low;
+        st += (f[t * stride] - low) * t;
+    }
+    if (!(sum > 0))
+        return false;
+
+    double p[4] = { high - low, st / sum, sigma, low };
+    auto chi2 = [&](const double* q)
+    {
+        double s = 0;
+        for (int t = 0; t < n; t++)
+        {
+            double d = t - q[1];
+            double r = f[t * stride] - (q[0] * pcl::Exp(-d * d / (2 * q[2] * q[2])) + q[3]);
+            s += r * r;
+        }
+        return s;
+    };
+
+    double current = chi2(p);
+    double lambda = 1.0e-3;
+    for (int iteration = 0; iteration < GaussianMaxIterations; iteration++)
+    {
+        double jtj[4][4] = {};
+        double jtr[4] = {};
+        for (int t = 0; t < n; t++)
+        {
+            double d = t - p[1];
+            double e = pcl::Exp(-d * d / (2 * p[2] * p[2]));
+            double r = f[t * stride] - (p[0] * e + p[3]);
+            double j[4] = { e, p[0] * e * d / (p[2] * p[2]), p[0] * e * d * d / (p[2] * p[2] * p[2]), 1.0 };
+            for (int a = 0; a < 4; a++)
+            {
+                jtr[a] += j[a] * r;
+                for (int b = 0; b < 4; b++)
+                    jtj[a][b] += j[a] * j[b];
+            }
+        }
+
+        bool improved = false;
+        while (!improved && lambda < 1.0e10)
+        {
+            double a[4][4];
+            double step[4];
+            for (int i = 0; i < 4; i++)
+            {
+                for (int k = 0; k < 4; k++)
+                    a[i][k] = jtj[i][k];
+                a[i][i] *= 1 + lambda;
+                step[i] = jtr[i];
+            }
+            if (!Solve4(a, step))
+                return false;
+            double q[4] = { p[0] + step[0], p[1] + step[1], p[2] + step[2], p[3] + step[3] };
+            double next = (q[2] > 0) ? chi2(q) : current + 1;
+            if (next <= current)
+            {
+                for (int i = 0; i < 4; i++)
+                    p[i] = q[i];
+                current = next;
+                lambda *= 0.1;
+                improved = true;
+                if (Abs(step[1]) < 1.0e-6)
+                    iteration = GaussianMaxIterations;
+            }
+            else
+                lambda *= 10;
+        }
+        if (!improved)
+            break;
+    }
+
+    if (!IsFinite(p[1]) || !(p[0] > 0) || p[1] < 0 || p[1] > n - 1)
+        return false;
+    center = p[1];
+    return true;
+}
+
+void EPSFBuilderCentroider::CentroidMarginals(Batch& batch, size_type begin, size_type end) const
+{
+    const size_type count = batch.Count();
+    const size_type m = end - begin;
+    const int n = batch.size;
+    std::vector<double> background(m);
+    Background(batch, begin, end, background.data());
+
+    // Marginal sums, stored like the cutouts: element t of the marginal of star i at [t*m + i]
+    std::vector<double> mx(size_type(n) * m, 0.0), my(size_type(n) * m, 0.0);
+    for (int r = 0; r < n; r++)
+        for (int c = 0; c < n; c++)
+        {
+            const float* p = batch.data.data() + (size_type(r) * n + c) * count + begin;
+            double* px = mx.data() + size_type(c) * m;
+            double* py = my.data() + size_type(r) * m;
+            for (size_type i = 0; i < m; i++)
+            {
+                double v = p[i] - background[i];
+                px[i] += v;
+                py[i] += v;
+            }
+        }
+
+    const double sigma = m_fwhm / 2.3548200450309493;
+    for (size_type i = 0; i < m; i++)
+    {
+        double x, y;
+        bool valid = FitGaussian1D(mx.data() + i, m, n, sigma, x) && FitGaussian1D(my.data() + i, m, n, sigma, y);
+        batch.valid[begin + i] = valid;
+        if (valid)
+        {
+            batch.x[begin + i] = x;
+            batch.y[begin + i] = y;
+        }
+    }
+}
+
+void EPSFBuilderCentroider::CentroidWeighted(Batch& batch, size_type begin, size_type end) const
+{
+    const size_type count = batch.Count();
+    const size_type m = end - begin;
+    const int n = batch.size;
+    std::vector<double> background(m);
+    Background(batch, begin, end, background.data());
+
+    std::vector<double> x(batch.x.begin() + begin, batch.x.begin() + end);
+    std::vector<double> y(batch.y.begin() + begin, batch.y.begin() + end);
+    std::vector<uint8> active(m, 1);
+    std::vector<uint8> found(m, 1);
+    std::vector<double> sum(m), sx(m), sy(m);
+
+    // The Gaussian window is separable: its row and column factors are computed once per iteration
+    std::vector<double> wx(size_type(n) * m), wy(size_type(n) * m);
+    const double sigma = m_fwhm / 2.3548200450309493;
+    const double k = -1 / (2 * sigma * sigma);
+
+    for (int iteration = 0; iteration < WeightedMaxIterations; iteration++)
+    {
+        for (int t = 0; t < n; t++)
+            for (size_type i = 0; i < m; i++)
+            {
+                wx[t * m + i] = pcl::Exp(k * (t - x[i]) * (t - x[i]));
+                wy[t * m + i] = pcl::Exp(k * (t - y[i]) * (t - y[i]));
+            }
+
+        sum.assign(m, 0.0);
+        sx.assign(m, 0.0);
+        sy.assign(m, 0.0);
+        for (int r = 0; r < n; r++)
+            for (int c = 0; c < n; c++)
+            {
+                const float* p = batch.data.data() + (size_type(r) * n + c) * count + begin;
+                const double* fx = wx.data() + size_type(c) * m;
+                const double* fy = wy.data() + size_type(r) * m;
+                for (size_type i = 0; i < m; i++)
+                {
+                    double v = (p[i] - background[i]) * fx[i] * fy[i];
+                    sum[i] += v;
+                    sx[i] += v * (c - x[i]);
+                    sy[i] += v * (r - y[i]);
+                }
+            }
+
+        // With a window matched to the star, twice the weighted offset is the step to the center
+        bool moving = false;
+        for (size_type i = 0; i < m; i++)
+            if (active[i])
+            {
+                if (!(sum[i] > 0))
+                {
+                    active[i] = found[i] = 0;
+                    continue;
+                }
+                double dx = 2 * sx[i] / sum[i];
+                double dy = 2 * sy[i] / sum[i];
+                x[i] += dx;
+                y[i] += dy;
+                if (x[i] < 0 || x[i] > n - 1 || y[i] < 0 || y[i] > n - 1)
+                    active[i] = 0;
+                else if (dx * dx + dy * dy < WeightedAccuracy * WeightedAccuracy)
+                    active[i] = 0;
+                else
+                    moving = true;
+            }
+        if (!moving)
+            break;
+    }
+
+    for (size_type i = 0; i < m; i++)
+    {
+        bool valid = found[i] && IsFinite(x[i]) && IsFinite(y[i]) && x[i] >= 0 && x[i] <= n - 1 && y[i] >= 0 && y[i] <= n - 1;
+        batch.valid[begin + i] = valid;
+        if (valid)
+        {
+            batch.x[begin + i] = x[i];
+            batch.y[begin + i] = y[i];
+        }
+    }
+}
+
+template <typename T, class F>
+void EPSFBuilderCentroider::RefineBoxes(const F& source, std::vector<double>& x, std::vector<double>& y) const
+{
+    const int size = BoxSize();
+    const int h = size / 2;
+
+    // Stars whose box lies entirely within their array
+    std::vector<size_type> stars;
+    std::vector<int> x0, y0;
+    for (size_type j = 0; j < x.size(); j++)
+    {
+        int width, height;
+        source(j, width, height);
+        int bx = RoundInt(x[j]) - h;
+        int by = RoundInt(y[j]) - h;
+        if (bx >= 0 && by >= 0 && bx + size <= width && by + size <= height)
+        {
+            stars.push_back(j);
+            x0.push_back(bx);
+            y0.push_back(by);
+        }
+    }
+    if (stars.empty())
+        return;
+
+    Batch batch(size, stars.size());
+    EPSFBuilderParallelFor(stars.size(), [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            size_type j = stars[i];
+            int width, height;
+            const T* data = source(j, width, height);
+            for (int r = 0; r < size; r++)
+            {
+                const T* row = data + size_type(y0[i] + r) * width + x0[i];
+                for (int c = 0; c < size; c++)
+                    batch.Pixel(i, c, r) = float(row[c]);
+            }
+            batch.x[i] = x[j] - x0[i];
+            batch.y[i] = y[j] - y0[i];
+        }
+    }, ThreadOverhead);
+
+    Centroid(batch);
+
+    for (size_type i = 0; i < stars.size(); i++)
+        if (batch.valid[i] && Abs(x0[i] + batch.x[i] - x[stars[i]]) <= h && Abs(y0[i] + batch.y[i] - y[stars[i]]) <= h)
+        {
+            x[stars[i]] = x0[i] + batch.x[i];
+            y[stars[i]] = y0[i] + batch.y[i];
+        }
+}
+
+void EPSFBuilderCentroider::Refine(const ImageVariant& image, std::vector<double>& positions) const
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("Centroiding requires a real floating point image");
+
+    std::vector<double> x, y;
+    for (size_type i = 0; i + 1 < positions.size(); i += 2)
+    {
+        x.push_back(positions[i]);
+        y.push_back(positions[i + 1]);
+    }
+
+    const int width = image.Width();
+    const int height = image.Height();
+    if (image.BitsPerSample() == 32)
+    {
+        const float* data = static_cast<const Image&>(*image)[0];
+        RefineBoxes<float>([=](size_type, int& w, int& h) { w = width; h = height; return data; }, x, y);
+    }
+    else
+    {
+        const double* data = static_cast<const DImage&>(*image)[0];
+        RefineBoxes<double>([=](size_type, int& w, int& h) { w = width; h = height; return data; }, x, y);
+    }
+
+    for (size_type i = 0; i < x.size(); i++)
+    {
+        positions[2 * i] = x[i];
+        positions[2 * i + 1] = y[i];
+    }
+}
+
+void EPSFBuilderCentroider::Refine(std::vector<EPSFBuilderFitter::Star>& stars) const
+{
+    std::vector<double> x, y;
+    for (const EPSFBuilderFitter::Star& star : stars)
+    {
+        x.push_back(star.x);
+        y.push_back(star.y);
+    }
+
+    RefineBoxes<float>([&](size_type i, int& w, int& h)
+    {
+        w = stars[i].width;
+        h = stars[i].height;
+        return stars[i].data;
+    }, x, y);
+
+    for (size_type i = 0; i < stars.size(); i++)
+    {
+        stars[i].x = x[i];
+        stars[i].y = y[i];
+    }
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef __EPSFBuilderCentroider_h
+#define __EPSFBuilderCentroider_h
+
+#include <vector>
+#include <pcl/ImageVariant.h>
+
+#include "EPSFBuilderFitter.h"
+
+namespace pcl
+{
+
+// Native sub-pixel centroiding of many stars at once, with the methods of EPSFBuilderCentroidMethod:
+//
+//   Moments             first moments of the cutout above its border level (photutils centroid_com)
+//   MarginalGaussian    a Gaussian plus a constant fitted to each marginal sum (photutils centroid_1dg)
+//   IterativeWeighted   first moments under a Gaussian window of the star FWHM, recentered on the
+//                       result until it moves less than 1e-4 pixels (SExtractor XWIN_IMAGE)
+//
+// The cutouts of a batch are stored pixel-major: pixel k of every star, then pixel k + 1, so the
+// inner loops run across stars, with no dependency between iterations, and are vectorized by the
+// compiler. Threads take contiguous ranges of stars.
+
+class EPSFBuilderCentroider
+{
+public:
+    // Square cutouts of a batch of stars in structure-of-arrays layout
+    struct Batch
+    {
+        int size = 0;                   // cutouts are size x size pixels
+        std::vector<float> data;        // size*size*Count() samples, data[k*Count() + i] is pixel k of star i
+        std::vector<double> x;          // centers in cutout pixel coordinates
+        std::vector<double> y;
+        std::vector<uint8> valid;       // zero where no centroid was found, x and y are then unchanged
+
+        Batch(int cutoutSize = 0, size_type count = 0);
+
+        size_type Count() const
+        {
+            return x.size();
+        }
+
+        float& Pixel(size_type star, int col, int row)
+        {
+            return data[(size_type(row) * size + col) * Count() + star];
+        }
+    };
+
+    EPSFBuilderCentroider(pcl_enum method, double fwhm);
+
+    // Centroids every cutout of the batch. IterativeWeighted starts from the centers of the batch,
+    // which must be set; the other methods ignore them.
+    void Centroid(Batch& batch) const;
+
+    // Moves the x, y pairs of positions, in image pixels, to the centroid of a BoxSize() box around
+    // them on the first channel of image. A position is kept when its box does not lie entirely
+    // within the image, or when no centroid is found within half a box of it.
+    void Refine(const ImageVariant& image, std::vector<double>& positions) const;
+
+    // The same on the cutout of each star, for the centers the fitter starts from
+    void Refine(std::vector<EPSFBuilderFitter::Star>& stars) const;
+
+    // Side of the boxes of Refine(), about three times the FWHM
+    int BoxSize() const;
+
+private:
+    pcl_enum m_method;
+    double m_fwhm;
+
+    // Refines x[i], y[i] on the row-major array returned by source(i, width, height)
+    template <typename T, class F>
+    void RefineBoxes(const F& source, std::vector<double>& x, std::vector<double>& y) const;
+
+    void Background(const Batch& batch, size_type begin, size_type end, double* background) const;
+    void CentroidMoments(Batch& batch, size_type begin, size_type end) const;
+    void CentroidMarginals(Batch& batch, size_type begin, size_type end) const;
+    void CentroidWeighted(Batch& batch, size_type begin, size_type end) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderCentroider_h
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include <pcl/Math.h>
+
+#include "EPSFBuilderDeconvolution.h"
+#include "EPSFBuilderParallel.h"
+
+namespace pcl
+{
+
+// Coordinate x of a line of n pixels mirrored at both ends, for any x
+static int Mirror(int x, int n)
+{
+    const int period = 2 * n;
+    x %= period;
+    if (x < 0)
+        x += period;
+    return (x < n) ? x : period - 1 - x;
+}
+
+EPSFBuilderDeconvolution::EPSFBuilderDeconvolution(int iterations, double tolerance)
+    : m_maxIterations(iterations)
+    , m_tolerance(tolerance)
+{
+}
+
+void EPSFBuilderDeconvolution::SetPSF(const std::vector<double>& psf, int size, int columns, int rows)
+{
+    if (size < 1 || columns < 1 || rows < 1 || psf.size() != size_type(size) * size * columns * rows)
+        throw Error("Invalid ePSF geometry for deconvolution");
+
+    m_size = size;
+    m_columns = columns;
+    m_rows = rows;
+    m_psf.assign(size_type(columns) * rows, std::vector<double>(size_type(size) * size));
+    const size_type stride = size_type(columns) * size;
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < columns; c++)
+        {
+            std::vector<double>& cell = m_psf[size_type(r) * columns + c];
+            double flux = 0;
+            for (int y = 0; y < size; y++)
+                for (int x = 0; x < size; x++)
+                {
+                    double v = Max(0.0, psf[(size_type(r) * size + y) * stride + size_type(c) * size + x]);
+                    cell[size_type(y) * size + x] = v;
+                    flux += v;
+                }
+            if (flux <= 0)
+                throw Error("Empty ePSF, unable to deconvolve");
+            for (double& v : cell)
+                v /= flux;
+        }
+    m_otfCell = -1;
+}
+
+void EPSFBuilderDeconvolution::Deconvolve(ImageVariant& image, int c)
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("Deconvolution requires a real floating point image");
+    if (m_psf.empty())
+        throw Error("Deconvolution requires an ePSF");
+
+    if (image.BitsPerSample() == 32)
+        DeconvolveImage(static_cast<Image&>(*image), c);
+    else
+        DeconvolveImage(static_cast<DImage&>(*image), c);
+}
+
+template <class P>
+void EPSFBuilderDeconvolution::DeconvolveImage(GenericImage<P>& image, int c)
+{
+    const int width = image.Width();
+    const int height = image.Height();
+    const int margin = m_size;
+
+    // The smallest tile holding the whole image, up to MaxTileSize, with a core at least as large as
+    // its margins
+    int n = 1;
+    while (n < Max(Max(width, height) + 2 * margin, 4 * margin) && n < int(MaxTileSize))
+        n <<= 1;
+    if (n < 4 * margin)
+        throw Error(String().Format("Deconvolution: an ePSF of %d pixels is too large for tiles of at most %d pixels", margin, int(MaxTileSize)));
+    Plan(n);
+    const int core = n - 2 * margin;
+
+    // The tiles read the original pixels, not those written back by the tiles before them
+    const typename P::sample* f = image[c];
+    std::vector<typename P::sample> source(f, f + image.NumberOfPixels());
+
+    std::vector<double> data(size_type(n) * n);
+    std::vector<double> u(size_type(n) * n);
+    std::vector<double> work(size_type(n) * n);
+    std::vector<complex> spectrum(size_type(n) * (n / 2 + 1));
+    for (int y0 = 0; y0 < height; y0 += core)
+        for (int x0 = 0; x0 < width; x0 += core)
+        {
+            const int coreWidth = Min(core, width - x0);
+            const int coreHeight = Min(core, height - y0);
+            int column = Min(m_columns - 1, (x0 + coreWidth / 2) * m_columns / width);
+            int row = Min(m_rows - 1, (y0 + coreHeight / 2) * m_rows / height);
+            TransferFunction(row * m_columns + column);
+
+            EPSFBuilderParallelFor(size_type(n), [&](size_type begin, size_type end, int)
+            {
+                for (size_type y = begin; y < end; y++)
+                {
+                    const typename P::sample* line = source.data() + size_type(Mirror(y0 - margin + int(y), height)) * width;
+                    double* d = data.data() + y * n;
+                    for (int x = 0; x < n; x++)
+                    {
+                        double v;
+                        P::FromSample(v, line[Mirror(x0 - margin + x, width)]);
+                        d[x] = Max(0.0, v);
+                    }
+                }
+            }, 16);
+
+            int iterations = DeconvolveTile(data, u, work, spectrum, margin, coreWidth, coreHeight);
+            m_tiles++;
+            m_iterationsDone += iterations;
+            if (iterations < m_maxIterations)
+                m_converged++;
+
+            typename P::sample* g = image[c];
+            for (int y = 0; y < coreHeight; y++)
+            {
+                const double* v = u.data() + size_type(margin + y) * n + margin;
+                typename P::sample* line = g + size_type(y0 + y) * width + x0;
+                for (int x = 0; x < coreWidth; x++)
+                    line[x] = typename P::sample(Range(v[x], 0.0, 1.0));
+            }
+        }
+}
+
+int EPSFBuilderDeconvolution::DeconvolveTile(const std::vector<double>& data, std::vector<double>& u, std::vector<double>& work, std::vector<complex>& spectrum, int margin, int coreWidth, int coreHeight) const
+{
+    const int n = m_n;
+    const double scale = 1.0 / (double(n) * n);     // of the inverse transforms
+    const double epsilon = 1.0e-12;
+    const int threads = EPSFBuilderThreadCount(size_type(n), 16);
+    std::vector<double> change(threads);
+    std::vector<double> total(threads);
+    const DRealFFT2D& fft = *m_fft;
+
+    // The first estimate is the observed tile; zero pixels would stay zero forever
+    EPSFBuilderParallelFor(size_type(n) * n, [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+            u[i] = Max(data[i], epsilon);
+    }, 65536);
+
+    int iteration = 0;
+    while (iteration < m_maxIterations)
+    {
+        iteration++;
+
+        // The estimate blurred by the ePSF, and the ratio of the observed tile to it
+        fft(spectrum.data(), u.data());
+        EPSFBuilderParallelFor(spectrum.size(), [&](size_type begin, size_type end, int)
+        {
+            for (size_type i = begin; i < end; i++)
+                spectrum[i] *= m_otf[i];
+        }, 65536);
+        fft(work.data(), spectrum.data());
+        EPSFBuilderParallelFor(size_type(n) * n, [&](size_type begin, size_type end, int)
+        {
+            for (size_type i = begin; i < end; i++)
+            {
+                double blurred = work[i] * scale;
+                work[i] = (blurred > epsilon) ? data[i] / blurred : 0.0;
+            }
+        }, 65536);
+
+        // The ratio correlated with the ePSF, the adjoint of the blur, corrects the estimate
+        fft(spectrum.data(), work.data());
+        EPSFBuilderParallelFor(spectrum.size(), [&](size_type begin, size_type end, int)
+        {
+            for (size_type i = begin; i < end; i++)
+                spectrum[i] *= ~m_otf[i];
+        }, 65536);
+        fft(work.data(), spectrum.data());
+        EPSFBuilderParallelFor(size_type(n), [&](size_type begin, size_type end, int t)
+        {
+            change[t] = total[t] = 0;
+            for (size_type y = begin; y < end; y++)
+            {
+                const bool inCore = int(y) >= margin && int(y) < margin + coreHeight;
+                for (int x = 0; x < n; x++)
+                {
+                    size_type i = y * n + x;
+                    double v = u[i] * Max(0.0, work[i] * scale);
+                    if (inCore && x >= margin && x < margin + coreWidth)
+                    {
+                        change[t] += Abs(v - u[i]);
+                        total[t] += u[i];
+                    }
+                    u[i] = v;
+                }
+            }
+        }, 16);
+
+        if (m_tolerance > 0)
+        {
+            double sumChange = 0, sumTotal = 0;
+            for (int t = 0; t < threads; t++)
+            {
+                sumChange += change[t];
+                sumTotal += total[t];
+            }
+            if (sumTotal <= 0 || sumChange < m_tolerance * sumTotal)
+                break;
+        }
+    }
+    return iteration;
+}
+
+void EPSFBuilderDeconvolution::Plan(int n)
+{
+    if (n == m_n)
+        return;
+
+    m_fft = new DRealFFT2D(n, n);
+#ifdef __EPSFBUILDER_STANDALONE
+    m_fft->DisableParallelProcessing();
+#endif
+    m_n = n;
+    m_otfCell = -1;
+}
+
+// Transform of the ePSF of a grid cell, centered at the origin of a tile with wraparound
+void EPSFBuilderDeconvolution::TransferFunction(int cell)
+{
+    if (cell == m_otfCell)
+        return;
+
+    const int n = m_n;
+    const int center = (m_size - 1) / 2;
+    const std::vector<double>& psf = m_psf[cell];
+    std::vector<double> tile(size_type(n) * n, 0.0);
+    for (int y = 0; y < m_size; y++)
+        for (int x = 0; x < m_size; x++)
+            tile[size_type((y - center + n) % n) * n + (x - center + n) % n] = psf[size_type(y) * m_size + x];
+    m_otf.resize(size_type(n) * (n / 2 + 1));
+    (*m_fft)(m_otf.data(), tile.data());
+    m_otfCell = cell;
+}
+
+}	// namespace pcl
\ No newline at end of file
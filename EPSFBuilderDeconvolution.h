@@ -0,0 +1,102 @@
+#ifndef __EPSFBuilderDeconvolution_h
+#define __EPSFBuilderDeconvolution_h
+
+#include <vector>
+#include <pcl/AutoPointer.h>
+#include <pcl/FFT2D.h>
+#include <pcl/ImageVariant.h>
+
+namespace pcl
+{
+
+// Richardson-Lucy deconvolution with a finished ePSF, by FFT convolution. The image is processed in
+// square tiles whose side is a power of two, at most MaxTileSize, so that every convolution of an
+// execution is a pair of transforms of one size: the PCL real 2-D FFT of that size is created once
+// and reused by every tile and iteration, and so is the transfer function of an ePSF while
+// consecutive tiles share it. The transforms run in parallel through PCL, except in standalone
+// builds, where PCL threads are not available; the pointwise steps of an iteration are processed in
+// parallel in both.
+//
+// Tiles overlap by a margin of one ePSF side, filled by mirroring the image at its edges, so the
+// wraparound of the circular convolution stays out of the core of a tile, the part written back.
+// Every tile stops iterating when the relative change of its core in an iteration falls below the
+// tolerance. With a PSF grid, every tile is deconvolved with the ePSF of the grid cell holding its
+// center.
+
+class EPSFBuilderDeconvolution
+{
+public:
+    enum { MaxTileSize = 512 };
+
+    // Every tile runs at most iterations iterations; a tolerance of zero disables early stopping
+    EPSFBuilderDeconvolution(int iterations, double tolerance);
+
+    // psf holds columns x rows ePSFs of size x size samples, tiled row by row as in the PSF grid
+    // image, for a grid of as many cells over the image; a single ePSF is a 1x1 grid. Every ePSF is
+    // normalized to unit flux here.
+    void SetPSF(const std::vector<double>& psf, int size, int columns = 1, int rows = 1);
+
+    // Deconvolves channel c of image in place, a real floating point image. The result is truncated
+    // to [0,1].
+    void Deconvolve(ImageVariant& image, int c = 0);
+
+    // Side of the tiles of the last Deconvolve(), including their margins
+    int TileSize() const
+    {
+        return m_n;
+    }
+
+    // Totals of all the calls to Deconvolve()
+    int Tiles() const
+    {
+        return m_tiles;
+    }
+
+    int Iterations() const
+    {
+        return m_iterationsDone;
+    }
+
+    // Tiles that stopped before the maximum number of iterations
+    int Converged() const
+    {
+        return m_converged;
+    }
+
+private:
+    typedef DRealFFT2D::complex complex;
+
+    int m_maxIterations;
+    double m_tolerance;
+    int m_size = 0;
+    int m_columns = 1;
+    int m_rows = 1;
+    std::vector<std::vector<double>> m_psf;     // one unit flux ePSF per grid cell
+
+    // Transform of m_n x m_n tiles
+    int m_n = 0;
+    AutoPointer<DRealFFT2D> m_fft;
+
+    // Transfer function of the ePSF of grid cell m_otfCell, a half spectrum of m_n rows and
+    // m_n/2 + 1 columns
+    int m_otfCell = -1;
+    std::vector<complex> m_otf;
+
+    int m_tiles = 0;
+    int m_iterationsDone = 0;
+    int m_converged = 0;
+
+    void Plan(int n);
+    void TransferFunction(int cell);
+    // Runs the iterations on a tile of observed data, writing the estimate to u; returns the number of
+    // iterations run. The core starts at (margin, margin) and has the given size. work and spectrum
+    // hold a tile and its half spectrum.
+    int DeconvolveTile(const std::vector<double>& data, std::vector<double>& u, std::vector<double>& work, std::vector<complex>& spectrum, int margin, int coreWidth, int coreHeight) const;
+
+    template <class P>
+    void DeconvolveImage(GenericImage<P>& image, int c);
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderDeconvolution_h
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "EPSFBuilderDetectionCache.h"
+
+namespace pcl
+{
+
+EPSFBuilderDetectionCache& EPSFBuilderDetectionCache::Instance()
+{
+    static EPSFBuilderDetectionCache s_cache;
+    return s_cache;
+}
+
+bool EPSFBuilderDetectionCache::Find(uint64 key, ImageVariant& starImage, EPSFBuilderExtraction& extraction)
+{
+    for (auto i = m_entries.begin(); i != m_entries.end(); ++i)
+        if (i->key == key)
+        {
+            m_entries.splice(m_entries.begin(), m_entries, i);
+            const Entry& entry = m_entries.front();
+            starImage.CopyImage(entry.starImage);
+            starImage.EnsureUniqueImage();
+            extraction = entry.extraction;
+            return true;
+        }
+    return false;
+}
+
+void EPSFBuilderDetectionCache::Store(uint64 key, const ImageVariant& starImage, const EPSFBuilderExtraction& extraction, size_type capacity)
+{
+    size_type bytes = starImage.NumberOfPixels() * starImage.NumberOfChannels() * starImage.BytesPerSample()
+        + (extraction.starData.size() + extraction.starMeta.size() + extraction.epsfData.size()) * sizeof(double);
+    if (bytes > capacity)
+    {
+        Evict(capacity);
+        return;
+    }
+
+    for (auto i = m_entries.begin(); i != m_entries.end(); ++i)
+        if (i->key == key)
+        {
+            m_size -= i->bytes;
+            m_entries.erase(i);
+            break;
+        }
+
+    Evict(capacity - bytes);
+
+    m_entries.emplace_front();
+    Entry& entry = m_entries.front();
+    entry.key = key;
+    entry.starImage.CopyImage(starImage);
+    entry.starImage.EnsureUniqueImage();
+    entry.starImage.SetStatusCallback(nullptr);
+    entry.extraction = extraction;
+    entry.bytes = bytes;
+    m_size += bytes;
+}
+
+void EPSFBuilderDetectionCache::Evict(size_type capacity)
+{
+    while (!m_entries.empty() && m_size > capacity)
+    {
+        m_size -= m_entries.back().bytes;
+        m_entries.pop_back();
+    }
+}
+
+}	// namespace pcl
\ No newline at end of file
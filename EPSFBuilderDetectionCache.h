@@ -0,0 +1,58 @@
+#ifndef __EPSFBuilderDetectionCache_h
+#define __EPSFBuilderDetectionCache_h
+
+#include <list>
+#include <pcl/ImageVariant.h>
+
+#include "EPSFBuilderPython.h"
+
+namespace pcl
+{
+
+// In-memory cache of the results of Steps 1 to 6, the background-subtracted image and the extracted
+// stars, keyed by a hash of the source pixels and of the parameters these steps depend on. Entries
+// are evicted in least recently used order to keep the cache within its capacity. The cache lives
+// as long as the module and must only be used from the main thread.
+
+class EPSFBuilderDetectionCache
+{
+public:
+    static EPSFBuilderDetectionCache& Instance();
+
+    // On a hit, starImage receives a private copy of the cached image
+    bool Find(uint64 key, ImageVariant& starImage, EPSFBuilderExtraction& extraction);
+
+    // Stores a copy of the results, evicting old entries to stay below capacity bytes. Results
+    // larger than the capacity are not stored.
+    void Store(uint64 key, const ImageVariant& starImage, const EPSFBuilderExtraction& extraction, size_type capacity);
+
+    size_type Size() const
+    {
+        return m_size;
+    }
+
+    size_type Length() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        uint64 key;
+        ImageVariant starImage;
+        EPSFBuilderExtraction extraction;
+        size_type bytes;
+    };
+
+    std::list<Entry> m_entries; // most recently used first
+    size_type m_size = 0;
+
+    EPSFBuilderDetectionCache() = default;
+
+    void Evict(size_type capacity);
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderDetectionCache_h
\ No newline at end of file
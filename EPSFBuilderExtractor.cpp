@@ -0,0 +1,84 @@
+#include <pcl/Math.h>
+
+#include "EPSFBuilderExtractor.h"
+#include "EPSFBuilderParallel.h"
+
+namespace pcl
+{
+
+EPSFBuilderExtractor::EPSFBuilderExtractor(int cutoutSize)
+    : m_cutoutSize(cutoutSize)
+{
+}
+
+void EPSFBuilderExtractor::Extract(const ImageVariant& image, const std::vector<double>& positions, int maxStars, EPSFBuilderStarArena& stars) const
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("Star extraction requires a real floating point image");
+
+    if (image.BitsPerSample() == 32)
+        ExtractImage(static_cast<const Image&>(*image), positions, maxStars, stars);
+    else
+        ExtractImage(static_cast<const DImage&>(*image), positions, maxStars, stars);
+
+    if (stars.IsEmpty())
+        throw Error("No isolated stars found");
+}
+
+void EPSFBuilderExtractor::Extract(const ImageVariant& image, const std::vector<double>& positions, int maxStars, EPSFBuilderExtraction& result) const
+{
+    EPSFBuilderStarArena stars;
+    Extract(image, positions, maxStars, stars);
+    result = EPSFBuilderExtraction();
+    stars.Export(result);
+}
+
+template <class P>
+void EPSFBuilderExtractor::ExtractImage(const GenericImage<P>& image, const std::vector<double>& positions, int maxStars, EPSFBuilderStarArena& stars) const
+{
+    const int size = m_cutoutSize;
+
+    // photutils overlap_slices: the cutout starts at ceil(center - size/2). Edge-clipped stars are
+    // skipped here, before any pixel is read, so the arena is allocated once.
+    std::vector<size_type> selected;
+    std::vector<int> x0, y0;
+    for (size_type i = 0; i + 1 < positions.size(); i += 2)
+    {
+        if (maxStars > 0 && int(selected.size()) == maxStars)
+            break;
+        int x = int(pcl::Ceil(positions[i] - 0.5 * size));
+        int y = int(pcl::Ceil(positions[i + 1] - 0.5 * size));
+        if (x < 0 || y < 0 || x + size > image.Width() || y + size > image.Height())
+            continue;
+        selected.push_back(i);
+        x0.push_back(x);
+        y0.push_back(y);
+    }
+
+    stars.Allocate(int(selected.size()), size, size);
+    EPSFBuilderParallelFor(selected.size(), [&](size_type begin, size_type end, int)
+    {
+        for (size_type k = begin; k < end; k++)
+        {
+            float* cutout = stars.Cutout(int(k));
+            double flux = 0;
+            for (int r = 0; r < size; r++)
+            {
+                const typename P::sample* row = image.PixelAddress(x0[k], y0[k] + r);
+                for (int c = 0; c < size; c++, cutout++)
+                {
+                    double v = double(row[c]);
+                    *cutout = float(v);
+                    flux += v;
+                }
+            }
+            stars.originX[k] = x0[k];
+            stars.originY[k] = y0[k];
+            stars.centerX[k] = positions[selected[k]];
+            stars.centerY[k] = positions[selected[k] + 1];
+            stars.flux[k] = flux;
+        }
+    }, 16);
+}
+
+}	// namespace pcl
\ No newline at end of file
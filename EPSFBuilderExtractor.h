@@ -0,0 +1,38 @@
+#ifndef __EPSFBuilderExtractor_h
+#define __EPSFBuilderExtractor_h
+
+#include <vector>
+#include <pcl/ImageVariant.h>
+
+#include "EPSFBuilderPython.h"
+#include "EPSFBuilderStarArena.h"
+
+namespace pcl
+{
+
+// Native implementation of photutils extract_stars, for runs that do not use Python. The cutout of
+// each star is placed as extract_stars places it, stars whose cutout does not lie entirely within
+// the image are skipped, and the flux is the sum of the cutout pixels. The stars are selected first,
+// from their positions only, then copied into a star arena in parallel.
+
+class EPSFBuilderExtractor
+{
+public:
+    EPSFBuilderExtractor(int cutoutSize);
+
+    // positions holds x, y pairs; at most maxStars stars are extracted if maxStars > 0
+    void Extract(const ImageVariant& image, const std::vector<double>& positions, int maxStars, EPSFBuilderStarArena& stars) const;
+
+    // The same, in the layout of the extraction done by the Python stages
+    void Extract(const ImageVariant& image, const std::vector<double>& positions, int maxStars, EPSFBuilderExtraction& result) const;
+
+private:
+    int m_cutoutSize;
+
+    template <class P>
+    void ExtractImage(const GenericImage<P>& image, const std::vector<double>& positions, int maxStars, EPSFBuilderStarArena& stars) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderExtractor_h
\ No newline at end of file
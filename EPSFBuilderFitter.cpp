@@ -0,0 +1,442 @@
+#include <pcl/Math.h>
+
+#include "EPSFBuilderFitter.h"
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderParameters.h"
+
+namespace pcl
+{
+
+// Same smoothing kernels as photutils EPSFBuilder
+static const double QuarticKernel[25] = {
+    +0.041632, -0.080816, +0.078368, -0.080816, +0.041632,
+    -0.080816, -0.019592, +0.200816, -0.019592, -0.080816,
+    +0.078368, +0.200816, +0.441632, +0.200816, +0.078368,
+    -0.080816, -0.019592, +0.200816, -0.019592, -0.080816,
+    +0.041632, -0.080816, +0.078368, -0.080816, +0.041632,
+};
+
+static const double QuadraticKernel[25] = {
+    -0.07428311, +0.01142786, +0.03999952, +0.01142786, -0.07428311,
+    +0.01142786, +0.09714283, +0.12571449, +0.09714283, +0.01142786,
+    +0.03999952, +0.12571449, +0.15428215, +0.12571449, +0.03999952,
+    +0.01142786, +0.09714283, +0.12571449, +0.09714283, +0.01142786,
+    -0.07428311, +0.01142786, +0.03999952, +0.01142786, -0.07428311,
+};
+
+static const double CenterAccuracy = 1.0e-3;
+static const int RecenteringBoxSize = 5;
+static const int RecenteringMaxIterations = 20;
+static const int FitBoxSize = 5;
+static const int FitMaxIterations = 50;
+static const double ClipSigma = 3.0;
+
+EPSFBuilderFitter::EPSFBuilderFitter(int oversampling, pcl_enum smoothingKernel, int maxIterations)
+    : m_oversampling(oversampling)
+    , m_smoothingKernel(smoothingKernel)
+    , m_maxIterations(maxIterations)
+{
+}
+
+std::vector<EPSFBuilderFitter::Star> EPSFBuilderFitter::Stars(const EPSFBuilderStarArena& arena)
+{
+    std::vector<Star> stars(arena.Count());
+    for (int i = 0; i < arena.Count(); i++)
+    {
+        Star& star = stars[i];
+        star.data = arena.Cutout(i);
+        star.width = arena.Width();
+        star.height = arena.Height();
+        star.x = arena.centerX[i] - arena.originX[i];
+        star.y = arena.centerY[i] - arena.originY[i];
+        star.flux = arena.flux[i];
+    }
+    return stars;
+}
+
+// A single chunk makes EPSFBuilderParallelFor run the body on the calling thread
+size_type EPSFBuilderFitter::OverheadLimit(size_type count) const
+{
+    return m_parallel ? 1 : Max(count, size_type(1));
+}
+
+static inline double CubicWeight(double t)
+{
+    t = Abs(t);
+    if (t < 1)
+        return (1.5 * t - 2.5) * t * t + 1;
+    if (t < 2)
+        return ((-0.5 * t + 2.5) * t - 4) * t + 2;
+    return 0;
+}
+
+double EPSFBuilderFitter::Interpolate(const std::vector<double>& grid, int size, double x, double y)
+{
+    int ix = int(Floor(x));
+    int iy = int(Floor(y));
+    if (ix < -2 || iy < -2 || ix > size || iy > size)
+        return 0;
+
+    double fx = x - ix;
+    double fy = y - iy;
+    double wx[4], wy[4];
+    for (int k = 0; k < 4; k++)
+    {
+        wx[k] = CubicWeight(fx - (k - 1));
+        wy[k] = CubicWeight(fy - (k - 1));
+    }
+
+    double v = 0;
+    for (int l = 0; l < 4; l++)
+    {
+        int py = iy + l - 1;
+        if (py < 0 || py >= size)
+            continue;
+        const double* row = grid.data() + size_type(py) * size;
+        double r = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            int px = ix + k - 1;
+            if (px >= 0 && px < size)
+                r += wx[k] * row[px];
+        }
+        v += wy[l] * r;
+    }
+    return v;
+}
+
+void EPSFBuilderFitter::AccumulateResiduals(const std::vector<Star>& stars, std::vector<double>& residuals)
+{
+    // Each thread accumulates onto its own partial grids, which are reduced at the end. The
+    // combination is a two-pass sigma-clipped mean, standing in for photutils' sigma-clipped median.
+    const size_type n = size_type(m_size) * m_size;
+    const double c = (m_size - 1) / 2.0;
+    const size_type overheadLimit = OverheadLimit(stars.size());
+    const int numberOfThreads = int(m_sum.size());
+
+    std::vector<double>& mean = residuals;
+    mean.assign(n, 0.0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int t = 0; t < numberOfThreads; t++)
+        {
+            std::fill(m_sum[t].begin(), m_sum[t].end(), 0.0);
+            std::fill(m_sum2[t].begin(), m_sum2[t].end(), 0.0);
+            std::fill(m_count[t].begin(), m_count[t].end(), uint32(0));
+        }
+
+        EPSFBuilderParallelFor(stars.size(), [&](size_type begin, size_type end, int thread)
+        {
+            double* s = m_sum[thread].data();
+            double* s2 = m_sum2[thread].data();
+            uint32* k = m_count[thread].data();
+            for (size_type i = begin; i < end; i++)
+            {
+                const Star& star = stars[i];
+                if (!(star.flux > 0))
+                    continue;
+                for (int y = 0; y < star.height; y++)
+                    for (int x = 0; x < star.width; x++)
+                    {
+                        double v = star.data[size_type(y) * star.width + x];
+                        if (!IsFinite(v))
+                            continue;
+                        double gx = m_oversampling * (x - star.x) + c;
+                        double gy = m_oversampling * (y - star.y) + c;
+                        int ix = int(Floor(gx + 0.5));
+                        int iy = int(Floor(gy + 0.5));
+                        if (ix < 0 || ix >= m_size || iy < 0 || iy >= m_size)
+                            continue;
+                        double r = v / star.flux - Interpolate(m_epsf, m_size, gx, gy);
+                        size_type j = size_type(iy) * m_size + ix;
+                        if (pass > 0 && Abs(r - mean[j]) > ClipSigma * m_sigma[j])
+                            continue;
+                        s[j] += r;
+                        s2[j] += r * r;
+                        k[j]++;
+                    }
+            }
+        }, overheadLimit);
+
+        std::vector<double>& sum = m_sum[0];
+        std::vector<double>& sum2 = m_sum2[0];
+        std::vector<uint32>& count = m_count[0];
+        for (int t = 1; t < numberOfThreads; t++)
+            for (size_type j = 0; j < n; j++)
+            {
+                sum[j] += m_sum[t][j];
+                sum2[j] += m_sum2[t][j];
+                count[j] += m_count[t][j];
+            }
+
+        for (size_type j = 0; j < n; j++)
+        {
+            uint32 m = count[j];
+            if (m == 0)
+            {
+                mean[j] = 0;
+                m_sigma[j] = 0;
+                continue;
+            }
+            mean[j] = sum[j] / m;
+            m_sigma[j] = pcl::Sqrt(Max(0.0, sum2[j] / m - mean[j] * mean[j]));
+        }
+    }
+}
+
+void EPSFBuilderFitter::Smooth()
+{
+    const double* kernel = (m_smoothingKernel == EPSFBuilderSmoothingKernel::Quartic) ? QuarticKernel : QuadraticKernel;
+    std::vector<double> smoothed(m_epsf.size(), 0.0);
+    for (int y = 0; y < m_size; y++)
+        for (int x = 0; x < m_size; x++)
+        {
+            double v = 0;
+            for (int ky = -2; ky <= 2; ky++)
+            {
+                int sy = y + ky;
+                if (sy < 0 || sy >= m_size)
+                    continue;
+                for (int kx = -2; kx <= 2; kx++)
+                {
+                    int sx = x + kx;
+                    if (sx >= 0 && sx < m_size)
+                        v += kernel[(ky + 2) * 5 + kx + 2] * m_epsf[size_type(sy) * m_size + sx];
+                }
+            }
+            smoothed[size_type(y) * m_size + x] = v;
+        }
+    m_epsf.swap(smoothed);
+}
+
+void EPSFBuilderFitter::Normalize()
+{
+    // Unit flux when sampled at the native (not oversampled) pixel scale
+    double sum = 0;
+    for (double v : m_epsf)
+        sum += v;
+    if (sum == 0)
+        return;
+    double k = double(m_oversampling) * m_oversampling / sum;
+    for (double& v : m_epsf)
+        v *= k;
+}
+
+void EPSFBuilderFitter::Recenter()
+{
+    // Move the centroid of the central box to the grid center. The shift is accumulated and the
+    // original data are resampled every iteration to avoid compounding interpolation errors.
+    const std::vector<double> original = m_epsf;
+    const int c = (m_size - 1) / 2;
+    const int h = RecenteringBoxSize / 2;
+    double dxTotal = 0, dyTotal = 0;
+    for (int iteration = 0; iteration < RecenteringMaxIterations; iteration++)
+    {
+        double sx = 0, sy = 0, s = 0;
+        for (int y = Max(0, c - h); y <= Min(m_size - 1, c + h); y++)
+            for (int x = Max(0, c - h); x <= Min(m_size - 1, c + h); x++)
+            {
+                double v = m_epsf[size_type(y) * m_size + x];
+                sx += v * x;
+                sy += v * y;
+                s += v;
+            }
+        if (s == 0)
+            break;
+
+        double dx = sx / s - c;
+        double dy = sy / s - c;
+        if (Abs(dx) < CenterAccuracy && Abs(dy) < CenterAccuracy)
+            break;
+
+        dxTotal += dx;
+        dyTotal += dy;
+        for (int y = 0; y < m_size; y++)
+            for (int x = 0; x < m_size; x++)
+                m_epsf[size_type(y) * m_size + x] = Interpolate(original, m_size, x + dxTotal, y + dyTotal);
+    }
+}
+
+static bool Solve3(double A[3][3], double b[3], double x[3])
+{
+    double det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1])
+               - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+               + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+    if (Abs(det) < 1.0e-300)
+        return false;
+    for (int i = 0; i < 3; i++)
+    {
+        double M[3][3];
+        for (int r = 0; r < 3; r++)
+            for (int k = 0; k < 3; k++)
+                M[r][k] = (k == i) ? b[r] : A[r][k];
+        x[i] = (M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+              - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+              + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0])) / det;
+    }
+    return true;
+}
+
+bool EPSFBuilderFitter::FitBox(const std::vector<double>& grid, int size, int oversampling, const double* box, int width, int height, double p[3])
+{
+    const double c = (size - 1) / 2.0;
+    const double os = oversampling;
+    const double h = 0.05;
+
+    auto chi2 = [&](const double* q)
+    {
+        double s = 0;
+        for (int y = 0, k = 0; y < height; y++)
+            for (int x = 0; x < width; x++, k++)
+                if (IsFinite(box[k]))
+                {
+                    double r = box[k] - q[0] * Interpolate(grid, size, os * (x - q[1]) + c, os * (y - q[2]) + c);
+                    s += r * r;
+                }
+        return s;
+    };
+
+    double lambda = 1.0e-3;
+    double current = chi2(p);
+    for (int iteration = 0; iteration < FitMaxIterations; iteration++)
+    {
+        // Normal equations, with the derivatives of the ePSF by central differences
+        double A[3][3] = {};
+        double b[3] = {};
+        for (int y = 0, k = 0; y < height; y++)
+            for (int x = 0; x < width; x++, k++)
+            {
+                if (!IsFinite(box[k]))
+                    continue;
+                double gx = os * (x - p[1]) + c;
+                double gy = os * (y - p[2]) + c;
+                double e = Interpolate(grid, size, gx, gy);
+                double dex = (Interpolate(grid, size, gx + h, gy) - Interpolate(grid, size, gx - h, gy)) / (2 * h);
+                double dey = (Interpolate(grid, size, gx, gy + h) - Interpolate(grid, size, gx, gy - h)) / (2 * h);
+                double J[3] = { e, -p[0] * os * dex, -p[0] * os * dey };
+                double r = box[k] - p[0] * e;
+                for (int i = 0; i < 3; i++)
+                {
+                    b[i] += J[i] * r;
+                    for (int j = 0; j < 3; j++)
+                        A[i][j] += J[i] * J[j];
+                }
+            }
+
+        bool improved = false;
+        bool done = false;
+        for (int attempt = 0; attempt < 10 && !improved; attempt++)
+        {
+            double D[3][3];
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    D[i][j] = A[i][j] + ((i == j) ? lambda * A[i][i] : 0.0);
+            double step[3];
+            if (!Solve3(D, b, step))
+                return false;
+            double q[3] = { p[0] + step[0], p[1] + step[1], p[2] + step[2] };
+            double next = chi2(q);
+            if (next <= current)
+            {
+                done = Abs(step[1]) < 1.0e-6 && Abs(step[2]) < 1.0e-6;
+                p[0] = q[0];
+                p[1] = q[1];
+                p[2] = q[2];
+                current = next;
+                lambda *= 0.1;
+                improved = true;
+            }
+            else
+                lambda *= 10;
+        }
+        if (!improved || done)
+            break;
+    }
+    return true;
+}
+
+bool EPSFBuilderFitter::FitStar(Star& star) const
+{
+    // Flux and center over a small box around the star center
+    int x0 = Max(0, RoundInt(star.x) - FitBoxSize / 2);
+    int x1 = Min(star.width - 1, RoundInt(star.x) + FitBoxSize / 2);
+    int y0 = Max(0, RoundInt(star.y) - FitBoxSize / 2);
+    int y1 = Min(star.height - 1, RoundInt(star.y) + FitBoxSize / 2);
+    if (x1 - x0 < 2 || y1 - y0 < 2)
+        return false;
+
+    double box[FitBoxSize * FitBoxSize];
+    for (int y = y0, k = 0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++, k++)
+            box[k] = star.data[size_type(y) * star.width + x];
+
+    double p[3] = { star.flux, star.x - x0, star.y - y0 };
+    if (!FitBox(m_epsf, m_size, m_oversampling, box, x1 - x0 + 1, y1 - y0 + 1, p))
+        return false;
+    p[1] += x0;
+    p[2] += y0;
+
+    if (!IsFinite(p[0]) || !IsFinite(p[1]) || !IsFinite(p[2]) || p[0] <= 0)
+        return false;
+    if (p[1] < 0 || p[1] > star.width - 1 || p[2] < 0 || p[2] > star.height - 1)
+        return false;
+
+    star.flux = p[0];
+    star.x = p[1];
+    star.y = p[2];
+    return true;
+}
+
+void EPSFBuilderFitter::Build(std::vector<Star>& stars)
+{
+    if (stars.empty())
+        throw Error("No stars available to build the ePSF");
+
+    int maxShape = 0;
+    for (const Star& star : stars)
+        maxShape = Max(maxShape, Max(star.width, star.height));
+    m_size = int(Ceil(double(maxShape) * m_oversampling));
+    if ((m_size & 1) == 0)
+        m_size++;
+    m_epsf.assign(size_type(m_size) * m_size, 0.0);
+
+    const size_type n = m_epsf.size();
+    const int numberOfThreads = EPSFBuilderThreadCount(stars.size(), OverheadLimit(stars.size()));
+    m_sum.assign(numberOfThreads, std::vector<double>(n));
+    m_sum2.assign(numberOfThreads, std::vector<double>(n));
+    m_count.assign(numberOfThreads, std::vector<uint32>(n));
+    m_sigma.assign(n, 0.0);
+
+    std::vector<double> residuals;
+    double maxShift2 = CenterAccuracy * CenterAccuracy;
+    for (m_iterations = 0; m_iterations < m_maxIterations && maxShift2 >= CenterAccuracy * CenterAccuracy && !m_aborted; )
+    {
+        m_iterations++;
+
+        AccumulateResiduals(stars, residuals);
+        for (size_type i = 0; i < m_epsf.size(); i++)
+            m_epsf[i] += residuals[i];
+        Smooth();
+        Normalize();
+        Recenter();
+        Normalize();
+
+        std::vector<double> shift2(stars.size(), 0.0);
+        EPSFBuilderParallelFor(stars.size(), [&](size_type begin, size_type end, int)
+        {
+            for (size_type i = begin; i < end; i++)
+            {
+                double x = stars[i].x;
+                double y = stars[i].y;
+                if (FitStar(stars[i]))
+                    shift2[i] = (stars[i].x - x) * (stars[i].x - x) + (stars[i].y - y) * (stars[i].y - y);
+            }
+        }, OverheadLimit(stars.size()));
+
+        maxShift2 = 0;
+        for (double d : shift2)
+            maxShift2 = Max(maxShift2, d);
+    }
+}
+
+}	// namespace pcl
\ No newline at end of file
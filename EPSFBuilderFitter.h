@@ -0,0 +1,113 @@
+#ifndef __EPSFBuilderFitter_h
+#define __EPSFBuilderFitter_h
+
+#include <atomic>
+#include <vector>
+#include <pcl/Defs.h>
+
+#include "EPSFBuilderStarArena.h"
+
+namespace pcl
+{
+
+// Native implementation of the iterative ePSF building algorithm of photutils EPSFBuilder
+// (Anderson & King 2000): residuals of the normalized stars are accumulated onto the oversampled
+// grid, the grid is smoothed and recentered, then every star is refitted with the new ePSF.
+
+class EPSFBuilderFitter
+{
+public:
+    struct Star
+    {
+        const float* data;          // cutout pixels, row-major, in a star arena
+        int width;
+        int height;
+        double x;                   // star center in cutout pixel coordinates
+        double y;
+        double flux;
+    };
+
+    EPSFBuilderFitter(int oversampling, pcl_enum smoothingKernel, int maxIterations);
+
+    // The stars of an arena, reading its cutouts in place; the arena must outlive them
+    static std::vector<Star> Stars(const EPSFBuilderStarArena& arena);
+
+    // Builds the ePSF from the stars. The star centers and fluxes are refined in place.
+    void Build(std::vector<Star>& stars);
+
+    // With parallel processing disabled the fitter runs on the calling thread, for callers that
+    // already run several fitters in parallel.
+    void EnableParallelProcessing(bool enable = true)
+    {
+        m_parallel = enable;
+    }
+
+    void DisableParallelProcessing(bool disable = true)
+    {
+        EnableParallelProcessing(!disable);
+    }
+
+    // Makes a Build() running on another thread return at the end of its current iteration
+    void Abort()
+    {
+        m_aborted = true;
+    }
+
+    bool IsAborted() const
+    {
+        return m_aborted;
+    }
+
+    // Oversampled ePSF, Size()*Size() pixels with the center at ((Size()-1)/2, (Size()-1)/2)
+    const std::vector<double>& Data() const
+    {
+        return m_epsf;
+    }
+
+    int Size() const
+    {
+        return m_size;
+    }
+
+    int Iterations() const
+    {
+        return m_iterations;
+    }
+
+    // Evaluates the ePSF at oversampled grid coordinates with bicubic interpolation
+    static double Interpolate(const std::vector<double>& grid, int size, double x, double y);
+
+    // Levenberg-Marquardt fit in flux and center of the ePSF grid, size*size samples at oversampling
+    // times the resolution of the box, scaled by the flux, to the finite pixels of box, width*height
+    // samples row by row. p holds the flux and the x, y center in box pixels to start from, and
+    // receives the fit, which is not checked. Returns false if the normal equations are singular.
+    static bool FitBox(const std::vector<double>& grid, int size, int oversampling, const double* box, int width, int height, double p[3]);
+
+private:
+    int m_oversampling;
+    pcl_enum m_smoothingKernel;
+    int m_maxIterations;
+    bool m_parallel = true;
+    std::atomic<bool> m_aborted{ false };
+    int m_size = 0;
+    int m_iterations = 0;
+    std::vector<double> m_epsf;
+
+    // Per-thread partial grids of AccumulateResiduals(), allocated once per Build() and zeroed
+    // before every pass, and the clipping sigma of the grid
+    std::vector<std::vector<double>> m_sum;
+    std::vector<std::vector<double>> m_sum2;
+    std::vector<std::vector<uint32>> m_count;
+    std::vector<double> m_sigma;
+
+    void AccumulateResiduals(const std::vector<Star>& stars, std::vector<double>& residuals);
+    void Smooth();
+    void Normalize();
+    void Recenter();
+    size_type OverheadLimit(size_type count) const;
+    bool FitStar(Star& star) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderFitter_h
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "EPSFBuilderFitter.h"
+#include "EPSFBuilderGrid.h"
+#include "EPSFBuilderParallel.h"
+
+namespace pcl
+{
+
+EPSFBuilderGrid::EPSFBuilderGrid(int columns, int rows, double overlap, int oversampling, pcl_enum smoothingKernel, int maxIterations)
+    : m_columns(columns)
+    , m_rows(rows)
+    , m_overlap(overlap)
+    , m_oversampling(oversampling)
+    , m_smoothingKernel(smoothingKernel)
+    , m_maxIterations(maxIterations)
+{
+}
+
+std::vector<EPSFBuilderGrid::Cell> EPSFBuilderGrid::Build(const EPSFBuilderStarArena& arena, int width, int height) const
+{
+    const int MinimumCellStars = 5;
+    const int cellCount = m_columns * m_rows;
+    const double cellWidth = double(width) / m_columns;
+    const double cellHeight = double(height) / m_rows;
+
+    // The cells share the cutouts of the arena, only the star descriptors are copied
+    const std::vector<EPSFBuilderFitter::Star> allStars = EPSFBuilderFitter::Stars(arena);
+    std::vector<std::vector<EPSFBuilderFitter::Star>> cellStars(cellCount);
+    for (int r = 0; r < m_rows; r++)
+        for (int c = 0; c < m_columns; c++)
+        {
+            std::vector<EPSFBuilderFitter::Star>& stars = cellStars[r * m_columns + c];
+
+            // Sparse cells are enlarged until they have enough stars or cover the whole image
+            for (double margin = m_overlap;; margin += 0.5)
+            {
+                double x0 = (c - margin) * cellWidth;
+                double y0 = (r - margin) * cellHeight;
+                double x1 = (c + 1 + margin) * cellWidth;
+                double y1 = (r + 1 + margin) * cellHeight;
+                stars.clear();
+                for (int i = 0; i < arena.Count(); i++)
+                    if (arena.centerX[i] >= x0 && arena.centerX[i] < x1 && arena.centerY[i] >= y0 && arena.centerY[i] < y1)
+                        stars.push_back(allStars[i]);
+                if (int(stars.size()) >= MinimumCellStars || (x0 <= 0 && y0 <= 0 && x1 >= width && y1 >= height))
+                    break;
+            }
+
+            if (stars.empty())
+                throw Error(String().Format("No stars available for PSF grid cell %d,%d", c + 1, r + 1));
+        }
+
+    // Each fitter only runs its own threads when there are fewer cells than processors
+    const bool nested = cellCount < EPSFBuilderThreadCount(PCL_MAX_PROCESSORS);
+    std::vector<Cell> cells(cellCount);
+    EPSFBuilderParallelFor(size_type(cellCount), [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            EPSFBuilderFitter fitter(m_oversampling, m_smoothingKernel, m_maxIterations);
+            fitter.EnableParallelProcessing(nested);
+            fitter.Build(cellStars[i]);
+            cells[i].data = fitter.Data();
+            cells[i].size = fitter.Size();
+            cells[i].stars = int(cellStars[i].size());
+            cells[i].iterations = fitter.Iterations();
+        }
+    });
+
+    return cells;
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef __EPSFBuilderGrid_h
+#define __EPSFBuilderGrid_h
+
+#include <vector>
+#include <pcl/Defs.h>
+
+#include "EPSFBuilderStarArena.h"
+
+namespace pcl
+{
+
+// Spatially varying ePSF: one oversampled ePSF per cell of a columns x rows grid over the image. A
+// star is used by every cell whose area, enlarged by overlap cells on each side, contains its
+// center, so stars near a border are shared by the neighboring cells; sparse cells are enlarged
+// further until they have enough stars. All cells read the cutouts of a single star arena in place
+// and are fitted in parallel with the native engine.
+
+class EPSFBuilderGrid
+{
+public:
+    struct Cell
+    {
+        std::vector<double> data;   // oversampled ePSF, size*size pixels
+        int size = 0;
+        int stars = 0;
+        int iterations = 0;
+    };
+
+    EPSFBuilderGrid(int columns, int rows, double overlap, int oversampling, pcl_enum smoothingKernel, int maxIterations);
+
+    // Returns the cells row by row, for an image of the given dimensions
+    std::vector<Cell> Build(const EPSFBuilderStarArena& arena, int width, int height) const;
+
+private:
+    int m_columns;
+    int m_rows;
+    double m_overlap;
+    int m_oversampling;
+    pcl_enum m_smoothingKernel;
+    int m_maxIterations;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderGrid_h
\ No newline at end of file
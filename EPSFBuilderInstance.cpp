@@ -1,437 +1,1135 @@
-#include <Tchar.h>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <pcl/AtrousWaveletTransform.h>
-#include <pcl/AutoViewLock.h>
-#include <pcl/Console.h>
-#include <pcl/DisplayFunction.h>
-#include <pcl/FileFormat.h>
-#include <pcl/FileFormatInstance.h>
-#include <pcl/IntegerResample.h>
-#include <pcl/Settings.h>
-#include <pcl/StandardStatus.h>
-#include <pcl/View.h>
-
-#include "EPSFBuilderInstance.h"
-#include "EPSFBuilderParameters.h"
-
-namespace pcl
-{
-
-HMODULE EPSFBuilderInstance::m_hPythonDll = NULL;
-
-EPSFBuilderInstance::EPSFBuilderInstance(const MetaProcess* m)
-    : ProcessImplementation(m)
-    , maxStars(TheEPSFBuilderMaxStarsParameter->DefaultValue())
-    , starMaxPeak(TheEPSFBuilderStarMaxPeakParameter->DefaultValue())
-    , starThreshold(TheEPSFBuilderStarThresholdParameter->DefaultValue())
-    , starFWHM(TheEPSFBuilderStarFWHMParameter->DefaultValue())
-    , starSize(TheEPSFBuilderStarSizeParameter->DefaultValue())
-    , oversampling(TheEPSFBuilderOversamplingParameter->DefaultValue())
-    , smoothingKernel(static_cast<pcl_enum>(TheEPSFBuilderSmoothingKernelParameter->DefaultValueIndex()))
-    , maxIterations(TheEPSFBuilderMaxIterationsParameter->DefaultValue())
-{
-}
-
-EPSFBuilderInstance::EPSFBuilderInstance(const EPSFBuilderInstance& x)
-    : ProcessImplementation(x)
-{
-    Assign(x);
-}
-
-void EPSFBuilderInstance::Assign(const ProcessImplementation& p)
-{
-    const EPSFBuilderInstance* x = dynamic_cast<const EPSFBuilderInstance*>(&p);
-    if (x != nullptr) {
-        pythonDll = x->pythonDll;
-        maxStars = x->maxStars;
-        starMaxPeak = x->starMaxPeak;
-        starThreshold = x->starThreshold;
-        starFWHM = x->starFWHM;
-        starSize = x->starSize;
-        oversampling = x->oversampling;
-        smoothingKernel = x->smoothingKernel;
-        maxIterations = x->maxIterations;
-    }
-}
-
-bool EPSFBuilderInstance::IsHistoryUpdater(const View& view) const
-{
-    return false;
-}
-
-UndoFlags EPSFBuilderInstance::UndoMode(const View&) const
-{
-    return UndoFlag::PixelData;
-}
-
-bool EPSFBuilderInstance::CanExecuteOn(const View& view, pcl::String& whyNot) const
-{
-    if (view.Image().IsComplexSample())
-    {
-        whyNot = "ePSF Builder cannot be executed on complex images.";
-        return false;
-    }
-    else if (!view.Image().IsFloatSample())
-    {
-        whyNot = "ePSF Builder can only be executed on float images.";
-        return false;
-    }
-    else if (view.Image().NumberOfChannels() != 1)
-    {
-        whyNot = "ePSF Builder can only be executed on single channel images.";
-        return false;
-    }
-
-    return true;
-}
-
-bool EPSFBuilderInstance::ExecuteOn(View& view)
-{
-    AutoViewLock lock(view);
-
-    StandardStatus status;
-    Console console;
-
-    console.EnableAbort();
-
-    ImageVariant image = view.Image();
-
-    if (image.IsComplexSample() || !view.Image().IsFloatSample() || (view.Image().NumberOfChannels() != 1))
-        return false;
-
-    image.SetStatusCallback(&status);
-
-    StringList swapDirs = ImageWindow::SwapDirectories();
-    if (swapDirs.Length() < 1)
-        throw Error("Swap storage directories not set");
-
-    // Step 0: prepare Python environment
-    if (!m_hPythonDll)
-    {
-        m_hPythonDll = LoadLibrary((LPCWSTR)pythonDll.c_str());
-        if (!m_hPythonDll)
-            throw Error("Failed to load Python DLL: " + pythonDll);
-    }
-
-    typedef void(__cdecl* f_Py_Initialize)();
-    f_Py_Initialize Py_Initialize = loadPythonAPI<f_Py_Initialize>("Py_Initialize");
-    typedef int(__cdecl* f_Py_IsInitialized)();
-    f_Py_IsInitialized Py_IsInitialized = loadPythonAPI<f_Py_IsInitialized>("Py_IsInitialized");
-    typedef int(__cdecl* f_PyRun_SimpleString)(const char*);
-    f_PyRun_SimpleString PyRun_SimpleString = loadPythonAPI<f_PyRun_SimpleString>("PyRun_SimpleString");
-
-    String why = "";
-    if (!Py_IsInitialized())
-    {
-        Py_Initialize();
-        if (!Py_IsInitialized())
-            throw Error("Failed to initialize Python");
-    }
-
-#define RUN_PYTHON(x)                                                   \
-    {                                                                   \
-        if (PyRun_SimpleString(x) != 0)                                 \
-            throw Error("Error running python script: " + String(x));   \
-    }
-
-#define LOG_PYTHON_VAR(x)                                       \
-    {                                                           \
-        RUN_PYTHON("logFp = open('E:/log.txt', 'a')");          \
-        RUN_PYTHON("logFp.write(str(" ##x ") + '\\n')");        \
-        RUN_PYTHON("logFp.close()");                            \
-    }
-
-    RUN_PYTHON("from astropy.io import fits");
-    RUN_PYTHON("from astropy.nddata import NDData");
-    RUN_PYTHON("from astropy.table import Table");
-    RUN_PYTHON("from photutils.detection import DAOStarFinder");
-    RUN_PYTHON("from photutils.psf import EPSFBuilder");
-    RUN_PYTHON("from photutils.psf import EPSFStars");
-    RUN_PYTHON("from photutils.psf import extract_stars");
-    RUN_PYTHON("import numpy as np");
-
-    // Step 1: remove local background
-    ImageVariant starImage;
-    starImage.CopyImage(image);
-    starImage.EnsureUniqueImage();
-    starImage.SetStatusCallback(nullptr);
-    image.Status().Initialize("Removing background", 1);
-    static const float B3S_hv[] = { 0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f };
-    int layers = int(pcl::Log2<double>(starSize) + 2.5);
-    StarletTransform mt(SeparableFilter(B3S_hv, B3S_hv, 5), layers);
-    mt << starImage;
-    mt.DisableLayer(layers);
-    mt >> starImage;
-    starImage.Truncate(-0.001, 1.0);
-    starImage.Normalize();
-    image.Status() += 1;
-    image.Status().Complete();
-
-    // Step 2: write to temporary FITS file
-    String tmpImgFilename = swapDirs[0] + "/tmp.fits";
-    FileFormatInstance tmpFits(FileFormat(".fits", false, true));
-    if (!tmpFits.Create(tmpImgFilename, "verbosity 0"))
-        throw Error("Unable to write to swap storage");
-
-    ImageOptions imgOpt;
-    imgOpt.bitsPerSample = starImage.BitsPerSample();
-    imgOpt.ieeefpSampleFormat = starImage.IsFloatSample();
-    tmpFits.SetOptions(imgOpt);
-    if (!tmpFits.WriteImage(starImage))
-        throw Error("Unable to write to swap storage");
-    tmpFits.Close();
-
-    // Step 3: read FITS in Python
-    char cmd[256];
-    sprintf_s(cmd, sizeof(cmd), "hdul = fits.open('%s', memmap = False, lazy_load_hdus = False)", tmpImgFilename.ToUTF8().c_str());
-    RUN_PYTHON(cmd);
-    RUN_PYTHON("data = hdul[0].data");
-    RUN_PYTHON("hdul.close()");
-
-    // Step 4: star detection
-    image.Status().Initialize("Running star detection", 1);
-    sprintf_s(cmd, sizeof(cmd), "daofind = DAOStarFinder(fwhm = %lf, threshold = %lf, peakmax = %lf, brightest = %d)", starFWHM, starThreshold, starMaxPeak, maxStars * 3);
-    RUN_PYTHON(cmd);
-    RUN_PYTHON("sources = daofind(data)");
-    RUN_PYTHON("starpos = np.transpose((sources['xcentroid'], sources['ycentroid']))");
-    image.Status() += 1;
-    image.Status().Complete();
-
-    // Step 5: star extraction
-    image.Status().Initialize("Extracting stars", 3);
-    RUN_PYTHON("stars_tbl = Table()");
-    RUN_PYTHON("stars_tbl['x'] = starpos[:, 0]");
-    RUN_PYTHON("stars_tbl['y'] = starpos[:, 1]");
-    RUN_PYTHON("nddata = NDData(data = data)");
-    sprintf_s(cmd, sizeof(cmd), "stars = extract_stars(nddata, stars_tbl, size = %d)", (int)(starSize * 1.5));
-    RUN_PYTHON(cmd);
-    image.Status() += 1;
-
-    // Step 6: filter stars
-    RUN_PYTHON("good_stars = []");
-    sprintf_s(cmd, sizeof(cmd), "daofind = DAOStarFinder(fwhm = %lf, threshold = %lf, brightest = 2)", starFWHM, starThreshold);
-    RUN_PYTHON(cmd);
-    RUN_PYTHON("for i in range(stars.n_stars):\n"
-               "    star = stars.all_stars[i]\n"
-               "    sources = daofind(star.data)\n"
-               "    if not (sources is None) and (sources['id'].size == 1):\n"
-               "        good_stars.append(star)\n");
-    RUN_PYTHON("stars = EPSFStars(good_stars)");
-    image.Status() += 1;
-
-    sprintf_s(cmd, sizeof(cmd), "n_stars = min(stars.n_stars, %d)", maxStars);
-    RUN_PYTHON(cmd);
-    sprintf_s(cmd, sizeof(cmd), "starPath = '%s'", swapDirs[0].ToUTF8().c_str());
-    RUN_PYTHON(cmd);
-    RUN_PYTHON("fp = open(starPath + '/stars.txt', 'w')");
-    RUN_PYTHON("for i in range(n_stars):\n"
-               "    star = stars.all_stars[i]\n"
-               "    hdu = fits.PrimaryHDU(star.data)\n"
-               "    hdu.writeto(starPath + '/star' + str(i) + '.fits', overwrite = True)\n"
-               "    fp.write(str(star.origin[0]) + ' ' + str(star.origin[1]) + ' ' + str(star.center[0]) + ' ' + str(star.center[1]) + ' ' + str(star.flux) + '\\n')");
-    RUN_PYTHON("fp.close()");
-    image.Status() += 1;
-    image.Status().Complete();
-
-    // Step 7: generate ePSF
-    image.Status().Initialize("Building ePSF", 1);
-    const char* smoothingKernelName[] = {
-        "quartic",
-        "quadratic",
-    };
-    sprintf_s(cmd, sizeof(cmd), "epsf_builder = EPSFBuilder(oversampling = %d, maxiters = %d, smoothing_kernel = '%s')", oversampling, maxIterations, smoothingKernelName[smoothingKernel]);
-    RUN_PYTHON(cmd);
-    RUN_PYTHON("epsf, fitted_stars = epsf_builder(stars)");
-    image.Status() += 1;
-    image.Status().Complete();
-
-    // Step 8: write ePSF to FITS
-    RUN_PYTHON("hdu = fits.PrimaryHDU(epsf.data)");
-    String ePSFFilename = swapDirs[0] + "/epsf.fits";
-    sprintf_s(cmd, sizeof(cmd), "hdu.writeto('%s', overwrite = True)", ePSFFilename.ToUTF8().c_str());
-    RUN_PYTHON(cmd);
-
-    // Step 9: read ePSF and stars
-    std::ifstream infile((swapDirs[0] + "/stars.txt").ToUTF8().c_str());
-    if (!infile.is_open())
-        throw Error("Cannot get star information");
-    std::string line;
-    struct Star
-    {
-        double origin[2];
-        double center[2];
-        double flux;
-        ImageVariant image;
-    };
-    std::vector<struct Star> stars;
-    FileFormatInstance starFits(FileFormat(".fits", true, false));
-    ImageDescriptionArray ida;
-    int starCount = 0;
-    while (std::getline(infile, line))
-    {
-        std::istringstream iss(line);
-        Star star;
-        if (!(iss >> star.origin[0] >> star.origin[1] >> star.center[0] >> star.center[1] >> star.flux))
-            throw Error("Error getting star information");
-        String starFilename = swapDirs[0] + "/star" + String(starCount) + ".fits";
-        star.image.CreateImageAs(image);
-        if (!starFits.Open(ida, starFilename, "verbosity 0") || !starFits.ReadImage(star.image))
-        {
-            infile.close();
-            throw Error("Error getting image of extracted stars");
-        }
-        starFits.Close();
-        int x0 = (star.image.Width() - starSize) / 2;
-        int y0 = (star.image.Height() - starSize) / 2;
-        star.image.CropTo(x0, y0, x0 + starSize, y0 + starSize);
-        stars.push_back(star);
-        starCount++;
-    }
-    infile.close();
-
-    ImageVariant epsfImage;
-    epsfImage.CreateImageAs(image);
-    String epsfFilename = swapDirs[0] + "/epsf.fits";
-    if (!starFits.Open(ida, epsfFilename, "verbosity 0") || !starFits.ReadImage(epsfImage))
-        throw Error("Error getting image of ePSF");
-    starFits.Close();
-
-    // Crop, downscale and normalize
-    int sz = starSize * oversampling;
-    int x0 = (epsfImage.Width() - sz) / 2;
-    int y0 = (epsfImage.Height() - sz) / 2;
-    epsfImage.CropTo(x0, y0, x0 + sz, y0 + sz);
-    IntegerResample ir(-oversampling);
-    ir >> epsfImage;
-    epsfImage.Subtract(epsfImage.MinimumSampleValue());
-    epsfImage.Divide(epsfImage.MaximumSampleValue());
-
-    // Create window for star detection
-    ImageVariant starDetImage;
-    starDetImage.CopyImage(image);
-    starDetImage.EnsureUniqueImage();
-    starDetImage.SetStatusCallback(nullptr);
-    for (int i = 0; i < starCount; i++)
-    {
-        // Draw detection box
-        int cx = stars[i].center[0];
-        int cy = stars[i].center[1];
-        int x0 = cx - starSize / 2;
-        int y0 = cy - starSize / 2;
-        for (int x = x0; x < x0 + starSize; x++)
-        {
-            if (starDetImage.BitsPerSample() == 32)
-            {
-                (static_cast<Image&>(*starDetImage))(x, y0) = 1;
-                (static_cast<Image&>(*starDetImage))(x, y0 + starSize) = 1;
-            }
-            else if (starDetImage.BitsPerSample() == 64)
-            {
-                (static_cast<DImage&>(*starDetImage))(x, y0) = 1;
-                (static_cast<DImage&>(*starDetImage))(x, y0 + starSize) = 1;
-            }
-        }
-        for (int y = y0; y < y0 + starSize; y++)
-        {
-            if (starDetImage.BitsPerSample() == 32)
-            {
-                (static_cast<Image&>(*starDetImage))(x0, y) = 1;
-                (static_cast<Image&>(*starDetImage))(x0 + starSize, y) = 1;
-            }
-            else if (starDetImage.BitsPerSample() == 64)
-            {
-                (static_cast<DImage&>(*starDetImage))(x0, y) = 1;
-                (static_cast<DImage&>(*starDetImage))(x0 + starSize, y) = 1;
-            }
-        }
-    }
-    IsoString id = view.FullId() + "_star_detection";
-    ImageWindow starDetWindow = ImageWindow(starDetImage.Width(), starDetImage.Height(), starDetImage.NumberOfChannels(), starDetImage.BitsPerSample(), starDetImage.IsFloatSample(), starDetImage.IsColor(), true, id);
-    if (starDetWindow.IsNull())
-        throw Error("Unable to create image window: " + id);
-    starDetWindow.MainView().Lock();
-    starDetWindow.MainView().Image().CopyImage(starDetImage);
-    starDetWindow.MainView().Unlock();
-    Vector center(1);
-    Vector sigma(1);
-    sigma[0] = 1.4826 * starDetImage.MAD(center[0] = starDetImage.Median());
-    DisplayFunction DF;
-    DF.SetLinkedRGB();
-    DF.ComputeAutoStretch(sigma, center);
-    starDetWindow.MainView().SetScreenTransferFunctions(DF.HistogramTransformations());
-    starDetWindow.Show();
-
-    // Create window for extracted stars
-    int ncols = pcl::Sqrt(starCount);
-    if (ncols < 2)
-        ncols = 2;
-    int nrows = (starCount + ncols - 1) / ncols;
-    ImageVariant starListImage;
-    starListImage.CreateImageAs(image);
-    starListImage.SetStatusCallback(nullptr);
-    starListImage.AllocateImage(ncols * starSize, nrows * starSize, image.NumberOfChannels(), image.ColorSpace());
-    starListImage.Fill(0.0);
-    for (int i = 0; i < starCount; i++)
-    {
-        int r = i / ncols;
-        int c = i % ncols;
-        int x0 = c * starSize;
-        int y0 = r * starSize;
-        for (int y = 0; y < starSize; y++)
-            for (int x = 0; x < starSize; x++)
-                if (starListImage.BitsPerSample() == 32)
-                    (static_cast<Image&>(*starListImage))(x0 + x, y0 + y) = stars[i].image(x, y);
-                else if (starListImage.BitsPerSample() == 64)
-                    (static_cast<DImage&>(*starListImage))(x0 + x, y0 + y) = stars[i].image(x, y);
-    }
-  
-    id = view.FullId() + "_extracted_stars";
-    ImageWindow starListWindow = ImageWindow(starListImage.Width(), starListImage.Height(), starListImage.NumberOfChannels(), starListImage.BitsPerSample(), starListImage.IsFloatSample(), starListImage.IsColor(), true, id);
-    if (starListWindow.IsNull())
-        throw Error("Unable to create image window: " + id);
-    starListWindow.MainView().Lock();
-    starListWindow.MainView().Image().CopyImage(starListImage);
-    starListWindow.MainView().Unlock();
-    sigma[0] = 1.4826 * starListImage.MAD(center[0] = starListImage.Median());
-    DF.SetLinkedRGB();
-    DF.ComputeAutoStretch(sigma, center);
-    starListWindow.MainView().SetScreenTransferFunctions(DF.HistogramTransformations());
-    starListWindow.Show();
-
-    // Create window for results
-    id = view.FullId() + "_ePSF";
-    ImageWindow ePSFWindow = ImageWindow(epsfImage.Width(), epsfImage.Height(), epsfImage.NumberOfChannels(), epsfImage.BitsPerSample(), epsfImage.IsFloatSample(), epsfImage.IsColor(), true, id);
-    if (ePSFWindow.IsNull())
-        throw Error("Unable to create image window: " + id);
-    ePSFWindow.MainView().Lock();
-    ePSFWindow.MainView().Image().CopyImage(epsfImage);
-    ePSFWindow.MainView().Unlock();
-    ePSFWindow.Show();
-
-    return true;
-}
-
-void* EPSFBuilderInstance::LockParameter(const MetaParameter* p, size_type /*tableRow*/)
-{
-    if (p == TheEPSFBuilderMaxStarsParameter)
-        return &maxStars;
-    else if (p == TheEPSFBuilderStarMaxPeakParameter)
-        return &starMaxPeak;
-    else if (p == TheEPSFBuilderStarThresholdParameter)
-        return &starThreshold;
-    else if (p == TheEPSFBuilderStarFWHMParameter)
-        return &starFWHM;
-    else if (p == TheEPSFBuilderStarSizeParameter)
-        return &starSize;
-    else if (p == TheEPSFBuilderOversamplingParameter)
-        return &oversampling;
-    else if (p == TheEPSFBuilderSmoothingKernelParameter)
-        return &smoothingKernel;
-    else if (p == TheEPSFBuilderMaxIterationsParameter)
-        return &maxIterations;
-    return nullptr;
-}
-
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <pcl/AutoPointer.h>
+#include <pcl/AutoViewLock.h>
+#include <pcl/Console.h>
+#include <pcl/DisplayFunction.h>
+#include <pcl/File.h>
+#include <pcl/FileFormat.h>
+#include <pcl/FileFormatInstance.h>
+#include <pcl/ImageWindow.h>
+#include <pcl/Math.h>
+#include <pcl/MetaModule.h>
+#include <pcl/ReferenceArray.h>
+#include <pcl/Settings.h>
+#include <pcl/StandardStatus.h>
+#include <pcl/Thread.h>
+#include <pcl/View.h>
+
+#include "EPSFBuilderAccumulator.h"
+#include "EPSFBuilderInstance.h"
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderParameters.h"
+#include "EPSFBuilderPipeline.h"
+#include "EPSFBuilderProfiler.h"
+#include "EPSFBuilderPython.h"
+#include "EPSFBuilderStatistics.h"
+#include "EPSFBuilderWorkerPool.h"
+
+namespace pcl
+{
+
+// Sets the linked screen stretch of an output window from the sampled statistics of its image
+static void AutoStretch(View& view, const ImageVariant& image)
+{
+    Vector center(1);
+    Vector sigma(1);
+    double mad = 0;
+    if (image.BitsPerSample() == 32)
+        EPSFBuilderSampledMedianMAD(static_cast<const Image&>(*image), center[0], mad);
+    else if (image.BitsPerSample() == 64)
+        EPSFBuilderSampledMedianMAD(static_cast<const DImage&>(*image), center[0], mad);
+    sigma[0] = 1.4826 * mad;
+    DisplayFunction DF;
+    DF.SetLinkedRGB();
+    DF.ComputeAutoStretch(sigma, center);
+    view.SetScreenTransferFunctions(DF.HistogramTransformations());
+}
+
+EPSFBuilderInstance::EPSFBuilderInstance(const MetaProcess* m)
+    : ProcessImplementation(m)
+    , maxStars(TheEPSFBuilderMaxStarsParameter->DefaultValue())
+    , starMaxPeak(TheEPSFBuilderStarMaxPeakParameter->DefaultValue())
+    , starThreshold(TheEPSFBuilderStarThresholdParameter->DefaultValue())
+    , starFWHM(TheEPSFBuilderStarFWHMParameter->DefaultValue())
+    , detectionEngine(static_cast<pcl_enum>(TheEPSFBuilderDetectionEngineParameter->DefaultValueIndex()))
+    , centroidMethod(static_cast<pcl_enum>(TheEPSFBuilderCentroidMethodParameter->DefaultValueIndex()))
+    , backgroundMode(static_cast<pcl_enum>(TheEPSFBuilderBackgroundModeParameter->DefaultValueIndex()))
+    , detectionCacheSize(TheEPSFBuilderDetectionCacheSizeParameter->DefaultValue())
+    , tileMemory(TheEPSFBuilderTileMemoryParameter->DefaultValue())
+    , starSize(TheEPSFBuilderStarSizeParameter->DefaultValue())
+    , oversampling(TheEPSFBuilderOversamplingParameter->DefaultValue())
+    , smoothingKernel(static_cast<pcl_enum>(TheEPSFBuilderSmoothingKernelParameter->DefaultValueIndex()))
+    , maxIterations(TheEPSFBuilderMaxIterationsParameter->DefaultValue())
+    , fittingEngine(static_cast<pcl_enum>(TheEPSFBuilderFittingEngineParameter->DefaultValueIndex()))
+    , gridColumns(TheEPSFBuilderGridColumnsParameter->DefaultValue())
+    , gridRows(TheEPSFBuilderGridRowsParameter->DefaultValue())
+    , gridOverlap(TheEPSFBuilderGridOverlapParameter->DefaultValue())
+    , photometryOutput(static_cast<pcl_enum>(TheEPSFBuilderPhotometryOutputParameter->DefaultValueIndex()))
+    , libraryMode(static_cast<pcl_enum>(TheEPSFBuilderLibraryModeParameter->DefaultValueIndex()))
+    , libraryDirectory()
+    , libraryTimeWindow(TheEPSFBuilderLibraryTimeWindowParameter->DefaultValue())
+    , libraryFWHMTolerance(TheEPSFBuilderLibraryFWHMToleranceParameter->DefaultValue())
+    , deconvolve(TheEPSFBuilderDeconvolveParameter->DefaultValue())
+    , deconvolutionIterations(TheEPSFBuilderDeconvolutionIterationsParameter->DefaultValue())
+    , deconvolutionTolerance(TheEPSFBuilderDeconvolutionToleranceParameter->DefaultValue())
+    , pythonWorkers(TheEPSFBuilderPythonWorkersParameter->DefaultValue())
+    , targetFrames()
+    , outputDirectory()
+    , accumulateFrames(TheEPSFBuilderAccumulateFramesParameter->DefaultValue())
+    , accumulatedStars(TheEPSFBuilderAccumulatedStarsParameter->DefaultValue())
+    , traceFile()
+    , showStarDetection(TheEPSFBuilderShowStarDetectionParameter->DefaultValue())
+    , showExtractedStars(TheEPSFBuilderShowExtractedStarsParameter->DefaultValue())
+{
+}
+
+EPSFBuilderInstance::EPSFBuilderInstance(const EPSFBuilderInstance& x)
+    : ProcessImplementation(x)
+{
+    Assign(x);
+}
+
+void EPSFBuilderInstance::Assign(const ProcessImplementation& p)
+{
+    const EPSFBuilderInstance* x = dynamic_cast<const EPSFBuilderInstance*>(&p);
+    if (x != nullptr) {
+        pythonDll = x->pythonDll;
+        maxStars = x->maxStars;
+        starMaxPeak = x->starMaxPeak;
+        starThreshold = x->starThreshold;
+        starFWHM = x->starFWHM;
+        detectionEngine = x->detectionEngine;
+        centroidMethod = x->centroidMethod;
+        backgroundMode = x->backgroundMode;
+        detectionCacheSize = x->detectionCacheSize;
+        tileMemory = x->tileMemory;
+        starSize = x->starSize;
+        oversampling = x->oversampling;
+        smoothingKernel = x->smoothingKernel;
+        maxIterations = x->maxIterations;
+        fittingEngine = x->fittingEngine;
+        gridColumns = x->gridColumns;
+        gridRows = x->gridRows;
+        gridOverlap = x->gridOverlap;
+        photometryOutput = x->photometryOutput;
+        libraryMode = x->libraryMode;
+        libraryDirectory = x->libraryDirectory;
+        libraryTimeWindow = x->libraryTimeWindow;
+        libraryFWHMTolerance = x->libraryFWHMTolerance;
+        deconvolve = x->deconvolve;
+        deconvolutionIterations = x->deconvolutionIterations;
+        deconvolutionTolerance = x->deconvolutionTolerance;
+        pythonWorkers = x->pythonWorkers;
+        targetFrames = x->targetFrames;
+        outputDirectory = x->outputDirectory;
+        accumulateFrames = x->accumulateFrames;
+        accumulatedStars = x->accumulatedStars;
+        traceFile = x->traceFile;
+        showStarDetection = x->showStarDetection;
+        showExtractedStars = x->showExtractedStars;
+    }
+}
+
+bool EPSFBuilderInstance::IsHistoryUpdater(const View& view) const
+{
+    return false;
+}
+
+UndoFlags EPSFBuilderInstance::UndoMode(const View&) const
+{
+    return UndoFlag::PixelData;
+}
+
+bool EPSFBuilderInstance::CanExecuteOn(const View& view, pcl::String& whyNot) const
+{
+    if (view.Image().IsComplexSample())
+    {
+        whyNot = "ePSF Builder cannot be executed on complex images.";
+        return false;
+    }
+    else if (!view.Image().IsFloatSample())
+    {
+        whyNot = "ePSF Builder can only be executed on float images.";
+        return false;
+    }
+
+    EPSFBuilderPipeline::Parameters parameters = PipelineParameters();
+    return parameters.CanTile(whyNot) && parameters.CanFitChannels(view.Image().NumberOfNominalChannels(), whyNot) && parameters.CanMeasureStars(whyNot) && parameters.CanUseLibrary(whyNot);
+}
+
+EPSFBuilderPipeline::Parameters EPSFBuilderInstance::PipelineParameters() const
+{
+    EPSFBuilderPipeline::Parameters p;
+    p.pythonDll = pythonDll;
+    p.maxStars = maxStars;
+    p.starMaxPeak = starMaxPeak;
+    p.starThreshold = starThreshold;
+    p.starFWHM = starFWHM;
+    p.detectionEngine = detectionEngine;
+    p.centroidMethod = centroidMethod;
+    p.backgroundMode = backgroundMode;
+    p.detectionCacheSize = detectionCacheSize;
+    p.tileMemory = tileMemory;
+    p.starSize = starSize;
+    p.oversampling = oversampling;
+    p.smoothingKernel = smoothingKernel;
+    p.maxIterations = maxIterations;
+    p.fittingEngine = fittingEngine;
+    p.gridColumns = gridColumns;
+    p.gridRows = gridRows;
+    p.gridOverlap = gridOverlap;
+    p.photometryOutput = photometryOutput;
+    p.libraryMode = libraryMode;
+    p.libraryDirectory = libraryDirectory;
+    p.libraryTimeWindow = libraryTimeWindow;
+    p.libraryFWHMTolerance = libraryFWHMTolerance;
+    p.deconvolve = deconvolve;
+    p.deconvolutionIterations = deconvolutionIterations;
+    p.deconvolutionTolerance = deconvolutionTolerance;
+    p.pythonWorkers = pythonWorkers;
+    p.accumulateFrames = accumulateFrames;
+    return p;
+}
+
+// Step 8 on a worker thread, so that the thread that starts it keeps the console responsive and may
+// render output meanwhile
+class EPSFBuilderFitThread : public Thread
+{
+public:
+    EPSFBuilderFitThread(EPSFBuilderPipeline::FitTask& fit)
+        : m_fit(fit)
+    {
+    }
+
+    void Run() override
+    {
+        m_fit.Run();
+    }
+
+private:
+    EPSFBuilderPipeline::FitTask& m_fit;
+};
+
+// The pipeline as run by the module: Console output, abort checkpoints that process the events of
+// the interface, the ePSF fit on its own thread and the Python stages in the worker processes
+class EPSFBuilderModulePipeline : public EPSFBuilderPipeline
+{
+public:
+    EPSFBuilderModulePipeline(const Parameters& parameters, StatusCallback& status)
+        : EPSFBuilderPipeline(parameters)
+    {
+        m_status = &status;
+    }
+
+    void RunPythonTask(const EPSFBuilderPythonTask& task, ImageVariant& starImage, EPSFBuilderExtraction& extraction) const override
+    {
+        if (m_parameters.pythonWorkers <= 0)
+        {
+            EPSFBuilderPipeline::RunPythonTask(task, starImage, extraction);
+            return;
+        }
+
+        // Steps 2 to 6 in a worker process, with photutils fitting too
+        starImage.Status().Initialize("Extracting stars", 1);
+        {
+            EPSFBuilderProfiler::Scope scope("python workers");
+            EPSFBuilderWorkerPool& pool = EPSFBuilderWorkerPool::Acquire(m_parameters.pythonDll, m_parameters.pythonWorkers);
+            int ticket = pool.Submit(task, starImage);
+            String errorMessage;
+            while (pool.WaitForAny(100, extraction, errorMessage) != ticket)
+            {
+                Module->ProcessEvents();
+                if (Console().AbortRequested())
+                {
+                    pool.Cancel();
+                    throw ProcessAborted();
+                }
+            }
+            if (!errorMessage.IsEmpty())
+                throw Error(errorMessage);
+        }
+        starImage.Status() += 1;
+        starImage.Status().Complete();
+    }
+
+protected:
+    void WriteLn(const String& text) const override
+    {
+        Console().WriteLn("<end><cbr>" + text);
+    }
+
+    void CheckAbort() const override
+    {
+        Module->ProcessEvents();
+        if (Console().AbortRequested())
+            throw ProcessAborted();
+    }
+
+    // The fit runs on a worker thread while this thread runs overlap, then waits for it with abort
+    // checkpoints; an aborted fit stops at its next iteration, or at its next Python statement
+    void RunFit(FitTask& fit, const std::function<void()>& overlap) const override
+    {
+        AutoPointer<EPSFBuilderPython::GILRelease> gil;
+        if (fit.Python() != nullptr)
+            gil = new EPSFBuilderPython::GILRelease(*fit.Python());
+        EPSFBuilderFitThread thread(fit);
+        thread.Start(ThreadPriority::DefaultMax);
+        bool aborted = false;
+        try
+        {
+            if (overlap)
+                overlap();
+        }
+        catch (...)
+        {
+            // Never destroy a running fit thread
+            fit.Abort();
+            thread.Wait();
+            throw;
+        }
+        while (!thread.Wait(100))
+        {
+            Module->ProcessEvents();
+            if (Console().AbortRequested())
+            {
+                aborted = true;
+                fit.Abort();
+            }
+        }
+        if (aborted)
+            throw ProcessAborted();
+    }
+};
+
+EPSFBuilderPipeline::StageOutputs EPSFBuilderInstance::s_lastRun;
+
+// Draws the size x size detection box of every star in every nominal channel, clipped to the image
+template <class P>
+void EPSFBuilderInstance::DrawDetectionBoxes(GenericImage<P>& image, const EPSFBuilderStarArena& stars, int size)
+{
+    const typename P::sample one = P::MaxSampleValue();
+    const int width = image.Width();
+    const int height = image.Height();
+    for (int i = 0; i < stars.Count(); i++)
+    {
+        int x0 = RoundInt(stars.centerX[i]) - size / 2;
+        int y0 = RoundInt(stars.centerY[i]) - size / 2;
+        int x1 = x0 + size;
+        int y1 = y0 + size;
+        int xa = Max(x0, 0);
+        int n = Min(x1, width) - xa;
+        for (int c = 0; c < image.NumberOfNominalChannels(); c++)
+        {
+            if (n > 0)
+            {
+                if (y0 >= 0 && y0 < height)
+                    P::Fill(image.PixelAddress(xa, y0, c), one, n);
+                if (y1 >= 0 && y1 < height)
+                    P::Fill(image.PixelAddress(xa, y1, c), one, n);
+            }
+            for (int y = Max(y0, 0), ye = Min(y1, height); y < ye; y++)
+            {
+                typename P::sample* row = image.ScanLine(y, c);
+                if (x0 >= 0 && x0 < width)
+                    row[x0] = one;
+                if (x1 >= 0 && x1 < width)
+                    row[x1] = one;
+            }
+        }
+    }
+}
+
+// Opens the star detection and extracted stars windows enabled by the parameters
+void EPSFBuilderInstance::ShowDiagnosticWindows(const View& view, const ImageVariant& image, const EPSFBuilderStarArena& stars) const
+{
+    EPSFBuilderProfiler::Scope scope("diagnostic windows");
+    int starCount = stars.Count();
+
+    // Create window for star detection. The target is copied once, straight into the window image,
+    // and the boxes are drawn there.
+    if (showStarDetection)
+    {
+        IsoString id = view.FullId() + "_star_detection";
+        ImageWindow starDetWindow = ImageWindow(image.Width(), image.Height(), image.NumberOfChannels(), image.BitsPerSample(), image.IsFloatSample(), image.IsColor(), true, id);
+        if (starDetWindow.IsNull())
+            throw Error("Unable to create image window: " + id);
+        View starDetView = starDetWindow.MainView();
+        starDetView.Lock();
+        ImageVariant starDetImage = starDetView.Image();
+        starDetImage.CopyImage(image);
+        if (starDetImage.BitsPerSample() == 32)
+            DrawDetectionBoxes(static_cast<Image&>(*starDetImage), stars, starSize);
+        else if (starDetImage.BitsPerSample() == 64)
+            DrawDetectionBoxes(static_cast<DImage&>(*starDetImage), stars, starSize);
+        starDetView.Unlock();
+        AutoStretch(starDetView, starDetImage);
+        starDetWindow.Show();
+    }
+
+    // Create window for extracted stars, tiled directly into the window image
+    if (showExtractedStars)
+    {
+        int ncols = EPSFBuilderPipeline::MosaicColumns(starCount);
+        int nrows = (starCount + ncols - 1) / ncols;
+        IsoString id = view.FullId() + "_extracted_stars";
+        // The stars are cut out of the single channel detection image
+        ImageWindow starListWindow = ImageWindow(ncols * starSize, nrows * starSize, 1, image.BitsPerSample(), image.IsFloatSample(), false, true, id);
+        if (starListWindow.IsNull())
+            throw Error("Unable to create image window: " + id);
+        View starListView = starListWindow.MainView();
+        starListView.Lock();
+        ImageVariant starListImage = starListView.Image();
+        starListImage.Fill(0.0);
+        EPSFBuilderPipeline::TileStars(starListImage, stars, ncols, starSize);
+        starListView.Unlock();
+        AutoStretch(starListView, starListImage);
+        starListWindow.Show();
+    }
+}
+
+bool EPSFBuilderInstance::ExecuteOn(View& view)
+{
+    AutoViewLock lock(view);
+
+    StandardStatus status;
+    Console console;
+    EPSFBuilderProfiler profiler;
+
+    console.EnableAbort();
+
+    ImageVariant image = view.Image();
+
+    if (image.IsComplexSample() || !view.Image().IsFloatSample())
+        return false;
+
+    EPSFBuilderModulePipeline pipeline(PipelineParameters(), status);
+    EPSFBuilderStatusScope imageStatus(image, &status);
+
+    // The photometry files of a view are named after its file, or written to the output directory
+    String photometryBase;
+    if (photometryOutput != EPSFBuilderPhotometryOutput::Disabled)
+    {
+        String filePath = view.Window().FilePath();
+        if (filePath.IsEmpty())
+        {
+            if (outputDirectory.IsEmpty())
+                throw Error("PSF photometry of a view without a file requires an output directory.");
+            photometryBase = OutputBaseName(view.FullId());
+        }
+        else
+            photometryBase = OutputBaseName(File::ExtractDrive(filePath) + File::ExtractDirectory(filePath) + '/' + view.FullId());
+    }
+
+    // A matching ePSF of the library replaces the whole build, diagnostic windows included
+    AutoPointer<EPSFBuilderLibrary> library;
+    EPSFBuilderLibrary::Entry libraryEntry;
+    if (libraryMode != EPSFBuilderLibraryMode::Disabled)
+    {
+        library = new EPSFBuilderLibrary(libraryDirectory);
+        libraryEntry = pipeline.LibraryEntry(view.Window().Keywords(), image.NumberOfNominalChannels());
+        if (pipeline.Settings().ReusesLibrary())
+        {
+            ImageVariant epsfImage;
+            int index = pipeline.LoadFromLibrary(*library, libraryEntry, epsfImage);
+            if (index >= 0)
+            {
+                console.WriteLn("<end><cbr>ePSF loaded from the library: " + library->Entries()[index].fileName);
+                ImageVariant deconvolvedImage;
+                if (deconvolve)
+                    pipeline.Deconvolve(deconvolvedImage, image, epsfImage, ImageVariant());
+                CreateResultWindows(view, epsfImage, ImageVariant(), deconvolvedImage);
+                ReportProfile(profiler);
+                return true;
+            }
+            console.WriteLn("<end><cbr>No matching ePSF in the library");
+        }
+    }
+
+    EPSFBuilderPipeline::StageOutputs& last = s_lastRun;
+    if (last.id != view.FullId())
+    {
+        last = EPSFBuilderPipeline::StageOutputs();
+        last.id = view.FullId();
+    }
+
+    // The stage outputs are kept for the next execution within the capacity of the detection cache,
+    // and released when they exceed it, however the execution ends; a zero capacity keeps nothing
+    struct Retention
+    {
+        EPSFBuilderPipeline::StageOutputs& outputs;
+        size_type capacity;
+
+        ~Retention()
+        {
+            if (outputs.Bytes() > capacity)
+                outputs = EPSFBuilderPipeline::StageOutputs();
+        }
+    } retention{ last, size_type(detectionCacheSize) << 20 };
+
+    // Steps 1 to 9 and the PSF grid, running only the stages whose fingerprint differs from the last
+    // run on this view. The diagnostic windows only need the stars collected by Step 7, so they are
+    // rendered while the ePSF is being fitted.
+    pipeline.Build(image, last, [&]()
+    {
+        ShowDiagnosticWindows(view, image, last.stars);
+    });
+    EPSFBuilderStatusScope starStatus(last.starImage, &status);
+
+    if (photometryOutput != EPSFBuilderPhotometryOutput::Disabled)
+        pipeline.MeasureStars(photometryBase, last.fittedImage, last.starImage, image, last.sources);
+
+    if (!library.IsNull())
+        pipeline.StoreInLibrary(*library, libraryEntry, last.epsfImage, last.stars.Count());
+
+    // Final stage: the target deconvolved with the finished ePSF, or with the PSF grid
+    ImageVariant deconvolvedImage;
+    if (deconvolve)
+        pipeline.Deconvolve(deconvolvedImage, image, last.epsfImage, last.gridImage);
+
+    CreateResultWindows(view, last.epsfImage, last.gridImage, deconvolvedImage);
+
+    ReportProfile(profiler);
+    return true;
+}
+
+void EPSFBuilderInstance::CreateResultWindows(const View& view, const ImageVariant& epsfImage, const ImageVariant& gridImage, const ImageVariant& deconvolvedImage) const
+{
+    EPSFBuilderProfiler::Scope scope("output windows");
+
+    // Create window for results
+    IsoString id = view.FullId() + "_ePSF";
+    ImageWindow ePSFWindow = ImageWindow(epsfImage.Width(), epsfImage.Height(), epsfImage.NumberOfChannels(), epsfImage.BitsPerSample(), epsfImage.IsFloatSample(), epsfImage.IsColor(), true, id);
+    if (ePSFWindow.IsNull())
+        throw Error("Unable to create image window: " + id);
+    ePSFWindow.MainView().Lock();
+    ePSFWindow.MainView().Image().CopyImage(epsfImage);
+    ePSFWindow.MainView().Unlock();
+    ePSFWindow.Show();
+
+    // Create window for the PSF grid
+    if (PipelineParameters().IsGridMode())
+    {
+        id = view.FullId() + "_ePSF_grid";
+        ImageWindow gridWindow = ImageWindow(gridImage.Width(), gridImage.Height(), gridImage.NumberOfChannels(), gridImage.BitsPerSample(), gridImage.IsFloatSample(), gridImage.IsColor(), true, id);
+        if (gridWindow.IsNull())
+            throw Error("Unable to create image window: " + id);
+        gridWindow.MainView().Lock();
+        gridWindow.MainView().Image().CopyImage(gridImage);
+        gridWindow.MainView().Unlock();
+        gridWindow.Show();
+    }
+
+    // Create window for the deconvolved target, with its keywords
+    if (deconvolve)
+    {
+        id = view.FullId() + "_deconvolved";
+        ImageWindow deconvolvedWindow = ImageWindow(deconvolvedImage.Width(), deconvolvedImage.Height(), deconvolvedImage.NumberOfChannels(), deconvolvedImage.BitsPerSample(), deconvolvedImage.IsFloatSample(), deconvolvedImage.IsColor(), true, id);
+        if (deconvolvedWindow.IsNull())
+            throw Error("Unable to create image window: " + id);
+        deconvolvedWindow.SetKeywords(view.Window().Keywords());
+        deconvolvedWindow.MainView().Lock();
+        deconvolvedWindow.MainView().Image().CopyImage(deconvolvedImage);
+        deconvolvedWindow.MainView().Unlock();
+        deconvolvedWindow.Show();
+    }
+}
+
+void EPSFBuilderInstance::ReportProfile(const EPSFBuilderProfiler& profiler) const
+{
+    Console console;
+    console.WriteLn("<end><cbr><br>Stage timings:");
+    console.Write(profiler.Summary());
+    if (!traceFile.IsEmpty())
+    {
+        // A trace that cannot be written must not fail a completed execution
+        try
+        {
+            profiler.WriteTrace(traceFile);
+            console.WriteLn("Trace written to " + traceFile);
+        }
+        catch (const Exception& x)
+        {
+            console.WarningLn("** Warning: " + x.Message());
+        }
+    }
+}
+
+bool EPSFBuilderInstance::CanExecuteGlobal(pcl::String& whyNot) const
+{
+    EPSFBuilderPipeline::Parameters parameters = PipelineParameters();
+    if (!parameters.CanTile(whyNot) || !parameters.CanMeasureStars(whyNot) || !parameters.CanUseLibrary(whyNot) || !parameters.CanDeconvolve(whyNot))
+        return false;
+
+    for (const FrameItem& item : targetFrames)
+        if (item.enabled)
+            return true;
+
+    whyNot = "No target frames have been specified.";
+    return false;
+}
+
+// Accumulated frames with the native detection engine need no Python before the final fit, so the
+// frame loaders run their Steps 4 to 6 and several frames are processed concurrently
+bool EPSFBuilderInstance::ExtractsInLoader() const
+{
+    return accumulateFrames && tileMemory <= 0 && detectionEngine == EPSFBuilderDetectionEngine::Native;
+}
+
+// Loads a target frame and removes its background on a worker thread, so that the next frame of a
+// batch is prepared while the current one is in star detection or ePSF fitting. Frames accumulated
+// with the native detection engine also run Steps 4 to 6 here, see ExtractsInLoader(). A frame with
+// a matching ePSF in the library only has its keywords read, and its pixels too for deconvolution,
+// and the stored ePSF is loaded instead. Python is never called from this thread.
+class EPSFBuilderFrameLoader : public Thread
+{
+public:
+    ImageVariant image;
+    ImageVariant starImage;
+    bool extracted = false;
+    EPSFBuilderExtraction extraction;
+    int candidates = 0;
+    int isolated = 0;
+    FITSKeywordArray keywords;
+    int libraryIndex = -1;              // the stored ePSF loaded into epsfImage, if not negative
+    ImageVariant epsfImage;
+    String errorMessage;
+
+    EPSFBuilderFrameLoader(const EPSFBuilderInstance& instance, const EPSFBuilderPipeline& pipeline, const String& filePath, const EPSFBuilderLibrary* library)
+        : m_instance(instance)
+        , m_pipeline(pipeline)
+        , m_filePath(filePath)
+        , m_library(library)
+    {
+    }
+
+    void Run() override
+    {
+        try
+        {
+            EPSFBuilderProfiler::Scope readScope("read frame");
+            FileFormat format(File::ExtractExtension(m_filePath), true/*read*/, false/*write*/);
+            FileFormatInstance file(format);
+
+            ImageDescriptionArray images;
+            if (!file.Open(images, m_filePath))
+                throw Error(m_filePath + ": Unable to open file.");
+            if (images.IsEmpty())
+                throw Error(m_filePath + ": Empty image file.");
+
+            if (format.CanStoreKeywords())
+                file.ReadFITSKeywords(keywords);
+            if (m_library != nullptr && m_pipeline.Settings().ReusesLibrary())
+            {
+                int channels = (images[0].info.colorSpace == ColorSpace::Gray) ? 1 : 3;
+                libraryIndex = m_pipeline.LoadFromLibrary(*m_library, m_pipeline.LibraryEntry(keywords, channels), epsfImage);
+                if (libraryIndex >= 0 && !m_instance.deconvolve)
+                {
+                    file.Close();
+                    return;
+                }
+            }
+
+            // The sample type of the file, as a view of it would have; integer frames, which cannot be
+            // executed on as views, are read as 32-bit floating point
+            const ImageOptions& options = images[0].options;
+            image.CreateFloatImage((options.ieeefpSampleFormat && options.bitsPerSample == 64) ? 64 : 32);
+            if (!file.ReadImage(image))
+                throw Error(m_filePath + ": Unable to read image.");
+            file.Close();
+            if (libraryIndex >= 0)
+                return;     // read only to be deconvolved with the stored ePSF
+
+            String whyNot;
+            if (!m_pipeline.Settings().CanFitChannels(image.NumberOfNominalChannels(), whyNot))
+                throw Error(m_filePath + ": " + whyNot);
+            readScope.End();
+
+            if (!m_pipeline.Settings().IsTiled())
+                m_pipeline.RemoveBackground(starImage, image);
+
+            if (m_instance.ExtractsInLoader())
+            {
+                m_pipeline.ExtractNative(starImage, extraction, candidates, isolated);
+                extracted = true;
+                image.Free();
+            }
+        }
+        catch (const Exception& x)
+        {
+            errorMessage = x.Message();
+        }
+        catch (...)
+        {
+            errorMessage = m_filePath + ": Unknown error loading frame.";
+        }
+    }
+
+private:
+    const EPSFBuilderInstance& m_instance;
+    const EPSFBuilderPipeline& m_pipeline;
+    String m_filePath;
+    const EPSFBuilderLibrary* m_library;
+};
+
+bool EPSFBuilderInstance::ExecuteGlobal()
+{
+    StandardStatus status;
+    Console console;
+    EPSFBuilderProfiler profiler;
+
+    console.EnableAbort();
+
+    EPSFBuilderModulePipeline pipeline(PipelineParameters(), status);
+
+    StringList filePaths;
+    for (const FrameItem& item : targetFrames)
+        if (item.enabled)
+            filePaths << item.path;
+    if (filePaths.IsEmpty())
+        throw Error("No target frames have been specified.");
+
+    if (!outputDirectory.IsEmpty() && !File::DirectoryExists(outputDirectory))
+        throw Error("The specified output directory does not exist: " + outputDirectory);
+
+    AutoPointer<EPSFBuilderLibrary> library;
+    if (libraryMode != EPSFBuilderLibraryMode::Disabled)
+        library = new EPSFBuilderLibrary(libraryDirectory);
+
+    // Start the Python workers, or load the embedded interpreter, before the first frame; they are
+    // reused by every frame of the batch. Tiled runs, frames extracted by the loaders and runs with
+    // native detection and fitting do not use Python.
+    EPSFBuilderWorkerPool* pool = nullptr;
+    if (!pipeline.Settings().IsTiled() && !ExtractsInLoader() && pipeline.Settings().UsesPython())
+    {
+        if (pythonWorkers > 0)
+            pool = &EPSFBuilderWorkerPool::Acquire(pythonDll, pythonWorkers);
+        else
+            EPSFBuilderPython::Acquire(pythonDll);
+    }
+
+    if (accumulateFrames)
+        console.WriteLn(String().Format("<end><cbr>Accumulating the stars of %d target frame(s)", int(filePaths.Length())));
+    else
+        console.WriteLn(String().Format("<end><cbr>Building ePSFs for %d target frame(s)", int(filePaths.Length())));
+
+    // Frames whose Python stages are running in a worker process
+    struct PendingFrame
+    {
+        int ticket;
+        size_type index;
+        AutoPointer<EPSFBuilderFrameLoader> frame;
+        std::vector<double> sources;
+    };
+    ReferenceArray<PendingFrame> pending;
+
+    // Accumulated frames only offer their stars. The background-subtracted image of the first one is
+    // kept for the geometry and sample type of the final ePSF.
+    EPSFBuilderAccumulator accumulator(accumulatedStars);
+    ImageVariant reference;
+    String referencePath;
+    FITSKeywordArray referenceKeywords;
+
+    int succeeded = 0;
+    auto finishFrame = [&](size_type index, const EPSFBuilderExtraction& extraction, const ImageVariant& starImage, const ImageVariant& image, const std::vector<double>& sources, const FITSKeywordArray& keywords)
+    {
+        if (accumulateFrames)
+        {
+            accumulator.Add(int(index), extraction);
+            if (referencePath.IsEmpty())
+            {
+                reference = starImage;
+                referencePath = filePaths[index];
+                referenceKeywords = keywords;
+            }
+            console.WriteLn(String().Format("%d stars offered, %d of %d kept", extraction.starCount, accumulator.Kept(), accumulator.Offered()));
+            succeeded++;
+            return;
+        }
+
+        EPSFBuilderStarArena stars;
+        ImageVariant epsfImage;
+        ImageVariant fittedImage;
+        ImageVariant gridImage;
+        pipeline.FinishEPSF(epsfImage, fittedImage, stars, extraction, starImage, image);
+        if (pipeline.Settings().IsGridMode())
+            pipeline.BuildEPSFGrid(gridImage, stars, starImage);
+        ImageVariant deconvolvedImage;
+        if (deconvolve)
+            pipeline.Deconvolve(deconvolvedImage, image, epsfImage, gridImage);
+        WriteFrameResults(filePaths[index], epsfImage, gridImage, stars, deconvolvedImage);
+        if (photometryOutput != EPSFBuilderPhotometryOutput::Disabled)
+            pipeline.MeasureStars(OutputBaseName(filePaths[index]), fittedImage, starImage, image, sources);
+        if (!library.IsNull())
+            pipeline.StoreInLibrary(*library, pipeline.LibraryEntry(keywords, epsfImage.NumberOfChannels()), epsfImage, stars.Count());
+        succeeded++;
+    };
+
+    // Frames loaded ahead of the current one: one, or several when the loaders also extract the stars
+    const size_type prefetch = ExtractsInLoader() ? size_type(Range(EPSFBuilderThreadCount(PCL_MAX_PROCESSORS) / 2, 1, 4)) : 1;
+    ReferenceArray<EPSFBuilderFrameLoader> loaders;
+    size_type loaded = 0;
+    auto startLoaders = [&]()
+    {
+        while (loaded < filePaths.Length() && loaders.Length() < prefetch)
+        {
+            EPSFBuilderFrameLoader* loader = new EPSFBuilderFrameLoader(*this, pipeline, filePaths[loaded++], library.Ptr());
+            loaders.Add(loader);
+            loader->Start(ThreadPriority::DefaultMax);
+        }
+    };
+    startLoaders();
+
+    try
+    {
+        size_type next = 0;
+        while (next < filePaths.Length() || !pending.IsEmpty())
+        {
+            if (next < filePaths.Length() && (pool == nullptr || pool->HasIdleWorker()))
+            {
+                // Wait for the next frame while keeping the console responsive
+                while (!loaders[0].Wait(150))
+                {
+                    Module->ProcessEvents();
+                    if (console.AbortRequested())
+                        throw ProcessAborted();
+                }
+
+                size_type i = next++;
+                AutoPointer<EPSFBuilderFrameLoader> frame = &loaders[0];
+                loaders.Remove(loaders.Begin());
+
+                // The next frames are loaded and background-subtracted while frame i is processed
+                startLoaders();
+
+                console.WriteLn("<end><cbr><br>" + String().Format("Frame %d of %d: ", int(i + 1), int(filePaths.Length())) + filePaths[i]);
+
+                if (!frame->errorMessage.IsEmpty())
+                {
+                    console.CriticalLn("*** Error: " + frame->errorMessage);
+                    continue;
+                }
+
+                try
+                {
+                    if (frame->libraryIndex >= 0)
+                    {
+                        console.WriteLn("ePSF loaded from the library: " + library->Entries()[frame->libraryIndex].fileName);
+                        ImageVariant deconvolvedImage;
+                        if (deconvolve)
+                            pipeline.Deconvolve(deconvolvedImage, frame->image, frame->epsfImage, ImageVariant());
+                        WriteFrameResults(filePaths[i], frame->epsfImage, ImageVariant(), EPSFBuilderStarArena(), deconvolvedImage);
+                        succeeded++;
+                    }
+                    else if (frame->extracted)
+                    {
+                        console.WriteLn(String().Format("%d star candidates detected, %d isolated, %d stars extracted", frame->candidates, frame->isolated, frame->extraction.starCount));
+                        finishFrame(i, frame->extraction, frame->starImage, frame->image, std::vector<double>(), frame->keywords);
+                    }
+                    else if (pipeline.Settings().IsTiled())
+                    {
+                        frame->image.SetStatusCallback(&status);
+                        EPSFBuilderExtraction extraction;
+                        pipeline.ExtractTiled(frame->image, extraction);
+                        finishFrame(i, extraction, frame->image, frame->image, std::vector<double>(), frame->keywords);
+                    }
+                    else
+                    {
+                        frame->starImage.SetStatusCallback(&status);
+                        EPSFBuilderPythonTask task = pipeline.PrepareTask();
+                        if (accumulateFrames)
+                            task.fit = false;   // fitted once, on the accumulated stars
+                        std::vector<double> sources;
+                        pipeline.DetectStars(task, frame->starImage, sources);
+                        if (pool == nullptr)
+                        {
+                            EPSFBuilderExtraction extraction;
+                            if (pipeline.Settings().UsesPython())
+                                pipeline.RunPythonTask(task, frame->starImage, extraction);
+                            else
+                                pipeline.ExtractStars(task, frame->starImage, extraction);
+                            finishFrame(i, extraction, frame->starImage, frame->image, sources, frame->keywords);
+                        }
+                        else
+                        {
+                            PendingFrame* p = new PendingFrame;
+                            p->ticket = pool->Submit(task, frame->starImage);
+                            p->index = i;
+                            p->frame = frame.Release();
+                            p->sources = std::move(sources);
+                            pending.Add(p);
+                        }
+                    }
+                }
+                catch (ProcessAborted&)
+                {
+                    throw;
+                }
+                catch (const Exception& x)
+                {
+                    console.CriticalLn("*** Error: " + x.Message());
+                }
+            }
+            else
+            {
+                // All workers are busy, or every frame has been dispatched
+                EPSFBuilderExtraction extraction;
+                String errorMessage;
+                int ticket = pool->WaitForAny(100, extraction, errorMessage);
+                for (size_type k = 0; k < pending.Length(); k++)
+                    if (pending[k].ticket == ticket)
+                    {
+                        size_type i = pending[k].index;
+                        console.WriteLn("<end><cbr><br>" + String().Format("Frame %d of %d, Python stages done: ", int(i + 1), int(filePaths.Length())) + filePaths[i]);
+                        try
+                        {
+                            if (!errorMessage.IsEmpty())
+                                throw Error(errorMessage);
+                            finishFrame(i, extraction, pending[k].frame->starImage, pending[k].frame->image, pending[k].sources, pending[k].frame->keywords);
+                        }
+                        catch (ProcessAborted&)
+                        {
+                            throw;
+                        }
+                        catch (const Exception& x)
+                        {
+                            console.CriticalLn("*** Error: " + x.Message());
+                        }
+                        pending.Destroy(pending.At(k));
+                        break;
+                    }
+            }
+
+            Module->ProcessEvents();
+            if (console.AbortRequested())
+                throw ProcessAborted();
+        }
+    }
+    catch (...)
+    {
+        if (pool != nullptr)
+            pool->Cancel();
+        pending.Destroy();
+
+        // Never destroy a running loader thread
+        for (EPSFBuilderFrameLoader& loader : loaders)
+            loader.Wait();
+        loaders.Destroy();
+        throw;
+    }
+
+    // A single ePSF from the accumulated stars, named after the first frame that contributed
+    if (accumulateFrames && succeeded > 0)
+    {
+        EPSFBuilderExtraction extraction = accumulator.Extraction();
+        console.WriteLn("<end><cbr><br>" + String().Format("Accumulated ePSF: %d of %d stars from %d frame(s)", extraction.starCount, accumulator.Offered(), accumulator.Frames()));
+        if (extraction.starCount < 1)
+            throw Error("No stars were extracted from the target frames.");
+        reference.SetStatusCallback(&status);
+        EPSFBuilderStarArena stars;
+        ImageVariant epsfImage;
+        ImageVariant fittedImage;
+        ImageVariant gridImage;
+        pipeline.FinishEPSF(epsfImage, fittedImage, stars, extraction, reference, reference);
+        if (pipeline.Settings().IsGridMode())
+            pipeline.BuildEPSFGrid(gridImage, stars, reference);
+        String accumulatedPath = File::ExtractDrive(referencePath) + File::ExtractDirectory(referencePath) + '/' + File::ExtractName(referencePath) + "_accumulated" + File::ExtractExtension(referencePath);
+        WriteFrameResults(accumulatedPath, epsfImage, gridImage, stars, ImageVariant());
+        if (!library.IsNull())
+            pipeline.StoreInLibrary(*library, pipeline.LibraryEntry(referenceKeywords, epsfImage.NumberOfChannels()), epsfImage, stars.Count());
+    }
+
+    console.WriteLn(String().Format("<end><cbr><br>ePSF Builder: %d of %d frame(s) processed successfully", succeeded, int(filePaths.Length())));
+    ReportProfile(profiler);
+    return succeeded > 0;
+}
+
+static void WriteImageFile(const String& filePath, const ImageVariant& image)
+{
+    FileFormat outputFormat(".xisf", false/*read*/, true/*write*/);
+    FileFormatInstance outputFile(outputFormat);
+    if (!outputFile.Create(filePath))
+        throw Error(filePath + ": Unable to create file.");
+    ImageOptions options;
+    options.bitsPerSample = 32;
+    options.ieeefpSampleFormat = true;
+    outputFile.SetOptions(options);
+    if (!outputFile.WriteImage(image))
+        throw Error(filePath + ": Unable to write image.");
+    outputFile.Close();
+}
+
+// The path of the results of filePath without suffix or extension: its name in the output directory,
+// or next to it
+String EPSFBuilderInstance::OutputBaseName(const String& filePath) const
+{
+    String directory = outputDirectory.IsEmpty() ? File::ExtractDrive(filePath) + File::ExtractDirectory(filePath) : outputDirectory;
+    if (!directory.EndsWith('/'))
+        directory += '/';
+    return directory + File::ExtractName(filePath);
+}
+
+// Writes <name>_ePSF.xisf, <name>_ePSF_grid.xisf in grid mode, <name>_deconvolved.xisf with
+// deconvolution and <name>_stars.csv to the output directory, or next to the frame. ePSFs loaded from
+// the library have no stars and no catalog.
+void EPSFBuilderInstance::WriteFrameResults(const String& filePath, const ImageVariant& epsfImage, const ImageVariant& gridImage, const EPSFBuilderStarArena& stars, const ImageVariant& deconvolvedImage) const
+{
+    EPSFBuilderProfiler::Scope scope("write results");
+    Console console;
+
+    String baseName = OutputBaseName(filePath);
+
+    String epsfPath = baseName + "_ePSF.xisf";
+    WriteImageFile(epsfPath, epsfImage);
+    console.WriteLn("<end><cbr>" + epsfPath);
+
+    if (PipelineParameters().IsGridMode())
+    {
+        String gridPath = baseName + "_ePSF_grid.xisf";
+        WriteImageFile(gridPath, gridImage);
+        console.WriteLn(gridPath);
+    }
+
+    if (deconvolve)
+    {
+        String deconvolvedPath = baseName + "_deconvolved.xisf";
+        WriteImageFile(deconvolvedPath, deconvolvedImage);
+        console.WriteLn(deconvolvedPath);
+    }
+
+    if (stars.IsEmpty())
+        return;
+
+    String catalogPath = baseName + "_stars.csv";
+    EPSFBuilderPipeline::WriteCatalog(catalogPath, stars);
+    console.WriteLn(catalogPath + String().Format(" (%d stars)", stars.Count()));
+}
+
+void* EPSFBuilderInstance::LockParameter(const MetaParameter* p, size_type tableRow)
+{
+    if (p == TheEPSFBuilderMaxStarsParameter)
+        return &maxStars;
+    else if (p == TheEPSFBuilderStarMaxPeakParameter)
+        return &starMaxPeak;
+    else if (p == TheEPSFBuilderStarThresholdParameter)
+        return &starThreshold;
+    else if (p == TheEPSFBuilderStarFWHMParameter)
+        return &starFWHM;
+    else if (p == TheEPSFBuilderDetectionEngineParameter)
+        return &detectionEngine;
+    else if (p == TheEPSFBuilderCentroidMethodParameter)
+        return &centroidMethod;
+    else if (p == TheEPSFBuilderBackgroundModeParameter)
+        return &backgroundMode;
+    else if (p == TheEPSFBuilderDetectionCacheSizeParameter)
+        return &detectionCacheSize;
+    else if (p == TheEPSFBuilderTileMemoryParameter)
+        return &tileMemory;
+    else if (p == TheEPSFBuilderStarSizeParameter)
+        return &starSize;
+    else if (p == TheEPSFBuilderOversamplingParameter)
+        return &oversampling;
+    else if (p == TheEPSFBuilderSmoothingKernelParameter)
+        return &smoothingKernel;
+    else if (p == TheEPSFBuilderMaxIterationsParameter)
+        return &maxIterations;
+    else if (p == TheEPSFBuilderFittingEngineParameter)
+        return &fittingEngine;
+    else if (p == TheEPSFBuilderGridColumnsParameter)
+        return &gridColumns;
+    else if (p == TheEPSFBuilderGridRowsParameter)
+        return &gridRows;
+    else if (p == TheEPSFBuilderGridOverlapParameter)
+        return &gridOverlap;
+    else if (p == TheEPSFBuilderPhotometryOutputParameter)
+        return &photometryOutput;
+    else if (p == TheEPSFBuilderLibraryModeParameter)
+        return &libraryMode;
+    else if (p == TheEPSFBuilderLibraryDirectoryParameter)
+        return libraryDirectory.Begin();
+    else if (p == TheEPSFBuilderLibraryTimeWindowParameter)
+        return &libraryTimeWindow;
+    else if (p == TheEPSFBuilderLibraryFWHMToleranceParameter)
+        return &libraryFWHMTolerance;
+    else if (p == TheEPSFBuilderDeconvolveParameter)
+        return &deconvolve;
+    else if (p == TheEPSFBuilderDeconvolutionIterationsParameter)
+        return &deconvolutionIterations;
+    else if (p == TheEPSFBuilderDeconvolutionToleranceParameter)
+        return &deconvolutionTolerance;
+    else if (p == TheEPSFBuilderPythonWorkersParameter)
+        return &pythonWorkers;
+    else if (p == TheEPSFBuilderTargetFrameEnabledParameter)
+        return &targetFrames[tableRow].enabled;
+    else if (p == TheEPSFBuilderTargetFramePathParameter)
+        return targetFrames[tableRow].path.Begin();
+    else if (p == TheEPSFBuilderOutputDirectoryParameter)
+        return outputDirectory.Begin();
+    else if (p == TheEPSFBuilderAccumulateFramesParameter)
+        return &accumulateFrames;
+    else if (p == TheEPSFBuilderAccumulatedStarsParameter)
+        return &accumulatedStars;
+    else if (p == TheEPSFBuilderTraceFileParameter)
+        return traceFile.Begin();
+    else if (p == TheEPSFBuilderShowStarDetectionParameter)
+        return &showStarDetection;
+    else if (p == TheEPSFBuilderShowExtractedStarsParameter)
+        return &showExtractedStars;
+    return nullptr;
+}
+
+bool EPSFBuilderInstance::AllocateParameter(size_type sizeOrLength, const MetaParameter* p, size_type tableRow)
+{
+    if (p == TheEPSFBuilderTargetFramesParameter)
+    {
+        targetFrames.Clear();
+        if (sizeOrLength > 0)
+            targetFrames.Add(FrameItem(), sizeOrLength);
+    }
+    else if (p == TheEPSFBuilderTargetFramePathParameter)
+    {
+        targetFrames[tableRow].path.Clear();
+        if (sizeOrLength > 0)
+            targetFrames[tableRow].path.SetLength(sizeOrLength);
+    }
+    else if (p == TheEPSFBuilderLibraryDirectoryParameter)
+    {
+        libraryDirectory.Clear();
+        if (sizeOrLength > 0)
+            libraryDirectory.SetLength(sizeOrLength);
+    }
+    else if (p == TheEPSFBuilderOutputDirectoryParameter)
+    {
+        outputDirectory.Clear();
+        if (sizeOrLength > 0)
+            outputDirectory.SetLength(sizeOrLength);
+    }
+    else if (p == TheEPSFBuilderTraceFileParameter)
+    {
+        traceFile.Clear();
+        if (sizeOrLength > 0)
+            traceFile.SetLength(sizeOrLength);
+    }
+    else
+        return false;
+
+    return true;
+}
+
+size_type EPSFBuilderInstance::ParameterLength(const MetaParameter* p, size_type tableRow) const
+{
+    if (p == TheEPSFBuilderTargetFramesParameter)
+        return targetFrames.Length();
+    else if (p == TheEPSFBuilderTargetFramePathParameter)
+        return targetFrames[tableRow].path.Length();
+    else if (p == TheEPSFBuilderLibraryDirectoryParameter)
+        return libraryDirectory.Length();
+    else if (p == TheEPSFBuilderOutputDirectoryParameter)
+        return outputDirectory.Length();
+    else if (p == TheEPSFBuilderTraceFileParameter)
+        return traceFile.Length();
+    return 0;
+}
+
 }	// namespace pcl
\ No newline at end of file
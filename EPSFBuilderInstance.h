@@ -1,51 +1,108 @@
-#ifndef __EPSFBuilderInstance_h
-#define __EPSFBuilderInstance_h
-
-#include <pcl/ProcessImplementation.h>
-#include <pcl/MetaParameter.h> // pcl_enum
-
-namespace pcl
-{
-
-class EPSFBuilderInstance : public ProcessImplementation
-{
-public:
-    EPSFBuilderInstance(const MetaProcess*);
-    EPSFBuilderInstance(const EPSFBuilderInstance&);
-
-    void Assign(const ProcessImplementation&) override;
-    bool IsHistoryUpdater(const View& v) const override;
-    UndoFlags UndoMode(const View&) const override;
-    bool CanExecuteOn(const View&, pcl::String& whyNot) const override;
-    bool ExecuteOn(View&) override;
-    void* LockParameter(const MetaParameter*, size_type tableRow) override;
-
-private:
-    String pythonDll;
-    int maxStars;
-    double starMaxPeak;
-    double starThreshold;
-    double starFWHM;
-    int starSize;
-    int oversampling;
-    pcl_enum smoothingKernel;
-    int maxIterations;
-
-    static HMODULE m_hPythonDll;
-
-    template<typename T>
-    T loadPythonAPI(LPCSTR funcName)
-    {
-        T func = (T)GetProcAddress(m_hPythonDll, funcName);
-        if (func == nullptr)
-            throw Error("Failed to get function " + String(funcName) + " from Python DLL");
-        return func;
-    }
-
-    friend class EPSFBuilderProcess;
-    friend class EPSFBuilderInterface;
-};
-
-}	// namespace pcl
-
+#ifndef __EPSFBuilderInstance_h
+#define __EPSFBuilderInstance_h
+
+#include <functional>
+#include <vector>
+#include <pcl/ImageVariant.h>
+#include <pcl/ProcessImplementation.h>
+#include <pcl/MetaParameter.h> // pcl_enum
+
+#include "EPSFBuilderParameters.h"
+#include "EPSFBuilderPipeline.h"
+#include "EPSFBuilderProfiler.h"
+
+namespace pcl
+{
+
+class EPSFBuilderInstance : public ProcessImplementation
+{
+public:
+    EPSFBuilderInstance(const MetaProcess*);
+    EPSFBuilderInstance(const EPSFBuilderInstance&);
+
+    void Assign(const ProcessImplementation&) override;
+    bool IsHistoryUpdater(const View& v) const override;
+    UndoFlags UndoMode(const View&) const override;
+    bool CanExecuteOn(const View&, pcl::String& whyNot) const override;
+    bool ExecuteOn(View&) override;
+    bool CanExecuteGlobal(pcl::String& whyNot) const override;
+    bool ExecuteGlobal() override;
+    void* LockParameter(const MetaParameter*, size_type tableRow) override;
+    bool AllocateParameter(size_type sizeOrLength, const MetaParameter* p, size_type tableRow) override;
+    size_type ParameterLength(const MetaParameter* p, size_type tableRow) const override;
+
+private:
+    String pythonDll;
+    int maxStars;
+    double starMaxPeak;
+    double starThreshold;
+    double starFWHM;
+    pcl_enum detectionEngine;
+    pcl_enum centroidMethod;
+    pcl_enum backgroundMode;
+    int detectionCacheSize;
+    int tileMemory;
+    int starSize;
+    int oversampling;
+    pcl_enum smoothingKernel;
+    int maxIterations;
+    pcl_enum fittingEngine;
+    int gridColumns;
+    int gridRows;
+    double gridOverlap;
+    pcl_enum photometryOutput;
+    pcl_enum libraryMode;
+    String libraryDirectory;
+    double libraryTimeWindow;
+    double libraryFWHMTolerance;
+    pcl_bool deconvolve;
+    int deconvolutionIterations;
+    double deconvolutionTolerance;
+    int pythonWorkers;
+
+    struct FrameItem
+    {
+        pcl_bool enabled;
+        String path;
+
+        FrameItem(const String& p = String())
+            : enabled(TheEPSFBuilderTargetFrameEnabledParameter->DefaultValue())
+            , path(p)
+        {
+        }
+    };
+
+    typedef Array<FrameItem> frame_list;
+
+    frame_list targetFrames;
+    String outputDirectory;
+    pcl_bool accumulateFrames;
+    int accumulatedStars;
+    String traceFile;
+    pcl_bool showStarDetection;
+    pcl_bool showExtractedStars;
+
+    // Stage outputs of the last ExecuteOn, reused by the next execution on the same view. They are
+    // only kept while Bytes() is within the detection cache size.
+    static EPSFBuilderPipeline::StageOutputs s_lastRun;
+
+    // The parameters of this instance read by EPSFBuilderPipeline
+    EPSFBuilderPipeline::Parameters PipelineParameters() const;
+    bool ExtractsInLoader() const;
+    void ShowDiagnosticWindows(const View& view, const ImageVariant& image, const EPSFBuilderStarArena& stars) const;
+    void CreateResultWindows(const View& view, const ImageVariant& epsfImage, const ImageVariant& gridImage, const ImageVariant& deconvolvedImage) const;
+    void WriteFrameResults(const String& filePath, const ImageVariant& epsfImage, const ImageVariant& gridImage, const EPSFBuilderStarArena& stars, const ImageVariant& deconvolvedImage) const;
+    String OutputBaseName(const String& filePath) const;
+    void ReportProfile(const EPSFBuilderProfiler& profiler) const;
+
+    template <class P>
+    static void DrawDetectionBoxes(GenericImage<P>& image, const EPSFBuilderStarArena& stars, int size);
+
+    friend class EPSFBuilderFrameLoader;
+    friend class EPSFBuilderProcess;
+    friend class EPSFBuilderInterface;
+};
+
+}	// namespace pcl
+
 #endif	// __EPSFBuilderInstance_h
\ No newline at end of file
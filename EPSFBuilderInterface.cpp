@@ -1,324 +1,976 @@
-#include "EPSFBuilderInterface.h"
-#include "EPSFBuilderParameters.h"
-#include "EPSFBuilderProcess.h"
-
-#include <pcl/ErrorHandler.h>
-#include <pcl/FileDialog.h>
-#include <pcl/Settings.h>
-#include <pcl/ViewSelectionDialog.h>
-
-namespace pcl
-{
-
-EPSFBuilderInterface* TheEPSFBuilderInterface = nullptr;
-
-EPSFBuilderInterface::EPSFBuilderInterface()
-	: instance(TheEPSFBuilderProcess)
-{
-	TheEPSFBuilderInterface = this;
-}
-
-EPSFBuilderInterface::~EPSFBuilderInterface()
-{
-	if (GUI != nullptr)
-		delete GUI, GUI = nullptr;
-}
-
-IsoString EPSFBuilderInterface::Id() const
-{
-	return "EPSFBuilder";
-}
-
-MetaProcess* EPSFBuilderInterface::Process() const
-{
-	return TheEPSFBuilderProcess;
-}
-
-IsoString EPSFBuilderInterface::IconImageSVG() const
-{
-	return TheEPSFBuilderProcess->IconImageSVG();
-}
-
-InterfaceFeatures EPSFBuilderInterface::Features() const
-{
-	return InterfaceFeature::Default;
-}
-
-void EPSFBuilderInterface::ApplyInstance() const
-{
-	instance.LaunchOnCurrentView();
-}
-
-void EPSFBuilderInterface::ResetInstance()
-{
-	EPSFBuilderInstance defaultInstance(TheEPSFBuilderProcess);
-	ImportProcess(defaultInstance);
-}
-
-bool EPSFBuilderInterface::Launch(const MetaProcess& P, const ProcessImplementation*, bool& dynamic, unsigned& /*flags*/)
-{
-	if (GUI == nullptr)
-	{
-		GUI = new GUIData(*this);
-		SetWindowTitle("ePSF Builder");
-		Settings::Read("PythonDLL", instance.pythonDll);
-		UpdateControls();
-	}
-
-	dynamic = false;
-	return &P == TheEPSFBuilderProcess;
-}
-
-ProcessImplementation* EPSFBuilderInterface::NewProcess() const
-{
-	return new EPSFBuilderInstance(instance);
-}
-
-bool EPSFBuilderInterface::ValidateProcess(const ProcessImplementation& p, String& whyNot) const
-{
-	if (dynamic_cast<const EPSFBuilderInstance*>(&p) != nullptr)
-		return true;
-	whyNot = "Not a EPSFBuilder instance.";
-	return false;
-}
-
-bool EPSFBuilderInterface::RequiresInstanceValidation() const
-{
-	return true;
-}
-
-bool EPSFBuilderInterface::ImportProcess(const ProcessImplementation& p)
-{
-	instance.Assign(p);
-	UpdateControls();
-	return true;
-}
-
-void EPSFBuilderInterface::UpdateControls()
-{
-	GUI->PythonDLL_Edit.SetText(instance.pythonDll);
-	Settings::Write("PythonDLL", instance.pythonDll);
-	GUI->MaxStars_NumericControl.SetValue(instance.maxStars);
-	GUI->StarMaxPeak_NumericControl.SetValue(instance.starMaxPeak);
-	GUI->StarThreshold_NumericControl.SetValue(instance.starThreshold);
-	GUI->StarFWHM_NumericControl.SetValue(instance.starFWHM);
-	GUI->StarSize_NumericControl.SetValue(instance.starSize);
-	GUI->Oversampling_NumericControl.SetValue(instance.oversampling);
-	GUI->SmoothingKernel_ComboBox.SetCurrentItem(instance.smoothingKernel);
-	GUI->MaxIterations_NumericControl.SetValue(instance.maxIterations);
-}
-
-void EPSFBuilderInterface::__EditValueUpdated(NumericEdit& sender, double value)
-{
-	if (sender == GUI->MaxStars_NumericControl)
-		instance.maxStars = value;
-	else if (sender == GUI->StarMaxPeak_NumericControl)
-		instance.starMaxPeak = value;
-	else if (sender == GUI->StarThreshold_NumericControl)
-		instance.starThreshold = value;
-	else if (sender == GUI->StarFWHM_NumericControl)
-		instance.starFWHM = value;
-	else if (sender == GUI->StarSize_NumericControl)
-		instance.starSize = value;
-	else if (sender == GUI->Oversampling_NumericControl)
-		instance.oversampling = value;
-	else if (sender == GUI->MaxIterations_NumericControl)
-		instance.maxIterations = value;
-}
-
-void EPSFBuilderInterface::__SmoothingKernel_ItemSelected(ComboBox& /*sender*/, int itemIndex)
-{
-	instance.smoothingKernel = itemIndex;
-}
-
-void EPSFBuilderInterface::__EditCompleted(Edit& sender)
-{
-	try
-	{
-		String filePath = sender.Text().Trimmed();
-		if (sender == GUI->PythonDLL_Edit)
-			instance.pythonDll = filePath;
-		UpdateControls();
-	}
-	ERROR_CLEANUP(
-		sender.SelectAll();
-		sender.Focus()
-	)
-}
-
-void EPSFBuilderInterface::__Click(Button& sender, bool checked)
-{
-	if (sender == GUI->PythonDLL_ToolButton)
-	{
-		OpenFileDialog d;
-		d.SetCaption("ePSF Builder: Select Python DLL");
-		d.AddFilter(FileFilter("DLL Files", ".DLL"));
-		d.AddFilter(FileFilter("Any Files", "*"));
-		d.DisableMultipleSelections();
-		if (d.Execute())
-		{
-			instance.pythonDll = d.FileName();
-			UpdateControls();
-		}
-	}
-}
-
-EPSFBuilderInterface::GUIData::GUIData(EPSFBuilderInterface& w)
-{
-	pcl::Font fnt = w.Font();
-	int labelWidth1 = fnt.Width(String("Maximum Iterations:") + 'T');
-	int editWidth1 = fnt.Width(String('0', 10));
-
-	Python_SectionBar.SetTitle("Python");
-	Python_SectionBar.SetSection(Python_Control);
-
-	const char* pythonDllToolTip = "<p>Path to Python DLL. Require to restart PixInsight if switching DLL.</p>";
-
-	PythonDLL_Label.SetText("Python DLL:");
-	PythonDLL_Label.SetFixedWidth(labelWidth1);
-	PythonDLL_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
-	PythonDLL_Label.SetToolTip(pythonDllToolTip);
-
-	PythonDLL_Edit.SetToolTip(pythonDllToolTip);
-	PythonDLL_Edit.SetMinWidth(fnt.Width(String('0', 45)));
-	PythonDLL_Edit.OnEditCompleted((Edit::edit_event_handler) & EPSFBuilderInterface::__EditCompleted, w);
-
-	PythonDLL_ToolButton.SetIcon(w.ScaledResource(":/browser/select-file.png"));
-	PythonDLL_ToolButton.SetScaledFixedSize(20, 20);
-	PythonDLL_ToolButton.SetToolTip("<p>Select Python DLL</p>");
-	PythonDLL_ToolButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
-
-	Python_Sizer.SetSpacing(4);
-	Python_Sizer.Add(PythonDLL_Label);
-	Python_Sizer.Add(PythonDLL_Edit, 100);
-	Python_Sizer.Add(PythonDLL_ToolButton);
-	Python_Sizer.AddStretch();
-
-	Python_Control.SetSizer(Python_Sizer);
-
-	StarDetection_SectionBar.SetTitle("Star Detection");
-	StarDetection_SectionBar.SetSection(StarDetection_Control);
-
-	MaxStars_NumericControl.label.SetText("Maximum stars:");
-	MaxStars_NumericControl.label.SetFixedWidth(labelWidth1);
-	MaxStars_NumericControl.slider.SetRange(0, 500);
-	MaxStars_NumericControl.slider.SetScaledMinWidth(300);
-	MaxStars_NumericControl.SetInteger();
-	MaxStars_NumericControl.SetRange(TheEPSFBuilderMaxStarsParameter->MinimumValue(), TheEPSFBuilderMaxStarsParameter->MaximumValue());
-	MaxStars_NumericControl.edit.SetFixedWidth(editWidth1);
-	MaxStars_NumericControl.SetToolTip("<p>Maximum number of brightest stars that will be detected for ePSF fitting.</p>");
-	MaxStars_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	StarMaxPeak_NumericControl.label.SetText("Maximum peak:");
-	StarMaxPeak_NumericControl.label.SetFixedWidth(labelWidth1);
-	StarMaxPeak_NumericControl.slider.SetRange(0, 500);
-	StarMaxPeak_NumericControl.slider.SetScaledMinWidth(300);
-	StarMaxPeak_NumericControl.SetReal();
-	StarMaxPeak_NumericControl.SetRange(TheEPSFBuilderStarMaxPeakParameter->MinimumValue(), TheEPSFBuilderStarMaxPeakParameter->MaximumValue());
-	StarMaxPeak_NumericControl.SetPrecision(TheEPSFBuilderStarMaxPeakParameter->Precision());
-	StarMaxPeak_NumericControl.edit.SetFixedWidth(editWidth1);
-	StarMaxPeak_NumericControl.SetToolTip("<p>Maximum peak value of a star that will be selected in star detection. This can be used to prevent the saturated stars from being selected.</p>");
-	StarMaxPeak_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	StarThreshold_NumericControl.label.SetText("Threshold:");
-	StarThreshold_NumericControl.label.SetFixedWidth(labelWidth1);
-	StarThreshold_NumericControl.slider.SetRange(0, 500);
-	StarThreshold_NumericControl.slider.SetScaledMinWidth(300);
-	StarThreshold_NumericControl.SetReal();
-	StarThreshold_NumericControl.SetRange(TheEPSFBuilderStarThresholdParameter->MinimumValue(), TheEPSFBuilderStarThresholdParameter->MaximumValue());
-	StarThreshold_NumericControl.SetPrecision(TheEPSFBuilderStarThresholdParameter->Precision());
-	StarThreshold_NumericControl.edit.SetFixedWidth(editWidth1);
-	StarThreshold_NumericControl.SetToolTip("<p>Absolute threshold value above which to detect a star.</p>");
-	StarThreshold_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	StarFWHM_NumericControl.label.SetText("FWHM:");
-	StarFWHM_NumericControl.label.SetFixedWidth(labelWidth1);
-	StarFWHM_NumericControl.slider.SetRange(0, 500);
-	StarFWHM_NumericControl.slider.SetScaledMinWidth(300);
-	StarFWHM_NumericControl.SetReal();
-	StarFWHM_NumericControl.SetRange(TheEPSFBuilderStarFWHMParameter->MinimumValue(), TheEPSFBuilderStarFWHMParameter->MaximumValue());
-	StarFWHM_NumericControl.SetPrecision(TheEPSFBuilderStarFWHMParameter->Precision());
-	StarFWHM_NumericControl.edit.SetFixedWidth(editWidth1);
-	StarFWHM_NumericControl.SetToolTip("<p>FWHM (full-width half-maximum) of the Gaussian kernel in units of pixels.</p>");
-	StarFWHM_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	StarDetection_Sizer.SetSpacing(4);
-	StarDetection_Sizer.Add(MaxStars_NumericControl);
-	StarDetection_Sizer.Add(StarMaxPeak_NumericControl);
-	StarDetection_Sizer.Add(StarThreshold_NumericControl);
-	StarDetection_Sizer.Add(StarFWHM_NumericControl);
-	StarDetection_Sizer.AddStretch();
-
-	StarDetection_Control.SetSizer(StarDetection_Sizer);
-
-	EPSFFitting_SectionBar.SetTitle("ePSF Fitting");
-	EPSFFitting_SectionBar.SetSection(EPSFFitting_Control);
-
-	StarSize_NumericControl.label.SetText("Star size:");
-	StarSize_NumericControl.label.SetFixedWidth(labelWidth1);
-	StarSize_NumericControl.slider.SetRange(0, 500);
-	StarSize_NumericControl.slider.SetScaledMinWidth(300);
-	StarSize_NumericControl.SetInteger();
-	StarSize_NumericControl.SetRange(TheEPSFBuilderStarSizeParameter->MinimumValue(), TheEPSFBuilderStarSizeParameter->MaximumValue());
-	StarSize_NumericControl.edit.SetFixedWidth(editWidth1);
-	StarSize_NumericControl.SetToolTip("<p>Star size in star extraction and of the generated ePSF in pixels along each axis.</p>");
-	StarSize_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	Oversampling_NumericControl.label.SetText("Oversampling:");
-	Oversampling_NumericControl.label.SetFixedWidth(labelWidth1);
-	Oversampling_NumericControl.slider.SetRange(0, 500);
-	Oversampling_NumericControl.slider.SetScaledMinWidth(300);
-	Oversampling_NumericControl.SetInteger();
-	Oversampling_NumericControl.SetRange(TheEPSFBuilderOversamplingParameter->MinimumValue(), TheEPSFBuilderOversamplingParameter->MaximumValue());
-	Oversampling_NumericControl.edit.SetFixedWidth(editWidth1);
-	Oversampling_NumericControl.SetToolTip("<p>Oversampling factor of drizzling when building the ePSF.</p>");
-	Oversampling_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	SmoothingKernel_Label.SetText("Smoothing Kernel:");
-	SmoothingKernel_Label.SetFixedWidth(labelWidth1);
-	SmoothingKernel_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
-	SmoothingKernel_ComboBox.AddItem("Quadratic");
-	SmoothingKernel_ComboBox.AddItem("Quartic");
-	SmoothingKernel_ComboBox.SetToolTip("<p>The smoothing kernel to apply to the ePSF.</p>");
-	SmoothingKernel_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__SmoothingKernel_ItemSelected, w);
-	SmoothingKernel_Sizer.SetSpacing(4);
-	SmoothingKernel_Sizer.Add(SmoothingKernel_Label);
-	SmoothingKernel_Sizer.Add(SmoothingKernel_ComboBox);
-	SmoothingKernel_Sizer.AddStretch();
-
-	MaxIterations_NumericControl.label.SetText("Maximum Iterations:");
-	MaxIterations_NumericControl.label.SetFixedWidth(labelWidth1);
-	MaxIterations_NumericControl.slider.SetRange(0, 500);
-	MaxIterations_NumericControl.slider.SetScaledMinWidth(300);
-	MaxIterations_NumericControl.SetInteger();
-	MaxIterations_NumericControl.SetRange(TheEPSFBuilderMaxIterationsParameter->MinimumValue(), TheEPSFBuilderMaxIterationsParameter->MaximumValue());
-	MaxIterations_NumericControl.edit.SetFixedWidth(editWidth1);
-	MaxIterations_NumericControl.SetToolTip("<p>The maximum number of iterations to perform when building the ePSF.</p>");
-	MaxIterations_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
-
-	EPSFFitting_Sizer.AddSpacing(4);
-	EPSFFitting_Sizer.Add(StarSize_NumericControl);
-	EPSFFitting_Sizer.Add(Oversampling_NumericControl);
-	EPSFFitting_Sizer.Add(SmoothingKernel_Sizer);
-	EPSFFitting_Sizer.Add(MaxIterations_NumericControl);
-	EPSFFitting_Sizer.AddStretch();
-
-	EPSFFitting_Control.SetSizer(EPSFFitting_Sizer);
-
-	Global_Sizer.SetMargin(8);
-	Global_Sizer.SetSpacing(4);
-	Global_Sizer.Add(Python_SectionBar);
-	Global_Sizer.Add(Python_Control);
-	Global_Sizer.Add(StarDetection_SectionBar);
-	Global_Sizer.Add(StarDetection_Control);
-	Global_Sizer.Add(EPSFFitting_SectionBar);
-	Global_Sizer.Add(EPSFFitting_Control);
-
-	w.SetSizer(Global_Sizer);
-
-	w.EnsureLayoutUpdated();
-	w.AdjustToContents();
-	w.SetFixedSize();
-}
-
+#include "EPSFBuilderInterface.h"
+#include "EPSFBuilderParameters.h"
+#include "EPSFBuilderProcess.h"
+
+#include <pcl/ErrorHandler.h>
+#include <pcl/File.h>
+#include <pcl/FileDialog.h>
+#include <pcl/FileFormat.h>
+#include <pcl/Settings.h>
+#include <pcl/ViewSelectionDialog.h>
+
+namespace pcl
+{
+
+EPSFBuilderInterface* TheEPSFBuilderInterface = nullptr;
+
+EPSFBuilderInterface::EPSFBuilderInterface()
+	: instance(TheEPSFBuilderProcess)
+{
+	TheEPSFBuilderInterface = this;
+}
+
+EPSFBuilderInterface::~EPSFBuilderInterface()
+{
+	if (GUI != nullptr)
+		delete GUI, GUI = nullptr;
+}
+
+IsoString EPSFBuilderInterface::Id() const
+{
+	return "EPSFBuilder";
+}
+
+MetaProcess* EPSFBuilderInterface::Process() const
+{
+	return TheEPSFBuilderProcess;
+}
+
+IsoString EPSFBuilderInterface::IconImageSVG() const
+{
+	return TheEPSFBuilderProcess->IconImageSVG();
+}
+
+InterfaceFeatures EPSFBuilderInterface::Features() const
+{
+	return InterfaceFeature::Default | InterfaceFeature::ApplyGlobalButton;
+}
+
+void EPSFBuilderInterface::ApplyInstance() const
+{
+	instance.LaunchOnCurrentView();
+}
+
+void EPSFBuilderInterface::ApplyInstanceGlobal() const
+{
+	instance.LaunchGlobal();
+}
+
+void EPSFBuilderInterface::ResetInstance()
+{
+	EPSFBuilderInstance defaultInstance(TheEPSFBuilderProcess);
+	ImportProcess(defaultInstance);
+}
+
+bool EPSFBuilderInterface::Launch(const MetaProcess& P, const ProcessImplementation*, bool& dynamic, unsigned& /*flags*/)
+{
+	if (GUI == nullptr)
+	{
+		GUI = new GUIData(*this);
+		SetWindowTitle("ePSF Builder");
+		Settings::Read("PythonDLL", instance.pythonDll);
+		UpdateControls();
+	}
+
+	dynamic = false;
+	return &P == TheEPSFBuilderProcess;
+}
+
+ProcessImplementation* EPSFBuilderInterface::NewProcess() const
+{
+	return new EPSFBuilderInstance(instance);
+}
+
+bool EPSFBuilderInterface::ValidateProcess(const ProcessImplementation& p, String& whyNot) const
+{
+	if (dynamic_cast<const EPSFBuilderInstance*>(&p) != nullptr)
+		return true;
+	whyNot = "Not a EPSFBuilder instance.";
+	return false;
+}
+
+bool EPSFBuilderInterface::RequiresInstanceValidation() const
+{
+	return true;
+}
+
+bool EPSFBuilderInterface::ImportProcess(const ProcessImplementation& p)
+{
+	instance.Assign(p);
+	UpdateControls();
+	return true;
+}
+
+void EPSFBuilderInterface::UpdateControls()
+{
+	GUI->PythonDLL_Edit.SetText(instance.pythonDll);
+	Settings::Write("PythonDLL", instance.pythonDll);
+	GUI->MaxStars_NumericControl.SetValue(instance.maxStars);
+	GUI->StarMaxPeak_NumericControl.SetValue(instance.starMaxPeak);
+	GUI->StarThreshold_NumericControl.SetValue(instance.starThreshold);
+	GUI->StarFWHM_NumericControl.SetValue(instance.starFWHM);
+	GUI->DetectionEngine_ComboBox.SetCurrentItem(instance.detectionEngine);
+	GUI->CentroidMethod_ComboBox.SetCurrentItem(instance.centroidMethod);
+	GUI->BackgroundMode_ComboBox.SetCurrentItem(instance.backgroundMode);
+	GUI->DetectionCacheSize_NumericControl.SetValue(instance.detectionCacheSize);
+	GUI->TileMemory_NumericControl.SetValue(instance.tileMemory);
+	GUI->StarSize_NumericControl.SetValue(instance.starSize);
+	GUI->Oversampling_NumericControl.SetValue(instance.oversampling);
+	GUI->SmoothingKernel_ComboBox.SetCurrentItem(instance.smoothingKernel);
+	GUI->MaxIterations_NumericControl.SetValue(instance.maxIterations);
+	GUI->FittingEngine_ComboBox.SetCurrentItem(instance.fittingEngine);
+	GUI->GridColumns_NumericControl.SetValue(instance.gridColumns);
+	GUI->GridRows_NumericControl.SetValue(instance.gridRows);
+	GUI->GridOverlap_NumericControl.SetValue(instance.gridOverlap);
+	GUI->GridOverlap_NumericControl.Enable(instance.gridColumns > 1 || instance.gridRows > 1);
+	GUI->PhotometryOutput_ComboBox.SetCurrentItem(instance.photometryOutput);
+	GUI->PythonWorkers_NumericControl.SetValue(instance.pythonWorkers);
+	GUI->OutputDirectory_Edit.SetText(instance.outputDirectory);
+	GUI->AccumulateFrames_CheckBox.SetChecked(instance.accumulateFrames);
+	GUI->AccumulatedStars_NumericControl.SetValue(instance.accumulatedStars);
+	GUI->AccumulatedStars_NumericControl.Enable(instance.accumulateFrames);
+	GUI->LibraryMode_ComboBox.SetCurrentItem(instance.libraryMode);
+	GUI->LibraryDirectory_Edit.SetText(instance.libraryDirectory);
+	GUI->LibraryTimeWindow_NumericControl.SetValue(instance.libraryTimeWindow);
+	GUI->LibraryTimeWindow_NumericControl.Enable(instance.libraryMode == EPSFBuilderLibraryMode::Reuse);
+	GUI->LibraryFWHMTolerance_NumericControl.SetValue(instance.libraryFWHMTolerance);
+	GUI->LibraryFWHMTolerance_NumericControl.Enable(instance.libraryMode == EPSFBuilderLibraryMode::Reuse);
+	GUI->Deconvolve_CheckBox.SetChecked(instance.deconvolve);
+	GUI->DeconvolutionIterations_NumericControl.SetValue(instance.deconvolutionIterations);
+	GUI->DeconvolutionIterations_NumericControl.Enable(instance.deconvolve);
+	GUI->DeconvolutionTolerance_NumericControl.SetValue(instance.deconvolutionTolerance);
+	GUI->DeconvolutionTolerance_NumericControl.Enable(instance.deconvolve);
+	GUI->TraceFile_Edit.SetText(instance.traceFile);
+	GUI->ShowStarDetection_CheckBox.SetChecked(instance.showStarDetection);
+	GUI->ShowExtractedStars_CheckBox.SetChecked(instance.showExtractedStars);
+	UpdateTargetFramesList();
+}
+
+void EPSFBuilderInterface::UpdateTargetFramesList()
+{
+	int currentIdx = GUI->TargetFrames_TreeBox.ChildIndex(GUI->TargetFrames_TreeBox.CurrentNode());
+
+	GUI->TargetFrames_TreeBox.DisableUpdates();
+	GUI->TargetFrames_TreeBox.Clear();
+
+	for (size_type i = 0; i < instance.targetFrames.Length(); ++i)
+	{
+		const EPSFBuilderInstance::FrameItem& item = instance.targetFrames[i];
+		TreeBox::Node* node = new TreeBox::Node(GUI->TargetFrames_TreeBox);
+		node->SetText(0, String(i + 1));
+		node->SetAlignment(0, TextAlign::Right);
+		node->SetIcon(1, ScaledResource(item.enabled ? ":/browser/enabled.png" : ":/browser/disabled.png"));
+		node->SetAlignment(1, TextAlign::Left);
+		node->SetText(2, File::ExtractNameAndSuffix(item.path));
+		node->SetToolTip(2, item.path);
+		node->SetAlignment(2, TextAlign::Left);
+	}
+
+	GUI->TargetFrames_TreeBox.AdjustColumnWidthToContents(0);
+	GUI->TargetFrames_TreeBox.AdjustColumnWidthToContents(1);
+	GUI->TargetFrames_TreeBox.AdjustColumnWidthToContents(2);
+
+	if (!instance.targetFrames.IsEmpty())
+		if (currentIdx >= 0 && currentIdx < GUI->TargetFrames_TreeBox.NumberOfChildren())
+			GUI->TargetFrames_TreeBox.SetCurrentNode(GUI->TargetFrames_TreeBox[currentIdx]);
+
+	GUI->TargetFrames_TreeBox.EnableUpdates();
+}
+
+void EPSFBuilderInterface::__EditValueUpdated(NumericEdit& sender, double value)
+{
+	if (sender == GUI->MaxStars_NumericControl)
+		instance.maxStars = value;
+	else if (sender == GUI->StarMaxPeak_NumericControl)
+		instance.starMaxPeak = value;
+	else if (sender == GUI->StarThreshold_NumericControl)
+		instance.starThreshold = value;
+	else if (sender == GUI->StarFWHM_NumericControl)
+		instance.starFWHM = value;
+	else if (sender == GUI->StarSize_NumericControl)
+		instance.starSize = value;
+	else if (sender == GUI->Oversampling_NumericControl)
+		instance.oversampling = value;
+	else if (sender == GUI->MaxIterations_NumericControl)
+		instance.maxIterations = value;
+	else if (sender == GUI->GridColumns_NumericControl)
+	{
+		instance.gridColumns = value;
+		UpdateControls();
+	}
+	else if (sender == GUI->GridRows_NumericControl)
+	{
+		instance.gridRows = value;
+		UpdateControls();
+	}
+	else if (sender == GUI->GridOverlap_NumericControl)
+		instance.gridOverlap = value;
+	else if (sender == GUI->DetectionCacheSize_NumericControl)
+		instance.detectionCacheSize = value;
+	else if (sender == GUI->TileMemory_NumericControl)
+		instance.tileMemory = value;
+	else if (sender == GUI->PythonWorkers_NumericControl)
+		instance.pythonWorkers = value;
+	else if (sender == GUI->AccumulatedStars_NumericControl)
+		instance.accumulatedStars = value;
+	else if (sender == GUI->LibraryTimeWindow_NumericControl)
+		instance.libraryTimeWindow = value;
+	else if (sender == GUI->LibraryFWHMTolerance_NumericControl)
+		instance.libraryFWHMTolerance = value;
+	else if (sender == GUI->DeconvolutionIterations_NumericControl)
+		instance.deconvolutionIterations = value;
+	else if (sender == GUI->DeconvolutionTolerance_NumericControl)
+		instance.deconvolutionTolerance = value;
+}
+
+void EPSFBuilderInterface::__SmoothingKernel_ItemSelected(ComboBox& /*sender*/, int itemIndex)
+{
+	instance.smoothingKernel = itemIndex;
+}
+
+void EPSFBuilderInterface::__ItemSelected(ComboBox& sender, int itemIndex)
+{
+	if (sender == GUI->DetectionEngine_ComboBox)
+		instance.detectionEngine = itemIndex;
+	else if (sender == GUI->CentroidMethod_ComboBox)
+		instance.centroidMethod = itemIndex;
+	else if (sender == GUI->BackgroundMode_ComboBox)
+		instance.backgroundMode = itemIndex;
+	else if (sender == GUI->FittingEngine_ComboBox)
+		instance.fittingEngine = itemIndex;
+	else if (sender == GUI->PhotometryOutput_ComboBox)
+		instance.photometryOutput = itemIndex;
+	else if (sender == GUI->LibraryMode_ComboBox)
+	{
+		instance.libraryMode = itemIndex;
+		UpdateControls();
+	}
+}
+
+void EPSFBuilderInterface::__EditCompleted(Edit& sender)
+{
+	try
+	{
+		String filePath = sender.Text().Trimmed();
+		if (sender == GUI->PythonDLL_Edit)
+			instance.pythonDll = filePath;
+		else if (sender == GUI->OutputDirectory_Edit)
+			instance.outputDirectory = filePath;
+		else if (sender == GUI->LibraryDirectory_Edit)
+			instance.libraryDirectory = filePath;
+		else if (sender == GUI->TraceFile_Edit)
+			instance.traceFile = filePath;
+		UpdateControls();
+	}
+	ERROR_CLEANUP(
+		sender.SelectAll();
+		sender.Focus()
+	)
+}
+
+void EPSFBuilderInterface::__Click(Button& sender, bool checked)
+{
+	if (sender == GUI->PythonDLL_ToolButton)
+	{
+		OpenFileDialog d;
+		d.SetCaption("ePSF Builder: Select Python DLL");
+#ifdef __PCL_WINDOWS
+		d.AddFilter(FileFilter("DLL Files", ".DLL"));
+#else
+		d.AddFilter(FileFilter("Shared Libraries", ".so"));
+#endif
+		d.AddFilter(FileFilter("Any Files", "*"));
+		d.DisableMultipleSelections();
+		if (d.Execute())
+		{
+			instance.pythonDll = d.FileName();
+			UpdateControls();
+		}
+	}
+	else if (sender == GUI->AccumulateFrames_CheckBox)
+	{
+		instance.accumulateFrames = checked;
+		UpdateControls();
+	}
+	else if (sender == GUI->Deconvolve_CheckBox)
+	{
+		instance.deconvolve = checked;
+		UpdateControls();
+	}
+	else if (sender == GUI->ShowStarDetection_CheckBox)
+		instance.showStarDetection = checked;
+	else if (sender == GUI->ShowExtractedStars_CheckBox)
+		instance.showExtractedStars = checked;
+	else if (sender == GUI->AddFiles_PushButton)
+	{
+		OpenFileDialog d;
+		d.SetCaption("ePSF Builder: Select Target Frames");
+		d.LoadImageFilters();
+		d.EnableMultipleSelections();
+		if (d.Execute())
+		{
+			for (const String& fileName : d.FileNames())
+				instance.targetFrames.Add(EPSFBuilderInstance::FrameItem(fileName));
+			UpdateTargetFramesList();
+		}
+	}
+	else if (sender == GUI->ToggleFrames_PushButton)
+	{
+		for (int i = 0, n = GUI->TargetFrames_TreeBox.NumberOfChildren(); i < n; ++i)
+			if (GUI->TargetFrames_TreeBox[i]->IsSelected())
+				instance.targetFrames[i].enabled = !instance.targetFrames[i].enabled;
+		UpdateTargetFramesList();
+	}
+	else if (sender == GUI->RemoveFrames_PushButton)
+	{
+		EPSFBuilderInstance::frame_list newTargets;
+		for (int i = 0, n = GUI->TargetFrames_TreeBox.NumberOfChildren(); i < n; ++i)
+			if (!GUI->TargetFrames_TreeBox[i]->IsSelected())
+				newTargets.Add(instance.targetFrames[i]);
+		instance.targetFrames = newTargets;
+		UpdateTargetFramesList();
+	}
+	else if (sender == GUI->ClearFrames_PushButton)
+	{
+		instance.targetFrames.Clear();
+		UpdateTargetFramesList();
+	}
+	else if (sender == GUI->OutputDirectory_ToolButton)
+	{
+		GetDirectoryDialog d;
+		d.SetCaption("ePSF Builder: Select Output Directory");
+		if (d.Execute())
+		{
+			instance.outputDirectory = d.Directory();
+			UpdateControls();
+		}
+	}
+	else if (sender == GUI->LibraryDirectory_ToolButton)
+	{
+		GetDirectoryDialog d;
+		d.SetCaption("ePSF Builder: Select Library Directory");
+		if (d.Execute())
+		{
+			instance.libraryDirectory = d.Directory();
+			UpdateControls();
+		}
+	}
+	else if (sender == GUI->TraceFile_ToolButton)
+	{
+		SaveFileDialog d;
+		d.SetCaption("ePSF Builder: Select Trace File");
+		d.AddFilter(FileFilter("Chrome Trace Files", ".json"));
+		d.AddFilter(FileFilter("Any Files", "*"));
+		d.EnableOverwritePrompt();
+		if (d.Execute())
+		{
+			instance.traceFile = d.FileName();
+			UpdateControls();
+		}
+	}
+}
+
+void EPSFBuilderInterface::__NodeActivated(TreeBox& sender, TreeBox::Node& node, int col)
+{
+	int index = sender.ChildIndex(&node);
+	if (index < 0 || size_type(index) >= instance.targetFrames.Length())
+		return;
+
+	// Double-clicking the second column toggles the frame
+	if (col == 1)
+	{
+		instance.targetFrames[index].enabled = !instance.targetFrames[index].enabled;
+		UpdateTargetFramesList();
+	}
+}
+
+EPSFBuilderInterface::GUIData::GUIData(EPSFBuilderInterface& w)
+{
+	pcl::Font fnt = w.Font();
+	int labelWidth1 = fnt.Width(String("Maximum Iterations:") + 'T');
+	int editWidth1 = fnt.Width(String('0', 10));
+
+	Python_SectionBar.SetTitle("Python");
+	Python_SectionBar.SetSection(Python_Control);
+
+	const char* pythonDllToolTip = "<p>Path to Python DLL. Require to restart PixInsight if switching DLL.</p>";
+
+	PythonDLL_Label.SetText("Python DLL:");
+	PythonDLL_Label.SetFixedWidth(labelWidth1);
+	PythonDLL_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	PythonDLL_Label.SetToolTip(pythonDllToolTip);
+
+	PythonDLL_Edit.SetToolTip(pythonDllToolTip);
+	PythonDLL_Edit.SetMinWidth(fnt.Width(String('0', 45)));
+	PythonDLL_Edit.OnEditCompleted((Edit::edit_event_handler) & EPSFBuilderInterface::__EditCompleted, w);
+
+	PythonDLL_ToolButton.SetIcon(w.ScaledResource(":/browser/select-file.png"));
+	PythonDLL_ToolButton.SetScaledFixedSize(20, 20);
+	PythonDLL_ToolButton.SetToolTip("<p>Select Python DLL</p>");
+	PythonDLL_ToolButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	PythonDLL_Sizer.SetSpacing(4);
+	PythonDLL_Sizer.Add(PythonDLL_Label);
+	PythonDLL_Sizer.Add(PythonDLL_Edit, 100);
+	PythonDLL_Sizer.Add(PythonDLL_ToolButton);
+	PythonDLL_Sizer.AddStretch();
+
+	PythonWorkers_NumericControl.label.SetText("Worker processes:");
+	PythonWorkers_NumericControl.label.SetFixedWidth(labelWidth1);
+	PythonWorkers_NumericControl.slider.SetRange(0, 64);
+	PythonWorkers_NumericControl.slider.SetScaledMinWidth(300);
+	PythonWorkers_NumericControl.SetInteger();
+	PythonWorkers_NumericControl.SetRange(TheEPSFBuilderPythonWorkersParameter->MinimumValue(), TheEPSFBuilderPythonWorkersParameter->MaximumValue());
+	PythonWorkers_NumericControl.edit.SetFixedWidth(editWidth1);
+	PythonWorkers_NumericControl.SetToolTip("<p>Number of persistent Python worker processes. Images and stars are exchanged with the "
+		"workers through shared memory, and in batch mode several frames are processed concurrently. A crash in a worker only fails "
+		"the frame it was processing. The workers run the Python executable found in the directory of the Python DLL.</p>"
+		"<p>With zero workers Python runs in the embedded interpreter.</p>");
+	PythonWorkers_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	Python_Sizer.SetSpacing(4);
+	Python_Sizer.Add(PythonDLL_Sizer);
+	Python_Sizer.Add(PythonWorkers_NumericControl);
+
+	Python_Control.SetSizer(Python_Sizer);
+
+	StarDetection_SectionBar.SetTitle("Star Detection");
+	StarDetection_SectionBar.SetSection(StarDetection_Control);
+
+	MaxStars_NumericControl.label.SetText("Maximum stars:");
+	MaxStars_NumericControl.label.SetFixedWidth(labelWidth1);
+	MaxStars_NumericControl.slider.SetRange(0, 500);
+	MaxStars_NumericControl.slider.SetScaledMinWidth(300);
+	MaxStars_NumericControl.SetInteger();
+	MaxStars_NumericControl.SetRange(TheEPSFBuilderMaxStarsParameter->MinimumValue(), TheEPSFBuilderMaxStarsParameter->MaximumValue());
+	MaxStars_NumericControl.edit.SetFixedWidth(editWidth1);
+	MaxStars_NumericControl.SetToolTip("<p>Maximum number of brightest stars that will be detected for ePSF fitting.</p>");
+	MaxStars_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	StarMaxPeak_NumericControl.label.SetText("Maximum peak:");
+	StarMaxPeak_NumericControl.label.SetFixedWidth(labelWidth1);
+	StarMaxPeak_NumericControl.slider.SetRange(0, 500);
+	StarMaxPeak_NumericControl.slider.SetScaledMinWidth(300);
+	StarMaxPeak_NumericControl.SetReal();
+	StarMaxPeak_NumericControl.SetRange(TheEPSFBuilderStarMaxPeakParameter->MinimumValue(), TheEPSFBuilderStarMaxPeakParameter->MaximumValue());
+	StarMaxPeak_NumericControl.SetPrecision(TheEPSFBuilderStarMaxPeakParameter->Precision());
+	StarMaxPeak_NumericControl.edit.SetFixedWidth(editWidth1);
+	StarMaxPeak_NumericControl.SetToolTip("<p>Maximum peak value of a star that will be selected in star detection. This can be used to prevent the saturated stars from being selected.</p>");
+	StarMaxPeak_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	StarThreshold_NumericControl.label.SetText("Threshold:");
+	StarThreshold_NumericControl.label.SetFixedWidth(labelWidth1);
+	StarThreshold_NumericControl.slider.SetRange(0, 500);
+	StarThreshold_NumericControl.slider.SetScaledMinWidth(300);
+	StarThreshold_NumericControl.SetReal();
+	StarThreshold_NumericControl.SetRange(TheEPSFBuilderStarThresholdParameter->MinimumValue(), TheEPSFBuilderStarThresholdParameter->MaximumValue());
+	StarThreshold_NumericControl.SetPrecision(TheEPSFBuilderStarThresholdParameter->Precision());
+	StarThreshold_NumericControl.edit.SetFixedWidth(editWidth1);
+	StarThreshold_NumericControl.SetToolTip("<p>Absolute threshold value above which to detect a star.</p>");
+	StarThreshold_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	StarFWHM_NumericControl.label.SetText("FWHM:");
+	StarFWHM_NumericControl.label.SetFixedWidth(labelWidth1);
+	StarFWHM_NumericControl.slider.SetRange(0, 500);
+	StarFWHM_NumericControl.slider.SetScaledMinWidth(300);
+	StarFWHM_NumericControl.SetReal();
+	StarFWHM_NumericControl.SetRange(TheEPSFBuilderStarFWHMParameter->MinimumValue(), TheEPSFBuilderStarFWHMParameter->MaximumValue());
+	StarFWHM_NumericControl.SetPrecision(TheEPSFBuilderStarFWHMParameter->Precision());
+	StarFWHM_NumericControl.edit.SetFixedWidth(editWidth1);
+	StarFWHM_NumericControl.SetToolTip("<p>FWHM (full-width half-maximum) of the Gaussian kernel in units of pixels.</p>");
+	StarFWHM_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	DetectionEngine_Label.SetText("Detection engine:");
+	DetectionEngine_Label.SetFixedWidth(labelWidth1);
+	DetectionEngine_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	DetectionEngine_ComboBox.AddItem("Native");
+	DetectionEngine_ComboBox.AddItem("Photutils");
+	DetectionEngine_ComboBox.SetToolTip("<p>The star detection engine. <i>Native</i> runs a multithreaded C++ implementation of the "
+		"DAOFIND algorithm; <i>Photutils</i> runs DAOStarFinder in Python and can be used to validate the native results.</p>");
+	DetectionEngine_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__ItemSelected, w);
+	DetectionEngine_Sizer.SetSpacing(4);
+	DetectionEngine_Sizer.Add(DetectionEngine_Label);
+	DetectionEngine_Sizer.Add(DetectionEngine_ComboBox);
+	DetectionEngine_Sizer.AddStretch();
+
+	CentroidMethod_Label.SetText("Centroiding:");
+	CentroidMethod_Label.SetFixedWidth(labelWidth1);
+	CentroidMethod_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	CentroidMethod_ComboBox.AddItem("Detector");
+	CentroidMethod_ComboBox.AddItem("Moments");
+	CentroidMethod_ComboBox.AddItem("Marginal Gaussian");
+	CentroidMethod_ComboBox.AddItem("Iterative weighted");
+	CentroidMethod_ComboBox.SetToolTip("<p>How star centers are refined. <i>Detector</i> keeps the centroids of the detection "
+		"engine. The other methods recenter every star on a box of about three FWHM: <i>Moments</i> computes its first moments, "
+		"<i>Marginal Gaussian</i> fits a Gaussian to each of its marginal sums, and <i>Iterative weighted</i> computes moments under "
+		"a Gaussian window of the star FWHM, moved until it converges, which is the most accurate on faint stars. The native "
+		"fitter also starts from these centroids.</p>");
+	CentroidMethod_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__ItemSelected, w);
+	CentroidMethod_Sizer.SetSpacing(4);
+	CentroidMethod_Sizer.Add(CentroidMethod_Label);
+	CentroidMethod_Sizer.Add(CentroidMethod_ComboBox);
+	CentroidMethod_Sizer.AddStretch();
+
+	BackgroundMode_Label.SetText("Background:");
+	BackgroundMode_Label.SetFixedWidth(labelWidth1);
+	BackgroundMode_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	BackgroundMode_ComboBox.AddItem("Starlet");
+	BackgroundMode_ComboBox.AddItem("Streaming");
+	BackgroundMode_ComboBox.AddItem("Multiresolution");
+	BackgroundMode_ComboBox.SetToolTip("<p>How the large-scale background is removed before star detection. <i>Starlet</i> "
+		"computes a full starlet transform and keeps every layer in memory. <i>Streaming</i> gives the same result keeping a "
+		"single smoothed plane. <i>Multiresolution</i> estimates the background on a downsampled image, a fraction of the "
+		"cost of the full transform at the price of an approximate result.</p>");
+	BackgroundMode_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__ItemSelected, w);
+	BackgroundMode_Sizer.SetSpacing(4);
+	BackgroundMode_Sizer.Add(BackgroundMode_Label);
+	BackgroundMode_Sizer.Add(BackgroundMode_ComboBox);
+	BackgroundMode_Sizer.AddStretch();
+
+	DetectionCacheSize_NumericControl.label.SetText("Cache size (MiB):");
+	DetectionCacheSize_NumericControl.label.SetFixedWidth(labelWidth1);
+	DetectionCacheSize_NumericControl.slider.SetRange(0, 256);
+	DetectionCacheSize_NumericControl.slider.SetScaledMinWidth(300);
+	DetectionCacheSize_NumericControl.SetInteger();
+	DetectionCacheSize_NumericControl.SetRange(TheEPSFBuilderDetectionCacheSizeParameter->MinimumValue(), TheEPSFBuilderDetectionCacheSizeParameter->MaximumValue());
+	DetectionCacheSize_NumericControl.edit.SetFixedWidth(editWidth1);
+	DetectionCacheSize_NumericControl.SetToolTip("<p>Memory reserved for the detection cache. The background-subtracted image and the "
+		"extracted stars are kept for every processed image, and are reused when the same pixels are processed again with the same "
+		"detection parameters, so only the ePSF is rebuilt when tuning the fitting parameters. The outputs of the last execution on a "
+		"view are kept within the same limit. Zero disables the cache.</p>");
+	DetectionCacheSize_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	TileMemory_NumericControl.label.SetText("Tile memory (MiB):");
+	TileMemory_NumericControl.label.SetFixedWidth(labelWidth1);
+	TileMemory_NumericControl.slider.SetRange(0, 4096);
+	TileMemory_NumericControl.slider.SetScaledMinWidth(300);
+	TileMemory_NumericControl.SetInteger();
+	TileMemory_NumericControl.SetRange(TheEPSFBuilderTileMemoryParameter->MinimumValue(), TheEPSFBuilderTileMemoryParameter->MaximumValue());
+	TileMemory_NumericControl.edit.SetFixedWidth(editWidth1);
+	TileMemory_NumericControl.SetToolTip("<p>Memory budget of tiled processing, for images too large to be processed as a whole. "
+		"Background removal, star detection and star extraction run on overlapping tiles, one at a time, each using at most this "
+		"memory, and the background-subtracted image is kept in a temporary file. The star catalogs of the tiles are merged without "
+		"duplicates. Tiled processing requires the native detection and fitting engines. Zero processes the whole image at once.</p>");
+	TileMemory_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	StarDetection_Sizer.SetSpacing(4);
+	StarDetection_Sizer.Add(MaxStars_NumericControl);
+	StarDetection_Sizer.Add(StarMaxPeak_NumericControl);
+	StarDetection_Sizer.Add(StarThreshold_NumericControl);
+	StarDetection_Sizer.Add(StarFWHM_NumericControl);
+	StarDetection_Sizer.Add(DetectionEngine_Sizer);
+	StarDetection_Sizer.Add(CentroidMethod_Sizer);
+	StarDetection_Sizer.Add(BackgroundMode_Sizer);
+	StarDetection_Sizer.Add(DetectionCacheSize_NumericControl);
+	StarDetection_Sizer.Add(TileMemory_NumericControl);
+	StarDetection_Sizer.AddStretch();
+
+	StarDetection_Control.SetSizer(StarDetection_Sizer);
+
+	EPSFFitting_SectionBar.SetTitle("ePSF Fitting");
+	EPSFFitting_SectionBar.SetSection(EPSFFitting_Control);
+
+	StarSize_NumericControl.label.SetText("Star size:");
+	StarSize_NumericControl.label.SetFixedWidth(labelWidth1);
+	StarSize_NumericControl.slider.SetRange(0, 500);
+	StarSize_NumericControl.slider.SetScaledMinWidth(300);
+	StarSize_NumericControl.SetInteger();
+	StarSize_NumericControl.SetRange(TheEPSFBuilderStarSizeParameter->MinimumValue(), TheEPSFBuilderStarSizeParameter->MaximumValue());
+	StarSize_NumericControl.edit.SetFixedWidth(editWidth1);
+	StarSize_NumericControl.SetToolTip("<p>Star size in star extraction and of the generated ePSF in pixels along each axis.</p>");
+	StarSize_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	Oversampling_NumericControl.label.SetText("Oversampling:");
+	Oversampling_NumericControl.label.SetFixedWidth(labelWidth1);
+	Oversampling_NumericControl.slider.SetRange(0, 500);
+	Oversampling_NumericControl.slider.SetScaledMinWidth(300);
+	Oversampling_NumericControl.SetInteger();
+	Oversampling_NumericControl.SetRange(TheEPSFBuilderOversamplingParameter->MinimumValue(), TheEPSFBuilderOversamplingParameter->MaximumValue());
+	Oversampling_NumericControl.edit.SetFixedWidth(editWidth1);
+	Oversampling_NumericControl.SetToolTip("<p>Oversampling factor of drizzling when building the ePSF.</p>");
+	Oversampling_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	SmoothingKernel_Label.SetText("Smoothing Kernel:");
+	SmoothingKernel_Label.SetFixedWidth(labelWidth1);
+	SmoothingKernel_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	SmoothingKernel_ComboBox.AddItem("Quadratic");
+	SmoothingKernel_ComboBox.AddItem("Quartic");
+	SmoothingKernel_ComboBox.SetToolTip("<p>The smoothing kernel to apply to the ePSF.</p>");
+	SmoothingKernel_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__SmoothingKernel_ItemSelected, w);
+	SmoothingKernel_Sizer.SetSpacing(4);
+	SmoothingKernel_Sizer.Add(SmoothingKernel_Label);
+	SmoothingKernel_Sizer.Add(SmoothingKernel_ComboBox);
+	SmoothingKernel_Sizer.AddStretch();
+
+	MaxIterations_NumericControl.label.SetText("Maximum Iterations:");
+	MaxIterations_NumericControl.label.SetFixedWidth(labelWidth1);
+	MaxIterations_NumericControl.slider.SetRange(0, 500);
+	MaxIterations_NumericControl.slider.SetScaledMinWidth(300);
+	MaxIterations_NumericControl.SetInteger();
+	MaxIterations_NumericControl.SetRange(TheEPSFBuilderMaxIterationsParameter->MinimumValue(), TheEPSFBuilderMaxIterationsParameter->MaximumValue());
+	MaxIterations_NumericControl.edit.SetFixedWidth(editWidth1);
+	MaxIterations_NumericControl.SetToolTip("<p>The maximum number of iterations to perform when building the ePSF.</p>");
+	MaxIterations_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	FittingEngine_Label.SetText("Fitting engine:");
+	FittingEngine_Label.SetFixedWidth(labelWidth1);
+	FittingEngine_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	FittingEngine_ComboBox.AddItem("Native");
+	FittingEngine_ComboBox.AddItem("Photutils");
+	FittingEngine_ComboBox.SetToolTip("<p>The ePSF building engine. <i>Native</i> runs a multithreaded C++ implementation of the "
+		"photutils EPSFBuilder algorithm; <i>Photutils</i> runs EPSFBuilder in Python and can be used to validate the native results.</p>");
+	FittingEngine_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__ItemSelected, w);
+	FittingEngine_Sizer.SetSpacing(4);
+	FittingEngine_Sizer.Add(FittingEngine_Label);
+	FittingEngine_Sizer.Add(FittingEngine_ComboBox);
+	FittingEngine_Sizer.AddStretch();
+
+	GridColumns_NumericControl.label.SetText("Grid columns:");
+	GridColumns_NumericControl.label.SetFixedWidth(labelWidth1);
+	GridColumns_NumericControl.slider.SetRange(1, 16);
+	GridColumns_NumericControl.slider.SetScaledMinWidth(300);
+	GridColumns_NumericControl.SetInteger();
+	GridColumns_NumericControl.SetRange(TheEPSFBuilderGridColumnsParameter->MinimumValue(), TheEPSFBuilderGridColumnsParameter->MaximumValue());
+	GridColumns_NumericControl.edit.SetFixedWidth(editWidth1);
+	GridColumns_NumericControl.SetToolTip("<p>Number of columns of the PSF grid. When the grid has more than one cell, an ePSF is "
+		"also built for every cell of the image to model a spatially varying PSF, and the cell ePSFs are tiled into a PSF grid image.</p>");
+	GridColumns_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	GridRows_NumericControl.label.SetText("Grid rows:");
+	GridRows_NumericControl.label.SetFixedWidth(labelWidth1);
+	GridRows_NumericControl.slider.SetRange(1, 16);
+	GridRows_NumericControl.slider.SetScaledMinWidth(300);
+	GridRows_NumericControl.SetInteger();
+	GridRows_NumericControl.SetRange(TheEPSFBuilderGridRowsParameter->MinimumValue(), TheEPSFBuilderGridRowsParameter->MaximumValue());
+	GridRows_NumericControl.edit.SetFixedWidth(editWidth1);
+	GridRows_NumericControl.SetToolTip("<p>Number of rows of the PSF grid.</p>");
+	GridRows_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	GridOverlap_NumericControl.label.SetText("Grid overlap:");
+	GridOverlap_NumericControl.label.SetFixedWidth(labelWidth1);
+	GridOverlap_NumericControl.slider.SetRange(0, 100);
+	GridOverlap_NumericControl.slider.SetScaledMinWidth(300);
+	GridOverlap_NumericControl.SetReal();
+	GridOverlap_NumericControl.SetRange(TheEPSFBuilderGridOverlapParameter->MinimumValue(), TheEPSFBuilderGridOverlapParameter->MaximumValue());
+	GridOverlap_NumericControl.SetPrecision(TheEPSFBuilderGridOverlapParameter->Precision());
+	GridOverlap_NumericControl.edit.SetFixedWidth(editWidth1);
+	GridOverlap_NumericControl.SetToolTip("<p>Fraction of the cell size by which every grid cell is enlarged on each side when "
+		"selecting its stars, so that stars near a border are shared with the neighboring cells. Cells with too few stars are "
+		"enlarged further. The cells are always fitted with the native engine.</p>");
+	GridOverlap_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	PhotometryOutput_Label.SetText("PSF photometry:");
+	PhotometryOutput_Label.SetFixedWidth(labelWidth1);
+	PhotometryOutput_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	PhotometryOutput_ComboBox.AddItem("Disabled");
+	PhotometryOutput_ComboBox.AddItem("CSV catalog");
+	PhotometryOutput_ComboBox.AddItem("FITS table");
+	PhotometryOutput_ComboBox.SetToolTip("<p>Fits the finished ePSF to every detected star and writes its flux, center, "
+		"fit residual and reduced chi-squared to &lt;name&gt;_photometry.csv or &lt;name&gt;_photometry.fits, next to the "
+		"image or in the output directory. Not available with tiled processing or accumulated frames.</p>");
+	PhotometryOutput_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__ItemSelected, w);
+	PhotometryOutput_Sizer.SetSpacing(4);
+	PhotometryOutput_Sizer.Add(PhotometryOutput_Label);
+	PhotometryOutput_Sizer.Add(PhotometryOutput_ComboBox);
+	PhotometryOutput_Sizer.AddStretch();
+
+	EPSFFitting_Sizer.AddSpacing(4);
+	EPSFFitting_Sizer.Add(StarSize_NumericControl);
+	EPSFFitting_Sizer.Add(Oversampling_NumericControl);
+	EPSFFitting_Sizer.Add(SmoothingKernel_Sizer);
+	EPSFFitting_Sizer.Add(MaxIterations_NumericControl);
+	EPSFFitting_Sizer.Add(FittingEngine_Sizer);
+	EPSFFitting_Sizer.Add(GridColumns_NumericControl);
+	EPSFFitting_Sizer.Add(GridRows_NumericControl);
+	EPSFFitting_Sizer.Add(GridOverlap_NumericControl);
+	EPSFFitting_Sizer.Add(PhotometryOutput_Sizer);
+	EPSFFitting_Sizer.AddStretch();
+
+	EPSFFitting_Control.SetSizer(EPSFFitting_Sizer);
+
+	BatchProcessing_SectionBar.SetTitle("Batch Processing");
+	BatchProcessing_SectionBar.SetSection(BatchProcessing_Control);
+
+	TargetFrames_TreeBox.SetMinHeight(fnt.Height() * 8);
+	TargetFrames_TreeBox.SetScaledMinWidth(344);
+	TargetFrames_TreeBox.SetNumberOfColumns(3);
+	TargetFrames_TreeBox.HideHeader();
+	TargetFrames_TreeBox.EnableMultipleSelections();
+	TargetFrames_TreeBox.DisableRootDecoration();
+	TargetFrames_TreeBox.EnableAlternateRowColor();
+	TargetFrames_TreeBox.SetToolTip("<p>Image files processed by global execution. For each enabled frame the ePSF and the "
+		"catalog of the stars used to build it are written to the output directory; no image windows are opened.</p>");
+	TargetFrames_TreeBox.OnNodeActivated((TreeBox::node_event_handler) & EPSFBuilderInterface::__NodeActivated, w);
+
+	AddFiles_PushButton.SetText("Add Files");
+	AddFiles_PushButton.SetToolTip("<p>Add existing image files to the list of target frames.</p>");
+	AddFiles_PushButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	ToggleFrames_PushButton.SetText("Toggle");
+	ToggleFrames_PushButton.SetToolTip("<p>Toggle the enabled/disabled state of the selected target frames.</p>");
+	ToggleFrames_PushButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	RemoveFrames_PushButton.SetText("Remove");
+	RemoveFrames_PushButton.SetToolTip("<p>Remove the selected target frames from the list.</p>");
+	RemoveFrames_PushButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	ClearFrames_PushButton.SetText("Clear");
+	ClearFrames_PushButton.SetToolTip("<p>Clear the list of target frames.</p>");
+	ClearFrames_PushButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	TargetButtons_Sizer.SetSpacing(4);
+	TargetButtons_Sizer.Add(AddFiles_PushButton);
+	TargetButtons_Sizer.Add(ToggleFrames_PushButton);
+	TargetButtons_Sizer.Add(RemoveFrames_PushButton);
+	TargetButtons_Sizer.Add(ClearFrames_PushButton);
+	TargetButtons_Sizer.AddStretch();
+
+	TargetFrames_Sizer.SetSpacing(4);
+	TargetFrames_Sizer.Add(TargetFrames_TreeBox, 100);
+	TargetFrames_Sizer.Add(TargetButtons_Sizer);
+
+	const char* outputDirectoryToolTip = "<p>Directory where the ePSF and star catalog of each target frame are written. "
+		"If empty, they are written next to the target frame.</p>";
+
+	OutputDirectory_Label.SetText("Output directory:");
+	OutputDirectory_Label.SetFixedWidth(labelWidth1);
+	OutputDirectory_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	OutputDirectory_Label.SetToolTip(outputDirectoryToolTip);
+
+	OutputDirectory_Edit.SetToolTip(outputDirectoryToolTip);
+	OutputDirectory_Edit.OnEditCompleted((Edit::edit_event_handler) & EPSFBuilderInterface::__EditCompleted, w);
+
+	OutputDirectory_ToolButton.SetIcon(w.ScaledResource(":/browser/select-file.png"));
+	OutputDirectory_ToolButton.SetScaledFixedSize(20, 20);
+	OutputDirectory_ToolButton.SetToolTip("<p>Select output directory</p>");
+	OutputDirectory_ToolButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	OutputDirectory_Sizer.SetSpacing(4);
+	OutputDirectory_Sizer.Add(OutputDirectory_Label);
+	OutputDirectory_Sizer.Add(OutputDirectory_Edit, 100);
+	OutputDirectory_Sizer.Add(OutputDirectory_ToolButton);
+
+	AccumulateFrames_CheckBox.SetText("Accumulate frames");
+	AccumulateFrames_CheckBox.SetToolTip("<p>Build a single ePSF from the stars of all target frames, which must be registered. "
+		"The frames are read and their stars extracted concurrently, with the native detection, and the ePSF is written to "
+		"the output directory, or next to the first frame, with an _accumulated suffix.</p>");
+	AccumulateFrames_CheckBox.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	AccumulateFrames_Sizer.AddUnscaledSpacing(labelWidth1 + w.LogicalPixelsToPhysical(4));
+	AccumulateFrames_Sizer.Add(AccumulateFrames_CheckBox);
+	AccumulateFrames_Sizer.AddStretch();
+
+	AccumulatedStars_NumericControl.label.SetText("Accumulated stars:");
+	AccumulatedStars_NumericControl.label.SetFixedWidth(labelWidth1);
+	AccumulatedStars_NumericControl.slider.SetRange(0, 100);
+	AccumulatedStars_NumericControl.slider.SetScaledMinWidth(300);
+	AccumulatedStars_NumericControl.SetInteger();
+	AccumulatedStars_NumericControl.SetRange(TheEPSFBuilderAccumulatedStarsParameter->MinimumValue(), TheEPSFBuilderAccumulatedStarsParameter->MaximumValue());
+	AccumulatedStars_NumericControl.edit.SetFixedWidth(editWidth1);
+	AccumulatedStars_NumericControl.SetToolTip("<p>Maximum number of stars kept from all frames for the accumulated ePSF. "
+		"When the frames hold more, a pseudo-random sample of this size is kept, which bounds memory and fitting time.</p>");
+	AccumulatedStars_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	BatchProcessing_Sizer.SetSpacing(4);
+	BatchProcessing_Sizer.Add(TargetFrames_Sizer, 100);
+	BatchProcessing_Sizer.Add(OutputDirectory_Sizer);
+	BatchProcessing_Sizer.Add(AccumulateFrames_Sizer);
+	BatchProcessing_Sizer.Add(AccumulatedStars_NumericControl);
+
+	BatchProcessing_Control.SetSizer(BatchProcessing_Sizer);
+
+	Library_SectionBar.SetTitle("ePSF Library");
+	Library_SectionBar.SetSection(Library_Control);
+
+	LibraryMode_Label.SetText("Library:");
+	LibraryMode_Label.SetFixedWidth(labelWidth1);
+	LibraryMode_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	LibraryMode_ComboBox.AddItem("Disabled");
+	LibraryMode_ComboBox.AddItem("Store");
+	LibraryMode_ComboBox.AddItem("Store and reuse");
+	LibraryMode_ComboBox.SetToolTip("<p><i>Store</i> writes every finished ePSF to the library directory, with the instrument, "
+		"filter and observation date of its frame, its oversampling, size, number of stars and FWHM as FITS keywords, and adds "
+		"it to the index of the library.</p>"
+		"<p><i>Store and reuse</i> first looks up the index for an ePSF of the same instrument, filter, oversampling and size, "
+		"observed within the time window and with a FWHM within the tolerance of the star FWHM. A matching ePSF is loaded "
+		"instead of being built, without diagnostic windows. It is never reused in grid mode, with PSF photometry or "
+		"when accumulating frames, which all need the stars.</p>");
+	LibraryMode_ComboBox.OnItemSelected((ComboBox::item_event_handler) & EPSFBuilderInterface::__ItemSelected, w);
+	LibraryMode_Sizer.SetSpacing(4);
+	LibraryMode_Sizer.Add(LibraryMode_Label);
+	LibraryMode_Sizer.Add(LibraryMode_ComboBox);
+	LibraryMode_Sizer.AddStretch();
+
+	const char* libraryDirectoryToolTip = "<p>Directory of the ePSF library, with the stored ePSFs and their index.</p>";
+
+	LibraryDirectory_Label.SetText("Library directory:");
+	LibraryDirectory_Label.SetFixedWidth(labelWidth1);
+	LibraryDirectory_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	LibraryDirectory_Label.SetToolTip(libraryDirectoryToolTip);
+
+	LibraryDirectory_Edit.SetToolTip(libraryDirectoryToolTip);
+	LibraryDirectory_Edit.OnEditCompleted((Edit::edit_event_handler) & EPSFBuilderInterface::__EditCompleted, w);
+
+	LibraryDirectory_ToolButton.SetIcon(w.ScaledResource(":/browser/select-file.png"));
+	LibraryDirectory_ToolButton.SetScaledFixedSize(20, 20);
+	LibraryDirectory_ToolButton.SetToolTip("<p>Select library directory</p>");
+	LibraryDirectory_ToolButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	LibraryDirectory_Sizer.SetSpacing(4);
+	LibraryDirectory_Sizer.Add(LibraryDirectory_Label);
+	LibraryDirectory_Sizer.Add(LibraryDirectory_Edit, 100);
+	LibraryDirectory_Sizer.Add(LibraryDirectory_ToolButton);
+
+	LibraryTimeWindow_NumericControl.label.SetText("Time window:");
+	LibraryTimeWindow_NumericControl.label.SetFixedWidth(labelWidth1);
+	LibraryTimeWindow_NumericControl.slider.SetRange(0, 100);
+	LibraryTimeWindow_NumericControl.slider.SetScaledMinWidth(300);
+	LibraryTimeWindow_NumericControl.SetReal();
+	LibraryTimeWindow_NumericControl.SetRange(TheEPSFBuilderLibraryTimeWindowParameter->MinimumValue(), TheEPSFBuilderLibraryTimeWindowParameter->MaximumValue());
+	LibraryTimeWindow_NumericControl.SetPrecision(TheEPSFBuilderLibraryTimeWindowParameter->Precision());
+	LibraryTimeWindow_NumericControl.edit.SetFixedWidth(editWidth1);
+	LibraryTimeWindow_NumericControl.SetToolTip("<p>Maximum time in hours between the DATE-OBS of the target and that of the "
+		"frame of a reused ePSF. Targets and ePSFs without a date are never matched.</p>");
+	LibraryTimeWindow_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	LibraryFWHMTolerance_NumericControl.label.SetText("FWHM tolerance:");
+	LibraryFWHMTolerance_NumericControl.label.SetFixedWidth(labelWidth1);
+	LibraryFWHMTolerance_NumericControl.slider.SetRange(0, 100);
+	LibraryFWHMTolerance_NumericControl.slider.SetScaledMinWidth(300);
+	LibraryFWHMTolerance_NumericControl.SetReal();
+	LibraryFWHMTolerance_NumericControl.SetRange(TheEPSFBuilderLibraryFWHMToleranceParameter->MinimumValue(), TheEPSFBuilderLibraryFWHMToleranceParameter->MaximumValue());
+	LibraryFWHMTolerance_NumericControl.SetPrecision(TheEPSFBuilderLibraryFWHMToleranceParameter->Precision());
+	LibraryFWHMTolerance_NumericControl.edit.SetFixedWidth(editWidth1);
+	LibraryFWHMTolerance_NumericControl.SetToolTip("<p>Maximum difference in pixels between the star FWHM and the star FWHM "
+		"a reused ePSF was built with.</p>");
+	LibraryFWHMTolerance_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	Library_Sizer.SetSpacing(4);
+	Library_Sizer.Add(LibraryMode_Sizer);
+	Library_Sizer.Add(LibraryDirectory_Sizer);
+	Library_Sizer.Add(LibraryTimeWindow_NumericControl);
+	Library_Sizer.Add(LibraryFWHMTolerance_NumericControl);
+
+	Library_Control.SetSizer(Library_Sizer);
+
+	Deconvolution_SectionBar.SetTitle("Deconvolution");
+	Deconvolution_SectionBar.SetSection(Deconvolution_Control);
+
+	Deconvolve_CheckBox.SetText("Deconvolve target");
+	Deconvolve_CheckBox.SetToolTip("<p>Deconvolve the target with the finished ePSF, or with the PSF grid when there is one, "
+		"by Richardson-Lucy iterations. The result opens in a new window with a _deconvolved suffix, or is written next to the "
+		"other results of a batch. Large images are deconvolved in overlapping tiles, each with the ePSF of its grid cell.</p>");
+	Deconvolve_CheckBox.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	Deconvolve_Sizer.AddUnscaledSpacing(labelWidth1 + w.LogicalPixelsToPhysical(4));
+	Deconvolve_Sizer.Add(Deconvolve_CheckBox);
+	Deconvolve_Sizer.AddStretch();
+
+	DeconvolutionIterations_NumericControl.label.SetText("Iterations:");
+	DeconvolutionIterations_NumericControl.label.SetFixedWidth(labelWidth1);
+	DeconvolutionIterations_NumericControl.slider.SetRange(0, 200);
+	DeconvolutionIterations_NumericControl.slider.SetScaledMinWidth(300);
+	DeconvolutionIterations_NumericControl.SetInteger();
+	DeconvolutionIterations_NumericControl.SetRange(TheEPSFBuilderDeconvolutionIterationsParameter->MinimumValue(), TheEPSFBuilderDeconvolutionIterationsParameter->MaximumValue());
+	DeconvolutionIterations_NumericControl.edit.SetFixedWidth(editWidth1);
+	DeconvolutionIterations_NumericControl.SetToolTip("<p>Maximum number of Richardson-Lucy iterations of every tile.</p>");
+	DeconvolutionIterations_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	DeconvolutionTolerance_NumericControl.label.SetText("Convergence:");
+	DeconvolutionTolerance_NumericControl.label.SetFixedWidth(labelWidth1);
+	DeconvolutionTolerance_NumericControl.slider.SetRange(0, 100);
+	DeconvolutionTolerance_NumericControl.slider.SetScaledMinWidth(300);
+	DeconvolutionTolerance_NumericControl.SetReal();
+	DeconvolutionTolerance_NumericControl.SetRange(TheEPSFBuilderDeconvolutionToleranceParameter->MinimumValue(), TheEPSFBuilderDeconvolutionToleranceParameter->MaximumValue());
+	DeconvolutionTolerance_NumericControl.SetPrecision(TheEPSFBuilderDeconvolutionToleranceParameter->Precision());
+	DeconvolutionTolerance_NumericControl.edit.SetFixedWidth(editWidth1);
+	DeconvolutionTolerance_NumericControl.SetToolTip("<p>A tile stops iterating when its estimate changes by less than this "
+		"fraction of its flux in one iteration. Zero runs every iteration.</p>");
+	DeconvolutionTolerance_NumericControl.OnValueUpdated((NumericEdit::value_event_handler) & EPSFBuilderInterface::__EditValueUpdated, w);
+
+	Deconvolution_Sizer.SetSpacing(4);
+	Deconvolution_Sizer.Add(Deconvolve_Sizer);
+	Deconvolution_Sizer.Add(DeconvolutionIterations_NumericControl);
+	Deconvolution_Sizer.Add(DeconvolutionTolerance_NumericControl);
+
+	Deconvolution_Control.SetSizer(Deconvolution_Sizer);
+
+	Diagnostics_SectionBar.SetTitle("Diagnostics");
+	Diagnostics_SectionBar.SetSection(Diagnostics_Control);
+
+	const char* traceFileToolTip = "<p>Every execution prints the wall time and memory use of each stage to the console. "
+		"If a file is specified, the stage timings of the last execution are also written to it in Chrome trace event format, "
+		"which can be opened with chrome://tracing or Perfetto to compare runs across machines.</p>";
+
+	TraceFile_Label.SetText("Trace file:");
+	TraceFile_Label.SetFixedWidth(labelWidth1);
+	TraceFile_Label.SetTextAlignment(TextAlign::Right | TextAlign::VertCenter);
+	TraceFile_Label.SetToolTip(traceFileToolTip);
+
+	TraceFile_Edit.SetToolTip(traceFileToolTip);
+	TraceFile_Edit.OnEditCompleted((Edit::edit_event_handler) & EPSFBuilderInterface::__EditCompleted, w);
+
+	TraceFile_ToolButton.SetIcon(w.ScaledResource(":/browser/select-file.png"));
+	TraceFile_ToolButton.SetScaledFixedSize(20, 20);
+	TraceFile_ToolButton.SetToolTip("<p>Select trace file</p>");
+	TraceFile_ToolButton.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	TraceFile_Sizer.SetSpacing(4);
+	TraceFile_Sizer.Add(TraceFile_Label);
+	TraceFile_Sizer.Add(TraceFile_Edit, 100);
+	TraceFile_Sizer.Add(TraceFile_ToolButton);
+
+	ShowStarDetection_CheckBox.SetText("Star detection window");
+	ShowStarDetection_CheckBox.SetToolTip("<p>Open a copy of the target with a box around every extracted star. "
+		"Disable it on large images when the boxes are not needed: the copy costs as much memory as the target.</p>");
+	ShowStarDetection_CheckBox.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	ShowStarDetection_Sizer.AddUnscaledSpacing(labelWidth1 + w.LogicalPixelsToPhysical(4));
+	ShowStarDetection_Sizer.Add(ShowStarDetection_CheckBox);
+	ShowStarDetection_Sizer.AddStretch();
+
+	ShowExtractedStars_CheckBox.SetText("Extracted stars window");
+	ShowExtractedStars_CheckBox.SetToolTip("<p>Open a mosaic of the stars the ePSF is built from.</p>");
+	ShowExtractedStars_CheckBox.OnClick((Button::click_event_handler) & EPSFBuilderInterface::__Click, w);
+
+	ShowExtractedStars_Sizer.AddUnscaledSpacing(labelWidth1 + w.LogicalPixelsToPhysical(4));
+	ShowExtractedStars_Sizer.Add(ShowExtractedStars_CheckBox);
+	ShowExtractedStars_Sizer.AddStretch();
+
+	Diagnostics_Sizer.SetSpacing(4);
+	Diagnostics_Sizer.Add(TraceFile_Sizer);
+	Diagnostics_Sizer.Add(ShowStarDetection_Sizer);
+	Diagnostics_Sizer.Add(ShowExtractedStars_Sizer);
+
+	Diagnostics_Control.SetSizer(Diagnostics_Sizer);
+
+	Global_Sizer.SetMargin(8);
+	Global_Sizer.SetSpacing(4);
+	Global_Sizer.Add(Python_SectionBar);
+	Global_Sizer.Add(Python_Control);
+	Global_Sizer.Add(StarDetection_SectionBar);
+	Global_Sizer.Add(StarDetection_Control);
+	Global_Sizer.Add(EPSFFitting_SectionBar);
+	Global_Sizer.Add(EPSFFitting_Control);
+	Global_Sizer.Add(BatchProcessing_SectionBar);
+	Global_Sizer.Add(BatchProcessing_Control);
+	Global_Sizer.Add(Library_SectionBar);
+	Global_Sizer.Add(Library_Control);
+	Global_Sizer.Add(Deconvolution_SectionBar);
+	Global_Sizer.Add(Deconvolution_Control);
+	Global_Sizer.Add(Diagnostics_SectionBar);
+	Global_Sizer.Add(Diagnostics_Control);
+
+	w.SetSizer(Global_Sizer);
+
+	BatchProcessing_Control.Hide();
+	Library_Control.Hide();
+	Deconvolution_Control.Hide();
+	Diagnostics_Control.Hide();
+
+	w.EnsureLayoutUpdated();
+	w.AdjustToContents();
+	w.SetFixedSize();
+}
+
 }	// namespace pcl
\ No newline at end of file
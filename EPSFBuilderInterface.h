@@ -1,85 +1,165 @@
-#ifndef __EPSFBuilderInterface_h
-#define __EPSFBuilderInterface_h
-
-#include <pcl/ComboBox.h>
-#include <pcl/NumericControl.h>
-#include <pcl/ProcessInterface.h>
-#include <pcl/SectionBar.h>
-#include <pcl/Sizer.h>
-#include <pcl/ToolButton.h>
-
-#include "EPSFBuilderInstance.h"
-
-namespace pcl {
-
-class EPSFBuilderInterface : public ProcessInterface
-{
-public:
-    EPSFBuilderInterface();
-    virtual ~EPSFBuilderInterface();
-
-    IsoString Id() const override;
-    MetaProcess* Process() const override;
-    IsoString IconImageSVG() const override;
-    InterfaceFeatures Features() const override;
-    void ApplyInstance() const override;
-    void ResetInstance() override;
-    bool Launch(const MetaProcess&, const ProcessImplementation*, bool& dynamic, unsigned& /*flags*/) override;
-    ProcessImplementation* NewProcess() const override;
-    bool ValidateProcess(const ProcessImplementation&, pcl::String& whyNot) const override;
-    bool RequiresInstanceValidation() const override;
-    bool ImportProcess(const ProcessImplementation&) override;
-
-private:
-    EPSFBuilderInstance instance;
-
-    struct GUIData
-    {
-        GUIData(EPSFBuilderInterface&);
-
-        VerticalSizer   Global_Sizer;
-
-        SectionBar      Python_SectionBar;
-        Control         Python_Control;
-        HorizontalSizer Python_Sizer;
-            Label           PythonDLL_Label;
-            Edit              PythonDLL_Edit;
-            ToolButton        PythonDLL_ToolButton;
-
-        SectionBar      StarDetection_SectionBar;
-        Control         StarDetection_Control;
-        VerticalSizer   StarDetection_Sizer;
-            NumericControl  MaxStars_NumericControl;
-            NumericControl  StarMaxPeak_NumericControl;
-            NumericControl  StarThreshold_NumericControl;
-            NumericControl  StarFWHM_NumericControl;
-
-        SectionBar      EPSFFitting_SectionBar;
-        Control         EPSFFitting_Control;
-        VerticalSizer   EPSFFitting_Sizer;
-            NumericControl  StarSize_NumericControl;
-            NumericControl  Oversampling_NumericControl;
-            HorizontalSizer SmoothingKernel_Sizer;
-                Label           SmoothingKernel_Label;
-                ComboBox        SmoothingKernel_ComboBox;
-            NumericControl  MaxIterations_NumericControl;
-    };
-
-    GUIData* GUI = nullptr;
-
-    void UpdateControls();
-    void __EditValueUpdated(NumericEdit& sender, double value);
-    void __SmoothingKernel_ItemSelected(ComboBox& sender, int itemIndex);
-    void __EditCompleted(Edit& sender);
-    void __Click(Button& sender, bool checked);
-
-    friend struct GUIData;
-};
-
-PCL_BEGIN_LOCAL
-extern EPSFBuilderInterface* TheEPSFBuilderInterface;
-PCL_END_LOCAL
-
-}	// namespace pcl
-
+#ifndef __EPSFBuilderInterface_h
+#define __EPSFBuilderInterface_h
+
+#include <pcl/CheckBox.h>
+#include <pcl/ComboBox.h>
+#include <pcl/NumericControl.h>
+#include <pcl/ProcessInterface.h>
+#include <pcl/PushButton.h>
+#include <pcl/SectionBar.h>
+#include <pcl/Sizer.h>
+#include <pcl/ToolButton.h>
+#include <pcl/TreeBox.h>
+
+#include "EPSFBuilderInstance.h"
+
+namespace pcl {
+
+class EPSFBuilderInterface : public ProcessInterface
+{
+public:
+    EPSFBuilderInterface();
+    virtual ~EPSFBuilderInterface();
+
+    IsoString Id() const override;
+    MetaProcess* Process() const override;
+    IsoString IconImageSVG() const override;
+    InterfaceFeatures Features() const override;
+    void ApplyInstance() const override;
+    void ApplyInstanceGlobal() const override;
+    void ResetInstance() override;
+    bool Launch(const MetaProcess&, const ProcessImplementation*, bool& dynamic, unsigned& /*flags*/) override;
+    ProcessImplementation* NewProcess() const override;
+    bool ValidateProcess(const ProcessImplementation&, pcl::String& whyNot) const override;
+    bool RequiresInstanceValidation() const override;
+    bool ImportProcess(const ProcessImplementation&) override;
+
+private:
+    EPSFBuilderInstance instance;
+
+    struct GUIData
+    {
+        GUIData(EPSFBuilderInterface&);
+
+        VerticalSizer   Global_Sizer;
+
+        SectionBar      Python_SectionBar;
+        Control         Python_Control;
+        VerticalSizer   Python_Sizer;
+            HorizontalSizer PythonDLL_Sizer;
+                Label           PythonDLL_Label;
+                Edit            PythonDLL_Edit;
+                ToolButton      PythonDLL_ToolButton;
+            NumericControl  PythonWorkers_NumericControl;
+
+        SectionBar      StarDetection_SectionBar;
+        Control         StarDetection_Control;
+        VerticalSizer   StarDetection_Sizer;
+            NumericControl  MaxStars_NumericControl;
+            NumericControl  StarMaxPeak_NumericControl;
+            NumericControl  StarThreshold_NumericControl;
+            NumericControl  StarFWHM_NumericControl;
+            HorizontalSizer DetectionEngine_Sizer;
+                Label           DetectionEngine_Label;
+                ComboBox        DetectionEngine_ComboBox;
+            HorizontalSizer CentroidMethod_Sizer;
+                Label           CentroidMethod_Label;
+                ComboBox        CentroidMethod_ComboBox;
+            HorizontalSizer BackgroundMode_Sizer;
+                Label           BackgroundMode_Label;
+                ComboBox        BackgroundMode_ComboBox;
+            NumericControl  DetectionCacheSize_NumericControl;
+            NumericControl  TileMemory_NumericControl;
+
+        SectionBar      EPSFFitting_SectionBar;
+        Control         EPSFFitting_Control;
+        VerticalSizer   EPSFFitting_Sizer;
+            NumericControl  StarSize_NumericControl;
+            NumericControl  Oversampling_NumericControl;
+            HorizontalSizer SmoothingKernel_Sizer;
+                Label           SmoothingKernel_Label;
+                ComboBox        SmoothingKernel_ComboBox;
+            NumericControl  MaxIterations_NumericControl;
+            HorizontalSizer FittingEngine_Sizer;
+                Label           FittingEngine_Label;
+                ComboBox        FittingEngine_ComboBox;
+            NumericControl  GridColumns_NumericControl;
+            NumericControl  GridRows_NumericControl;
+            NumericControl  GridOverlap_NumericControl;
+            HorizontalSizer PhotometryOutput_Sizer;
+                Label           PhotometryOutput_Label;
+                ComboBox        PhotometryOutput_ComboBox;
+
+        SectionBar      BatchProcessing_SectionBar;
+        Control         BatchProcessing_Control;
+        VerticalSizer   BatchProcessing_Sizer;
+            HorizontalSizer TargetFrames_Sizer;
+                TreeBox         TargetFrames_TreeBox;
+                VerticalSizer   TargetButtons_Sizer;
+                    PushButton      AddFiles_PushButton;
+                    PushButton      ToggleFrames_PushButton;
+                    PushButton      RemoveFrames_PushButton;
+                    PushButton      ClearFrames_PushButton;
+            HorizontalSizer OutputDirectory_Sizer;
+                Label           OutputDirectory_Label;
+                Edit            OutputDirectory_Edit;
+                ToolButton      OutputDirectory_ToolButton;
+            HorizontalSizer AccumulateFrames_Sizer;
+                CheckBox        AccumulateFrames_CheckBox;
+            NumericControl  AccumulatedStars_NumericControl;
+
+        SectionBar      Library_SectionBar;
+        Control         Library_Control;
+        VerticalSizer   Library_Sizer;
+            HorizontalSizer LibraryMode_Sizer;
+                Label           LibraryMode_Label;
+                ComboBox        LibraryMode_ComboBox;
+            HorizontalSizer LibraryDirectory_Sizer;
+                Label           LibraryDirectory_Label;
+                Edit            LibraryDirectory_Edit;
+                ToolButton      LibraryDirectory_ToolButton;
+            NumericControl  LibraryTimeWindow_NumericControl;
+            NumericControl  LibraryFWHMTolerance_NumericControl;
+
+        SectionBar      Deconvolution_SectionBar;
+        Control         Deconvolution_Control;
+        VerticalSizer   Deconvolution_Sizer;
+            HorizontalSizer Deconvolve_Sizer;
+                CheckBox        Deconvolve_CheckBox;
+            NumericControl  DeconvolutionIterations_NumericControl;
+            NumericControl  DeconvolutionTolerance_NumericControl;
+
+        SectionBar      Diagnostics_SectionBar;
+        Control         Diagnostics_Control;
+        VerticalSizer   Diagnostics_Sizer;
+            HorizontalSizer TraceFile_Sizer;
+                Label           TraceFile_Label;
+                Edit            TraceFile_Edit;
+                ToolButton      TraceFile_ToolButton;
+            HorizontalSizer ShowStarDetection_Sizer;
+                CheckBox        ShowStarDetection_CheckBox;
+            HorizontalSizer ShowExtractedStars_Sizer;
+                CheckBox        ShowExtractedStars_CheckBox;
+    };
+
+    GUIData* GUI = nullptr;
+
+    void UpdateControls();
+    void UpdateTargetFramesList();
+    void __EditValueUpdated(NumericEdit& sender, double value);
+    void __SmoothingKernel_ItemSelected(ComboBox& sender, int itemIndex);
+    void __ItemSelected(ComboBox& sender, int itemIndex);
+    void __EditCompleted(Edit& sender);
+    void __Click(Button& sender, bool checked);
+    void __NodeActivated(TreeBox& sender, TreeBox::Node& node, int col);
+
+    friend struct GUIData;
+};
+
+PCL_BEGIN_LOCAL
+extern EPSFBuilderInterface* TheEPSFBuilderInterface;
+PCL_END_LOCAL
+
+}	// namespace pcl
+
 #endif  // __EPSFBuilderInterface_h
\ No newline at end of file
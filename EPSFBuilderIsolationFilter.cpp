@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderIsolationFilter.h"
+#include "EPSFBuilderParallel.h"
+
+namespace pcl
+{
+
+EPSFBuilderIsolationFilter::EPSFBuilderIsolationFilter(int cutoutSize, double fwhm, double threshold)
+    : m_cutoutSize(cutoutSize)
+    , m_fwhm(fwhm)
+    , m_threshold(threshold)
+{
+}
+
+std::vector<int> EPSFBuilderIsolationFilter::Filter(const std::vector<EPSFBuilderStarDetector::Star>& candidates, const ImageVariant& image, int maxStars) const
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("Star isolation requires a real floating point image");
+
+    int width = image.Width();
+    int height = image.Height();
+    std::vector<uint8> crowded = FindCrowded(candidates, width, height);
+
+    // Per-star checks in parallel, each thread with its own cutout buffers
+    size_type count = candidates.size();
+    std::vector<uint8> isolated(count, 0);
+    std::vector<std::vector<double>> work(EPSFBuilderThreadCount(count, 16));
+    EPSFBuilderParallelFor(count, [&](size_type begin, size_type end, int thread)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            const EPSFBuilderStarDetector::Star& star = candidates[i];
+            int x0 = int(star.x + 0.5) - m_cutoutSize / 2;
+            int y0 = int(star.y + 0.5) - m_cutoutSize / 2;
+            if (crowded[i] || x0 < 0 || y0 < 0 || x0 + m_cutoutSize > width || y0 + m_cutoutSize > height)
+                continue;
+            bool contaminated = (image.BitsPerSample() == 32) ?
+                IsContaminated(static_cast<const Image&>(*image), star, work[thread]) :
+                IsContaminated(static_cast<const DImage&>(*image), star, work[thread]);
+            isolated[i] = contaminated ? 0 : 1;
+        }
+    }, 16);
+
+    std::vector<int> result;
+    for (size_type i = 0; i < count; i++)
+        if (isolated[i])
+        {
+            result.push_back(int(i));
+            if (maxStars > 0 && int(result.size()) == maxStars)
+                break;
+        }
+    return result;
+}
+
+std::vector<uint8> EPSFBuilderIsolationFilter::FindCrowded(const std::vector<EPSFBuilderStarDetector::Star>& candidates, int width, int height) const
+{
+    // A candidate inside the cutout of a star is at most cell pixels away on both axes, so it falls
+    // in one of the 3x3 grid cells around the star
+    int n = int(candidates.size());
+    int half = m_cutoutSize / 2;
+    int cell = half + 1;
+    int cols = width / cell + 1;
+    int rows = height / cell + 1;
+    auto cellIndex = [&](const EPSFBuilderStarDetector::Star& s)
+    {
+        int cx = Range(int(s.x) / cell, 0, cols - 1);
+        int cy = Range(int(s.y) / cell, 0, rows - 1);
+        return cy * cols + cx;
+    };
+
+    // Counting sort of the candidates by grid cell
+    std::vector<int> start(size_type(cols) * rows + 1, 0);
+    for (int i = 0; i < n; i++)
+        start[cellIndex(candidates[i]) + 1]++;
+    for (size_type k = 1; k < start.size(); k++)
+        start[k] += start[k - 1];
+    std::vector<int> items(n);
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < n; i++)
+        items[fill[cellIndex(candidates[i])]++] = i;
+
+    std::vector<uint8> crowded(n, 0);
+    EPSFBuilderParallelFor(size_type(n), [&](size_type begin, size_type end, int)
+    {
+        for (int i = int(begin); i < int(end); i++)
+        {
+            const EPSFBuilderStarDetector::Star& star = candidates[i];
+            int x0 = int(star.x + 0.5) - half;
+            int y0 = int(star.y + 0.5) - half;
+            int cx = Range(int(star.x) / cell, 0, cols - 1);
+            int cy = Range(int(star.y) / cell, 0, rows - 1);
+            for (int y = Max(0, cy - 1); y <= Min(rows - 1, cy + 1) && !crowded[i]; y++)
+                for (int x = Max(0, cx - 1); x <= Min(cols - 1, cx + 1) && !crowded[i]; x++)
+                {
+                    int k = y * cols + x;
+                    for (int j = start[k]; j < start[k + 1]; j++)
+                    {
+                        const EPSFBuilderStarDetector::Star& other = candidates[items[j]];
+                        if (items[j] != i && other.x >= x0 && other.x < x0 + m_cutoutSize && other.y >= y0 && other.y < y0 + m_cutoutSize)
+                        {
+                            crowded[i] = 1;
+                            break;
+                        }
+                    }
+                }
+        }
+    }, 64);
+
+    return crowded;
+}
+
+template <class P>
+bool EPSFBuilderIsolationFilter::IsContaminated(const GenericImage<P>& image, const EPSFBuilderStarDetector::Star& star, std::vector<double>& work) const
+{
+    int size = m_cutoutSize;
+    size_type n = size_type(size) * size;
+    int x0 = int(star.x + 0.5) - size / 2;
+    int y0 = int(star.y + 0.5) - size / 2;
+
+    // Cutout, then a scratch copy for the median
+    work.resize(2 * n);
+    double* cutout = work.data();
+    double* scratch = cutout + n;
+    for (int y = 0, k = 0; y < size; y++)
+    {
+        const typename P::sample* row = image.PixelAddress(x0, y0 + y);
+        for (int x = 0; x < size; x++, k++)
+            cutout[k] = row[x];
+    }
+    std::copy(cutout, cutout + n, scratch);
+    std::nth_element(scratch, scratch + n / 2, scratch + n);
+    double median = scratch[n / 2];
+
+    // Any other local maximum farther than one FWHM from the star whose 3x3 mean, which damps the
+    // noise, rises above the detection threshold is a second source
+    double r2 = m_fwhm * m_fwhm;
+    for (int y = 1; y < size - 1; y++)
+        for (int x = 1; x < size - 1; x++)
+        {
+            double dx = x0 + x - star.x;
+            double dy = y0 + y - star.y;
+            if (dx * dx + dy * dy <= r2)
+                continue;
+            const double* p = cutout + y * size + x;
+            double v = *p;
+            if (v <= p[-1] || v <= p[1] ||
+                v <= p[-size - 1] || v <= p[-size] || v <= p[-size + 1] ||
+                v <= p[size - 1] || v <= p[size] || v <= p[size + 1])
+                continue;
+            double mean = (v + p[-1] + p[1] + p[-size - 1] + p[-size] + p[-size + 1] + p[size - 1] + p[size] + p[size + 1]) / 9;
+            if (mean - median > m_threshold)
+                return true;
+        }
+
+    return false;
+}
+
+}	// namespace pcl
\ No newline at end of file
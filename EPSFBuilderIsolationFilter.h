@@ -0,0 +1,41 @@
+#ifndef __EPSFBuilderIsolationFilter_h
+#define __EPSFBuilderIsolationFilter_h
+
+#include <vector>
+#include <pcl/ImageVariant.h>
+
+#include "EPSFBuilderStarDetector.h"
+
+namespace pcl
+{
+
+// Native replacement for the isolation test of Step 6, which ran DAOStarFinder on every cutout and
+// kept the stars with a single source. Candidates are bucketed in a uniform grid with cells of half
+// the cutout size, so the candidates that fall inside the cutout of a star are found by looking at
+// the adjacent cells only. Sources fainter than the detected candidates are caught by a peak test on
+// the cutout: any other local maximum rising more than the detection threshold above the cutout
+// median marks the star as contaminated.
+
+class EPSFBuilderIsolationFilter
+{
+public:
+    EPSFBuilderIsolationFilter(int cutoutSize, double fwhm, double threshold);
+
+    // Returns the indices of the isolated candidates whose cutout lies entirely within the image, in
+    // the order of candidates, at most maxStars of them if maxStars > 0.
+    std::vector<int> Filter(const std::vector<EPSFBuilderStarDetector::Star>& candidates, const ImageVariant& image, int maxStars = 0) const;
+
+private:
+    int m_cutoutSize;
+    double m_fwhm;
+    double m_threshold;
+
+    std::vector<uint8> FindCrowded(const std::vector<EPSFBuilderStarDetector::Star>& candidates, int width, int height) const;
+
+    template <class P>
+    bool IsContaminated(const GenericImage<P>& image, const EPSFBuilderStarDetector::Star& star, std::vector<double>& work) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderIsolationFilter_h
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <cstring>
+#include <pcl/File.h>
+#include <pcl/Math.h>
+#include <pcl/TimePoint.h>
+#include <pcl/XISF.h>
+
+#ifndef __PCL_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "EPSFBuilderLibrary.h"
+
+namespace pcl
+{
+
+static const char* s_indexHeader = "file,instrument,filter,date_obs,jd,fwhm,oversampling,star_size,stars,channels,star_fwhm\n";
+
+// Read-only mapping of a whole file
+class EPSFBuilderMappedFile
+{
+public:
+    EPSFBuilderMappedFile(const String& filePath)
+    {
+#ifdef __PCL_WINDOWS
+        m_file = CreateFileW((LPCWSTR)filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE)
+            throw Error(filePath + ": Unable to open file.");
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(m_file);
+            throw Error(filePath + ": Unable to map file.");
+        }
+        m_size = size_type(size.QuadPart);
+        m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        m_data = (m_mapping != NULL) ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (m_data == nullptr)
+        {
+            if (m_mapping != NULL)
+                CloseHandle(m_mapping);
+            CloseHandle(m_file);
+            throw Error(filePath + ": Unable to map file.");
+        }
+#else
+        m_fd = open(filePath.ToUTF8().c_str(), O_RDONLY);
+        if (m_fd < 0)
+            throw Error(filePath + ": Unable to open file.");
+        struct stat info;
+        if (fstat(m_fd, &info) != 0 || info.st_size == 0)
+        {
+            close(m_fd);
+            throw Error(filePath + ": Unable to map file.");
+        }
+        m_size = size_type(info.st_size);
+        m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (m_data == MAP_FAILED)
+        {
+            close(m_fd);
+            throw Error(filePath + ": Unable to map file.");
+        }
+#endif
+    }
+
+    ~EPSFBuilderMappedFile()
+    {
+#ifdef __PCL_WINDOWS
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+#else
+        munmap(m_data, m_size);
+        close(m_fd);
+#endif
+    }
+
+    EPSFBuilderMappedFile(const EPSFBuilderMappedFile&) = delete;
+    EPSFBuilderMappedFile& operator =(const EPSFBuilderMappedFile&) = delete;
+
+    const uint8* Data() const
+    {
+        return static_cast<const uint8*>(m_data);
+    }
+
+    size_type Size() const
+    {
+        return m_size;
+    }
+
+private:
+    void* m_data = nullptr;
+    size_type m_size = 0;
+#ifdef __PCL_WINDOWS
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = NULL;
+#else
+    int m_fd = -1;
+#endif
+};
+
+EPSFBuilderLibrary::EPSFBuilderLibrary(const String& directory)
+    : m_directory(directory)
+{
+    if (!File::DirectoryExists(directory))
+        throw Error("The ePSF library directory does not exist: " + directory);
+    if (!m_directory.EndsWith('/'))
+        m_directory += '/';
+    if (!File::Exists(IndexPath()))
+        return;
+
+    // One line per ePSF after the header, with the columns of s_indexHeader; indexes written before
+    // star_fwhm was added have one column less, and their ePSFs are never matched
+    IsoStringList lines = File::ReadLines(IndexPath());
+    for (size_type i = 1; i < lines.Length(); i++)
+    {
+        IsoStringList fields;
+        lines[i].Break(fields, ',');
+        if (fields.Length() != 10 && fields.Length() != 11)
+            continue;
+        Entry entry;
+        entry.fileName = fields[0].UTF8ToUTF16();
+        entry.instrument = fields[1];
+        entry.filter = fields[2];
+        entry.dateObs = fields[3];
+        entry.date = fields[4].ToDouble();
+        entry.fwhm = fields[5].ToDouble();
+        entry.oversampling = fields[6].ToInt();
+        entry.starSize = fields[7].ToInt();
+        entry.stars = fields[8].ToInt();
+        entry.channels = fields[9].ToInt();
+        if (fields.Length() > 10)
+            entry.starFWHM = fields[10].ToDouble();
+        m_entries.push_back(entry);
+    }
+}
+
+String EPSFBuilderLibrary::IndexPath() const
+{
+    return m_directory + "index.csv";
+}
+
+void EPSFBuilderLibrary::WriteIndex() const
+{
+    IsoString index = s_indexHeader;
+    for (const Entry& entry : m_entries)
+        index.AppendFormat("%s,%s,%s,%s,%.8f,%.4f,%d,%d,%d,%d,%.4f\n", entry.fileName.ToUTF8().c_str(), entry.instrument.c_str(), entry.filter.c_str(),
+            entry.dateObs.c_str(), entry.date, entry.fwhm, entry.oversampling, entry.starSize, entry.stars, entry.channels, entry.starFWHM);
+    File::WriteTextFile(IndexPath(), index);
+}
+
+int EPSFBuilderLibrary::Find(const Entry& query, double timeWindow, double fwhmTolerance) const
+{
+    if (query.date == 0)
+        return -1;
+    int best = -1;
+    double bestHours = 0, bestFWHM = 0;
+    for (size_type i = 0; i < m_entries.size(); i++)
+    {
+        const Entry& entry = m_entries[i];
+        if (entry.date == 0 || entry.starFWHM == 0
+            || entry.instrument != query.instrument || entry.filter != query.filter
+            || entry.oversampling != query.oversampling || entry.starSize != query.starSize || entry.channels != query.channels)
+            continue;
+        double hours = Abs(entry.date - query.date) * 24;
+        double fwhm = Abs(entry.starFWHM - query.starFWHM);
+        if (hours > timeWindow || fwhm > fwhmTolerance)
+            continue;
+        if (best < 0 || hours < bestHours || (hours == bestHours && fwhm < bestFWHM))
+        {
+            best = int(i);
+            bestHours = hours;
+            bestFWHM = fwhm;
+        }
+    }
+    return best;
+}
+
+template <class P>
+static void CopyPlanes(GenericImage<P>& image, const uint8* data)
+{
+    const size_type planeBytes = image.NumberOfPixels() * sizeof(typename P::sample);
+    for (int c = 0; c < image.NumberOfChannels(); c++)
+        std::memcpy(image[c], data + c * planeBytes, planeBytes);
+}
+
+// Reads an XISF file written by Store(): the signature, the little-endian length of the XML header,
+// and an uncompressed planar attachment with the pixels, whose position and size are given by the
+// location attribute of the Image element. Returns false for anything else.
+bool EPSFBuilderLibrary::LoadMapped(const String& filePath, ImageVariant& epsf) const
+{
+    EPSFBuilderMappedFile file(filePath);
+    const uint8* data = file.Data();
+    if (file.Size() < 16 || std::memcmp(data, "XISF0100", 8) != 0)
+        return false;
+    uint32 headerLength = uint32(data[8]) | uint32(data[9]) << 8 | uint32(data[10]) << 16 | uint32(data[11]) << 24;
+    if (16 + size_type(headerLength) > file.Size())
+        return false;
+
+    IsoString header(reinterpret_cast<const char*>(data) + 16, 0, headerLength);
+    size_type start = header.Find("<Image ");
+    if (start == IsoString::notFound)
+        return false;
+    size_type end = header.Find('>', start);
+    if (end == IsoString::notFound)
+        return false;
+    IsoString element = header.Substring(start, end - start);
+    auto attribute = [&](const char* name)
+    {
+        IsoString key = IsoString(" ") + name + "=\"";
+        size_type p = element.Find(key);
+        if (p == IsoString::notFound)
+            return IsoString();
+        p += key.Length();
+        return element.Substring(p, element.Find('"', p) - p);
+    };
+    if (!attribute("compression").IsEmpty() || attribute("byteOrder") == "big" || attribute("pixelStorage") == "Normal")
+        return false;
+
+    IsoStringList geometry, location;
+    attribute("geometry").Break(geometry, ':');
+    attribute("location").Break(location, ':');
+    if (geometry.Length() != 3 || location.Length() != 3 || location[0] != "attachment")
+        return false;
+    IsoString sampleFormat = attribute("sampleFormat");
+    int bitsPerSample = (sampleFormat == "Float32") ? 32 : ((sampleFormat == "Float64") ? 64 : 0);
+    if (bitsPerSample == 0)
+        return false;
+    int width = geometry[0].ToInt();
+    int height = geometry[1].ToInt();
+    int channels = geometry[2].ToInt();
+    uint64 position = location[1].ToUInt64();
+    uint64 size = location[2].ToUInt64();
+    if (size != uint64(width) * height * channels * (bitsPerSample >> 3) || position + size > file.Size())
+        return false;
+
+    epsf.CreateFloatImage(bitsPerSample);
+    epsf.AllocateImage(width, height, channels, (attribute("colorSpace") == "RGB") ? ColorSpace::RGB : ColorSpace::Gray);
+    if (bitsPerSample == 32)
+        CopyPlanes(static_cast<Image&>(*epsf), data + position);
+    else
+        CopyPlanes(static_cast<DImage&>(*epsf), data + position);
+    return true;
+}
+
+void EPSFBuilderLibrary::Load(int index, ImageVariant& epsf) const
+{
+    String filePath = m_directory + m_entries[index].fileName;
+    if (LoadMapped(filePath, epsf))
+        return;
+    XISFReader reader;
+    reader.Open(filePath);
+    const ImageOptions options = reader.ImageOptions();
+    epsf.CreateFloatImage((options.ieeefpSampleFormat && options.bitsPerSample == 64) ? 64 : 32);
+    if (epsf.BitsPerSample() == 64)
+        reader.ReadImage(static_cast<DImage&>(*epsf));
+    else
+        reader.ReadImage(static_cast<Image&>(*epsf));
+    reader.Close();
+}
+
+static IsoString FITSString(const IsoString& value)
+{
+    return "'" + value + "'";
+}
+
+void EPSFBuilderLibrary::Store(const ImageVariant& epsf, Entry& entry)
+{
+    entry.fwhm = MeasureFWHM(epsf);
+    entry.channels = epsf.NumberOfChannels();
+
+    uint64 hash = (uint64(entry.oversampling) << 32) | uint32(entry.starSize);
+    for (int c = 0; c < epsf.NumberOfChannels(); c++)
+    {
+        const void* pixels = (epsf.BitsPerSample() == 32) ? (const void*)static_cast<const Image&>(*epsf)[c] : (const void*)static_cast<const DImage&>(*epsf)[c];
+        hash = Hash64(pixels, epsf.NumberOfPixels() * epsf.BytesPerSample(), hash);
+    }
+    entry.fileName = String().Format("ePSF_%016llx.xisf", (unsigned long long)hash);
+
+    FITSKeywordArray keywords;
+    if (!entry.instrument.IsEmpty())
+        keywords << FITSHeaderKeyword("INSTRUME", FITSString(entry.instrument), "Instrument of the source frame");
+    if (!entry.filter.IsEmpty())
+        keywords << FITSHeaderKeyword("FILTER", FITSString(entry.filter), "Filter of the source frame");
+    if (!entry.dateObs.IsEmpty())
+        keywords << FITSHeaderKeyword("DATE-OBS", FITSString(entry.dateObs), "Observation date of the source frame");
+    keywords << FITSHeaderKeyword("EPSFOVER", IsoString().Format("%d", entry.oversampling), "ePSF oversampling factor")
+             << FITSHeaderKeyword("EPSFSIZE", IsoString().Format("%d", entry.starSize), "ePSF size in pixels")
+             << FITSHeaderKeyword("EPSFSTAR", IsoString().Format("%d", entry.stars), "Number of stars in the ePSF")
+             << FITSHeaderKeyword("EPSFFWHM", IsoString().Format("%.4f", entry.fwhm), "ePSF FWHM in pixels")
+             << FITSHeaderKeyword("EPSFSFWH", IsoString().Format("%.4f", entry.starFWHM), "Star FWHM parameter of the build in pixels");
+
+    XISFWriter writer;
+    writer.Create(m_directory + entry.fileName, 1);
+    writer.WriteFITSKeywords(keywords);
+    if (epsf.BitsPerSample() == 32)
+        writer.WriteImage(static_cast<const Image&>(*epsf));
+    else
+        writer.WriteImage(static_cast<const DImage&>(*epsf));
+    writer.Close();
+
+    auto i = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.fileName == entry.fileName; });
+    if (i != m_entries.end())
+        *i = entry;
+    else
+        m_entries.push_back(entry);
+    WriteIndex();
+}
+
+void EPSFBuilderLibrary::DescribeFrame(Entry& entry, const FITSKeywordArray& keywords)
+{
+    for (const FITSHeaderKeyword& keyword : keywords)
+    {
+        // Commas would split the fields of the index
+        IsoString value = keyword.StripValueDelimiters().Trimmed();
+        value.ReplaceChar(',', ' ');
+        if (keyword.name == "INSTRUME")
+            entry.instrument = value;
+        else if (keyword.name == "FILTER")
+            entry.filter = value;
+        else if (keyword.name == "DATE-OBS")
+        {
+            TimePoint t;
+            if (TimePoint::TryFromString(t, String(value)))
+            {
+                entry.dateObs = value;
+                entry.date = t.JD();
+            }
+        }
+    }
+}
+
+template <class P>
+static double EquivalentFWHM(const GenericImage<P>& image)
+{
+    double peak = 0, flux = 0;
+    const typename P::sample* f = image[0];
+    for (size_type i = 0; i < image.NumberOfPixels(); i++)
+    {
+        flux += f[i];
+        peak = Max(peak, double(f[i]));
+    }
+    if (peak <= 0 || flux <= 0)
+        return 0;
+    return 2.3548200450309493 * pcl::Sqrt(flux / (2 * Const<double>::pi() * peak));
+}
+
+double EPSFBuilderLibrary::MeasureFWHM(const ImageVariant& epsf)
+{
+    if (epsf.BitsPerSample() == 32)
+        return EquivalentFWHM(static_cast<const Image&>(*epsf));
+    if (epsf.BitsPerSample() == 64)
+        return EquivalentFWHM(static_cast<const DImage&>(*epsf));
+    return 0;
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef __EPSFBuilderLibrary_h
+#define __EPSFBuilderLibrary_h
+
+#include <vector>
+#include <pcl/FITSHeaderKeyword.h>
+#include <pcl/ImageVariant.h>
+#include <pcl/String.h>
+
+namespace pcl
+{
+
+// Persistent store of finished ePSFs in a directory. Every ePSF is an XISF file named after a hash of
+// its pixels, with its metadata as FITS keywords:
+//
+//   INSTRUME, FILTER, DATE-OBS   copied from the source frame
+//   EPSFOVER                     oversampling of the fit
+//   EPSFSIZE                     side of the ePSF in pixels, the starSize parameter
+//   EPSFSTAR                     number of stars in the fit
+//   EPSFFWHM                     FWHM of the ePSF in pixels, measured with MeasureFWHM()
+//   EPSFSFWH                     starFWHM parameter of the build, matched by Find()
+//
+// The same metadata is kept for all the stored ePSFs in index.csv, so lookups never open an ePSF
+// file. A matching ePSF is loaded by mapping its file in memory and copying the uncompressed image
+// block straight into the image; files that cannot be read that way, like compressed ones, are read
+// with XISFReader.
+//
+// A library is opened for an execution, which reads its index. Find() and Load() may be called from
+// frame loader threads; Store() must only be called from the main thread.
+
+class EPSFBuilderLibrary
+{
+public:
+    struct Entry
+    {
+        String fileName;            // in the library directory
+        IsoString instrument;       // of the source frame, empty if unknown
+        IsoString filter;
+        IsoString dateObs;
+        double date = 0;            // dateObs as a Julian date, 0 if unknown
+        double fwhm = 0;            // measured on the stored ePSF
+        double starFWHM = 0;        // the starFWHM parameter, the seeing of the build
+        int oversampling = 0;
+        int starSize = 0;
+        int stars = 0;
+        int channels = 0;
+    };
+
+    // Opens the library in directory, which must exist, and reads its index if there is one
+    explicit EPSFBuilderLibrary(const String& directory);
+
+    const std::vector<Entry>& Entries() const
+    {
+        return m_entries;
+    }
+
+    // Index of the stored ePSF for a frame described by query: the same instrument, filter,
+    // oversampling, size and number of channels, observed within timeWindow hours of it and built
+    // with a starFWHM within fwhmTolerance pixels of query.starFWHM. The nearest in time is chosen,
+    // then the nearest in FWHM. Returns -1 if there is none; ePSFs and frames without a date never
+    // match, nor do ePSFs indexed without a starFWHM.
+    int Find(const Entry& query, double timeWindow, double fwhmTolerance) const;
+
+    // Reads the stored ePSF of Entries()[index] into epsf, with the sample type of its file
+    void Load(int index, ImageVariant& epsf) const;
+
+    // Writes epsf with the metadata of entry, whose fileName and fwhm are set here, and adds it to the
+    // index. An identical ePSF stored before is replaced.
+    void Store(const ImageVariant& epsf, Entry& entry);
+
+    // Sets the instrument, filter and date of entry from the keywords of a frame
+    static void DescribeFrame(Entry& entry, const FITSKeywordArray& keywords);
+
+    // FWHM in pixels of the Gaussian with the peak and flux of the first channel of an ePSF
+    static double MeasureFWHM(const ImageVariant& epsf);
+
+private:
+    String m_directory;
+    std::vector<Entry> m_entries;
+
+    String IndexPath() const;
+    void WriteIndex() const;
+    bool LoadMapped(const String& filePath, ImageVariant& epsf) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderLibrary_h
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef __EPSFBuilderParallel_h
+#define __EPSFBuilderParallel_h
+
+#include <pcl/Exception.h>
+#include <pcl/ReferenceArray.h>
+#include <pcl/Thread.h>
+
+#ifdef __EPSFBUILDER_STANDALONE
+#include <thread>
+#include <vector>
+#endif
+
+namespace pcl
+{
+
+// Runs body(begin, end, threadIndex) over contiguous chunks of [0, count), one chunk per PCL thread.
+// Exceptions thrown by the body are caught in the worker thread and rethrown on the calling thread.
+//
+// Standalone builds (__EPSFBUILDER_STANDALONE, see linux/g++/makefile) run outside PixInsight, where
+// the PCL thread API is not available; there the chunks run on std::thread, one per hardware thread.
+
+template <class F>
+class EPSFBuilderRangeTask
+{
+public:
+    EPSFBuilderRangeTask(const F& body, size_type begin, size_type end, int index)
+        : m_body(body)
+        , m_begin(begin)
+        , m_end(end)
+        , m_index(index)
+    {
+    }
+
+    void Execute()
+    {
+        try
+        {
+            m_body(m_begin, m_end, m_index);
+        }
+        catch (const Exception& x)
+        {
+            m_error = x.Message();
+            m_failed = true;
+        }
+        catch (const std::exception& x)
+        {
+            m_error = x.what();
+            m_failed = true;
+        }
+        catch (...)
+        {
+            m_error = "Unknown error in worker thread";
+            m_failed = true;
+        }
+    }
+
+    bool Failed() const
+    {
+        return m_failed;
+    }
+
+    const String& ErrorMessage() const
+    {
+        return m_error;
+    }
+
+private:
+    const F& m_body;
+    size_type m_begin;
+    size_type m_end;
+    int m_index;
+    bool m_failed = false;
+    String m_error;
+};
+
+#ifndef __EPSFBUILDER_STANDALONE
+
+template <class F>
+class EPSFBuilderRangeThread : public Thread, public EPSFBuilderRangeTask<F>
+{
+public:
+    EPSFBuilderRangeThread(const F& body, size_type begin, size_type end, int index)
+        : EPSFBuilderRangeTask<F>(body, begin, end, index)
+    {
+    }
+
+    void Run() override
+    {
+        this->Execute();
+    }
+};
+
+#endif
+
+// Chunk lengths for count items: at most one chunk per processor, and no more chunks than
+// count/overheadLimit
+inline Array<size_type> EPSFBuilderThreadLoads(size_type count, size_type overheadLimit = 1)
+{
+#ifdef __EPSFBUILDER_STANDALONE
+    size_type n = Max(size_type(1), Min(size_type(std::thread::hardware_concurrency()), count / Max(overheadLimit, size_type(1))));
+    Array<size_type> L(n, count / n);
+    for (size_type i = 0; i < count % n; i++)
+        L[i]++;
+    return L;
+#else
+    return Thread::OptimalThreadLoads(count, overheadLimit);
+#endif
+}
+
+// Number of chunks EPSFBuilderParallelFor will use for the same arguments. Use it to size per-thread
+// partial results, which are then indexed by the threadIndex argument of the body.
+inline int EPSFBuilderThreadCount(size_type count, size_type overheadLimit = 1)
+{
+    if (count == 0)
+        return 0;
+    return int(EPSFBuilderThreadLoads(count, overheadLimit).Length());
+}
+
+template <class F>
+void EPSFBuilderParallelFor(size_type count, const F& body, size_type overheadLimit = 1)
+{
+    if (count == 0)
+        return;
+
+    Array<size_type> L = EPSFBuilderThreadLoads(count, overheadLimit);
+
+#ifdef __EPSFBUILDER_STANDALONE
+    std::vector<EPSFBuilderRangeTask<F>> tasks;
+    size_type n = 0;
+    for (size_type i = 0; i < L.Length(); n += L[i++])
+        tasks.emplace_back(body, n, n + L[i], int(i));
+
+    if (tasks.size() > 1)
+    {
+        std::vector<std::thread> threads;
+        for (size_type i = 0; i < tasks.size(); i++)
+            threads.emplace_back([&tasks, i]() { tasks[i].Execute(); });
+        for (std::thread& t : threads)
+            t.join();
+    }
+    else
+        tasks[0].Execute();
+
+    for (const EPSFBuilderRangeTask<F>& task : tasks)
+        if (task.Failed())
+            throw Error(task.ErrorMessage());
+#else
+    ReferenceArray<EPSFBuilderRangeThread<F>> threads;
+    size_type n = 0;
+    for (size_type i = 0; i < L.Length(); n += L[i++])
+        threads.Add(new EPSFBuilderRangeThread<F>(body, n, n + L[i], int(i)));
+
+    if (threads.Length() > 1)
+    {
+        for (size_type i = 0; i < threads.Length(); i++)
+            threads[i].Start(ThreadPriority::DefaultMax, int(i));
+        for (size_type i = 0; i < threads.Length(); i++)
+            threads[i].Wait();
+    }
+    else
+        threads[0].Execute();
+
+    String why;
+    for (size_type i = 0; i < threads.Length(); i++)
+        if (threads[i].Failed())
+        {
+            why = threads[i].ErrorMessage();
+            break;
+        }
+    threads.Destroy();
+
+    if (!why.IsEmpty())
+        throw Error(why);
+#endif
+}
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderParallel_h
\ No newline at end of file
@@ -1,256 +1,976 @@
-#include "EPSFBuilderParameters.h"
-
-namespace pcl
-{
-
-EPSFBuilderMaxStars* TheEPSFBuilderMaxStarsParameter = nullptr;
-EPSFBuilderStarMaxPeak* TheEPSFBuilderStarMaxPeakParameter = nullptr;
-EPSFBuilderStarThreshold* TheEPSFBuilderStarThresholdParameter = nullptr;
-EPSFBuilderStarFWHM* TheEPSFBuilderStarFWHMParameter = nullptr;
-EPSFBuilderStarSize* TheEPSFBuilderStarSizeParameter = nullptr;
-EPSFBuilderOversampling* TheEPSFBuilderOversamplingParameter = nullptr;
-EPSFBuilderSmoothingKernel* TheEPSFBuilderSmoothingKernelParameter = nullptr;
-EPSFBuilderMaxIterations* TheEPSFBuilderMaxIterationsParameter = nullptr;
-
-// Maximum number of brightest stars for star detection
-
-EPSFBuilderMaxStars::EPSFBuilderMaxStars(MetaProcess* P) : MetaInt32(P)
-{
-    TheEPSFBuilderMaxStarsParameter = this;
-}
-
-IsoString EPSFBuilderMaxStars::Id() const
-{
-    return "maxStars";
-}
-
-double EPSFBuilderMaxStars::MinimumValue() const
-{
-    return 10.0;
-}
-
-double EPSFBuilderMaxStars::MaximumValue() const
-{
-    return 500.0;
-}
-
-double EPSFBuilderMaxStars::DefaultValue() const
-{
-    return 100.0;
-}
-
-// Maximum peak value of a star that will be selected in star detection
-
-EPSFBuilderStarMaxPeak::EPSFBuilderStarMaxPeak(MetaProcess* P) : MetaFloat(P)
-{
-    TheEPSFBuilderStarMaxPeakParameter = this;
-}
-
-IsoString EPSFBuilderStarMaxPeak::Id() const
-{
-    return "starMaxPeak";
-}
-
-int EPSFBuilderStarMaxPeak::Precision() const
-{
-    return 1;
-}
-
-double EPSFBuilderStarMaxPeak::MinimumValue() const
-{
-    return 0.1;
-}
-
-double EPSFBuilderStarMaxPeak::MaximumValue() const
-{
-    return 1.0;
-}
-
-double EPSFBuilderStarMaxPeak::DefaultValue() const
-{
-    return 0.7;
-}
-
-// Absolute threshold value above which to detect a star
-
-EPSFBuilderStarThreshold::EPSFBuilderStarThreshold(MetaProcess* P) : MetaFloat(P)
-{
-    TheEPSFBuilderStarThresholdParameter = this;
-}
-
-IsoString EPSFBuilderStarThreshold::Id() const
-{
-    return "starThreshold";
-}
-
-int EPSFBuilderStarThreshold::Precision() const
-{
-    return 3;
-}
-
-double EPSFBuilderStarThreshold::MinimumValue() const
-{
-    return 0.0;
-}
-
-double EPSFBuilderStarThreshold::MaximumValue() const
-{
-    return 1.0;
-}
-
-double EPSFBuilderStarThreshold::DefaultValue() const
-{
-    return 0.01;
-}
-
-// FWHM (full-width half-maximum) of the Gaussian kernel in units of pixels
-
-EPSFBuilderStarFWHM::EPSFBuilderStarFWHM(MetaProcess* P) : MetaFloat(P)
-{
-    TheEPSFBuilderStarFWHMParameter = this;
-}
-
-IsoString EPSFBuilderStarFWHM::Id() const
-{
-    return "starFWHM";
-}
-
-int EPSFBuilderStarFWHM::Precision() const
-{
-    return 1;
-}
-
-double EPSFBuilderStarFWHM::MinimumValue() const
-{
-    return 1.0;
-}
-
-double EPSFBuilderStarFWHM::MaximumValue() const
-{
-    return 10.0;
-}
-
-double EPSFBuilderStarFWHM::DefaultValue() const
-{
-    return 3.0;
-}
-
-// Star size in star extraction and of the generated ePSF in pixels along each axis
-
-EPSFBuilderStarSize::EPSFBuilderStarSize(MetaProcess* P) : MetaInt8(P)
-{
-    TheEPSFBuilderStarSizeParameter = this;
-}
-
-IsoString EPSFBuilderStarSize::Id() const
-{
-    return "starSize";
-}
-
-double EPSFBuilderStarSize::MinimumValue() const
-{
-    return 5.0;
-}
-
-double EPSFBuilderStarSize::MaximumValue() const
-{
-    return 100.0;
-}
-
-double EPSFBuilderStarSize::DefaultValue() const
-{
-    return 45.0;
-}
-
-// Oversampling factor of drizzling when building the ePSF
-
-EPSFBuilderOversampling::EPSFBuilderOversampling(MetaProcess* P) : MetaInt8(P)
-{
-    TheEPSFBuilderOversamplingParameter = this;
-}
-
-IsoString EPSFBuilderOversampling::Id() const
-{
-    return "oversampling";
-}
-
-double EPSFBuilderOversampling::MinimumValue() const
-{
-    return 1.0;
-}
-
-double EPSFBuilderOversampling::MaximumValue() const
-{
-    return 4.0;
-}
-
-double EPSFBuilderOversampling::DefaultValue() const
-{
-    return 2.0;
-}
-
-// The smoothing kernel to apply to the ePSF
-
-EPSFBuilderSmoothingKernel::EPSFBuilderSmoothingKernel(MetaProcess* P) : MetaEnumeration(P)
-{
-    TheEPSFBuilderSmoothingKernelParameter = this;
-}
-
-IsoString EPSFBuilderSmoothingKernel::Id() const
-{
-    return "smoothingKernel";
-}
-
-size_type EPSFBuilderSmoothingKernel::NumberOfElements() const
-{
-    return NumberOfSmoothingKernel;
-}
-
-IsoString EPSFBuilderSmoothingKernel::ElementId(size_type i) const
-{
-    switch (i)
-    {
-    default:
-    case Quadratic: return "Quadratic";
-    case Quartic:   return "Quartic";
-    }
-}
-
-int EPSFBuilderSmoothingKernel::ElementValue(size_type i) const
-{
-    return int(i);
-}
-
-size_type EPSFBuilderSmoothingKernel::DefaultValueIndex() const
-{
-    return Default;
-}
-
-// The maximum number of iterations to perform when building the ePSF
-
-EPSFBuilderMaxIterations::EPSFBuilderMaxIterations(MetaProcess* P) : MetaInt8(P)
-{
-    TheEPSFBuilderMaxIterationsParameter = this;
-}
-
-IsoString EPSFBuilderMaxIterations::Id() const
-{
-    return "maxIterations";
-}
-
-double EPSFBuilderMaxIterations::MinimumValue() const
-{
-    return 1.0;
-}
-
-double EPSFBuilderMaxIterations::MaximumValue() const
-{
-    return 10.0;
-}
-
-double EPSFBuilderMaxIterations::DefaultValue() const
-{
-    return 5.0;
-}
-
+#include "EPSFBuilderParameters.h"
+
+namespace pcl
+{
+
+EPSFBuilderMaxStars* TheEPSFBuilderMaxStarsParameter = nullptr;
+EPSFBuilderStarMaxPeak* TheEPSFBuilderStarMaxPeakParameter = nullptr;
+EPSFBuilderStarThreshold* TheEPSFBuilderStarThresholdParameter = nullptr;
+EPSFBuilderStarFWHM* TheEPSFBuilderStarFWHMParameter = nullptr;
+EPSFBuilderDetectionEngine* TheEPSFBuilderDetectionEngineParameter = nullptr;
+EPSFBuilderCentroidMethod* TheEPSFBuilderCentroidMethodParameter = nullptr;
+EPSFBuilderBackgroundMode* TheEPSFBuilderBackgroundModeParameter = nullptr;
+EPSFBuilderDetectionCacheSize* TheEPSFBuilderDetectionCacheSizeParameter = nullptr;
+EPSFBuilderTileMemory* TheEPSFBuilderTileMemoryParameter = nullptr;
+EPSFBuilderStarSize* TheEPSFBuilderStarSizeParameter = nullptr;
+EPSFBuilderOversampling* TheEPSFBuilderOversamplingParameter = nullptr;
+EPSFBuilderSmoothingKernel* TheEPSFBuilderSmoothingKernelParameter = nullptr;
+EPSFBuilderMaxIterations* TheEPSFBuilderMaxIterationsParameter = nullptr;
+EPSFBuilderFittingEngine* TheEPSFBuilderFittingEngineParameter = nullptr;
+EPSFBuilderGridColumns* TheEPSFBuilderGridColumnsParameter = nullptr;
+EPSFBuilderGridRows* TheEPSFBuilderGridRowsParameter = nullptr;
+EPSFBuilderGridOverlap* TheEPSFBuilderGridOverlapParameter = nullptr;
+EPSFBuilderPhotometryOutput* TheEPSFBuilderPhotometryOutputParameter = nullptr;
+EPSFBuilderLibraryMode* TheEPSFBuilderLibraryModeParameter = nullptr;
+EPSFBuilderLibraryDirectory* TheEPSFBuilderLibraryDirectoryParameter = nullptr;
+EPSFBuilderLibraryTimeWindow* TheEPSFBuilderLibraryTimeWindowParameter = nullptr;
+EPSFBuilderLibraryFWHMTolerance* TheEPSFBuilderLibraryFWHMToleranceParameter = nullptr;
+EPSFBuilderDeconvolve* TheEPSFBuilderDeconvolveParameter = nullptr;
+EPSFBuilderDeconvolutionIterations* TheEPSFBuilderDeconvolutionIterationsParameter = nullptr;
+EPSFBuilderDeconvolutionTolerance* TheEPSFBuilderDeconvolutionToleranceParameter = nullptr;
+EPSFBuilderPythonWorkers* TheEPSFBuilderPythonWorkersParameter = nullptr;
+EPSFBuilderTargetFrames* TheEPSFBuilderTargetFramesParameter = nullptr;
+EPSFBuilderTargetFrameEnabled* TheEPSFBuilderTargetFrameEnabledParameter = nullptr;
+EPSFBuilderTargetFramePath* TheEPSFBuilderTargetFramePathParameter = nullptr;
+EPSFBuilderOutputDirectory* TheEPSFBuilderOutputDirectoryParameter = nullptr;
+EPSFBuilderAccumulateFrames* TheEPSFBuilderAccumulateFramesParameter = nullptr;
+EPSFBuilderAccumulatedStars* TheEPSFBuilderAccumulatedStarsParameter = nullptr;
+EPSFBuilderTraceFile* TheEPSFBuilderTraceFileParameter = nullptr;
+EPSFBuilderShowStarDetection* TheEPSFBuilderShowStarDetectionParameter = nullptr;
+EPSFBuilderShowExtractedStars* TheEPSFBuilderShowExtractedStarsParameter = nullptr;
+
+// Maximum number of brightest stars for star detection
+
+EPSFBuilderMaxStars::EPSFBuilderMaxStars(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderMaxStarsParameter = this;
+}
+
+IsoString EPSFBuilderMaxStars::Id() const
+{
+    return "maxStars";
+}
+
+double EPSFBuilderMaxStars::MinimumValue() const
+{
+    return 10.0;
+}
+
+double EPSFBuilderMaxStars::MaximumValue() const
+{
+    return 500.0;
+}
+
+double EPSFBuilderMaxStars::DefaultValue() const
+{
+    return 100.0;
+}
+
+// Maximum peak value of a star that will be selected in star detection
+
+EPSFBuilderStarMaxPeak::EPSFBuilderStarMaxPeak(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderStarMaxPeakParameter = this;
+}
+
+IsoString EPSFBuilderStarMaxPeak::Id() const
+{
+    return "starMaxPeak";
+}
+
+int EPSFBuilderStarMaxPeak::Precision() const
+{
+    return 1;
+}
+
+double EPSFBuilderStarMaxPeak::MinimumValue() const
+{
+    return 0.1;
+}
+
+double EPSFBuilderStarMaxPeak::MaximumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderStarMaxPeak::DefaultValue() const
+{
+    return 0.7;
+}
+
+// Absolute threshold value above which to detect a star
+
+EPSFBuilderStarThreshold::EPSFBuilderStarThreshold(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderStarThresholdParameter = this;
+}
+
+IsoString EPSFBuilderStarThreshold::Id() const
+{
+    return "starThreshold";
+}
+
+int EPSFBuilderStarThreshold::Precision() const
+{
+    return 3;
+}
+
+double EPSFBuilderStarThreshold::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderStarThreshold::MaximumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderStarThreshold::DefaultValue() const
+{
+    return 0.01;
+}
+
+// FWHM (full-width half-maximum) of the Gaussian kernel in units of pixels
+
+EPSFBuilderStarFWHM::EPSFBuilderStarFWHM(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderStarFWHMParameter = this;
+}
+
+IsoString EPSFBuilderStarFWHM::Id() const
+{
+    return "starFWHM";
+}
+
+int EPSFBuilderStarFWHM::Precision() const
+{
+    return 1;
+}
+
+double EPSFBuilderStarFWHM::MinimumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderStarFWHM::MaximumValue() const
+{
+    return 10.0;
+}
+
+double EPSFBuilderStarFWHM::DefaultValue() const
+{
+    return 3.0;
+}
+
+// The star detection engine: native C++ or photutils DAOStarFinder
+
+EPSFBuilderDetectionEngine::EPSFBuilderDetectionEngine(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderDetectionEngineParameter = this;
+}
+
+IsoString EPSFBuilderDetectionEngine::Id() const
+{
+    return "detectionEngine";
+}
+
+size_type EPSFBuilderDetectionEngine::NumberOfElements() const
+{
+    return NumberOfDetectionEngine;
+}
+
+IsoString EPSFBuilderDetectionEngine::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    default:
+    case Native:    return "Native";
+    case Photutils: return "Photutils";
+    }
+}
+
+int EPSFBuilderDetectionEngine::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderDetectionEngine::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// How star centers are refined: kept as found by the detector, or by EPSFBuilderCentroider
+
+EPSFBuilderCentroidMethod::EPSFBuilderCentroidMethod(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderCentroidMethodParameter = this;
+}
+
+IsoString EPSFBuilderCentroidMethod::Id() const
+{
+    return "centroidMethod";
+}
+
+size_type EPSFBuilderCentroidMethod::NumberOfElements() const
+{
+    return NumberOfCentroidMethod;
+}
+
+IsoString EPSFBuilderCentroidMethod::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    default:
+    case Detector:          return "Detector";
+    case Moments:           return "Moments";
+    case MarginalGaussian:  return "MarginalGaussian";
+    case IterativeWeighted: return "IterativeWeighted";
+    }
+}
+
+int EPSFBuilderCentroidMethod::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderCentroidMethod::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// Background removal of Step 1: full starlet transform, streaming through the scales with the same
+// result, or an approximate multiresolution estimate
+
+EPSFBuilderBackgroundMode::EPSFBuilderBackgroundMode(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderBackgroundModeParameter = this;
+}
+
+IsoString EPSFBuilderBackgroundMode::Id() const
+{
+    return "backgroundMode";
+}
+
+size_type EPSFBuilderBackgroundMode::NumberOfElements() const
+{
+    return NumberOfBackgroundMode;
+}
+
+IsoString EPSFBuilderBackgroundMode::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    case Starlet:         return "Starlet";
+    default:
+    case Streaming:       return "Streaming";
+    case Multiresolution: return "Multiresolution";
+    }
+}
+
+int EPSFBuilderBackgroundMode::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderBackgroundMode::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// Capacity in MiB of the cache of background-subtracted images and extracted stars, 0 disables it.
+// It also bounds the stage outputs kept from the last execution on a view.
+
+EPSFBuilderDetectionCacheSize::EPSFBuilderDetectionCacheSize(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderDetectionCacheSizeParameter = this;
+}
+
+IsoString EPSFBuilderDetectionCacheSize::Id() const
+{
+    return "detectionCacheSize";
+}
+
+double EPSFBuilderDetectionCacheSize::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderDetectionCacheSize::MaximumValue() const
+{
+    return 65536.0;
+}
+
+double EPSFBuilderDetectionCacheSize::DefaultValue() const
+{
+    return 1024.0;
+}
+
+// Memory budget in MiB of one tile of Steps 1 to 6, see EPSFBuilderTiler; 0 processes the image as a
+// whole
+
+EPSFBuilderTileMemory::EPSFBuilderTileMemory(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderTileMemoryParameter = this;
+}
+
+IsoString EPSFBuilderTileMemory::Id() const
+{
+    return "tileMemory";
+}
+
+double EPSFBuilderTileMemory::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderTileMemory::MaximumValue() const
+{
+    return 1048576.0;
+}
+
+double EPSFBuilderTileMemory::DefaultValue() const
+{
+    return 0.0;
+}
+
+// Star size in star extraction and of the generated ePSF in pixels along each axis
+
+EPSFBuilderStarSize::EPSFBuilderStarSize(MetaProcess* P) : MetaInt8(P)
+{
+    TheEPSFBuilderStarSizeParameter = this;
+}
+
+IsoString EPSFBuilderStarSize::Id() const
+{
+    return "starSize";
+}
+
+double EPSFBuilderStarSize::MinimumValue() const
+{
+    return 5.0;
+}
+
+double EPSFBuilderStarSize::MaximumValue() const
+{
+    return 100.0;
+}
+
+double EPSFBuilderStarSize::DefaultValue() const
+{
+    return 45.0;
+}
+
+// Oversampling factor of drizzling when building the ePSF
+
+EPSFBuilderOversampling::EPSFBuilderOversampling(MetaProcess* P) : MetaInt8(P)
+{
+    TheEPSFBuilderOversamplingParameter = this;
+}
+
+IsoString EPSFBuilderOversampling::Id() const
+{
+    return "oversampling";
+}
+
+double EPSFBuilderOversampling::MinimumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderOversampling::MaximumValue() const
+{
+    return 4.0;
+}
+
+double EPSFBuilderOversampling::DefaultValue() const
+{
+    return 2.0;
+}
+
+// The smoothing kernel to apply to the ePSF
+
+EPSFBuilderSmoothingKernel::EPSFBuilderSmoothingKernel(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderSmoothingKernelParameter = this;
+}
+
+IsoString EPSFBuilderSmoothingKernel::Id() const
+{
+    return "smoothingKernel";
+}
+
+size_type EPSFBuilderSmoothingKernel::NumberOfElements() const
+{
+    return NumberOfSmoothingKernel;
+}
+
+IsoString EPSFBuilderSmoothingKernel::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    default:
+    case Quadratic: return "Quadratic";
+    case Quartic:   return "Quartic";
+    }
+}
+
+int EPSFBuilderSmoothingKernel::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderSmoothingKernel::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// The maximum number of iterations to perform when building the ePSF
+
+EPSFBuilderMaxIterations::EPSFBuilderMaxIterations(MetaProcess* P) : MetaInt8(P)
+{
+    TheEPSFBuilderMaxIterationsParameter = this;
+}
+
+IsoString EPSFBuilderMaxIterations::Id() const
+{
+    return "maxIterations";
+}
+
+double EPSFBuilderMaxIterations::MinimumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderMaxIterations::MaximumValue() const
+{
+    return 10.0;
+}
+
+double EPSFBuilderMaxIterations::DefaultValue() const
+{
+    return 5.0;
+}
+
+// The ePSF building engine: native C++ or photutils EPSFBuilder
+
+EPSFBuilderFittingEngine::EPSFBuilderFittingEngine(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderFittingEngineParameter = this;
+}
+
+IsoString EPSFBuilderFittingEngine::Id() const
+{
+    return "fittingEngine";
+}
+
+size_type EPSFBuilderFittingEngine::NumberOfElements() const
+{
+    return NumberOfFittingEngine;
+}
+
+IsoString EPSFBuilderFittingEngine::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    default:
+    case Native:    return "Native";
+    case Photutils: return "Photutils";
+    }
+}
+
+int EPSFBuilderFittingEngine::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderFittingEngine::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// Number of columns of the PSF grid, one ePSF is built per grid cell
+
+EPSFBuilderGridColumns::EPSFBuilderGridColumns(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderGridColumnsParameter = this;
+}
+
+IsoString EPSFBuilderGridColumns::Id() const
+{
+    return "gridColumns";
+}
+
+double EPSFBuilderGridColumns::MinimumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderGridColumns::MaximumValue() const
+{
+    return 16.0;
+}
+
+double EPSFBuilderGridColumns::DefaultValue() const
+{
+    return 1.0;
+}
+
+// Number of rows of the PSF grid
+
+EPSFBuilderGridRows::EPSFBuilderGridRows(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderGridRowsParameter = this;
+}
+
+IsoString EPSFBuilderGridRows::Id() const
+{
+    return "gridRows";
+}
+
+double EPSFBuilderGridRows::MinimumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderGridRows::MaximumValue() const
+{
+    return 16.0;
+}
+
+double EPSFBuilderGridRows::DefaultValue() const
+{
+    return 1.0;
+}
+
+// Margin around each grid cell, as a fraction of the cell size, where stars are shared with the neighboring cells
+
+EPSFBuilderGridOverlap::EPSFBuilderGridOverlap(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderGridOverlapParameter = this;
+}
+
+IsoString EPSFBuilderGridOverlap::Id() const
+{
+    return "gridOverlap";
+}
+
+int EPSFBuilderGridOverlap::Precision() const
+{
+    return 2;
+}
+
+double EPSFBuilderGridOverlap::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderGridOverlap::MaximumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderGridOverlap::DefaultValue() const
+{
+    return 0.25;
+}
+
+// PSF photometry of every detected star with the finished ePSF, written as a CSV catalog or a FITS
+// binary table, see EPSFBuilderPhotometry
+
+EPSFBuilderPhotometryOutput::EPSFBuilderPhotometryOutput(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderPhotometryOutputParameter = this;
+}
+
+IsoString EPSFBuilderPhotometryOutput::Id() const
+{
+    return "photometryOutput";
+}
+
+size_type EPSFBuilderPhotometryOutput::NumberOfElements() const
+{
+    return NumberOfPhotometryOutput;
+}
+
+IsoString EPSFBuilderPhotometryOutput::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    default:
+    case Disabled: return "Disabled";
+    case CSV:      return "CSV";
+    case FITS:     return "FITS";
+    }
+}
+
+int EPSFBuilderPhotometryOutput::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderPhotometryOutput::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// Write every finished ePSF to the ePSF library, and with Reuse load a matching stored ePSF instead of
+// building a new one, see EPSFBuilderLibrary
+
+EPSFBuilderLibraryMode::EPSFBuilderLibraryMode(MetaProcess* P) : MetaEnumeration(P)
+{
+    TheEPSFBuilderLibraryModeParameter = this;
+}
+
+IsoString EPSFBuilderLibraryMode::Id() const
+{
+    return "libraryMode";
+}
+
+size_type EPSFBuilderLibraryMode::NumberOfElements() const
+{
+    return NumberOfLibraryMode;
+}
+
+IsoString EPSFBuilderLibraryMode::ElementId(size_type i) const
+{
+    switch (i)
+    {
+    default:
+    case Disabled: return "Disabled";
+    case Store:    return "Store";
+    case Reuse:    return "Reuse";
+    }
+}
+
+int EPSFBuilderLibraryMode::ElementValue(size_type i) const
+{
+    return int(i);
+}
+
+size_type EPSFBuilderLibraryMode::DefaultValueIndex() const
+{
+    return Default;
+}
+
+// Directory of the ePSF library, holding the stored ePSFs and their index
+
+EPSFBuilderLibraryDirectory::EPSFBuilderLibraryDirectory(MetaProcess* P) : MetaString(P)
+{
+    TheEPSFBuilderLibraryDirectoryParameter = this;
+}
+
+IsoString EPSFBuilderLibraryDirectory::Id() const
+{
+    return "libraryDirectory";
+}
+
+// Maximum time in hours between the observation of a frame and that of a stored ePSF it reuses
+
+EPSFBuilderLibraryTimeWindow::EPSFBuilderLibraryTimeWindow(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderLibraryTimeWindowParameter = this;
+}
+
+IsoString EPSFBuilderLibraryTimeWindow::Id() const
+{
+    return "libraryTimeWindow";
+}
+
+int EPSFBuilderLibraryTimeWindow::Precision() const
+{
+    return 2;
+}
+
+double EPSFBuilderLibraryTimeWindow::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderLibraryTimeWindow::MaximumValue() const
+{
+    return 8760.0;
+}
+
+double EPSFBuilderLibraryTimeWindow::DefaultValue() const
+{
+    return 12.0;
+}
+
+// Maximum difference in pixels between the star FWHM and the FWHM of a stored ePSF it reuses
+
+EPSFBuilderLibraryFWHMTolerance::EPSFBuilderLibraryFWHMTolerance(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderLibraryFWHMToleranceParameter = this;
+}
+
+IsoString EPSFBuilderLibraryFWHMTolerance::Id() const
+{
+    return "libraryFWHMTolerance";
+}
+
+int EPSFBuilderLibraryFWHMTolerance::Precision() const
+{
+    return 2;
+}
+
+double EPSFBuilderLibraryFWHMTolerance::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderLibraryFWHMTolerance::MaximumValue() const
+{
+    return 10.0;
+}
+
+double EPSFBuilderLibraryFWHMTolerance::DefaultValue() const
+{
+    return 0.5;
+}
+
+// Deconvolve the target with the finished ePSF, or with the PSF grid when there is one, see
+// EPSFBuilderDeconvolution
+
+EPSFBuilderDeconvolve::EPSFBuilderDeconvolve(MetaProcess* P) : MetaBoolean(P)
+{
+    TheEPSFBuilderDeconvolveParameter = this;
+}
+
+IsoString EPSFBuilderDeconvolve::Id() const
+{
+    return "deconvolve";
+}
+
+bool EPSFBuilderDeconvolve::DefaultValue() const
+{
+    return false;
+}
+
+// Maximum number of Richardson-Lucy iterations of every deconvolution tile
+
+EPSFBuilderDeconvolutionIterations::EPSFBuilderDeconvolutionIterations(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderDeconvolutionIterationsParameter = this;
+}
+
+IsoString EPSFBuilderDeconvolutionIterations::Id() const
+{
+    return "deconvolutionIterations";
+}
+
+double EPSFBuilderDeconvolutionIterations::MinimumValue() const
+{
+    return 1.0;
+}
+
+double EPSFBuilderDeconvolutionIterations::MaximumValue() const
+{
+    return 1000.0;
+}
+
+double EPSFBuilderDeconvolutionIterations::DefaultValue() const
+{
+    return 50.0;
+}
+
+// A tile stops iterating when its estimate changes by less than this fraction of its flux in one
+// iteration; zero runs every iteration
+
+EPSFBuilderDeconvolutionTolerance::EPSFBuilderDeconvolutionTolerance(MetaProcess* P) : MetaFloat(P)
+{
+    TheEPSFBuilderDeconvolutionToleranceParameter = this;
+}
+
+IsoString EPSFBuilderDeconvolutionTolerance::Id() const
+{
+    return "deconvolutionTolerance";
+}
+
+int EPSFBuilderDeconvolutionTolerance::Precision() const
+{
+    return 6;
+}
+
+double EPSFBuilderDeconvolutionTolerance::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderDeconvolutionTolerance::MaximumValue() const
+{
+    return 0.01;
+}
+
+double EPSFBuilderDeconvolutionTolerance::DefaultValue() const
+{
+    return 0.00001;
+}
+
+// Number of out-of-process Python workers, 0 runs Python in the embedded interpreter
+
+EPSFBuilderPythonWorkers::EPSFBuilderPythonWorkers(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderPythonWorkersParameter = this;
+}
+
+IsoString EPSFBuilderPythonWorkers::Id() const
+{
+    return "pythonWorkers";
+}
+
+double EPSFBuilderPythonWorkers::MinimumValue() const
+{
+    return 0.0;
+}
+
+double EPSFBuilderPythonWorkers::MaximumValue() const
+{
+    return 64.0;
+}
+
+double EPSFBuilderPythonWorkers::DefaultValue() const
+{
+    return 0.0;
+}
+
+// List of image files processed by global execution
+
+EPSFBuilderTargetFrames::EPSFBuilderTargetFrames(MetaProcess* P) : MetaTable(P)
+{
+    TheEPSFBuilderTargetFramesParameter = this;
+}
+
+IsoString EPSFBuilderTargetFrames::Id() const
+{
+    return "targetFrames";
+}
+
+EPSFBuilderTargetFrameEnabled::EPSFBuilderTargetFrameEnabled(MetaTable* T) : MetaBoolean(T)
+{
+    TheEPSFBuilderTargetFrameEnabledParameter = this;
+}
+
+IsoString EPSFBuilderTargetFrameEnabled::Id() const
+{
+    return "enabled";
+}
+
+bool EPSFBuilderTargetFrameEnabled::DefaultValue() const
+{
+    return true;
+}
+
+EPSFBuilderTargetFramePath::EPSFBuilderTargetFramePath(MetaTable* T) : MetaString(T)
+{
+    TheEPSFBuilderTargetFramePathParameter = this;
+}
+
+IsoString EPSFBuilderTargetFramePath::Id() const
+{
+    return "path";
+}
+
+// Directory where the ePSF and star catalog of each target frame are written, next to the frame if empty
+
+EPSFBuilderOutputDirectory::EPSFBuilderOutputDirectory(MetaProcess* P) : MetaString(P)
+{
+    TheEPSFBuilderOutputDirectoryParameter = this;
+}
+
+IsoString EPSFBuilderOutputDirectory::Id() const
+{
+    return "outputDirectory";
+}
+
+// Build a single ePSF from the stars of all target frames, which must be registered, instead of one
+// ePSF per frame
+
+EPSFBuilderAccumulateFrames::EPSFBuilderAccumulateFrames(MetaProcess* P) : MetaBoolean(P)
+{
+    TheEPSFBuilderAccumulateFramesParameter = this;
+}
+
+IsoString EPSFBuilderAccumulateFrames::Id() const
+{
+    return "accumulateFrames";
+}
+
+bool EPSFBuilderAccumulateFrames::DefaultValue() const
+{
+    return false;
+}
+
+// Maximum number of stars kept from all frames for the accumulated ePSF, see EPSFBuilderAccumulator
+
+EPSFBuilderAccumulatedStars::EPSFBuilderAccumulatedStars(MetaProcess* P) : MetaInt32(P)
+{
+    TheEPSFBuilderAccumulatedStarsParameter = this;
+}
+
+IsoString EPSFBuilderAccumulatedStars::Id() const
+{
+    return "accumulatedStars";
+}
+
+double EPSFBuilderAccumulatedStars::MinimumValue() const
+{
+    return 10.0;
+}
+
+double EPSFBuilderAccumulatedStars::MaximumValue() const
+{
+    return 1000000.0;
+}
+
+double EPSFBuilderAccumulatedStars::DefaultValue() const
+{
+    return 10000.0;
+}
+
+// Chrome trace JSON file receiving the stage timings of every execution, none if empty
+
+EPSFBuilderTraceFile::EPSFBuilderTraceFile(MetaProcess* P) : MetaString(P)
+{
+    TheEPSFBuilderTraceFileParameter = this;
+}
+
+IsoString EPSFBuilderTraceFile::Id() const
+{
+    return "traceFile";
+}
+
+// Open the star detection window, the target with the box of every extracted star
+
+EPSFBuilderShowStarDetection::EPSFBuilderShowStarDetection(MetaProcess* P) : MetaBoolean(P)
+{
+    TheEPSFBuilderShowStarDetectionParameter = this;
+}
+
+IsoString EPSFBuilderShowStarDetection::Id() const
+{
+    return "showStarDetection";
+}
+
+bool EPSFBuilderShowStarDetection::DefaultValue() const
+{
+    return true;
+}
+
+// Open the extracted stars window, the mosaic of the stars the ePSF is built from
+
+EPSFBuilderShowExtractedStars::EPSFBuilderShowExtractedStars(MetaProcess* P) : MetaBoolean(P)
+{
+    TheEPSFBuilderShowExtractedStarsParameter = this;
+}
+
+IsoString EPSFBuilderShowExtractedStars::Id() const
+{
+    return "showExtractedStars";
+}
+
+bool EPSFBuilderShowExtractedStars::DefaultValue() const
+{
+    return true;
+}
+
 }	// namespace pcl
\ No newline at end of file
@@ -1,132 +1,506 @@
-#ifndef __EPSFBuilderParameters_h
-#define __EPSFBuilderParameters_h
-
-#include <pcl/MetaParameter.h>
-
-namespace pcl
-{
-
-PCL_BEGIN_LOCAL
-
-// Parameters for star detection
-
-class EPSFBuilderMaxStars : public MetaInt32
-{
-public:
-    EPSFBuilderMaxStars(MetaProcess*);
-
-    IsoString Id() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderMaxStars* TheEPSFBuilderMaxStarsParameter;
-
-class EPSFBuilderStarMaxPeak : public MetaFloat
-{
-public:
-    EPSFBuilderStarMaxPeak(MetaProcess*);
-
-    IsoString Id() const override;
-    int Precision() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderStarMaxPeak* TheEPSFBuilderStarMaxPeakParameter;
-
-class EPSFBuilderStarThreshold : public MetaFloat
-{
-public:
-    EPSFBuilderStarThreshold(MetaProcess*);
-
-    IsoString Id() const override;
-    int Precision() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderStarThreshold* TheEPSFBuilderStarThresholdParameter;
-
-class EPSFBuilderStarFWHM : public MetaFloat
-{
-public:
-    EPSFBuilderStarFWHM(MetaProcess*);
-
-    IsoString Id() const override;
-    int Precision() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderStarFWHM* TheEPSFBuilderStarFWHMParameter;
-
-// Parameters for building ePSF
-
-class EPSFBuilderStarSize : public MetaInt8
-{
-public:
-    EPSFBuilderStarSize(MetaProcess*);
-
-    IsoString Id() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderStarSize* TheEPSFBuilderStarSizeParameter;
-
-class EPSFBuilderOversampling : public MetaInt8
-{
-public:
-    EPSFBuilderOversampling(MetaProcess*);
-
-    IsoString Id() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderOversampling* TheEPSFBuilderOversamplingParameter;
-
-class EPSFBuilderSmoothingKernel : public MetaEnumeration
-{
-public:
-
-    enum {
-        Quartic, Quadratic, NumberOfSmoothingKernel, Default = Quadratic
-    };
-
-    EPSFBuilderSmoothingKernel(MetaProcess*);
-
-    IsoString Id() const override;
-    size_type NumberOfElements() const override;
-    IsoString ElementId(size_type) const override;
-    int ElementValue(size_type) const override;
-    size_type DefaultValueIndex() const override;
-};
-
-extern EPSFBuilderSmoothingKernel* TheEPSFBuilderSmoothingKernelParameter;
-
-class EPSFBuilderMaxIterations : public MetaInt8
-{
-public:
-    EPSFBuilderMaxIterations(MetaProcess*);
-
-    IsoString Id() const override;
-    double MinimumValue() const override;
-    double MaximumValue() const override;
-    double DefaultValue() const override;
-};
-
-extern EPSFBuilderMaxIterations* TheEPSFBuilderMaxIterationsParameter;
-
-PCL_END_LOCAL
-
-}	// namespace pcl
-
+#ifndef __EPSFBuilderParameters_h
+#define __EPSFBuilderParameters_h
+
+#include <pcl/MetaParameter.h>
+
+namespace pcl
+{
+
+PCL_BEGIN_LOCAL
+
+// Parameters for star detection
+
+class EPSFBuilderMaxStars : public MetaInt32
+{
+public:
+    EPSFBuilderMaxStars(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderMaxStars* TheEPSFBuilderMaxStarsParameter;
+
+class EPSFBuilderStarMaxPeak : public MetaFloat
+{
+public:
+    EPSFBuilderStarMaxPeak(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderStarMaxPeak* TheEPSFBuilderStarMaxPeakParameter;
+
+class EPSFBuilderStarThreshold : public MetaFloat
+{
+public:
+    EPSFBuilderStarThreshold(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderStarThreshold* TheEPSFBuilderStarThresholdParameter;
+
+class EPSFBuilderStarFWHM : public MetaFloat
+{
+public:
+    EPSFBuilderStarFWHM(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderStarFWHM* TheEPSFBuilderStarFWHMParameter;
+
+class EPSFBuilderDetectionEngine : public MetaEnumeration
+{
+public:
+
+    enum {
+        Native, Photutils, NumberOfDetectionEngine, Default = Native
+    };
+
+    EPSFBuilderDetectionEngine(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderDetectionEngine* TheEPSFBuilderDetectionEngineParameter;
+
+class EPSFBuilderCentroidMethod : public MetaEnumeration
+{
+public:
+
+    enum {
+        Detector, Moments, MarginalGaussian, IterativeWeighted, NumberOfCentroidMethod, Default = Detector
+    };
+
+    EPSFBuilderCentroidMethod(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderCentroidMethod* TheEPSFBuilderCentroidMethodParameter;
+
+class EPSFBuilderBackgroundMode : public MetaEnumeration
+{
+public:
+
+    enum {
+        Starlet, Streaming, Multiresolution, NumberOfBackgroundMode, Default = Streaming
+    };
+
+    EPSFBuilderBackgroundMode(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderBackgroundMode* TheEPSFBuilderBackgroundModeParameter;
+
+class EPSFBuilderDetectionCacheSize : public MetaInt32
+{
+public:
+    EPSFBuilderDetectionCacheSize(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderDetectionCacheSize* TheEPSFBuilderDetectionCacheSizeParameter;
+
+class EPSFBuilderTileMemory : public MetaInt32
+{
+public:
+    EPSFBuilderTileMemory(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderTileMemory* TheEPSFBuilderTileMemoryParameter;
+
+// Parameters for building ePSF
+
+class EPSFBuilderStarSize : public MetaInt8
+{
+public:
+    EPSFBuilderStarSize(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderStarSize* TheEPSFBuilderStarSizeParameter;
+
+class EPSFBuilderOversampling : public MetaInt8
+{
+public:
+    EPSFBuilderOversampling(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderOversampling* TheEPSFBuilderOversamplingParameter;
+
+class EPSFBuilderSmoothingKernel : public MetaEnumeration
+{
+public:
+
+    enum {
+        Quartic, Quadratic, NumberOfSmoothingKernel, Default = Quadratic
+    };
+
+    EPSFBuilderSmoothingKernel(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderSmoothingKernel* TheEPSFBuilderSmoothingKernelParameter;
+
+class EPSFBuilderMaxIterations : public MetaInt8
+{
+public:
+    EPSFBuilderMaxIterations(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderMaxIterations* TheEPSFBuilderMaxIterationsParameter;
+
+class EPSFBuilderFittingEngine : public MetaEnumeration
+{
+public:
+
+    enum {
+        Native, Photutils, NumberOfFittingEngine, Default = Native
+    };
+
+    EPSFBuilderFittingEngine(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderFittingEngine* TheEPSFBuilderFittingEngineParameter;
+
+class EPSFBuilderGridColumns : public MetaInt32
+{
+public:
+    EPSFBuilderGridColumns(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderGridColumns* TheEPSFBuilderGridColumnsParameter;
+
+class EPSFBuilderGridRows : public MetaInt32
+{
+public:
+    EPSFBuilderGridRows(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderGridRows* TheEPSFBuilderGridRowsParameter;
+
+class EPSFBuilderGridOverlap : public MetaFloat
+{
+public:
+    EPSFBuilderGridOverlap(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderGridOverlap* TheEPSFBuilderGridOverlapParameter;
+
+class EPSFBuilderPhotometryOutput : public MetaEnumeration
+{
+public:
+
+    enum {
+        Disabled, CSV, FITS, NumberOfPhotometryOutput, Default = Disabled
+    };
+
+    EPSFBuilderPhotometryOutput(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderPhotometryOutput* TheEPSFBuilderPhotometryOutputParameter;
+
+// Parameters for the ePSF library
+
+class EPSFBuilderLibraryMode : public MetaEnumeration
+{
+public:
+
+    enum {
+        Disabled, Store, Reuse, NumberOfLibraryMode, Default = Disabled
+    };
+
+    EPSFBuilderLibraryMode(MetaProcess*);
+
+    IsoString Id() const override;
+    size_type NumberOfElements() const override;
+    IsoString ElementId(size_type) const override;
+    int ElementValue(size_type) const override;
+    size_type DefaultValueIndex() const override;
+};
+
+extern EPSFBuilderLibraryMode* TheEPSFBuilderLibraryModeParameter;
+
+class EPSFBuilderLibraryDirectory : public MetaString
+{
+public:
+    EPSFBuilderLibraryDirectory(MetaProcess*);
+
+    IsoString Id() const override;
+};
+
+extern EPSFBuilderLibraryDirectory* TheEPSFBuilderLibraryDirectoryParameter;
+
+class EPSFBuilderLibraryTimeWindow : public MetaFloat
+{
+public:
+    EPSFBuilderLibraryTimeWindow(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderLibraryTimeWindow* TheEPSFBuilderLibraryTimeWindowParameter;
+
+class EPSFBuilderLibraryFWHMTolerance : public MetaFloat
+{
+public:
+    EPSFBuilderLibraryFWHMTolerance(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderLibraryFWHMTolerance* TheEPSFBuilderLibraryFWHMToleranceParameter;
+
+// Parameters for deconvolution
+
+class EPSFBuilderDeconvolve : public MetaBoolean
+{
+public:
+    EPSFBuilderDeconvolve(MetaProcess*);
+
+    IsoString Id() const override;
+    bool DefaultValue() const override;
+};
+
+extern EPSFBuilderDeconvolve* TheEPSFBuilderDeconvolveParameter;
+
+class EPSFBuilderDeconvolutionIterations : public MetaInt32
+{
+public:
+    EPSFBuilderDeconvolutionIterations(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderDeconvolutionIterations* TheEPSFBuilderDeconvolutionIterationsParameter;
+
+class EPSFBuilderDeconvolutionTolerance : public MetaFloat
+{
+public:
+    EPSFBuilderDeconvolutionTolerance(MetaProcess*);
+
+    IsoString Id() const override;
+    int Precision() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderDeconvolutionTolerance* TheEPSFBuilderDeconvolutionToleranceParameter;
+
+// Parameters for Python execution
+
+class EPSFBuilderPythonWorkers : public MetaInt32
+{
+public:
+    EPSFBuilderPythonWorkers(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderPythonWorkers* TheEPSFBuilderPythonWorkersParameter;
+
+// Parameters for batch processing
+
+class EPSFBuilderTargetFrames : public MetaTable
+{
+public:
+    EPSFBuilderTargetFrames(MetaProcess*);
+
+    IsoString Id() const override;
+};
+
+extern EPSFBuilderTargetFrames* TheEPSFBuilderTargetFramesParameter;
+
+class EPSFBuilderTargetFrameEnabled : public MetaBoolean
+{
+public:
+    EPSFBuilderTargetFrameEnabled(MetaTable*);
+
+    IsoString Id() const override;
+    bool DefaultValue() const override;
+};
+
+extern EPSFBuilderTargetFrameEnabled* TheEPSFBuilderTargetFrameEnabledParameter;
+
+class EPSFBuilderTargetFramePath : public MetaString
+{
+public:
+    EPSFBuilderTargetFramePath(MetaTable*);
+
+    IsoString Id() const override;
+};
+
+extern EPSFBuilderTargetFramePath* TheEPSFBuilderTargetFramePathParameter;
+
+class EPSFBuilderOutputDirectory : public MetaString
+{
+public:
+    EPSFBuilderOutputDirectory(MetaProcess*);
+
+    IsoString Id() const override;
+};
+
+extern EPSFBuilderOutputDirectory* TheEPSFBuilderOutputDirectoryParameter;
+
+class EPSFBuilderAccumulateFrames : public MetaBoolean
+{
+public:
+    EPSFBuilderAccumulateFrames(MetaProcess*);
+
+    IsoString Id() const override;
+    bool DefaultValue() const override;
+};
+
+extern EPSFBuilderAccumulateFrames* TheEPSFBuilderAccumulateFramesParameter;
+
+class EPSFBuilderAccumulatedStars : public MetaInt32
+{
+public:
+    EPSFBuilderAccumulatedStars(MetaProcess*);
+
+    IsoString Id() const override;
+    double MinimumValue() const override;
+    double MaximumValue() const override;
+    double DefaultValue() const override;
+};
+
+extern EPSFBuilderAccumulatedStars* TheEPSFBuilderAccumulatedStarsParameter;
+
+class EPSFBuilderTraceFile : public MetaString
+{
+public:
+    EPSFBuilderTraceFile(MetaProcess*);
+
+    IsoString Id() const override;
+};
+
+extern EPSFBuilderTraceFile* TheEPSFBuilderTraceFileParameter;
+
+class EPSFBuilderShowStarDetection : public MetaBoolean
+{
+public:
+    EPSFBuilderShowStarDetection(MetaProcess*);
+
+    IsoString Id() const override;
+    bool DefaultValue() const override;
+};
+
+extern EPSFBuilderShowStarDetection* TheEPSFBuilderShowStarDetectionParameter;
+
+class EPSFBuilderShowExtractedStars : public MetaBoolean
+{
+public:
+    EPSFBuilderShowExtractedStars(MetaProcess*);
+
+    IsoString Id() const override;
+    bool DefaultValue() const override;
+};
+
+extern EPSFBuilderShowExtractedStars* TheEPSFBuilderShowExtractedStarsParameter;
+
+PCL_END_LOCAL
+
+}	// namespace pcl
+
 #endif	// __EPSFBuilderParameters_h
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include <cstring>
+#include <pcl/File.h>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderFitter.h"
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderPhotometry.h"
+#include "EPSFBuilderStatistics.h"
+
+namespace pcl
+{
+
+EPSFBuilderPhotometry::EPSFBuilderPhotometry(const std::vector<double>& epsf, int size, int oversampling, double fwhm)
+    : m_epsf(epsf)
+    , m_size(size)
+    , m_oversampling(oversampling)
+    , m_fwhm(fwhm)
+{
+    if (m_epsf.empty() || size_type(m_size) * m_size != m_epsf.size())
+        throw Error("PSF photometry requires an ePSF");
+
+    double sum = 0;
+    for (double v : m_epsf)
+        sum += v;
+    if (!(sum > 0))
+        throw Error("PSF photometry requires an ePSF of positive flux");
+    double k = double(m_oversampling) * m_oversampling / sum;
+    for (double& v : m_epsf)
+        v *= k;
+}
+
+int EPSFBuilderPhotometry::BoxSize() const
+{
+    return 2 * Max(2, RoundInt(1.5 * m_fwhm)) + 1;
+}
+
+void EPSFBuilderPhotometry::Fit(const ImageVariant& image, const std::vector<double>& positions)
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("PSF photometry requires a real floating point image");
+
+    if (image.BitsPerSample() == 32)
+        FitImage(static_cast<const Image&>(*image), positions);
+    else
+        FitImage(static_cast<const DImage&>(*image), positions);
+}
+
+template <class P>
+void EPSFBuilderPhotometry::FitImage(const GenericImage<P>& image, const std::vector<double>& positions)
+{
+    // Robust standard deviation of the image
+    double median, mad;
+    EPSFBuilderSampledMedianMAD(image, median, mad);
+    m_noise = 1.4826 * mad;
+
+    const size_type count = positions.size() / 2;
+    std::vector<Source> sources(count);
+    std::vector<uint8> fitted(count, 0);
+    EPSFBuilderParallelFor(count, [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            sources[i].id = int(i + 1);
+            fitted[i] = FitSource(image, positions[2 * i], positions[2 * i + 1], sources[i]);
+        }
+    }, 16);
+
+    m_sources.clear();
+    for (size_type i = 0; i < count; i++)
+        if (fitted[i])
+            m_sources.push_back(sources[i]);
+}
+
+template <class P>
+bool EPSFBuilderPhotometry::FitSource(const GenericImage<P>& image, double x, double y, Source& source) const
+{
+    const double c = (m_size - 1) / 2.0;
+    const double os = m_oversampling;
+    const int half = BoxSize() / 2;
+
+    // The box stays where the source was detected, clipped to the image
+    int x0 = Max(0, RoundInt(x) - half);
+    int x1 = Min(image.Width() - 1, RoundInt(x) + half);
+    int y0 = Max(0, RoundInt(y) - half);
+    int y1 = Min(image.Height() - 1, RoundInt(y) + half);
+    if (x1 - x0 < 2 || y1 - y0 < 2)
+        return false;
+
+    const int width = x1 - x0 + 1;
+    std::vector<double> box(size_type(width) * (y1 - y0 + 1));
+    for (int j = y0, k = 0; j <= y1; j++)
+    {
+        const typename P::sample* row = image.ScanLine(j) + x0;
+        for (int i = 0; i < width; i++, k++)
+            P::FromSample(box[k], row[i]);
+    }
+
+    auto model = [&](double px, double py, int i, int j)
+    {
+        return EPSFBuilderFitter::Interpolate(m_epsf, m_size, os * (i - px) + c, os * (j - py) + c);
+    };
+
+    // Linear least squares flux at the detected center as the starting point
+    double ve = 0, ee = 0;
+    for (int j = y0, k = 0; j <= y1; j++)
+        for (int i = x0; i <= x1; i++, k++)
+            if (IsFinite(box[k]))
+            {
+                double e = model(x, y, i, j);
+                ve += box[k] * e;
+                ee += e * e;
+            }
+    if (!(ee > 0))
+        return false;
+
+    double p[3] = { ve / ee, x - x0, y - y0 };
+    if (!EPSFBuilderFitter::FitBox(m_epsf, m_size, m_oversampling, box.data(), width, y1 - y0 + 1, p))
+        return false;
+    p[1] += x0;
+    p[2] += y0;
+
+    if (!IsFinite(p[0]) || !IsFinite(p[1]) || !IsFinite(p[2]) || p[0] <= 0)
+        return false;
+    if (Abs(p[1] - x) > half || Abs(p[2] - y) > half)
+        return false;
+
+    double absolute = 0, squared = 0;
+    int n = 0;
+    for (int j = y0, k = 0; j <= y1; j++)
+        for (int i = x0; i <= x1; i++, k++)
+            if (IsFinite(box[k]))
+            {
+                double r = box[k] - p[0] * model(p[1], p[2], i, j);
+                absolute += Abs(r);
+                squared += r * r;
+                n++;
+            }
+    if (n <= 3)
+        return false;
+
+    const double variance = (m_noise > 0) ? m_noise * m_noise : 1.0;
+    source.x = p[1];
+    source.y = p[2];
+    source.flux = p[0];
+    source.residual = absolute / p[0];
+    source.chi2 = squared / variance / (n - 3);
+    return true;
+}
+
+void EPSFBuilderPhotometry::WriteCSV(const String& filePath) const
+{
+    IsoString text = "id,x,y,flux,residual,chi2\n";
+    for (const Source& source : m_sources)
+        text.AppendFormat("%d,%.4f,%.4f,%.6e,%.6e,%.6e\n", source.id, source.x, source.y, source.flux, source.residual, source.chi2);
+    File::WriteTextFile(filePath, text);
+}
+
+// FITS header and data units are whole 2880-byte blocks of 80-character cards
+static const size_type FITSBlockSize = 2880;
+
+static void AppendCard(IsoString& header, const char* keyword, const IsoString& value, const char* comment = nullptr)
+{
+    IsoString card = IsoString().Format("%-8s= %20s", keyword, value.c_str());
+    if (comment != nullptr)
+        card += IsoString(" / ") + comment;
+    if (card.Length() > 80)
+        card = card.Left(80);
+    while (card.Length() < 80)
+        card += ' ';
+    header += card;
+}
+
+static IsoString FITSString(const char* value)
+{
+    // Quoted, at least eight characters between the quotes, left-aligned in the value field
+    IsoString quoted = IsoString().Format("'%-8s'", value);
+    while (quoted.Length() < 20)
+        quoted += ' ';
+    return quoted;
+}
+
+static void EndHeader(IsoString& header)
+{
+    IsoString end = "END";
+    while (end.Length() < 80)
+        end += ' ';
+    header += end;
+    while (header.Length() % FITSBlockSize != 0)
+        header += ' ';
+}
+
+template <typename T, typename U>
+static void AppendBigEndian(std::vector<uint8>& data, T value)
+{
+    U u;
+    std::memcpy(&u, &value, sizeof(T));
+    for (int b = int(sizeof(T)) - 1; b >= 0; b--)
+        data.push_back(uint8(u >> (8 * b)));
+}
+
+void EPSFBuilderPhotometry::WriteFITS(const String& filePath) const
+{
+    static const char* columns[] = { "ID", "X", "Y", "FLUX", "RESIDUAL", "CHI2" };
+    const int numberOfColumns = 6;
+    const int rowBytes = 4 + 5 * 8;
+
+    IsoString primary;
+    AppendCard(primary, "SIMPLE", "T", "conforms to FITS standard");
+    AppendCard(primary, "BITPIX", "8");
+    AppendCard(primary, "NAXIS", "0");
+    AppendCard(primary, "EXTEND", "T");
+    EndHeader(primary);
+
+    IsoString table;
+    AppendCard(table, "XTENSION", FITSString("BINTABLE"), "binary table extension");
+    AppendCard(table, "BITPIX", "8");
+    AppendCard(table, "NAXIS", "2");
+    AppendCard(table, "NAXIS1", IsoString().Format("%d", rowBytes), "bytes per row");
+    AppendCard(table, "NAXIS2", IsoString().Format("%d", int(m_sources.size())), "number of sources");
+    AppendCard(table, "PCOUNT", "0");
+    AppendCard(table, "GCOUNT", "1");
+    AppendCard(table, "TFIELDS", IsoString().Format("%d", numberOfColumns));
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        IsoString type = IsoString().Format("TTYPE%d", i + 1);
+        IsoString form = IsoString().Format("TFORM%d", i + 1);
+        AppendCard(table, type.c_str(), FITSString(columns[i]));
+        AppendCard(table, form.c_str(), FITSString((i == 0) ? "1J" : "1D"));
+    }
+    AppendCard(table, "EXTNAME", FITSString("PHOTOMETRY"));
+    AppendCard(table, "NOISE", IsoString().Format("%.10g", m_noise), "noise sigma of the chi-squared");
+    EndHeader(table);
+
+    std::vector<uint8> data;
+    data.reserve(m_sources.size() * rowBytes + FITSBlockSize);
+    for (const Source& source : m_sources)
+    {
+        AppendBigEndian<int32, uint32>(data, int32(source.id));
+        AppendBigEndian<double, uint64>(data, source.x);
+        AppendBigEndian<double, uint64>(data, source.y);
+        AppendBigEndian<double, uint64>(data, source.flux);
+        AppendBigEndian<double, uint64>(data, source.residual);
+        AppendBigEndian<double, uint64>(data, source.chi2);
+    }
+    while (data.size() % FITSBlockSize != 0)
+        data.push_back(0);
+
+    File file;
+    file.Create(filePath);
+    file.Write(primary.c_str(), fsize_type(primary.Length()));
+    file.Write(table.c_str(), fsize_type(table.Length()));
+    if (!data.empty())
+        file.Write(data.data(), fsize_type(data.size()));
+    file.Close();
+}
+
+}	// namespace pcl
\ No newline at end of file
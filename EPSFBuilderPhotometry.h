@@ -0,0 +1,80 @@
+#ifndef __EPSFBuilderPhotometry_h
+#define __EPSFBuilderPhotometry_h
+
+#include <vector>
+#include <pcl/ImageVariant.h>
+#include <pcl/String.h>
+
+namespace pcl
+{
+
+// PSF photometry with a finished ePSF. The ePSF, scaled by a flux, is fitted to every source in flux
+// and center by EPSFBuilderFitter::FitBox(), the fit the native fitter refits its stars with, over a
+// box of about three times the FWHM around the source. Sources are independent and fitted in
+// parallel, each thread taking a contiguous range of them.
+//
+// The fit quality is reported as the residual of photutils (qfit), the sum of the absolute fit
+// residuals over the fitted flux, and as the reduced chi-squared with the noise of the image,
+// estimated from the MAD of a regular sample of its pixels.
+
+class EPSFBuilderPhotometry
+{
+public:
+    struct Source
+    {
+        int id;                     // 1-based index of the source in the positions given to Fit()
+        double x;                   // fitted center, in image pixels
+        double y;
+        double flux;
+        double residual;
+        double chi2;
+    };
+
+    // epsf holds size*size samples at oversampling times the image resolution, with the center at
+    // ((size-1)/2, (size-1)/2); it is normalized to unit flux at the image resolution
+    EPSFBuilderPhotometry(const std::vector<double>& epsf, int size, int oversampling, double fwhm);
+
+    // Fits every x, y pair of positions on the first channel of image, a background-subtracted real
+    // floating point image. Sources without a finite fit of positive flux within half a fit box of
+    // their position are left out of Sources().
+    void Fit(const ImageVariant& image, const std::vector<double>& positions);
+
+    const std::vector<Source>& Sources() const
+    {
+        return m_sources;
+    }
+
+    // Noise of the image of the last Fit()
+    double Noise() const
+    {
+        return m_noise;
+    }
+
+    // Side of the fit boxes
+    int BoxSize() const;
+
+    // Writes the sources as CSV with an id,x,y,flux,residual,chi2 header line
+    void WriteCSV(const String& filePath) const;
+
+    // Writes the sources as a FITS binary table with the same columns, in the first extension of a
+    // file with an empty primary HDU
+    void WriteFITS(const String& filePath) const;
+
+private:
+    std::vector<double> m_epsf;
+    int m_size;
+    int m_oversampling;
+    double m_fwhm;
+    double m_noise = 0;
+    std::vector<Source> m_sources;
+
+    template <class P>
+    void FitImage(const GenericImage<P>& image, const std::vector<double>& positions);
+
+    template <class P>
+    bool FitSource(const GenericImage<P>& image, double x, double y, Source& source) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderPhotometry_h
\ No newline at end of file
@@ -0,0 +1,1030 @@
+#include <algorithm>
+#include <pcl/AutoPointer.h>
+#include <pcl/File.h>
+#include <pcl/IntegerResample.h>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderBackground.h"
+#include "EPSFBuilderCentroider.h"
+#include "EPSFBuilderDeconvolution.h"
+#include "EPSFBuilderDetectionCache.h"
+#include "EPSFBuilderExtractor.h"
+#include "EPSFBuilderGrid.h"
+#include "EPSFBuilderIsolationFilter.h"
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderParameters.h"
+#include "EPSFBuilderPhotometry.h"
+#include "EPSFBuilderPipeline.h"
+#include "EPSFBuilderProfiler.h"
+#include "EPSFBuilderStarDetector.h"
+#include "EPSFBuilderTiler.h"
+
+namespace pcl
+{
+
+// Pixel kernels of the stages, instantiated once per sample type. The pipeline only accepts 32 and
+// 64-bit floating point images, and every image derived from the target shares its sample type, so
+// each call dispatches once on BitsPerSample() and the loops work on raw scan lines.
+
+// The images created by the pipeline take the parallel processing settings of the image they derive
+// from, which standalone builds disable
+static void InheritParallelism(ImageVariant& image, const ImageVariant& source)
+{
+    image->EnableParallelProcessing(source->IsParallelProcessingEnabled(), source->MaxProcessors());
+}
+
+// Allocates a single channel image of the given size and fills it from a row-major buffer
+template <class P>
+static void CopyToImage(GenericImage<P>& image, const double* data, int width, int height)
+{
+    image.AllocateData(width, height, 1, ColorSpace::Gray);
+    P::Copy(image[0], data, size_type(width) * height);
+}
+
+static void CopyToImage(ImageVariant& image, const double* data, int width, int height)
+{
+    if (image.BitsPerSample() == 32)
+        CopyToImage(static_cast<Image&>(*image), data, width, height);
+    else if (image.BitsPerSample() == 64)
+        CopyToImage(static_cast<DImage&>(*image), data, width, height);
+}
+
+// Copies a whole image into target with its top left corner at (x0, y0), one scan line at a time
+template <class P>
+static void CopyTile(GenericImage<P>& target, const GenericImage<P>& tile, int x0, int y0)
+{
+    for (int y = 0; y < tile.Height(); y++)
+        P::Copy(target.PixelAddress(x0, y0 + y), tile.ScanLine(y), tile.Width());
+}
+
+// Allocates an image with one channel per ePSF, all of the same size, and fills it
+template <class P>
+static void CopyToImage(GenericImage<P>& image, const std::vector<EPSFBuilderExtraction>& epsfs, int colorSpace)
+{
+    image.AllocateData(epsfs[0].epsfWidth, epsfs[0].epsfHeight, int(epsfs.size()), ColorSpace::value_type(colorSpace));
+    for (size_type c = 0; c < epsfs.size(); c++)
+        P::Copy(image[int(c)], epsfs[c].epsfData.data(), image.NumberOfPixels());
+}
+
+static void CopyToImage(ImageVariant& image, const std::vector<EPSFBuilderExtraction>& epsfs, int colorSpace)
+{
+    if (image.BitsPerSample() == 32)
+        CopyToImage(static_cast<Image&>(*image), epsfs, colorSpace);
+    else if (image.BitsPerSample() == 64)
+        CopyToImage(static_cast<DImage&>(*image), epsfs, colorSpace);
+}
+
+// Allocates a single channel image with the mean of the nominal channels of image, the image in
+// which the stars of a multichannel target are detected
+template <class P>
+static void CombineChannels(GenericImage<P>& combined, const GenericImage<P>& image)
+{
+    const int channels = image.NumberOfNominalChannels();
+    const double scale = 1.0 / channels;
+    combined.AllocateData(image.Width(), image.Height(), 1, ColorSpace::Gray);
+    EPSFBuilderParallelFor(image.NumberOfPixels(), [&](size_type begin, size_type end, int)
+    {
+        typename P::sample* f = combined[0];
+        for (size_type i = begin; i < end; i++)
+        {
+            double sum = 0;
+            for (int c = 0; c < channels; c++)
+                sum += image[c][i];
+            f[i] = typename P::sample(scale * sum);
+        }
+    }, 65536);
+}
+
+static void CombineChannels(ImageVariant& combined, const ImageVariant& image)
+{
+    if (image.BitsPerSample() == 32)
+        CombineChannels(static_cast<Image&>(*combined), static_cast<const Image&>(*image));
+    else if (image.BitsPerSample() == 64)
+        CombineChannels(static_cast<DImage&>(*combined), static_cast<const DImage&>(*image));
+}
+
+// Allocates a single channel image with channel c of image
+template <class P>
+static void CopyChannel(GenericImage<P>& target, const GenericImage<P>& image, int c)
+{
+    target.AllocateData(image.Width(), image.Height(), 1, ColorSpace::Gray);
+    P::Copy(target[0], image[c], image.NumberOfPixels());
+}
+
+static void CopyChannel(ImageVariant& target, const ImageVariant& image, int c)
+{
+    if (image.BitsPerSample() == 32)
+        CopyChannel(static_cast<Image&>(*target), static_cast<const Image&>(*image), c);
+    else if (image.BitsPerSample() == 64)
+        CopyChannel(static_cast<DImage&>(*target), static_cast<const DImage&>(*image), c);
+}
+
+// Row-major mean of the channels of image, the ePSF of the combined image of a color target
+template <class P>
+static void MeanOfChannels(std::vector<double>& mean, const GenericImage<P>& image)
+{
+    const double scale = 1.0 / image.NumberOfChannels();
+    mean.assign(image.NumberOfPixels(), 0.0);
+    for (int c = 0; c < image.NumberOfChannels(); c++)
+        for (size_type i = 0; i < image.NumberOfPixels(); i++)
+            mean[i] += scale * image[c][i];
+}
+
+static void MeanOfChannels(std::vector<double>& mean, const ImageVariant& image)
+{
+    if (image.BitsPerSample() == 32)
+        MeanOfChannels(mean, static_cast<const Image&>(*image));
+    else if (image.BitsPerSample() == 64)
+        MeanOfChannels(mean, static_cast<const DImage&>(*image));
+}
+
+// Row-major samples of channel c of image
+template <class P>
+static void ChannelData(std::vector<double>& data, const GenericImage<P>& image, int c)
+{
+    data.resize(image.NumberOfPixels());
+    for (size_type i = 0; i < image.NumberOfPixels(); i++)
+        P::FromSample(data[i], image[c][i]);
+}
+
+static void ChannelData(std::vector<double>& data, const ImageVariant& image, int c)
+{
+    if (image.BitsPerSample() == 32)
+        ChannelData(data, static_cast<const Image&>(*image), c);
+    else if (image.BitsPerSample() == 64)
+        ChannelData(data, static_cast<const DImage&>(*image), c);
+}
+
+// Cuts the stars of reference out of a single channel image into stars, at the same origins and with
+// the same size as the cutouts of reference. Pixels outside the image are zero.
+template <class P>
+static void CutOutStars(const GenericImage<P>& image, const EPSFBuilderStarArena& reference, EPSFBuilderStarArena& stars)
+{
+    const int width = reference.Width();
+    const int height = reference.Height();
+    stars.Allocate(reference.Count(), width, height);
+    stars.originX = reference.originX;
+    stars.originY = reference.originY;
+    stars.centerX = reference.centerX;
+    stars.centerY = reference.centerY;
+    EPSFBuilderParallelFor(size_type(stars.Count()), [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            int ox = RoundInt(stars.originX[i]);
+            int oy = RoundInt(stars.originY[i]);
+            float* cutout = stars.Cutout(int(i));
+            double flux = 0;
+            for (int y = 0; y < height; y++)
+                if (oy + y >= 0 && oy + y < image.Height())
+                    for (int x = 0; x < width; x++)
+                        if (ox + x >= 0 && ox + x < image.Width())
+                        {
+                            double v;
+                            P::FromSample(v, image(ox + x, oy + y));
+                            cutout[size_type(y) * width + x] = float(v);
+                            flux += v;
+                        }
+            stars.flux[i] = flux;
+        }
+    }, 16);
+}
+
+static void CutOutStars(const ImageVariant& image, const EPSFBuilderStarArena& reference, EPSFBuilderStarArena& stars)
+{
+    if (image.BitsPerSample() == 32)
+        CutOutStars(static_cast<const Image&>(*image), reference, stars);
+    else if (image.BitsPerSample() == 64)
+        CutOutStars(static_cast<const DImage&>(*image), reference, stars);
+}
+
+// Tiles do not overlap, so the stars are copied in parallel
+template <class P>
+static void TileStars(GenericImage<P>& mosaic, const EPSFBuilderStarArena& stars, int ncols, int size)
+{
+    const int x0 = (stars.Width() - size) / 2;
+    const int y0 = (stars.Height() - size) / 2;
+    EPSFBuilderParallelFor(size_type(stars.Count()), [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            const float* cutout = stars.Cutout(int(i));
+            int tx = int(i % ncols) * size;
+            int ty = int(i / ncols) * size;
+            for (int y = 0; y < size; y++)
+                P::Copy(mosaic.PixelAddress(tx, ty + y), cutout + size_type(y0 + y) * stars.Width() + x0, size);
+        }
+    }, 64);
+}
+
+// Number of layers of the starlet transform of Step 1, growing with the ePSF size
+static int BackgroundLayers(int starSize)
+{
+    return int(pcl::Log2<double>(starSize) + 2.5);
+}
+
+// ----------------------------------------------------------------------------
+
+bool EPSFBuilderPipeline::Parameters::IsGridMode() const
+{
+    return gridColumns > 1 || gridRows > 1;
+}
+
+bool EPSFBuilderPipeline::Parameters::IsTiled() const
+{
+    return tileMemory > 0;
+}
+
+bool EPSFBuilderPipeline::Parameters::UsesPython() const
+{
+    return detectionEngine == EPSFBuilderDetectionEngine::Photutils || fittingEngine == EPSFBuilderFittingEngine::Photutils;
+}
+
+// A stored ePSF replaces the build only when nothing else needs the stars: the PSF grid, the
+// photometry and the accumulation of frames all do
+bool EPSFBuilderPipeline::Parameters::ReusesLibrary() const
+{
+    return libraryMode == EPSFBuilderLibraryMode::Reuse && !IsGridMode() && !accumulateFrames && photometryOutput == EPSFBuilderPhotometryOutput::Disabled;
+}
+
+bool EPSFBuilderPipeline::Parameters::CanTile(String& whyNot) const
+{
+    if (IsTiled() && (detectionEngine != EPSFBuilderDetectionEngine::Native || fittingEngine != EPSFBuilderFittingEngine::Native))
+    {
+        whyNot = "Tiled processing requires the native detection and fitting engines.";
+        return false;
+    }
+    return true;
+}
+
+// Multichannel images are detected once, on their combined channels, then one ePSF is fitted per
+// channel from the same stars with the native fitter
+bool EPSFBuilderPipeline::Parameters::CanFitChannels(int channels, String& whyNot) const
+{
+    if (channels > 1 && fittingEngine != EPSFBuilderFittingEngine::Native)
+    {
+        whyNot = "Multichannel images require the native fitting engine.";
+        return false;
+    }
+    if (channels > 1 && IsTiled())
+    {
+        whyNot = "Tiled processing only supports single channel images.";
+        return false;
+    }
+    return true;
+}
+
+// PSF photometry fits the background-subtracted image of a single frame, which tiled processing does
+// not keep and accumulated frames do not share
+bool EPSFBuilderPipeline::Parameters::CanMeasureStars(String& whyNot) const
+{
+    if (photometryOutput == EPSFBuilderPhotometryOutput::Disabled)
+        return true;
+    if (IsTiled())
+    {
+        whyNot = "PSF photometry is not available with tiled processing.";
+        return false;
+    }
+    if (accumulateFrames)
+    {
+        whyNot = "PSF photometry is not available when accumulating frames.";
+        return false;
+    }
+    return true;
+}
+
+bool EPSFBuilderPipeline::Parameters::CanUseLibrary(String& whyNot) const
+{
+    if (libraryMode != EPSFBuilderLibraryMode::Disabled && libraryDirectory.IsEmpty())
+    {
+        whyNot = "The ePSF library requires a library directory.";
+        return false;
+    }
+    return true;
+}
+
+// Deconvolution needs the target pixels of every frame, and the accumulated ePSF belongs to no frame
+bool EPSFBuilderPipeline::Parameters::CanDeconvolve(String& whyNot) const
+{
+    if (deconvolve && accumulateFrames)
+    {
+        whyNot = "Deconvolution is not available when accumulating frames.";
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+size_type EPSFBuilderPipeline::StageOutputs::Bytes() const
+{
+    auto imageBytes = [](const ImageVariant& image)
+    {
+        return size_type(image.NumberOfPixels()) * image.NumberOfChannels() * image.BytesPerSample();
+    };
+    return imageBytes(starImage) + imageBytes(epsfImage) + imageBytes(fittedImage) + imageBytes(gridImage)
+        + (positions.size() + sources.size()) * sizeof(double)
+        + (extraction.starData.size() + extraction.starMeta.size() + extraction.epsfData.size()) * sizeof(double)
+        + size_type(stars.Count()) * (stars.Stride() * sizeof(float) + 5 * sizeof(double));
+}
+
+// ----------------------------------------------------------------------------
+
+EPSFBuilderPipeline::FitTask::FitTask(const EPSFBuilderPipeline& pipeline, std::vector<std::vector<EPSFBuilderFitter::Star>>& stars, const EPSFBuilderExtraction& extraction)
+    : results(stars.size())
+    , iterations(stars.size(), 0)
+    , m_pipeline(pipeline)
+    , m_stars(stars)
+    , m_extraction(extraction)
+{
+    const Parameters& p = pipeline.m_parameters;
+    for (size_type c = 0; c < stars.size(); c++)
+        m_fitters.Add(new EPSFBuilderFitter(p.oversampling, p.smoothingKernel, p.maxIterations));
+    if (p.fittingEngine == EPSFBuilderFittingEngine::Photutils)
+        m_python = &EPSFBuilderPython::Acquire(p.pythonDll);
+}
+
+void EPSFBuilderPipeline::FitTask::Run()
+{
+    try
+    {
+        if (m_python != nullptr)
+            m_python->Fit(m_pipeline.PrepareTask(), m_extraction, results[0]);
+        else
+        {
+            // The channels are fitted concurrently. Each fitter only runs its own threads when there
+            // are fewer channels than processors.
+            EPSFBuilderProfiler::Scope fitScope("ePSF fitting");
+            const bool nested = m_stars.size() < size_type(EPSFBuilderThreadCount(PCL_MAX_PROCESSORS));
+            EPSFBuilderParallelFor(m_stars.size(), [&](size_type begin, size_type end, int)
+            {
+                for (size_type c = begin; c < end; c++)
+                {
+                    EPSFBuilderFitter& fitter = m_fitters[c];
+                    fitter.EnableParallelProcessing(nested);
+                    fitter.Build(m_stars[c]);
+                    iterations[c] = fitter.Iterations();
+                    results[c].epsfWidth = results[c].epsfHeight = fitter.Size();
+                    results[c].epsfData = fitter.Data();
+                }
+            });
+        }
+    }
+    catch (const Exception& x)
+    {
+        errorMessage = x.Message();
+    }
+    catch (...)
+    {
+        errorMessage = "Unknown error building the ePSF.";
+    }
+}
+
+void EPSFBuilderPipeline::FitTask::Abort()
+{
+    for (EPSFBuilderFitter& fitter : m_fitters)
+        fitter.Abort();
+    if (m_python != nullptr)
+        m_python->Interrupt();
+}
+
+// ----------------------------------------------------------------------------
+
+EPSFBuilderPipeline::EPSFBuilderPipeline(const Parameters& parameters)
+    : m_parameters(parameters)
+{
+}
+
+IsoString EPSFBuilderPipeline::StageParameters(int stage) const
+{
+    const Parameters& p = m_parameters;
+    switch (stage)
+    {
+    case BackgroundStage:
+        return IsoString().Format("%d %d %d", p.starSize, int(p.backgroundMode), p.tileMemory);
+    case DetectionStage:
+        return IsoString().Format("%.10g %.10g %.10g %d %d %d %d", p.starFWHM, p.starThreshold, p.starMaxPeak, p.maxStars, p.starSize, int(p.detectionEngine), int(p.centroidMethod));
+    case ExtractionStage:
+        {
+            // The Python workers build the photutils ePSF along with the extraction
+            IsoString parameters = IsoString().Format("%d", int(p.fittingEngine));
+            if (p.fittingEngine == EPSFBuilderFittingEngine::Photutils)
+                parameters.AppendFormat(" %d %d %d", p.oversampling, int(p.smoothingKernel), p.maxIterations);
+            return parameters;
+        }
+    case EPSFStage:
+        return IsoString().Format("%d %d %d %d %d %d", p.starSize, p.oversampling, int(p.smoothingKernel), p.maxIterations, int(p.fittingEngine), int(p.centroidMethod));
+    case GridStage:
+        return IsoString().Format("%d %d %.10g %d %d %d %d", p.gridColumns, p.gridRows, p.gridOverlap, p.starSize, p.oversampling, int(p.smoothingKernel), p.maxIterations);
+    }
+    return IsoString();
+}
+
+void EPSFBuilderPipeline::Build(const ImageVariant& image, StageOutputs& outputs, const std::function<void()>& overlap) const
+{
+    const Parameters& p = m_parameters;
+
+    // Stage dependency graph: the fingerprint of a stage hashes its parameters and the fingerprint of
+    // its parent, seeded with the source pixels for the first stage, so a change invalidates the stage
+    // and everything downstream of it
+    static const int parentStage[NumberOfStages] = { -1, BackgroundStage, DetectionStage, ExtractionStage, ExtractionStage };
+    static const char* stageName[NumberOfStages] = { "background", "detection", "extraction", "ePSF", "PSF grid" };
+
+    uint64 source;
+    {
+        EPSFBuilderProfiler::Scope scope("fingerprint");
+        source = (uint64(image.Width()) << 32) | uint32(image.Height());
+        for (int c = 0; c < image.NumberOfChannels(); c++)
+        {
+            const void* pixels = (image.BitsPerSample() == 32) ? (const void*)static_cast<const Image&>(*image)[c] : (const void*)static_cast<const DImage&>(*image)[c];
+            source = Hash64(pixels, image.NumberOfPixels() * image.BytesPerSample(), source);
+        }
+    }
+    uint64 fingerprint[NumberOfStages];
+    bool stale[NumberOfStages];
+    String rerun, reused;
+    for (int s = 0; s < NumberOfStages; s++)
+    {
+        IsoString parameters = StageParameters(s);
+        fingerprint[s] = Hash64(parameters.c_str(), parameters.Length(), (parentStage[s] < 0) ? source : fingerprint[parentStage[s]]);
+        stale[s] = fingerprint[s] != outputs.fingerprint[s];
+        if (s == GridStage && !p.IsGridMode())
+            continue;
+        String& list = stale[s] ? rerun : reused;
+        if (!list.IsEmpty())
+            list += ", ";
+        list += stageName[s];
+    }
+    WriteLn("Stages to run: " + (rerun.IsEmpty() ? String("none") : rerun));
+    if (!reused.IsEmpty())
+        WriteLn("Stages reused: " + reused);
+
+    // Steps 1 to 6. The detection cache may hold the extraction from a run on other images.
+    if (stale[ExtractionStage])
+    {
+        outputs.fingerprint[ExtractionStage] = 0;
+        EPSFBuilderDetectionCache& cache = EPSFBuilderDetectionCache::Instance();
+        bool cached;
+        {
+            EPSFBuilderProfiler::Scope scope("detection cache lookup");
+            cached = cache.Find(fingerprint[ExtractionStage], outputs.starImage, outputs.extraction);
+        }
+        if (cached)
+        {
+            WriteLn(String().Format("Detection cache hit: %d stars reused", outputs.extraction.starCount));
+            InheritParallelism(outputs.starImage, image);
+            outputs.sources.clear();
+            outputs.fingerprint[BackgroundStage] = fingerprint[BackgroundStage];
+            outputs.fingerprint[DetectionStage] = 0;
+        }
+        else
+        {
+            WriteLn("Detection cache miss");
+
+            if (p.IsTiled())
+            {
+                // Steps 1 to 6 in tiles, keeping none of the intermediate outputs
+                outputs.fingerprint[BackgroundStage] = 0;
+                outputs.fingerprint[DetectionStage] = 0;
+                outputs.starImage.CreateImageAs(image);
+                outputs.positions.clear();
+                outputs.sources.clear();
+                ExtractTiled(image, outputs.extraction);
+            }
+            else
+            {
+                // Step 1: remove local background
+                if (stale[BackgroundStage])
+                {
+                    outputs.fingerprint[BackgroundStage] = 0;
+                    image.Status().Initialize("Removing background", 1);
+                    RemoveBackground(outputs.starImage, image);
+                    image.Status() += 1;
+                    image.Status().Complete();
+                    outputs.fingerprint[BackgroundStage] = fingerprint[BackgroundStage];
+                    CheckAbort();
+                }
+
+                // Steps 4 and 6: native detection and isolation filter
+                EPSFBuilderStatusScope starStatus(outputs.starImage, m_status);
+                EPSFBuilderPythonTask task = PrepareTask();
+                if (stale[DetectionStage])
+                {
+                    outputs.fingerprint[DetectionStage] = 0;
+                    DetectStars(task, outputs.starImage, outputs.sources);
+                    outputs.positions = task.positions;
+                    outputs.fingerprint[DetectionStage] = fingerprint[DetectionStage];
+                    CheckAbort();
+                }
+                else
+                    task.positions = outputs.positions;
+
+                // Steps 2 to 6: extraction, plus detection and fitting with photutils
+                if (p.UsesPython())
+                    RunPythonTask(task, outputs.starImage, outputs.extraction);
+                else
+                    ExtractStars(task, outputs.starImage, outputs.extraction);
+            }
+
+            if (p.detectionCacheSize > 0)
+            {
+                EPSFBuilderProfiler::Scope scope("detection cache store");
+                cache.Store(fingerprint[ExtractionStage], outputs.starImage, outputs.extraction, size_type(p.detectionCacheSize) << 20);
+            }
+        }
+        outputs.fingerprint[ExtractionStage] = fingerprint[ExtractionStage];
+        WriteLn(String().Format("Detection cache: %d entries, %.1f MiB", int(cache.Length()), cache.Size() / 1048576.0));
+        CheckAbort();
+    }
+    EPSFBuilderStatusScope starStatus(outputs.starImage, m_status);
+
+    // The later stages only take the sample type and geometry of the background-subtracted image,
+    // which tiled runs do not keep
+    const ImageVariant& starImage = p.IsTiled() ? image : outputs.starImage;
+
+    // Steps 7 to 9: build the ePSF, running overlap while it is being fitted
+    bool overlapped = false;
+    auto runOverlap = [&]()
+    {
+        overlapped = true;
+        if (overlap)
+            overlap();
+    };
+    if (stale[EPSFStage])
+    {
+        outputs.fingerprint[EPSFStage] = 0;
+        FinishEPSF(outputs.epsfImage, outputs.fittedImage, outputs.stars, outputs.extraction, starImage, image, runOverlap);
+        outputs.fingerprint[EPSFStage] = fingerprint[EPSFStage];
+    }
+    CheckAbort();
+
+    // Spatially varying ePSF
+    if (!p.IsGridMode())
+    {
+        outputs.fingerprint[GridStage] = 0;
+        outputs.gridImage.Free();
+    }
+    else if (stale[GridStage])
+    {
+        outputs.fingerprint[GridStage] = 0;
+        BuildEPSFGrid(outputs.gridImage, outputs.stars, starImage);
+        outputs.fingerprint[GridStage] = fingerprint[GridStage];
+    }
+
+    if (!overlapped)
+        runOverlap();
+}
+
+void EPSFBuilderPipeline::RemoveBackground(ImageVariant& starImage, const ImageVariant& image, bool rescale) const
+{
+    EPSFBuilderProfiler::Scope scope("background");
+    if (image.NumberOfChannels() > 1)
+    {
+        starImage.CreateImageAs(image);
+        InheritParallelism(starImage, image);
+        CombineChannels(starImage, image);
+    }
+    else
+    {
+        starImage.CopyImage(image);
+        starImage.EnsureUniqueImage();
+        InheritParallelism(starImage, image);
+    }
+    starImage.SetStatusCallback(nullptr);
+    EPSFBuilderBackground background(BackgroundLayers(m_parameters.starSize));
+    if (rescale)
+        background.Remove(starImage, m_parameters.backgroundMode);
+    else
+        background.Subtract(starImage, m_parameters.backgroundMode);
+}
+
+EPSFBuilderPythonTask EPSFBuilderPipeline::PrepareTask() const
+{
+    const Parameters& p = m_parameters;
+    EPSFBuilderPythonTask task;
+    task.detect = p.detectionEngine == EPSFBuilderDetectionEngine::Photutils;
+    task.fwhm = p.starFWHM;
+    task.threshold = p.starThreshold;
+    task.peakMax = p.starMaxPeak;
+    task.brightest = p.maxStars * 3;
+    task.maxStars = p.maxStars;
+    task.cutoutSize = int(p.starSize * 1.5);
+    task.isolate = task.detect;
+    // In the embedded interpreter the photutils fit runs later, in FinishEPSF
+    task.fit = p.fittingEngine == EPSFBuilderFittingEngine::Photutils && p.pythonWorkers > 0;
+    task.oversampling = p.oversampling;
+    task.maxIterations = p.maxIterations;
+    task.smoothingKernel = (p.smoothingKernel == EPSFBuilderSmoothingKernel::Quartic) ? "quartic" : "quadratic";
+    return task;
+}
+
+void EPSFBuilderPipeline::DetectStars(EPSFBuilderPythonTask& task, const ImageVariant& starImage, std::vector<double>& sources) const
+{
+    const Parameters& p = m_parameters;
+    sources.clear();
+
+    // Step 4: native star detection, photutils detection runs with the Python stages
+    if (!task.detect)
+    {
+        starImage.Status().Initialize("Running star detection", 1);
+        std::vector<EPSFBuilderStarDetector::Star> candidates;
+        {
+            EPSFBuilderProfiler::Scope scope("star detection");
+            EPSFBuilderStarDetector detector(p.starFWHM, p.starThreshold, p.starMaxPeak, p.maxStars * 3);
+            candidates = detector.Detect(starImage);
+        }
+        if (candidates.empty())
+            throw Error("No stars detected");
+        WriteLn(String().Format("%d star candidates detected", int(candidates.size())));
+        for (const EPSFBuilderStarDetector::Star& candidate : candidates)
+        {
+            sources.push_back(candidate.x);
+            sources.push_back(candidate.y);
+        }
+        starImage.Status() += 1;
+        starImage.Status().Complete();
+
+        // Step 6 ahead of the extraction: native isolation filter on the candidate catalog
+        starImage.Status().Initialize("Filtering isolated stars", 1);
+        std::vector<int> isolated;
+        {
+            EPSFBuilderProfiler::Scope scope("isolation filter");
+            EPSFBuilderIsolationFilter filter(task.cutoutSize, p.starFWHM, p.starThreshold);
+            isolated = filter.Filter(candidates, starImage, p.maxStars);
+        }
+        if (isolated.empty())
+            throw Error("No isolated stars found");
+        WriteLn(String().Format("%d isolated stars selected", int(isolated.size())));
+        for (int i : isolated)
+        {
+            task.positions.push_back(candidates[i].x);
+            task.positions.push_back(candidates[i].y);
+        }
+        RefineCenters(starImage, task.positions);
+        starImage.Status() += 1;
+        starImage.Status().Complete();
+    }
+}
+
+// Moves the x, y pairs of positions to the centroids of centroidMethod, with the star detector
+// centroids kept as they are by default
+void EPSFBuilderPipeline::RefineCenters(const ImageVariant& starImage, std::vector<double>& positions) const
+{
+    if (m_parameters.centroidMethod == EPSFBuilderCentroidMethod::Detector)
+        return;
+    EPSFBuilderProfiler::Scope scope("centroiding");
+    EPSFBuilderCentroider(m_parameters.centroidMethod, m_parameters.starFWHM).Refine(starImage, positions);
+}
+
+void EPSFBuilderPipeline::RunPythonTask(const EPSFBuilderPythonTask& task, ImageVariant& starImage, EPSFBuilderExtraction& extraction) const
+{
+    // Steps 2 to 6: star extraction and filtering, plus detection with photutils. The interpreter and
+    // the Python imports are shared by all executions.
+    starImage.Status().Initialize("Extracting stars", 1);
+    EPSFBuilderPython::Acquire(m_parameters.pythonDll).RunTask(task, starImage, extraction);
+    starImage.Status() += 1;
+    starImage.Status().Complete();
+}
+
+// Step 5 with the native extractor, for executions in which no stage uses photutils
+void EPSFBuilderPipeline::ExtractStars(const EPSFBuilderPythonTask& task, const ImageVariant& starImage, EPSFBuilderExtraction& extraction) const
+{
+    EPSFBuilderProfiler::Scope scope("star extraction");
+    starImage.Status().Initialize("Extracting stars", 1);
+    EPSFBuilderExtractor(task.cutoutSize).Extract(starImage, task.positions, task.maxStars, extraction);
+    if (extraction.starCount == 0)
+        throw Error("No stars could be extracted");
+    WriteLn(String().Format("%d stars extracted", extraction.starCount));
+    starImage.Status() += 1;
+    starImage.Status().Complete();
+}
+
+// Steps 1 to 6 over tiles of at most tileMemory MiB, see EPSFBuilderTiler. The background-subtracted
+// image is never held as a whole, and the stars are extracted natively.
+void EPSFBuilderPipeline::ExtractTiled(const ImageVariant& image, EPSFBuilderExtraction& extraction) const
+{
+    EPSFBuilderProfiler::Scope scope("tiled extraction");
+    const Parameters& p = m_parameters;
+
+    EPSFBuilderTiler::Parameters parameters;
+    parameters.backgroundMode = p.backgroundMode;
+    parameters.layers = BackgroundLayers(p.starSize);
+    parameters.fwhm = p.starFWHM;
+    parameters.threshold = p.starThreshold;
+    parameters.peakMax = p.starMaxPeak;
+    parameters.maxStars = p.maxStars;
+    parameters.cutoutSize = int(p.starSize * 1.5);
+    parameters.centroidMethod = p.centroidMethod;
+    EPSFBuilderTiler tiler(parameters, size_type(p.tileMemory) << 20);
+
+    image.Status().Initialize("Extracting stars in tiles", 1);
+    tiler.Extract(image, extraction);
+    image.Status() += 1;
+    image.Status().Complete();
+
+    int core = tiler.CoreSize(image.BytesPerSample());
+    WriteLn(String().Format("%d tile(s) with %dx%d pixel cores", tiler.Tiles(), core, core));
+    WriteLn(String().Format("%d star candidates detected, %d isolated, %d stars extracted", tiler.Candidates(), tiler.Isolated(), extraction.starCount));
+}
+
+void EPSFBuilderPipeline::ExtractNative(const ImageVariant& starImage, EPSFBuilderExtraction& extraction, int& candidates, int& isolated) const
+{
+    EPSFBuilderProfiler::Scope scope("native extraction");
+    const Parameters& p = m_parameters;
+    int cutoutSize = int(p.starSize * 1.5);
+    EPSFBuilderStarDetector detector(p.starFWHM, p.starThreshold, p.starMaxPeak, p.maxStars * 3);
+    std::vector<EPSFBuilderStarDetector::Star> sources = detector.Detect(starImage);
+    EPSFBuilderIsolationFilter filter(cutoutSize, p.starFWHM, p.starThreshold);
+    std::vector<int> selected = filter.Filter(sources, starImage, p.maxStars);
+    candidates = int(sources.size());
+    isolated = int(selected.size());
+
+    extraction = EPSFBuilderExtraction();
+    if (selected.empty())
+        return;
+    std::vector<double> positions;
+    for (int i : selected)
+    {
+        positions.push_back(sources[i].x);
+        positions.push_back(sources[i].y);
+    }
+    RefineCenters(starImage, positions);
+    EPSFBuilderExtractor(cutoutSize).Extract(starImage, positions, p.maxStars, extraction);
+}
+
+void EPSFBuilderPipeline::RunFit(FitTask& fit, const std::function<void()>& overlap) const
+{
+    fit.Run();
+    if (overlap)
+        overlap();
+}
+
+void EPSFBuilderPipeline::FinishEPSF(ImageVariant& epsfImage, ImageVariant& fittedImage, EPSFBuilderStarArena& stars, const EPSFBuilderExtraction& extraction, const ImageVariant& starImage, const ImageVariant& image, const std::function<void()>& overlap) const
+{
+    EPSFBuilderProfiler::Scope scope("ePSF");
+    const Parameters& p = m_parameters;
+
+    int starCount = extraction.starCount;
+
+    // Step 7: collect the extracted stars into the star arena, from which the mosaic, the detection
+    // boxes and the catalog are drawn. The native fitter reads the cutouts of the arena in place.
+    bool native = p.fittingEngine == EPSFBuilderFittingEngine::Native;
+    int channels = image.NumberOfNominalChannels();
+    {
+        EPSFBuilderProfiler::Scope arenaScope("star arena");
+        stars.Assign(extraction);
+    }
+    std::vector<std::vector<EPSFBuilderFitter::Star>> fitStars(channels);
+    if (native && channels == 1)
+        fitStars[0] = EPSFBuilderFitter::Stars(stars);
+
+    // Multichannel images: the stars of every channel, background-subtracted like the combined image,
+    // at the positions found in the combined image
+    std::vector<EPSFBuilderStarArena> channelStars(channels);
+    if (channels > 1)
+    {
+        EPSFBuilderProfiler::Scope channelScope("channel stars");
+        starImage.Status().Initialize("Extracting channel stars", channels);
+        EPSFBuilderBackground background(BackgroundLayers(p.starSize));
+        for (int c = 0; c < channels; c++)
+        {
+            ImageVariant channelImage;
+            channelImage.CreateImageAs(image);
+            InheritParallelism(channelImage, image);
+            CopyChannel(channelImage, image, c);
+            background.Remove(channelImage, p.backgroundMode);
+            CutOutStars(channelImage, stars, channelStars[c]);
+            fitStars[c] = EPSFBuilderFitter::Stars(channelStars[c]);
+            starImage.Status() += 1;
+        }
+        starImage.Status().Complete();
+    }
+
+    // The native fitter starts from the centroid of each star, in every channel
+    if (native && p.centroidMethod != EPSFBuilderCentroidMethod::Detector)
+    {
+        EPSFBuilderProfiler::Scope centroidScope("centroiding");
+        EPSFBuilderCentroider centroider(p.centroidMethod, p.starFWHM);
+        for (std::vector<EPSFBuilderFitter::Star>& channelStars : fitStars)
+            centroider.Refine(channelStars);
+    }
+
+    // Step 8: generate ePSF, unless photutils has built it with the Python workers
+    starImage.Status().Initialize("Building ePSF", 1);
+    epsfImage.CreateImageAs(starImage);
+    InheritParallelism(epsfImage, starImage);
+    if (native || extraction.epsfData.empty())
+    {
+        FitTask fit(*this, fitStars, extraction);
+        RunFit(fit, overlap);
+        if (!fit.errorMessage.IsEmpty())
+            throw Error(fit.errorMessage);
+        if (native)
+            for (int c = 0; c < channels; c++)
+                WriteLn(String().Format("ePSF built from %d stars in %d iteration(s)", starCount, fit.iterations[c])
+                    + ((channels > 1) ? String().Format(", channel %d", c) : String()));
+        if (channels > 1)
+            CopyToImage(epsfImage, fit.results, image.ColorSpace());
+        else
+            CopyToImage(epsfImage, fit.results[0].epsfData.data(), fit.results[0].epsfWidth, fit.results[0].epsfHeight);
+    }
+    else
+    {
+        if (overlap)
+            overlap();
+        CopyToImage(epsfImage, extraction.epsfData.data(), extraction.epsfWidth, extraction.epsfHeight);
+    }
+    starImage.Status() += 1;
+    starImage.Status().Complete();
+
+    // Step 9: crop, downscale and normalize, keeping the ePSF as fitted for PSF photometry
+    fittedImage.CopyImage(epsfImage);
+    fittedImage.EnsureUniqueImage();
+    InheritParallelism(fittedImage, epsfImage);
+    ResampleEPSF(epsfImage);
+}
+
+void EPSFBuilderPipeline::ResampleEPSF(ImageVariant& epsfImage) const
+{
+    EPSFBuilderProfiler::Scope scope("resample");
+    const int oversampling = m_parameters.oversampling;
+    int sz = m_parameters.starSize * oversampling;
+    int x0 = (epsfImage.Width() - sz) / 2;
+    int y0 = (epsfImage.Height() - sz) / 2;
+    epsfImage.CropTo(x0, y0, x0 + sz, y0 + sz);
+    IntegerResample ir(-oversampling);
+    ir.EnableParallelProcessing(epsfImage->IsParallelProcessingEnabled(), epsfImage->MaxProcessors());
+    ir >> epsfImage;
+    for (int c = 0; c < epsfImage.NumberOfChannels(); c++)
+    {
+        epsfImage.SelectChannel(c);
+        epsfImage.Subtract(epsfImage.MinimumSampleValue());
+        epsfImage.Divide(epsfImage.MaximumSampleValue());
+    }
+    epsfImage.ResetSelections();
+}
+
+// Builds one ePSF per cell of a gridColumns x gridRows grid, see EPSFBuilderGrid, and tiles them row
+// by row into gridImage
+void EPSFBuilderPipeline::BuildEPSFGrid(ImageVariant& gridImage, const EPSFBuilderStarArena& stars, const ImageVariant& starImage) const
+{
+    EPSFBuilderProfiler::Scope scope("PSF grid");
+    const Parameters& p = m_parameters;
+
+    starImage.Status().Initialize("Building PSF grid", 1);
+
+    EPSFBuilderGrid grid(p.gridColumns, p.gridRows, p.gridOverlap, p.oversampling, p.smoothingKernel, p.maxIterations);
+    std::vector<EPSFBuilderGrid::Cell> cells = grid.Build(stars, starImage.Width(), starImage.Height());
+
+    gridImage.CreateImageAs(starImage);
+    InheritParallelism(gridImage, starImage);
+    gridImage.AllocateImage(p.gridColumns * p.starSize, p.gridRows * p.starSize, 1, ColorSpace::Gray);
+    gridImage.Fill(0.0);
+    for (int r = 0; r < p.gridRows; r++)
+        for (int c = 0; c < p.gridColumns; c++)
+        {
+            const EPSFBuilderGrid::Cell& cell = cells[r * p.gridColumns + c];
+            ImageVariant cellImage;
+            cellImage.CreateImageAs(starImage);
+            InheritParallelism(cellImage, starImage);
+            CopyToImage(cellImage, cell.data.data(), cell.size, cell.size);
+            ResampleEPSF(cellImage);
+
+            if (gridImage.BitsPerSample() == 32)
+                CopyTile(static_cast<Image&>(*gridImage), static_cast<const Image&>(*cellImage), c * p.starSize, r * p.starSize);
+            else if (gridImage.BitsPerSample() == 64)
+                CopyTile(static_cast<DImage&>(*gridImage), static_cast<const DImage&>(*cellImage), c * p.starSize, r * p.starSize);
+
+            WriteLn(String().Format("PSF grid cell %d,%d: %d stars, %d iteration(s)", c + 1, r + 1, cell.stars, cell.iterations));
+        }
+
+    starImage.Status() += 1;
+    starImage.Status().Complete();
+}
+
+void EPSFBuilderPipeline::MeasureStars(const String& baseName, const ImageVariant& fittedImage, const ImageVariant& starImage, const ImageVariant& image, const std::vector<double>& sources) const
+{
+    EPSFBuilderProfiler::Scope scope("PSF photometry");
+    const Parameters& p = m_parameters;
+
+    // The candidates of Step 4 are not kept by the detection cache nor returned by photutils
+    std::vector<double> positions = sources;
+    if (positions.empty())
+    {
+        EPSFBuilderStarDetector detector(p.starFWHM, p.starThreshold, p.starMaxPeak, p.maxStars * 3);
+        for (const EPSFBuilderStarDetector::Star& star : detector.Detect(starImage))
+        {
+            positions.push_back(star.x);
+            positions.push_back(star.y);
+        }
+    }
+
+    // The fluxes are measured in the units of the target: its background is subtracted again, without
+    // the rescaling of Step 1
+    ImageVariant photometryImage;
+    {
+        EPSFBuilderProfiler::Scope backgroundScope("background");
+        RemoveBackground(photometryImage, image, false);
+    }
+
+    // The oversampled ePSF as fitted; color ePSFs are fitted as the mean of their channels, as the
+    // stars of the combined image
+    std::vector<double> epsf;
+    MeanOfChannels(epsf, fittedImage);
+
+    EPSFBuilderPhotometry photometry(epsf, fittedImage.Width(), p.oversampling, p.starFWHM);
+    photometry.Fit(photometryImage, positions);
+
+    String path = baseName + ((p.photometryOutput == EPSFBuilderPhotometryOutput::FITS) ? "_photometry.fits" : "_photometry.csv");
+    if (p.photometryOutput == EPSFBuilderPhotometryOutput::FITS)
+        photometry.WriteFITS(path);
+    else
+        photometry.WriteCSV(path);
+    WriteLn(path + String().Format(" (%d of %d sources fitted)", int(photometry.Sources().size()), int(positions.size() / 2)));
+}
+
+// Each nominal channel is deconvolved with the ePSF of the same channel of epsfImage, or every channel
+// with the PSF grid of gridImage in grid mode
+void EPSFBuilderPipeline::Deconvolve(ImageVariant& deconvolvedImage, const ImageVariant& image, const ImageVariant& epsfImage, const ImageVariant& gridImage) const
+{
+    EPSFBuilderProfiler::Scope scope("deconvolution");
+    const Parameters& p = m_parameters;
+
+    deconvolvedImage.CopyImage(image);
+    deconvolvedImage.EnsureUniqueImage();
+    InheritParallelism(deconvolvedImage, image);
+    deconvolvedImage.SetStatusCallback(nullptr);
+
+    EPSFBuilderDeconvolution deconvolution(p.deconvolutionIterations, p.deconvolutionTolerance);
+    std::vector<double> psf;
+    if (p.IsGridMode())
+    {
+        ChannelData(psf, gridImage, 0);
+        deconvolution.SetPSF(psf, p.starSize, p.gridColumns, p.gridRows);
+    }
+    for (int c = 0; c < image.NumberOfNominalChannels(); c++)
+    {
+        if (!p.IsGridMode())
+        {
+            ChannelData(psf, epsfImage, Min(c, epsfImage.NumberOfChannels() - 1));
+            deconvolution.SetPSF(psf, epsfImage.Width());
+        }
+        deconvolution.Deconvolve(deconvolvedImage, c);
+        CheckAbort();
+    }
+
+    WriteLn(String().Format("Deconvolution: %d tile(s) of %dx%d pixels, %.1f iterations per tile, %d stopped early",
+        deconvolution.Tiles(), deconvolution.TileSize(), deconvolution.TileSize(), double(deconvolution.Iterations()) / deconvolution.Tiles(), deconvolution.Converged()));
+}
+
+EPSFBuilderLibrary::Entry EPSFBuilderPipeline::LibraryEntry(const FITSKeywordArray& keywords, int channels) const
+{
+    EPSFBuilderLibrary::Entry entry;
+    EPSFBuilderLibrary::DescribeFrame(entry, keywords);
+    entry.starFWHM = m_parameters.starFWHM;
+    entry.oversampling = m_parameters.oversampling;
+    entry.starSize = m_parameters.starSize;
+    entry.channels = channels;
+    return entry;
+}
+
+int EPSFBuilderPipeline::LoadFromLibrary(const EPSFBuilderLibrary& library, const EPSFBuilderLibrary::Entry& entry, ImageVariant& epsfImage) const
+{
+    EPSFBuilderProfiler::Scope scope("library lookup");
+    int index = library.Find(entry, m_parameters.libraryTimeWindow, m_parameters.libraryFWHMTolerance);
+    if (index >= 0)
+        library.Load(index, epsfImage);
+    return index;
+}
+
+void EPSFBuilderPipeline::StoreInLibrary(EPSFBuilderLibrary& library, EPSFBuilderLibrary::Entry entry, const ImageVariant& epsfImage, int stars) const
+{
+    EPSFBuilderProfiler::Scope scope("library store");
+    entry.stars = stars;
+    library.Store(epsfImage, entry);
+    WriteLn("ePSF stored in the library as " + entry.fileName);
+}
+
+void EPSFBuilderPipeline::WriteCatalog(const String& filePath, const EPSFBuilderStarArena& stars)
+{
+    IsoString catalog = "id,x,y,flux\n";
+    for (int i = 0; i < stars.Count(); i++)
+        catalog.AppendFormat("%d,%.4f,%.4f,%.6e\n", i + 1, stars.centerX[i], stars.centerY[i], stars.flux[i]);
+    File::WriteTextFile(filePath, catalog);
+}
+
+int EPSFBuilderPipeline::MosaicColumns(int stars)
+{
+    int ncols = pcl::Sqrt(stars);
+    return (ncols < 2) ? 2 : ncols;
+}
+
+void EPSFBuilderPipeline::TileStars(ImageVariant& mosaic, const EPSFBuilderStarArena& stars, int ncols, int size)
+{
+    if (mosaic.BitsPerSample() == 32)
+        pcl::TileStars(static_cast<Image&>(*mosaic), stars, ncols, size);
+    else if (mosaic.BitsPerSample() == 64)
+        pcl::TileStars(static_cast<DImage&>(*mosaic), stars, ncols, size);
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,230 @@
+#ifndef __EPSFBuilderPipeline_h
+#define __EPSFBuilderPipeline_h
+
+#include <functional>
+#include <vector>
+#include <pcl/ImageVariant.h>
+#include <pcl/MetaParameter.h> // pcl_enum
+#include <pcl/ReferenceArray.h>
+#include <pcl/StatusMonitor.h>
+
+#include "EPSFBuilderFitter.h"
+#include "EPSFBuilderLibrary.h"
+#include "EPSFBuilderPython.h"
+#include "EPSFBuilderStarArena.h"
+
+namespace pcl
+{
+
+// The processing of an ePSF Builder execution on an image in memory, shared by the module,
+// EPSFBuilderInstance, and the headless runner, tools/EPSFBuilderCLI.cpp. It knows nothing of views,
+// windows or file formats: its callers read the frames, write the results, and provide the console
+// output and the abort checkpoints through the virtual functions, where the module also runs the fit
+// on its own thread and the Python stages in the worker processes.
+//
+// The steps of an execution: 1 background removal, 4 star detection, 6 isolation filter and 5 star
+// extraction, natively or with 2 to 6 in Python; 7 the star arena, 8 the ePSF fit, and 9 its crop,
+// downscaling and normalization; then the PSF grid, the PSF photometry and the deconvolution.
+
+class EPSFBuilderPipeline
+{
+public:
+    // The process parameters read by the pipeline, as defined by EPSFBuilderParameters
+    struct Parameters
+    {
+        String pythonDll;
+        int maxStars;
+        double starMaxPeak;
+        double starThreshold;
+        double starFWHM;
+        pcl_enum detectionEngine;
+        pcl_enum centroidMethod;
+        pcl_enum backgroundMode;
+        int detectionCacheSize;     // MiB
+        int tileMemory;             // MiB, zero for whole images
+        int starSize;
+        int oversampling;
+        pcl_enum smoothingKernel;
+        int maxIterations;
+        pcl_enum fittingEngine;
+        int gridColumns;
+        int gridRows;
+        double gridOverlap;
+        pcl_enum photometryOutput;
+        pcl_enum libraryMode;
+        String libraryDirectory;
+        double libraryTimeWindow;
+        double libraryFWHMTolerance;
+        bool deconvolve;
+        int deconvolutionIterations;
+        double deconvolutionTolerance;
+        int pythonWorkers;
+        bool accumulateFrames;
+
+        bool IsGridMode() const;
+        bool IsTiled() const;
+        // Photutils detection or fitting needs the Python stages; otherwise Steps 2 to 9 are all native
+        bool UsesPython() const;
+        bool ReusesLibrary() const;
+
+        // Each of these explains in whyNot why the parameters cannot be executed
+        bool CanTile(String& whyNot) const;
+        bool CanFitChannels(int channels, String& whyNot) const;
+        bool CanMeasureStars(String& whyNot) const;
+        bool CanUseLibrary(String& whyNot) const;
+        bool CanDeconvolve(String& whyNot) const;
+    };
+
+    // Stages of Build(), see StageParameters()
+    enum { BackgroundStage, DetectionStage, ExtractionStage, EPSFStage, GridStage, NumberOfStages };
+
+    // Stage outputs of a Build(), reused by the next one on the same image. A zero fingerprint marks a
+    // stage without valid output.
+    struct StageOutputs
+    {
+        String id;                          // of the view or file the outputs belong to
+        uint64 fingerprint[NumberOfStages] = {};
+        ImageVariant starImage;
+        std::vector<double> positions;
+        std::vector<double> sources;        // every detected star, for PSF photometry
+        EPSFBuilderExtraction extraction;
+        EPSFBuilderStarArena stars;
+        ImageVariant epsfImage;
+        ImageVariant fittedImage;           // the ePSF before Step 9, for PSF photometry
+        ImageVariant gridImage;
+
+        size_type Bytes() const;
+    };
+
+    // Step 8 for the stars of every channel: the native fitter, or photutils EPSFBuilder in the
+    // embedded interpreter. Run() may be called on any thread, see RunFit().
+    class FitTask
+    {
+    public:
+        std::vector<EPSFBuilderExtraction> results; // the ePSF of every channel only
+        std::vector<int> iterations;
+        String errorMessage;
+
+        FitTask(const EPSFBuilderPipeline& pipeline, std::vector<std::vector<EPSFBuilderFitter::Star>>& stars, const EPSFBuilderExtraction& extraction);
+
+        void Run();
+
+        // Makes a running fit return early
+        void Abort();
+
+        EPSFBuilderPython* Python() const
+        {
+            return m_python;
+        }
+
+    private:
+        const EPSFBuilderPipeline& m_pipeline;
+        std::vector<std::vector<EPSFBuilderFitter::Star>>& m_stars;
+        const EPSFBuilderExtraction& m_extraction;
+        ReferenceArray<EPSFBuilderFitter> m_fitters;
+        EPSFBuilderPython* m_python = nullptr;
+    };
+
+    EPSFBuilderPipeline(const Parameters& parameters);
+
+    virtual ~EPSFBuilderPipeline()
+    {
+    }
+
+    const Parameters& Settings() const
+    {
+        return m_parameters;
+    }
+
+    // The parameters read by each stage of Build()
+    IsoString StageParameters(int stage) const;
+
+    // Steps 1 to 9 and the PSF grid on image, the target. Every stage reads the parameters given by
+    // StageParameters() and the output of its parent; only the stages whose fingerprint differs from
+    // that of outputs are run, and the others are reused. Steps 1 to 6 may also be found in the
+    // detection cache. overlap, if any, runs while the ePSF is being fitted, or at the end when the
+    // ePSF is reused.
+    void Build(const ImageVariant& image, StageOutputs& outputs, const std::function<void()>& overlap = std::function<void()>()) const;
+
+    // Step 1 into starImage; without rescale the background is only subtracted, keeping the units of
+    // the target
+    void RemoveBackground(ImageVariant& starImage, const ImageVariant& image, bool rescale = true) const;
+    EPSFBuilderPythonTask PrepareTask() const;
+    // Steps 4 and 6 with the native engines into task.positions; sources receives every candidate
+    void DetectStars(EPSFBuilderPythonTask& task, const ImageVariant& starImage, std::vector<double>& sources) const;
+    void RefineCenters(const ImageVariant& starImage, std::vector<double>& positions) const;
+    void ExtractStars(const EPSFBuilderPythonTask& task, const ImageVariant& starImage, EPSFBuilderExtraction& extraction) const;
+    void ExtractTiled(const ImageVariant& image, EPSFBuilderExtraction& extraction) const;
+    // Steps 4 to 6 natively without console output, for frame loader threads
+    void ExtractNative(const ImageVariant& starImage, EPSFBuilderExtraction& extraction, int& candidates, int& isolated) const;
+    // image is the target, with one ePSF fitted per nominal channel; fittedImage receives the ePSF
+    // before Step 9, at the oversampled resolution of the fit. overlap, if any, runs while the ePSF is
+    // being fitted.
+    void FinishEPSF(ImageVariant& epsfImage, ImageVariant& fittedImage, EPSFBuilderStarArena& stars, const EPSFBuilderExtraction& extraction, const ImageVariant& starImage, const ImageVariant& image, const std::function<void()>& overlap = std::function<void()>()) const;
+    void ResampleEPSF(ImageVariant& epsfImage) const;
+    void BuildEPSFGrid(ImageVariant& gridImage, const EPSFBuilderStarArena& stars, const ImageVariant& starImage) const;
+    // Fits fittedImage, the ePSF of FinishEPSF, to every star of sources, x, y pairs detected
+    // natively in starImage, or to the stars of a new native detection if it is empty, on image, the
+    // target, with its background subtracted. Writes the catalog of photometryOutput to baseName with
+    // its suffix.
+    void MeasureStars(const String& baseName, const ImageVariant& fittedImage, const ImageVariant& starImage, const ImageVariant& image, const std::vector<double>& sources) const;
+    // Deconvolves a copy of image, the target, into deconvolvedImage
+    void Deconvolve(ImageVariant& deconvolvedImage, const ImageVariant& image, const ImageVariant& epsfImage, const ImageVariant& gridImage) const;
+
+    // The library entry of an ePSF built from a frame with the given keywords, also the query for a
+    // stored ePSF to reuse
+    EPSFBuilderLibrary::Entry LibraryEntry(const FITSKeywordArray& keywords, int channels) const;
+    // Loads the stored ePSF matching entry into epsfImage; returns its index, or -1 if there is none
+    int LoadFromLibrary(const EPSFBuilderLibrary& library, const EPSFBuilderLibrary::Entry& entry, ImageVariant& epsfImage) const;
+    void StoreInLibrary(EPSFBuilderLibrary& library, EPSFBuilderLibrary::Entry entry, const ImageVariant& epsfImage, int stars) const;
+
+    // Writes the id, x, y, flux catalog of the stars as CSV
+    static void WriteCatalog(const String& filePath, const EPSFBuilderStarArena& stars);
+    // Columns of the mosaic of the extracted stars
+    static int MosaicColumns(int stars);
+    // Tiles the central size x size window of the star cutouts row by row, ncols per row, into mosaic,
+    // an allocated single channel image
+    static void TileStars(ImageVariant& mosaic, const EPSFBuilderStarArena& stars, int ncols, int size);
+
+    // Steps 2 to 6 in Python: the default runs them in the embedded interpreter
+    virtual void RunPythonTask(const EPSFBuilderPythonTask& task, ImageVariant& starImage, EPSFBuilderExtraction& extraction) const;
+
+protected:
+    Parameters m_parameters;
+    StatusCallback* m_status = nullptr;     // monitors the images of Build()
+
+    // One line of console output
+    virtual void WriteLn(const String& text) const = 0;
+
+    // Abort checkpoint between the stages; throws ProcessAborted
+    virtual void CheckAbort() const
+    {
+    }
+
+    // Runs fit, and overlap meanwhile if any; the default runs both on the calling thread
+    virtual void RunFit(FitTask& fit, const std::function<void()>& overlap) const;
+};
+
+// Points the status callback of an image to a monitor for the lifetime of the object, so that an
+// image that outlives the execution never keeps a pointer to its monitor, however the scope is left
+class EPSFBuilderStatusScope
+{
+public:
+    EPSFBuilderStatusScope(ImageVariant& image, StatusCallback* status)
+        : m_image(image)
+    {
+        m_image.SetStatusCallback(status);
+    }
+
+    ~EPSFBuilderStatusScope()
+    {
+        m_image.SetStatusCallback(nullptr);
+    }
+
+private:
+    ImageVariant& m_image;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderPipeline_h
\ No newline at end of file
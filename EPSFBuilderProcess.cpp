@@ -22,10 +22,37 @@ EPSFBuilderProcess::EPSFBuilderProcess()
     new EPSFBuilderStarMaxPeak(this);
     new EPSFBuilderStarThreshold(this);
     new EPSFBuilderStarFWHM(this);
+    new EPSFBuilderDetectionEngine(this);
+    new EPSFBuilderCentroidMethod(this);
+    new EPSFBuilderBackgroundMode(this);
+    new EPSFBuilderDetectionCacheSize(this);
+    new EPSFBuilderTileMemory(this);
     new EPSFBuilderStarSize(this);
     new EPSFBuilderOversampling(this);
     new EPSFBuilderSmoothingKernel(this);
     new EPSFBuilderMaxIterations(this);
+    new EPSFBuilderFittingEngine(this);
+    new EPSFBuilderGridColumns(this);
+    new EPSFBuilderGridRows(this);
+    new EPSFBuilderGridOverlap(this);
+    new EPSFBuilderPhotometryOutput(this);
+    new EPSFBuilderLibraryMode(this);
+    new EPSFBuilderLibraryDirectory(this);
+    new EPSFBuilderLibraryTimeWindow(this);
+    new EPSFBuilderLibraryFWHMTolerance(this);
+    new EPSFBuilderDeconvolve(this);
+    new EPSFBuilderDeconvolutionIterations(this);
+    new EPSFBuilderDeconvolutionTolerance(this);
+    new EPSFBuilderPythonWorkers(this);
+    new EPSFBuilderTargetFrames(this);
+    new EPSFBuilderTargetFrameEnabled(TheEPSFBuilderTargetFramesParameter);
+    new EPSFBuilderTargetFramePath(TheEPSFBuilderTargetFramesParameter);
+    new EPSFBuilderOutputDirectory(this);
+    new EPSFBuilderAccumulateFrames(this);
+    new EPSFBuilderAccumulatedStars(this);
+    new EPSFBuilderTraceFile(this);
+    new EPSFBuilderShowStarDetection(this);
+    new EPSFBuilderShowExtractedStars(this);
 }
 
 IsoString EPSFBuilderProcess::Id() const
@@ -155,4 +182,11 @@ bool EPSFBuilderProcess::CanProcessCommandLines() const
     return false;
 }
 
+// ----------------------------------------------------------------------------
+
+bool EPSFBuilderProcess::CanProcessGlobal() const
+{
+    return true;
+}
+
 }	// namespace pcl
\ No newline at end of file
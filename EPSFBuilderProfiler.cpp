@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <pcl/AutoLock.h>
+#include <pcl/File.h>
+
+#ifdef __PCL_WINDOWS
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef __PCL_MACOSX
+#include <mach/mach.h>
+#endif
+
+#include "EPSFBuilderProfiler.h"
+
+namespace pcl
+{
+
+static std::atomic<EPSFBuilderProfiler*> s_activeProfiler(nullptr);
+static thread_local int s_depth = 0;
+
+EPSFBuilderProfiler::Scope::Scope(const IsoString& name)
+    : m_profiler(s_activeProfiler.load())
+{
+    if (m_profiler != nullptr)
+    {
+        m_name = name;
+        m_peakRSS = PeakRSS();
+        ++s_depth;
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+EPSFBuilderProfiler::Scope::~Scope()
+{
+    End();
+}
+
+void EPSFBuilderProfiler::Scope::End()
+{
+    if (m_profiler != nullptr)
+    {
+        auto end = std::chrono::steady_clock::now();
+        --s_depth;
+        size_type peakRSS = PeakRSS();
+        m_profiler->Record(m_name, m_start, end, s_depth, CurrentRSS(), peakRSS, (peakRSS > m_peakRSS) ? peakRSS - m_peakRSS : 0);
+        m_profiler = nullptr;
+    }
+}
+
+EPSFBuilderProfiler::EPSFBuilderProfiler()
+    : m_origin(std::chrono::steady_clock::now())
+{
+    m_threads.push_back(std::this_thread::get_id());
+    s_activeProfiler = this;
+}
+
+EPSFBuilderProfiler::~EPSFBuilderProfiler()
+{
+    EPSFBuilderProfiler* self = this;
+    s_activeProfiler.compare_exchange_strong(self, nullptr);
+}
+
+void EPSFBuilderProfiler::Record(const IsoString& name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, int depth, size_type rss, size_type peakRSS, size_type peakGrowth)
+{
+    volatile AutoLock lock(m_mutex);
+
+    std::thread::id id = std::this_thread::get_id();
+    int thread = 0;
+    while (size_type(thread) < m_threads.size() && m_threads[thread] != id)
+        thread++;
+    if (size_type(thread) == m_threads.size())
+        m_threads.push_back(id);
+
+    Event event;
+    event.name = name;
+    event.start = std::chrono::duration<double>(start - m_origin).count();
+    event.duration = std::chrono::duration<double>(end - start).count();
+    event.thread = thread;
+    event.depth = depth;
+    event.rss = rss;
+    event.peakRSS = peakRSS;
+    event.peakGrowth = peakGrowth;
+    m_events.push_back(event);
+}
+
+std::vector<EPSFBuilderProfiler::Event> EPSFBuilderProfiler::Events() const
+{
+    volatile AutoLock lock(m_mutex);
+    return m_events;
+}
+
+String EPSFBuilderProfiler::Summary() const
+{
+    std::vector<Event> events = Events();
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_origin).count();
+
+    struct Row
+    {
+        IsoString name;
+        int depth;
+        int calls = 0;
+        double time = 0;
+        size_type peakRSS = 0;
+        size_type peakGrowth = 0;
+    };
+    std::vector<Row> rows;
+    for (const Event& event : events)
+    {
+        size_type i = 0;
+        while (i < rows.size() && rows[i].name != event.name)
+            i++;
+        if (i == rows.size())
+        {
+            rows.emplace_back();
+            rows[i].name = event.name;
+            rows[i].depth = event.depth;
+        }
+        rows[i].calls++;
+        rows[i].time += event.duration;
+        rows[i].peakRSS = Max(rows[i].peakRSS, event.peakRSS);
+        rows[i].peakGrowth += event.peakGrowth;
+    }
+
+    // Scopes close before their parents, so order the rows by their first start time
+    std::vector<double> firstStart(rows.size(), wallTime);
+    for (const Event& event : events)
+        for (size_type i = 0; i < rows.size(); i++)
+            if (rows[i].name == event.name)
+                firstStart[i] = Min(firstStart[i], event.start);
+    std::vector<size_type> order(rows.size());
+    for (size_type i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_type a, size_type b) { return firstStart[a] < firstStart[b]; });
+
+    const double MiB = 1048576.0;
+    IsoString summary = IsoString().Format("%-36s %6s %10s %7s %12s %12s\n", "Stage", "Calls", "Time (s)", "Share", "Peak (MiB)", "Growth (MiB)");
+    for (size_type i : order)
+    {
+        const Row& row = rows[i];
+        IsoString name = IsoString(' ', 2 * row.depth) + row.name;
+        summary.AppendFormat("%-36s %6d %10.3f %6.1f%% %12.1f %12.1f\n", name.c_str(), row.calls, row.time, 100 * row.time / Max(wallTime, 1.0e-9), row.peakRSS / MiB, row.peakGrowth / MiB);
+    }
+    summary.AppendFormat("%-36s %6s %10.3f %7s %12.1f\n", "total", "", wallTime, "", PeakRSS() / MiB);
+    return String(summary);
+}
+
+static IsoString JSONString(const IsoString& s)
+{
+    IsoString json = '\"';
+    for (char c : s)
+        if (c == '\"' || c == '\\')
+            json << '\\' << c;
+        else if (uint8(c) < 0x20)
+            json.AppendFormat("\\u%04x", unsigned(c));
+        else
+            json << c;
+    json << '\"';
+    return json;
+}
+
+void EPSFBuilderProfiler::WriteTrace(const String& filePath) const
+{
+    std::vector<Event> events = Events();
+    size_type threadCount;
+    {
+        volatile AutoLock lock(m_mutex);
+        threadCount = m_threads.size();
+    }
+
+    const double MiB = 1048576.0;
+    IsoString trace = "{\"displayTimeUnit\":\"ms\",\"otherData\":{";
+#ifdef __PCL_WINDOWS
+    trace << "\"platform\":\"windows\"";
+#elif defined(__PCL_MACOSX)
+    trace << "\"platform\":\"macos\"";
+#else
+    trace << "\"platform\":\"linux\"";
+#endif
+    trace.AppendFormat(",\"logicalProcessors\":%u},\"traceEvents\":[\n", std::thread::hardware_concurrency());
+    for (size_type t = 0; t < threadCount; t++)
+        trace.AppendFormat("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", int(t), (t == 0) ? "main" : IsoString().Format("worker %d", int(t)).c_str());
+    for (size_type i = 0; i < events.size(); i++)
+    {
+        const Event& event = events[i];
+        trace << "{\"name\":" << JSONString(event.name);
+        trace.AppendFormat(",\"cat\":\"epsfbuilder\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"rssMiB\":%.2f,\"peakRssMiB\":%.2f,\"peakGrowthMiB\":%.2f}}%s\n",
+            event.start * 1.0e6, event.duration * 1.0e6, event.thread, event.rss / MiB, event.peakRSS / MiB, event.peakGrowth / MiB,
+            (i + 1 < events.size()) ? "," : "");
+    }
+    trace << "]}\n";
+    File::WriteTextFile(filePath, trace);
+}
+
+size_type EPSFBuilderProfiler::CurrentRSS()
+{
+#ifdef __PCL_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return size_type(counters.WorkingSetSize);
+    return 0;
+#elif defined(__PCL_MACOSX)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+        return size_type(info.resident_size);
+    return 0;
+#else
+    size_type rss = 0;
+    if (FILE* f = fopen("/proc/self/statm", "r"))
+    {
+        unsigned long size, resident;
+        if (fscanf(f, "%lu %lu", &size, &resident) == 2)
+            rss = size_type(resident) * size_type(sysconf(_SC_PAGESIZE));
+        fclose(f);
+    }
+    return rss;
+#endif
+}
+
+size_type EPSFBuilderProfiler::PeakRSS()
+{
+#ifdef __PCL_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return size_type(counters.PeakWorkingSetSize);
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __PCL_MACOSX
+    return size_type(usage.ru_maxrss);          // bytes
+#else
+    return size_type(usage.ru_maxrss) * 1024;   // KiB
+#endif
+#endif
+}
+
+}	// namespace pcl
\ No newline at end of file
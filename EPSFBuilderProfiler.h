@@ -0,0 +1,84 @@
+#ifndef __EPSFBuilderProfiler_h
+#define __EPSFBuilderProfiler_h
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <pcl/Mutex.h>
+#include <pcl/String.h>
+
+namespace pcl
+{
+
+// Wall time and memory use of the stages of one execution. While a profiler object exists it is the
+// active profiler, and every EPSFBuilderProfiler::Scope, on any thread, records one event into it:
+// start, duration, nesting depth, resident set size at the end of the scope and how much the peak
+// resident set size of the process grew during the scope. Without an active profiler scopes do
+// nothing. Memory used by the Python worker processes is not included.
+
+class EPSFBuilderProfiler
+{
+public:
+    struct Event
+    {
+        IsoString name;
+        double start;           // seconds since the profiler was created
+        double duration;        // seconds
+        int thread;             // 0 for the thread that created the profiler
+        int depth;
+        size_type rss;          // bytes, at the end of the scope
+        size_type peakRSS;      // bytes, at the end of the scope
+        size_type peakGrowth;   // bytes
+    };
+
+    class Scope
+    {
+    public:
+        Scope(const IsoString& name);
+        ~Scope();
+
+        // Records the event before the end of the enclosing block
+        void End();
+
+        Scope(const Scope&) = delete;
+        Scope& operator =(const Scope&) = delete;
+
+    private:
+        EPSFBuilderProfiler* m_profiler;
+        IsoString m_name;
+        std::chrono::steady_clock::time_point m_start;
+        size_type m_peakRSS;
+    };
+
+    EPSFBuilderProfiler();
+    ~EPSFBuilderProfiler();
+
+    EPSFBuilderProfiler(const EPSFBuilderProfiler&) = delete;
+    EPSFBuilderProfiler& operator =(const EPSFBuilderProfiler&) = delete;
+
+    // Events in the order the scopes were closed
+    std::vector<Event> Events() const;
+
+    // Table of the stages, one row per stage name in order of first appearance, with the number of
+    // calls, total time, share of the wall time and peak memory
+    String Summary() const;
+
+    // Writes the events in Chrome trace event format, for chrome://tracing or Perfetto
+    void WriteTrace(const String& filePath) const;
+
+    // Resident set size and peak resident set size of the process in bytes, 0 if unknown
+    static size_type CurrentRSS();
+    static size_type PeakRSS();
+
+private:
+    std::chrono::steady_clock::time_point m_origin;
+    mutable Mutex m_mutex;
+    std::vector<Event> m_events;
+    std::vector<std::thread::id> m_threads;
+
+    void Record(const IsoString& name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, int depth, size_type rss, size_type peakRSS, size_type peakGrowth);
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderProfiler_h
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include <cstdlib>
+#include <cstring>
+
+#ifndef __PCL_WINDOWS
+#include <dlfcn.h>
+#endif
+
+#include "EPSFBuilderProfiler.h"
+#include "EPSFBuilderPython.h"
+
+namespace pcl
+{
+
+void* EPSFBuilderPython::m_pythonLibrary = nullptr;
+
+static EPSFBuilderPython* s_python = nullptr;
+
+bool EPSFBuilderStubWorkers()
+{
+    static const bool stub = []
+    {
+        const char* value = ::getenv("EPSFBUILDER_STUB_WORKERS");
+        return value != nullptr && *value != '\0' && strcmp(value, "0") != 0;
+    }();
+    return stub;
+}
+
+EPSFBuilderPython& EPSFBuilderPython::Acquire(const String& pythonDll)
+{
+    if (s_python == nullptr)
+    {
+        if (m_pythonLibrary == nullptr)
+        {
+            // The symbols must be global on POSIX, the extension modules imported later link to them
+#ifdef __PCL_WINDOWS
+            m_pythonLibrary = (void*)LoadLibraryW((LPCWSTR)pythonDll.c_str());
+#else
+            m_pythonLibrary = dlopen(pythonDll.ToUTF8().c_str(), RTLD_NOW | RTLD_GLOBAL);
+#endif
+            if (m_pythonLibrary == nullptr)
+                throw Error("Failed to load Python DLL: " + pythonDll);
+        }
+        s_python = new EPSFBuilderPython;
+    }
+    return *s_python;
+}
+
+void* EPSFBuilderPython::Symbol(const char* name)
+{
+#ifdef __PCL_WINDOWS
+    return (void*)GetProcAddress((HMODULE)m_pythonLibrary, name);
+#else
+    return dlsym(m_pythonLibrary, name);
+#endif
+}
+
+EPSFBuilderPython::EPSFBuilderPython()
+    : m_fitThread(0)
+{
+    EPSFBuilderProfiler::Scope scope("python: initialize");
+
+    typedef void(__cdecl* f_Py_Initialize)();
+    typedef int(__cdecl* f_Py_IsInitialized)();
+    typedef PyObjectPtr(__cdecl* f_PyImport_AddModule)(const char*);
+    typedef PyObjectPtr(__cdecl* f_PyModule_GetDict)(PyObjectPtr);
+    f_Py_Initialize Py_Initialize;
+    f_Py_IsInitialized Py_IsInitialized;
+    f_PyImport_AddModule PyImport_AddModule;
+    f_PyModule_GetDict PyModule_GetDict;
+    loadPythonAPI(Py_Initialize, "Py_Initialize");
+    loadPythonAPI(Py_IsInitialized, "Py_IsInitialized");
+    loadPythonAPI(PyImport_AddModule, "PyImport_AddModule");
+    loadPythonAPI(PyModule_GetDict, "PyModule_GetDict");
+    loadPythonAPI(PyRun_SimpleString, "PyRun_SimpleString");
+    loadPythonAPI(PyMemoryView_FromMemory, "PyMemoryView_FromMemory");
+    loadPythonAPI(PyDict_SetItemString, "PyDict_SetItemString");
+    loadPythonAPI(PyDict_GetItemString, "PyDict_GetItemString");
+    loadPythonAPI(PyLong_AsLong, "PyLong_AsLong");
+    loadPythonAPI(Py_DecRef, "Py_DecRef");
+    loadPythonAPI(PyEval_SaveThread, "PyEval_SaveThread");
+    loadPythonAPI(PyEval_RestoreThread, "PyEval_RestoreThread");
+    loadPythonAPI(PyGILState_Ensure, "PyGILState_Ensure");
+    loadPythonAPI(PyGILState_Release, "PyGILState_Release");
+    loadPythonAPI(PyThread_get_thread_ident, "PyThread_get_thread_ident");
+    loadPythonAPI(PyThreadState_SetAsyncExc, "PyThreadState_SetAsyncExc");
+    loadPythonAPI(m_keyboardInterrupt, "PyExc_KeyboardInterrupt");
+
+    if (!Py_IsInitialized())
+    {
+        Py_Initialize();
+        if (!Py_IsInitialized())
+            throw Error("Failed to initialize Python");
+    }
+
+    m_mainDict = PyModule_GetDict(PyImport_AddModule("__main__"));
+
+    Run("from astropy.nddata import NDData");
+    Run("from astropy.table import Table");
+    Run("from photutils.detection import DAOStarFinder");
+    Run("from photutils.psf import EPSFBuilder");
+    Run("from photutils.psf import EPSFStar");
+    Run("from photutils.psf import EPSFStars");
+    Run("from photutils.psf import extract_stars");
+    Run("import numpy as np");
+}
+
+void EPSFBuilderPython::Run(const char* code)
+{
+    if (PyRun_SimpleString(code) != 0)
+        throw Error("Error running python script: " + String(code));
+}
+
+void EPSFBuilderPython::ShareBuffer(const char* name, void* buffer, size_type size, bool writable)
+{
+    const int PyBUF_READ = 0x100;
+    const int PyBUF_WRITE = 0x200;
+    PyObjectPtr memoryView = PyMemoryView_FromMemory((char*)buffer, ptrdiff_t(size), writable ? PyBUF_WRITE : PyBUF_READ);
+    if (memoryView == nullptr)
+        throw Error("Unable to share buffer with Python: " + String(name));
+    int result = PyDict_SetItemString(m_mainDict, name, memoryView);
+    Py_DecRef(memoryView);
+    if (result != 0)
+        throw Error("Unable to share buffer with Python: " + String(name));
+}
+
+int EPSFBuilderPython::GetInt(const char* name)
+{
+    PyObjectPtr value = PyDict_GetItemString(m_mainDict, name);
+    if (value == nullptr)
+        throw Error("Python variable not found: " + String(name));
+    return int(PyLong_AsLong(value));
+}
+
+void EPSFBuilderPython::Release()
+{
+    Run("for name in ('image_buffer', 'data', 'positions_buffer', 'starpos', 'stars_tbl', 'nddata', 'stars', 'good_stars', 'star',\n"
+        "             'epsf_builder', 'fitted_stars', 'star_buffer', 'meta_buffer', 'star_data', 'star_meta', 'epsf_buffer'):\n"
+        "    globals().pop(name, None)\n");
+}
+
+void EPSFBuilderPython::RunTask(const EPSFBuilderPythonTask& task, ImageVariant& image, EPSFBuilderExtraction& result)
+{
+    EPSFBuilderProfiler::Scope scope("python task");
+    try
+    {
+        // Expose the pixel buffer to Python as a read-only memoryview, no copy is made
+        void* buffer = (image.BitsPerSample() == 32) ? (void*)static_cast<Image&>(*image)[0] : (void*)static_cast<DImage&>(*image)[0];
+        ShareBuffer("image_buffer", buffer, image.NumberOfPixels() * image.BytesPerSample(), false);
+
+        // Wrap the buffer as a numpy array, keeping the sample type of the image
+        IsoString cmd;
+        cmd.Format("data = np.frombuffer(image_buffer, dtype = np.%s).reshape(%d, %d)", (image.BitsPerSample() == 32) ? "float32" : "float64", image.Height(), image.Width());
+        Run(cmd);
+
+        // Star detection
+        if (task.detect)
+        {
+            EPSFBuilderProfiler::Scope detectScope("python: DAOStarFinder");
+            cmd.Format("daofind = DAOStarFinder(fwhm = %lf, threshold = %lf, peakmax = %lf, brightest = %d)", task.fwhm, task.threshold, task.peakMax, task.brightest);
+            Run(cmd);
+            Run("sources = daofind(data)");
+            Run("starpos = np.transpose((sources['xcentroid'], sources['ycentroid']))");
+        }
+        else if (task.positions.empty())
+            Run("starpos = np.empty((0, 2))");
+        else
+        {
+            // The x, y pairs are read in place, like the pixels
+            ShareBuffer("positions_buffer", const_cast<double*>(task.positions.data()), task.positions.size() * sizeof(double), false);
+            Run("starpos = np.frombuffer(positions_buffer, dtype = np.float64).reshape(-1, 2)");
+        }
+
+        // Star extraction
+        EPSFBuilderProfiler::Scope extractScope("python: extract_stars");
+        Run("stars_tbl = Table()");
+        Run("stars_tbl['x'] = starpos[:, 0]");
+        Run("stars_tbl['y'] = starpos[:, 1]");
+        Run("nddata = NDData(data = data)");
+        cmd.Format("stars = extract_stars(nddata, stars_tbl, size = %d)", task.cutoutSize);
+        Run(cmd);
+        extractScope.End();
+
+        // Keep the stars without a second source in their cutout
+        if (task.isolate)
+        {
+            EPSFBuilderProfiler::Scope isolateScope("python: isolation filter");
+            Run("good_stars = []");
+            cmd.Format("daofind = DAOStarFinder(fwhm = %lf, threshold = %lf, brightest = 2)", task.fwhm, task.threshold);
+            Run(cmd);
+            Run("for i in range(stars.n_stars):\n"
+                "    star = stars.all_stars[i]\n"
+                "    sources = daofind(star.data)\n"
+                "    if not (sources is None) and (sources['id'].size == 1):\n"
+                "        good_stars.append(star)\n");
+            Run("stars = EPSFStars(good_stars)");
+        }
+
+        cmd.Format("n_stars = min(stars.n_stars, %d)", task.maxStars);
+        Run(cmd);
+        Run("cutout_height, cutout_width = stars.all_stars[0].data.shape if n_stars > 0 else (0, 0)");
+        result.starCount = GetInt("n_stars");
+        if (result.starCount < 1)
+            throw Error("No isolated stars found");
+        result.cutoutWidth = GetInt("cutout_width");
+        result.cutoutHeight = GetInt("cutout_height");
+        size_type cutoutSize = size_type(result.cutoutWidth) * result.cutoutHeight;
+
+        // Python copies all cutouts and their origin, center and flux into two contiguous C++ blocks
+        EPSFBuilderProfiler::Scope copyScope("python: copy stars");
+        result.starData.resize(result.starCount * cutoutSize);
+        result.starMeta.resize(result.starCount * 5);
+        ShareBuffer("star_buffer", result.starData.data(), result.starData.size() * sizeof(double), true);
+        ShareBuffer("meta_buffer", result.starMeta.data(), result.starMeta.size() * sizeof(double), true);
+        Run("star_data = np.frombuffer(star_buffer, dtype = np.float64).reshape(n_stars, cutout_height, cutout_width)\n"
+            "star_meta = np.frombuffer(meta_buffer, dtype = np.float64).reshape(n_stars, 5)\n"
+            "for i in range(n_stars):\n"
+            "    star = stars.all_stars[i]\n"
+            "    star_data[i] = star.data\n"
+            "    star_meta[i] = (star.origin[0], star.origin[1], star.center[0], star.center[1], star.flux)\n"
+            "del star_data, star_meta, star_buffer, meta_buffer\n");
+        copyScope.End();
+
+        // ePSF fitting
+        if (task.fit)
+            FitStars(task, result);
+    }
+    catch (...)
+    {
+        Release();
+        throw;
+    }
+
+    // Drop every Python object that may still reference the pixel buffer of image
+    Release();
+}
+
+void EPSFBuilderPython::FitStars(const EPSFBuilderPythonTask& task, EPSFBuilderExtraction& result)
+{
+    EPSFBuilderProfiler::Scope fitScope("python: EPSFBuilder");
+    IsoString cmd;
+    cmd.Format("epsf_builder = EPSFBuilder(oversampling = %d, maxiters = %d, smoothing_kernel = '%s')", task.oversampling, task.maxIterations, task.smoothingKernel);
+    Run(cmd);
+    Run("epsf, fitted_stars = epsf_builder(stars)");
+
+    // Python copies the ePSF into a C++ buffer
+    Run("epsf_height, epsf_width = epsf.data.shape");
+    result.epsfWidth = GetInt("epsf_width");
+    result.epsfHeight = GetInt("epsf_height");
+    result.epsfData.resize(size_type(result.epsfWidth) * result.epsfHeight);
+    ShareBuffer("epsf_buffer", result.epsfData.data(), result.epsfData.size() * sizeof(double), true);
+    Run("np.frombuffer(epsf_buffer, dtype = np.float64).reshape(epsf_height, epsf_width)[:] = epsf.data\n"
+        "del epsf_buffer\n");
+}
+
+void EPSFBuilderPython::Fit(const EPSFBuilderPythonTask& task, const EPSFBuilderExtraction& stars, EPSFBuilderExtraction& result)
+{
+    EPSFBuilderProfiler::Scope scope("python fit");
+
+    // The GIL is released on every exit, including a KeyboardInterrupt raised while cleaning up
+    struct GILState
+    {
+        EPSFBuilderPython& python;
+        int state;
+
+        GILState(EPSFBuilderPython& p)
+            : python(p)
+            , state(p.PyGILState_Ensure())
+        {
+        }
+
+        ~GILState()
+        {
+            python.m_fitThread = 0;
+            python.PyGILState_Release(state);
+        }
+    } gil(*this);
+
+    m_fitThread = PyThread_get_thread_ident();
+    try
+    {
+        // The cutouts are shared read-only and copied into the stars, which EPSFBuilder may modify
+        ShareBuffer("star_buffer", (void*)stars.starData.data(), stars.starData.size() * sizeof(double), false);
+        ShareBuffer("meta_buffer", (void*)stars.starMeta.data(), stars.starMeta.size() * sizeof(double), false);
+        IsoString cmd;
+        cmd.Format("star_data = np.frombuffer(star_buffer, dtype = np.float64).reshape(%d, %d, %d)\n"
+                   "star_meta = np.frombuffer(meta_buffer, dtype = np.float64).reshape(%d, 5)\n",
+                   stars.starCount, stars.cutoutHeight, stars.cutoutWidth, stars.starCount);
+        Run(cmd);
+        Run("stars = EPSFStars([EPSFStar(np.array(star_data[i]), cutout_center = (m[2] - m[0], m[3] - m[1]), origin = (m[0], m[1]))\n"
+            "                   for i, m in enumerate(star_meta)])\n"
+            "del star_data, star_meta, star_buffer, meta_buffer\n");
+        FitStars(task, result);
+    }
+    catch (...)
+    {
+        m_fitThread = 0;
+        Release();
+        throw;
+    }
+    m_fitThread = 0;
+    Release();
+}
+
+void EPSFBuilderPython::Interrupt()
+{
+    int gil = PyGILState_Ensure();
+    unsigned long thread = m_fitThread;
+    if (thread != 0)
+        PyThreadState_SetAsyncExc(thread, *m_keyboardInterrupt);
+    PyGILState_Release(gil);
+}
+
+EPSFBuilderPython::GILRelease::GILRelease(EPSFBuilderPython& python)
+    : m_python(python)
+    , m_state(python.PyEval_SaveThread())
+{
+}
+
+EPSFBuilderPython::GILRelease::~GILRelease()
+{
+    m_python.PyEval_RestoreThread(m_state);
+}
+
+}	// namespace pcl
\ No newline at end of file
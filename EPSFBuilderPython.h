@@ -0,0 +1,149 @@
+#ifndef __EPSFBuilderPython_h
+#define __EPSFBuilderPython_h
+
+#include <atomic>
+#include <vector>
+#include <pcl/Exception.h>
+#include <pcl/ImageVariant.h>
+#include <pcl/String.h>
+
+// The calling convention only matters on 32-bit Windows
+#ifndef __PCL_WINDOWS
+#define __cdecl
+#endif
+
+namespace pcl
+{
+
+// Work done in Python for one image: optional photutils detection, star extraction, the isolation
+// filter and, with the photutils fitting engine, EPSFBuilder. It runs either in the embedded
+// interpreter or in an out-of-process worker (EPSFBuilderWorkerPool).
+
+struct EPSFBuilderPythonTask
+{
+    bool detect = false;            // run DAOStarFinder instead of using positions
+    std::vector<double> positions;  // x, y pairs of the natively detected stars
+    double fwhm = 0;
+    double threshold = 0;
+    double peakMax = 0;
+    int brightest = 0;
+    int maxStars = 0;
+    int cutoutSize = 0;
+    bool isolate = false;           // reject crowded cutouts with DAOStarFinder, positions are prefiltered otherwise
+    bool fit = false;               // run photutils EPSFBuilder
+    int oversampling = 0;
+    int maxIterations = 0;
+    const char* smoothingKernel = "quartic";
+};
+
+// Debug switch of the transport: with the environment variable EPSFBUILDER_STUB_WORKERS set to
+// anything but 0, the out-of-process workers are stand-ins that only need the Python standard
+// library, extract plain cutouts around the given positions and only support the native engines.
+// Read once per process.
+bool EPSFBuilderStubWorkers();
+
+// Result of an EPSFBuilderPythonTask. Cutouts are stored contiguously, starMeta holds origin x, y,
+// center x, y and flux of every star, and epsfData is only filled when the task fits the ePSF.
+
+struct EPSFBuilderExtraction
+{
+    int starCount = 0;
+    int cutoutWidth = 0;
+    int cutoutHeight = 0;
+    std::vector<double> starData;
+    std::vector<double> starMeta;
+    int epsfWidth = 0;
+    int epsfHeight = 0;
+    std::vector<double> epsfData;
+};
+
+// Embedded Python interpreter. The DLL, the interpreter and the astropy/photutils/numpy imports are
+// loaded once per session and reused by every execution, including all frames of a batch.
+
+class EPSFBuilderPython
+{
+public:
+    // Returns the shared interpreter, loading pythonDll on first use
+    static EPSFBuilderPython& Acquire(const String& pythonDll);
+
+    void Run(const char* code);
+
+    void Run(const IsoString& code)
+    {
+        Run(code.c_str());
+    }
+
+    // Publishes a C++ buffer in __main__ as a memoryview, without copying it
+    void ShareBuffer(const char* name, void* buffer, size_type size, bool writable);
+
+    int GetInt(const char* name);
+
+    // Drops every __main__ name that may hold a view of a shared C++ buffer
+    void Release();
+
+    // Runs the task on image, which is shared with Python without copying it
+    void RunTask(const EPSFBuilderPythonTask& task, ImageVariant& image, EPSFBuilderExtraction& result);
+
+    // Runs photutils EPSFBuilder on the stars of an extraction, rebuilt from its cutouts, and stores
+    // the ePSF in the epsf members of result. Unlike the other members it is called from a worker
+    // thread, which takes the GIL for the duration of the fit: the thread that owns the interpreter
+    // must release it first.
+    void Fit(const EPSFBuilderPythonTask& task, const EPSFBuilderExtraction& stars, EPSFBuilderExtraction& result);
+
+    // Raises KeyboardInterrupt in the thread running Fit(), which then throws. Called by the owner of
+    // the interpreter while it has released the GIL.
+    void Interrupt();
+
+    // Releases the GIL held by the thread that initialized the interpreter, for the lifetime of the
+    // object, so that Fit() can run on another thread
+    class GILRelease
+    {
+    public:
+        GILRelease(EPSFBuilderPython& python);
+        ~GILRelease();
+
+    private:
+        EPSFBuilderPython& m_python;
+        void* m_state;
+    };
+
+private:
+    typedef void* PyObjectPtr;
+
+    static void* m_pythonLibrary;   // HMODULE on Windows, dlopen() handle elsewhere
+
+    int(__cdecl* PyRun_SimpleString)(const char*);
+    PyObjectPtr(__cdecl* PyMemoryView_FromMemory)(char*, ptrdiff_t, int);
+    int(__cdecl* PyDict_SetItemString)(PyObjectPtr, const char*, PyObjectPtr);
+    PyObjectPtr(__cdecl* PyDict_GetItemString)(PyObjectPtr, const char*);
+    long(__cdecl* PyLong_AsLong)(PyObjectPtr);
+    void(__cdecl* Py_DecRef)(PyObjectPtr);
+    void*(__cdecl* PyEval_SaveThread)();
+    void(__cdecl* PyEval_RestoreThread)(void*);
+    int(__cdecl* PyGILState_Ensure)();
+    void(__cdecl* PyGILState_Release)(int);
+    unsigned long(__cdecl* PyThread_get_thread_ident)();
+    int(__cdecl* PyThreadState_SetAsyncExc)(unsigned long, PyObjectPtr);
+    PyObjectPtr* m_keyboardInterrupt = nullptr;
+    PyObjectPtr m_mainDict = nullptr;
+    std::atomic<unsigned long> m_fitThread;
+
+    EPSFBuilderPython();
+
+    // Runs EPSFBuilder on the EPSFStars object stars and copies the ePSF into result
+    void FitStars(const EPSFBuilderPythonTask& task, EPSFBuilderExtraction& result);
+
+    static void* Symbol(const char* name);
+
+    template<typename T>
+    void loadPythonAPI(T& func, const char* funcName)
+    {
+        func = (T)Symbol(funcName);
+        if (func == nullptr)
+            throw Error("Failed to get function " + String(funcName) + " from Python DLL");
+    }
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderPython_h
\ No newline at end of file
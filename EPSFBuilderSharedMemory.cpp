@@ -0,0 +1,66 @@
+#include <pcl/Atomic.h>
+
+#ifndef __PCL_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "EPSFBuilderSharedMemory.h"
+
+namespace pcl
+{
+
+static AtomicInt s_segmentCount;
+
+EPSFBuilderSharedMemory::EPSFBuilderSharedMemory(size_type size)
+    : m_size(pcl::Max(size, size_type(8)))
+{
+#ifdef __PCL_WINDOWS
+    m_name = IsoString().Format("epsfbuilder_%u_%d", unsigned(GetCurrentProcessId()), s_segmentCount.FetchAndAdd(1));
+    m_handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, DWORD(uint64(m_size) >> 32), DWORD(m_size & 0xffffffff), (LPCWSTR)String(m_name).c_str());
+    if (m_handle == NULL)
+        throw Error("Unable to create shared memory segment: " + String(m_name));
+    m_data = MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, m_size);
+    if (m_data == nullptr)
+    {
+        CloseHandle(m_handle);
+        throw Error("Unable to map shared memory segment: " + String(m_name));
+    }
+#else
+    m_name = IsoString().Format("epsfbuilder_%d_%d", int(getpid()), s_segmentCount.FetchAndAdd(1));
+    IsoString path = '/' + m_name;
+    m_fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (m_fd < 0)
+        throw Error("Unable to create shared memory segment: " + String(m_name));
+    if (ftruncate(m_fd, off_t(m_size)) != 0)
+    {
+        close(m_fd);
+        shm_unlink(path.c_str());
+        throw Error("Unable to allocate shared memory segment: " + String(m_name));
+    }
+    m_data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_data == MAP_FAILED)
+    {
+        m_data = nullptr;
+        close(m_fd);
+        shm_unlink(path.c_str());
+        throw Error("Unable to map shared memory segment: " + String(m_name));
+    }
+#endif
+}
+
+EPSFBuilderSharedMemory::~EPSFBuilderSharedMemory()
+{
+#ifdef __PCL_WINDOWS
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_handle);
+#else
+    munmap(m_data, m_size);
+    close(m_fd);
+    shm_unlink(('/' + m_name).c_str());
+#endif
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef __EPSFBuilderSharedMemory_h
+#define __EPSFBuilderSharedMemory_h
+
+#include <pcl/Exception.h>
+#include <pcl/String.h>
+
+namespace pcl
+{
+
+// Named shared memory segment owned by this process. Python workers attach to it by name with
+// multiprocessing.shared_memory.SharedMemory. The segment is unlinked when the object is destroyed.
+
+class EPSFBuilderSharedMemory
+{
+public:
+    EPSFBuilderSharedMemory(size_type size);
+    ~EPSFBuilderSharedMemory();
+
+    EPSFBuilderSharedMemory(const EPSFBuilderSharedMemory&) = delete;
+    EPSFBuilderSharedMemory& operator =(const EPSFBuilderSharedMemory&) = delete;
+
+    const IsoString& Name() const
+    {
+        return m_name;
+    }
+
+    void* Data() const
+    {
+        return m_data;
+    }
+
+    size_type Size() const
+    {
+        return m_size;
+    }
+
+private:
+    IsoString m_name;
+    void* m_data = nullptr;
+    size_type m_size = 0;
+#ifdef __PCL_WINDOWS
+    HANDLE m_handle = NULL;
+#else
+    int m_fd = -1;
+#endif
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderSharedMemory_h
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderStarArena.h"
+
+namespace pcl
+{
+
+void EPSFBuilderStarArena::Allocate(int count, int width, int height)
+{
+    const size_type samplesPerLine = Alignment / sizeof(float);
+    m_count = count;
+    m_width = width;
+    m_height = height;
+    m_stride = (size_type(width) * height + samplesPerLine - 1) / samplesPerLine * samplesPerLine;
+    m_data.assign(m_stride * count, 0.0f);
+    originX.assign(count, 0.0);
+    originY.assign(count, 0.0);
+    centerX.assign(count, 0.0);
+    centerY.assign(count, 0.0);
+    flux.assign(count, 0.0);
+}
+
+void EPSFBuilderStarArena::Assign(const EPSFBuilderExtraction& extraction)
+{
+    Allocate(extraction.starCount, extraction.cutoutWidth, extraction.cutoutHeight);
+    const size_type cutoutSize = size_type(m_width) * m_height;
+    EPSFBuilderParallelFor(size_type(m_count), [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            const double* cutout = extraction.starData.data() + i * cutoutSize;
+            std::copy(cutout, cutout + cutoutSize, Cutout(int(i)));
+            const double* meta = extraction.starMeta.data() + 5 * i;
+            originX[i] = meta[0];
+            originY[i] = meta[1];
+            centerX[i] = meta[2];
+            centerY[i] = meta[3];
+            flux[i] = meta[4];
+        }
+    }, 64);
+}
+
+void EPSFBuilderStarArena::Export(EPSFBuilderExtraction& extraction) const
+{
+    const size_type cutoutSize = size_type(m_width) * m_height;
+    extraction.starCount = m_count;
+    extraction.cutoutWidth = m_width;
+    extraction.cutoutHeight = m_height;
+    extraction.starData.resize(m_count * cutoutSize);
+    extraction.starMeta.resize(5 * size_type(m_count));
+    EPSFBuilderParallelFor(size_type(m_count), [&](size_type begin, size_type end, int)
+    {
+        for (size_type i = begin; i < end; i++)
+        {
+            const float* cutout = Cutout(int(i));
+            std::copy(cutout, cutout + cutoutSize, extraction.starData.begin() + i * cutoutSize);
+            double* meta = extraction.starMeta.data() + 5 * i;
+            meta[0] = originX[i];
+            meta[1] = originY[i];
+            meta[2] = centerX[i];
+            meta[3] = centerY[i];
+            meta[4] = flux[i];
+        }
+    }, 64);
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef __EPSFBuilderStarArena_h
+#define __EPSFBuilderStarArena_h
+
+#include <new>
+#include <vector>
+#include <pcl/Defs.h>
+
+#include "EPSFBuilderPython.h"
+
+namespace pcl
+{
+
+// Allocator of blocks aligned to a cache line, which is also the width of the widest vector registers
+template <typename T>
+class EPSFBuilderAlignedAllocator
+{
+public:
+    typedef T value_type;
+
+    static const size_t Alignment = 64;     // bytes
+
+    EPSFBuilderAlignedAllocator() = default;
+
+    template <typename U>
+    EPSFBuilderAlignedAllocator(const EPSFBuilderAlignedAllocator<U>&)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const EPSFBuilderAlignedAllocator<U>&) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const EPSFBuilderAlignedAllocator<U>&) const
+    {
+        return false;
+    }
+};
+
+// The extracted stars of an image, the single star container from Step 7 on: the fitter reads its
+// cutouts in place, and the mosaic, the detection boxes and the catalog are drawn from it. Every
+// cutout is stored as 32-bit samples in one contiguous block, starting on a 64-byte boundary so
+// that the rows of every cutout can be loaded with aligned vector instructions, and the metadata of
+// the stars is held in parallel arrays.
+//
+// EPSFBuilderExtraction remains the layout exchanged with Python and the detection cache; Assign()
+// and Export() convert between both.
+
+class EPSFBuilderStarArena
+{
+public:
+    static const size_type Alignment = EPSFBuilderAlignedAllocator<float>::Alignment;
+
+    std::vector<double> originX;                    // top left corner of the cutouts, in image pixels
+    std::vector<double> originY;
+    std::vector<double> centerX;                    // star centers, in image pixels
+    std::vector<double> centerY;
+    std::vector<double> flux;                       // sum of the cutout pixels
+
+    // Allocates count zero cutouts of width x height samples, with zero metadata
+    void Allocate(int count, int width, int height);
+
+    void Assign(const EPSFBuilderExtraction& extraction);
+
+    // Writes the stars into the cutouts and metadata of extraction; the ePSF of extraction is kept
+    void Export(EPSFBuilderExtraction& extraction) const;
+
+    void Clear()
+    {
+        Allocate(0, 0, 0);
+    }
+
+    int Count() const
+    {
+        return m_count;
+    }
+
+    bool IsEmpty() const
+    {
+        return m_count == 0;
+    }
+
+    int Width() const
+    {
+        return m_width;
+    }
+
+    int Height() const
+    {
+        return m_height;
+    }
+
+    // Samples from the start of a cutout to the start of the next one, a multiple of the alignment
+    size_type Stride() const
+    {
+        return m_stride;
+    }
+
+    float* Cutout(int i)
+    {
+        return m_data.data() + i * m_stride;
+    }
+
+    const float* Cutout(int i) const
+    {
+        return m_data.data() + i * m_stride;
+    }
+
+private:
+    int m_count = 0;
+    int m_width = 0;
+    int m_height = 0;
+    size_type m_stride = 0;
+    std::vector<float, EPSFBuilderAlignedAllocator<float>> m_data;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderStarArena_h
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <pcl/Math.h>
+#include <pcl/Point.h>
+
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderStarDetector.h"
+
+namespace pcl
+{
+
+// Sharpness and roundness limits used by DAOStarFinder by default
+static const double SharpLow = 0.2;
+static const double SharpHigh = 1.0;
+static const double RoundLow = -1.0;
+static const double RoundHigh = 1.0;
+
+EPSFBuilderStarDetector::EPSFBuilderStarDetector(double fwhm, double threshold, double peakMax, int brightest)
+    : m_threshold(threshold)
+    , m_peakMax(peakMax)
+    , m_brightest(brightest)
+{
+    // Circular Gaussian truncated at 1.5 sigma, with a minimum radius of 2 pixels
+    m_sigma = fwhm / 2.3548200450309493;
+    double a = 1 / (2 * m_sigma * m_sigma);
+    double f = 1.5 * 1.5 / 2;
+    m_nx = m_ny = 2 * int(Max(2.0, pcl::Sqrt(f / a))) + 1;
+    m_xc = m_nx / 2;
+    m_yc = m_ny / 2;
+
+    size_type n = size_type(m_nx) * m_ny;
+    m_gaussian.resize(n);
+    m_mask.resize(n);
+    m_kernel.resize(n);
+    m_npixels = 0;
+    double sum = 0, sum2 = 0;
+    for (int y = 0, k = 0; y < m_ny; y++)
+        for (int x = 0; x < m_nx; x++, k++)
+        {
+            double dx = x - m_xc;
+            double dy = y - m_yc;
+            double r = a * (dx * dx + dy * dy);
+            m_gaussian[k] = pcl::Exp(-r);
+            m_mask[k] = (r <= f || pcl::Sqrt(dx * dx + dy * dy) <= 2.0) ? 1 : 0;
+            if (m_mask[k])
+            {
+                m_npixels++;
+                sum += m_gaussian[k];
+                sum2 += m_gaussian[k] * m_gaussian[k];
+            }
+        }
+
+    double denom = sum2 - sum * sum / m_npixels;
+    m_relerr = 1 / pcl::Sqrt(denom);
+    for (size_type k = 0; k < n; k++)
+        m_kernel[k] = m_mask[k] ? (m_gaussian[k] - sum / m_npixels) / denom : 0.0;
+}
+
+std::vector<EPSFBuilderStarDetector::Star> EPSFBuilderStarDetector::Detect(const ImageVariant& image) const
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("Star detection requires a real floating point image");
+
+    switch (image.BitsPerSample())
+    {
+    case 32: return DetectImage(static_cast<const Image&>(*image));
+    case 64: return DetectImage(static_cast<const DImage&>(*image));
+    }
+    return std::vector<Star>();
+}
+
+template <typename T>
+void EPSFBuilderStarDetector::Convolve(const T* data, T* result, int width, int height) const
+{
+    // Zero-padded direct convolution. Each kernel tap is applied to a whole row segment, so the
+    // innermost loop is a contiguous multiply-add the compiler can vectorize.
+    EPSFBuilderParallelFor(size_type(height), [&](size_type begin, size_type end, int)
+    {
+        for (int y = int(begin); y < int(end); y++)
+        {
+            T* out = result + size_type(y) * width;
+            std::fill(out, out + width, T(0));
+            for (int ky = 0; ky < m_ny; ky++)
+            {
+                int sy = y + ky - m_yc;
+                if (sy < 0 || sy >= height)
+                    continue;
+                const T* row = data + size_type(sy) * width;
+                for (int kx = 0; kx < m_nx; kx++)
+                {
+                    int k = ky * m_nx + kx;
+                    if (!m_mask[k])
+                        continue;
+                    T w = T(m_kernel[k]);
+                    int dx = kx - m_xc;
+                    int x0 = Max(0, -dx);
+                    int x1 = Min(width, width - dx);
+                    const T* __restrict in = row + x0 + dx;
+                    T* __restrict o = out + x0;
+                    for (int x = 0, n = x1 - x0; x < n; x++)
+                        o[x] += w * in[x];
+                }
+            }
+        }
+    }, 16);
+}
+
+bool EPSFBuilderStarDetector::MarginalFit(const double* cutout, bool alongX, double& shift, double& amplitude) const
+{
+    // Fit data = sky + h*kernel to the triangularly weighted marginal distribution along one axis,
+    // then linearize the Gaussian around the kernel center to obtain the centroid shift.
+    int size = alongX ? m_nx : m_ny;
+    int center = alongX ? m_xc : m_yc;
+    int otherSize = alongX ? m_ny : m_nx;
+    int otherCenter = alongX ? m_yc : m_xc;
+
+    double wtSum = 0, kernSum = 0, kern2Sum = 0, dkernSum = 0, dkern2Sum = 0, kernDkernSum = 0;
+    double dataSum = 0, dataKernSum = 0, dataDkernSum = 0, dataDxSum = 0;
+    for (int i = 0; i < size; i++)
+    {
+        double kern1d = 0, data1d = 0;
+        for (int j = 0; j < otherSize; j++)
+        {
+            int k = alongX ? j * m_nx + i : i * m_nx + j;
+            double w = otherCenter - Abs(j - otherCenter) + 1;
+            kern1d += m_gaussian[k] * w;
+            data1d += cutout[k] * w;
+        }
+
+        double wt = center - Abs(i - center) + 1;
+        double dx = center - i;
+        double dkern = kern1d * dx;
+        wtSum += wt;
+        kernSum += kern1d * wt;
+        kern2Sum += kern1d * kern1d * wt;
+        dkernSum += dkern * wt;
+        dkern2Sum += dkern * dkern * wt;
+        kernDkernSum += kern1d * dkern * wt;
+        dataSum += data1d * wt;
+        dataKernSum += data1d * kern1d * wt;
+        dataDkernSum += data1d * dkern * wt;
+        dataDxSum += data1d * (i - center) * wt;
+    }
+
+    double hNumer = dataKernSum - dataSum * kernSum / wtSum;
+    double hDenom = kern2Sum - kernSum * kernSum / wtSum;
+    if (hNumer <= 0 || hDenom <= 0)
+        return false;
+
+    double h = hNumer / hDenom;
+    double sky = (dataSum - h * kernSum) / wtSum;
+    double dx = m_sigma * m_sigma * (h * kernDkernSum + sky * dkernSum - dataDkernSum) / (h * dkern2Sum);
+
+    double halfSize = size / 2.0;
+    if (Abs(dx) > halfSize)
+    {
+        dx = (dataSum != 0) ? dataDxSum / dataSum : 0.0;
+        if (Abs(dx) > halfSize)
+            dx = 0;
+    }
+
+    shift = dx;
+    amplitude = h;
+    return true;
+}
+
+template <class P>
+std::vector<EPSFBuilderStarDetector::Star> EPSFBuilderStarDetector::DetectImage(const GenericImage<P>& image) const
+{
+    typedef typename P::sample sample;
+
+    const int width = image.Width();
+    const int height = image.Height();
+    const sample* data = image[0];
+    const double thresholdEff = m_threshold * m_relerr;
+
+    std::vector<sample> convolved(size_type(width) * height);
+    Convolve(data, convolved.data(), width, height);
+
+    // Footprint offsets for the local maximum search, excluding the central pixel
+    std::vector<int> fx, fy;
+    for (int y = 0, k = 0; y < m_ny; y++)
+        for (int x = 0; x < m_nx; x++, k++)
+            if (m_mask[k] && (x != m_xc || y != m_yc))
+            {
+                fx.push_back(x - m_xc);
+                fy.push_back(y - m_yc);
+            }
+
+    // Local maxima above threshold, with zero padding outside the image
+    int numberOfThreads = EPSFBuilderThreadCount(size_type(height), 16);
+    std::vector<std::vector<Point>> threadPeaks(numberOfThreads);
+    EPSFBuilderParallelFor(size_type(height), [&](size_type begin, size_type end, int thread)
+    {
+        std::vector<Point>& peaks = threadPeaks[thread];
+        for (int y = int(begin); y < int(end); y++)
+        {
+            const sample* row = convolved.data() + size_type(y) * width;
+            for (int x = 0; x < width; x++)
+            {
+                sample v = row[x];
+                if (!(v > thresholdEff))
+                    continue;
+                bool isPeak = true;
+                for (size_type i = 0; i < fx.size(); i++)
+                {
+                    int sx = x + fx[i];
+                    int sy = y + fy[i];
+                    sample n = (sx >= 0 && sx < width && sy >= 0 && sy < height) ? convolved[size_type(sy) * width + sx] : sample(0);
+                    if (n > v)
+                    {
+                        isPeak = false;
+                        break;
+                    }
+                }
+                if (isPeak)
+                    peaks.push_back(Point(x, y));
+            }
+        }
+    }, 16);
+
+    std::vector<Point> peaks;
+    for (const std::vector<Point>& p : threadPeaks)
+        peaks.insert(peaks.end(), p.begin(), p.end());
+
+    // Source properties and filtering
+    std::vector<Star> stars(peaks.size());
+    std::vector<uint8> accepted(peaks.size(), 0);
+    EPSFBuilderParallelFor(peaks.size(), [&](size_type begin, size_type end, int)
+    {
+        std::vector<double> cutData(size_type(m_nx) * m_ny);
+        std::vector<double> cutConv(size_type(m_nx) * m_ny);
+        for (size_type s = begin; s < end; s++)
+        {
+            int px = peaks[s].x;
+            int py = peaks[s].y;
+            for (int y = 0, k = 0; y < m_ny; y++)
+                for (int x = 0; x < m_nx; x++, k++)
+                {
+                    int sx = px + x - m_xc;
+                    int sy = py + y - m_yc;
+                    bool inside = sx >= 0 && sx < width && sy >= 0 && sy < height;
+                    size_type i = size_type(sy) * width + sx;
+                    cutData[k] = inside ? double(data[i]) : 0.0;
+                    cutConv[k] = inside ? double(convolved[i]) : 0.0;
+                }
+
+            int kc = m_yc * m_nx + m_xc;
+            double dataPeak = cutData[kc];
+            double convPeak = cutConv[kc];
+
+            double maskedSum = 0;
+            for (int k = 0, n = m_nx * m_ny; k < n; k++)
+                if (m_mask[k])
+                    maskedSum += cutData[k];
+
+            // The quadrant sums of roundness1 cover the whole box of the convolved cutout, not only
+            // the kernel footprint, with the central pixel set to zero, quad1 to quad4 as photutils
+            double roundSum2 = 0, roundSum4 = 0;
+            int nonZero = 0;
+            for (int y = 0, k = 0; y < m_ny; y++)
+                for (int x = 0; x < m_nx; x++, k++)
+                {
+                    if (cutData[k] != 0)
+                        nonZero++;
+                    if (k == kc)
+                        continue;
+                    double c = cutConv[k];
+                    roundSum4 += Abs(c);
+                    if (y <= m_yc && x > m_xc)
+                        roundSum2 -= c;
+                    else if (y < m_yc && x <= m_xc)
+                        roundSum2 += c;
+                    else if (y >= m_yc && x < m_xc)
+                        roundSum2 -= c;
+                    else if (y > m_yc && x >= m_xc)
+                        roundSum2 += c;
+                }
+
+            // photutils rejects a cutout with a single nonzero pixel, and a zero sum4, where
+            // roundness1 is not finite
+            if (nonZero <= 1 || roundSum4 == 0)
+                continue;
+
+            Star& star = stars[s];
+            star.peak = dataPeak;
+            star.convolvedPeak = convPeak;
+            star.sharpness = (dataPeak - (maskedSum - dataPeak) / (m_npixels - 1)) / convPeak;
+            star.roundness1 = 2 * roundSum2 / roundSum4;
+
+            double dx, hx, dy, hy;
+            if (!MarginalFit(cutData.data(), true, dx, hx) || !MarginalFit(cutData.data(), false, dy, hy))
+                continue;
+            star.x = px + dx;
+            star.y = py + dy;
+            star.roundness2 = 2 * (hx - hy) / (hx + hy);
+
+            if (star.sharpness < SharpLow || star.sharpness > SharpHigh)
+                continue;
+            if (star.roundness1 < RoundLow || star.roundness1 > RoundHigh)
+                continue;
+            if (star.roundness2 < RoundLow || star.roundness2 > RoundHigh)
+                continue;
+            if (star.peak > m_peakMax)
+                continue;
+            accepted[s] = 1;
+        }
+    });
+
+    std::vector<Star> result;
+    for (size_type s = 0; s < stars.size(); s++)
+        if (accepted[s])
+            result.push_back(stars[s]);
+
+    std::stable_sort(result.begin(), result.end(), [](const Star& a, const Star& b)
+    {
+        return a.convolvedPeak > b.convolvedPeak;
+    });
+    if (m_brightest > 0 && result.size() > size_type(m_brightest))
+        result.resize(m_brightest);
+
+    return result;
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef __EPSFBuilderStarDetector_h
+#define __EPSFBuilderStarDetector_h
+
+#include <vector>
+#include <pcl/ImageVariant.h>
+
+namespace pcl
+{
+
+// Native implementation of the DAOFIND algorithm as used by photutils DAOStarFinder: convolution
+// with a zero-sum Gaussian kernel, local maximum search over the kernel footprint, then
+// sharpness/roundness/peakmax filtering of the candidates.
+
+class EPSFBuilderStarDetector
+{
+public:
+    struct Star
+    {
+        double x;               // centroid, in image pixels
+        double y;
+        double peak;            // peak value of the source image
+        double convolvedPeak;   // peak value of the convolved image
+        double sharpness;
+        double roundness1;
+        double roundness2;
+    };
+
+    EPSFBuilderStarDetector(double fwhm, double threshold, double peakMax, int brightest);
+
+    // Returns the detected stars sorted by brightness, at most `brightest` of them if brightest > 0.
+    std::vector<Star> Detect(const ImageVariant& image) const;
+
+private:
+    double m_threshold;
+    double m_peakMax;
+    int m_brightest;
+
+    // Kernel geometry and coefficients, see photutils _StarFinderKernel
+    double m_sigma;
+    int m_nx;
+    int m_ny;
+    int m_xc;
+    int m_yc;
+    int m_npixels;
+    double m_relerr;
+    std::vector<double> m_gaussian;     // unmasked Gaussian
+    std::vector<uint8> m_mask;
+    std::vector<double> m_kernel;       // zero-sum normalized convolution kernel
+
+    template <class P>
+    std::vector<Star> DetectImage(const GenericImage<P>& image) const;
+
+    template <typename T>
+    void Convolve(const T* data, T* result, int width, int height) const;
+
+    bool MarginalFit(const double* cutout, bool alongX, double& shift, double& amplitude) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderStarDetector_h
\ No newline at end of file
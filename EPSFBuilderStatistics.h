@@ -0,0 +1,47 @@
+#ifndef __EPSFBuilderStatistics_h
+#define __EPSFBuilderStatistics_h
+
+#include <algorithm>
+#include <vector>
+#include <pcl/Image.h>
+#include <pcl/Math.h>
+
+namespace pcl
+{
+
+// Median and MAD of the first channel of image, estimated from a regular sample of at most 2^18 of
+// its finite pixels, so that the cost does not grow with the size of the image. Both are zero for an
+// image without finite pixels.
+template <class P>
+void EPSFBuilderSampledMedianMAD(const GenericImage<P>& image, double& median, double& mad)
+{
+    const size_type maxSamples = 262144;
+    const size_type count = image.NumberOfPixels();
+    const size_type step = Max(size_type(1), count / maxSamples);
+    const typename P::sample* data = image[0];
+    std::vector<double> samples;
+    samples.reserve(count / step + 1);
+    for (size_type i = step / 2; i < count; i += step)
+    {
+        double value;
+        P::FromSample(value, data[i]);
+        if (IsFinite(value))
+            samples.push_back(value);
+    }
+    if (samples.empty())
+    {
+        median = mad = 0;
+        return;
+    }
+    auto middle = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), middle, samples.end());
+    median = *middle;
+    for (double& value : samples)
+        value = Abs(value - median);
+    std::nth_element(samples.begin(), middle, samples.end());
+    mad = *middle;
+}
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderStatistics_h
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <cmath>
+#include <random>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderParallel.h"
+#include "EPSFBuilderSynthetic.h"
+
+namespace pcl
+{
+
+EPSFBuilderSynthetic::EPSFBuilderSynthetic(const Parameters& parameters)
+    : m_parameters(parameters)
+    , m_sigma(parameters.fwhm / 2.3548200450309493)
+{
+    std::mt19937_64 rng(parameters.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int count = int(parameters.density * parameters.width * parameters.height / 1.0e6 + 0.5);
+    double logMin = pcl::Ln(parameters.minPeak);
+    double logMax = pcl::Ln(parameters.maxPeak);
+    m_stars.resize(count);
+    for (Star& star : m_stars)
+    {
+        star.x = unit(rng) * parameters.width;
+        star.y = unit(rng) * parameters.height;
+        star.flux = pcl::Exp(logMin + unit(rng) * (logMax - logMin)) * 2 * Const<double>::pi() * m_sigma * m_sigma;
+    }
+}
+
+double EPSFBuilderSynthetic::PixelIntegral(double d) const
+{
+    double s = m_sigma * Const<double>::sqrt2();
+    return 0.5 * (std::erf((d + 0.5) / s) - std::erf((d - 0.5) / s));
+}
+
+double EPSFBuilderSynthetic::EffectivePSF(double dx, double dy) const
+{
+    return PixelIntegral(dx) * PixelIntegral(dy);
+}
+
+void EPSFBuilderSynthetic::Render(Image& image) const
+{
+    int width = m_parameters.width;
+    int height = m_parameters.height;
+    image.AllocateData(width, height);
+
+    // Background plane and noise, with one generator per row so the field does not depend on the
+    // number of threads
+    EPSFBuilderParallelFor(size_type(height), [&](size_type begin, size_type end, int)
+    {
+        for (int y = int(begin); y < int(end); y++)
+        {
+            std::mt19937_64 rng(m_parameters.seed * 0x9E3779B97F4A7C15ull + uint64(y));
+            std::normal_distribution<double> noise(0.0, m_parameters.noise);
+            float* row = image.ScanLine(y);
+            double gy = (y - 0.5 * height) / height;
+            for (int x = 0; x < width; x++)
+            {
+                double gx = (x - 0.5 * width) / width;
+                row[x] = float(m_parameters.background + 0.5 * m_parameters.gradient * (gx + gy) + noise(rng));
+            }
+        }
+    }, 16);
+
+    // Stars, truncated at 5 sigma
+    int radius = int(pcl::Ceil(5 * m_sigma));
+    std::vector<double> ex(2 * radius + 1);
+    std::vector<double> ey(2 * radius + 1);
+    for (const Star& star : m_stars)
+    {
+        int cx = int(star.x + 0.5);
+        int cy = int(star.y + 0.5);
+        for (int i = -radius; i <= radius; i++)
+        {
+            ex[i + radius] = PixelIntegral(cx + i - star.x);
+            ey[i + radius] = PixelIntegral(cy + i - star.y);
+        }
+        for (int y = Max(0, cy - radius); y <= Min(height - 1, cy + radius); y++)
+        {
+            float* row = image.ScanLine(y);
+            double fy = star.flux * ey[y - cy + radius];
+            for (int x = Max(0, cx - radius); x <= Min(width - 1, cx + radius); x++)
+                row[x] += float(fy * ex[x - cx + radius]);
+        }
+    }
+
+    // Saturation
+    EPSFBuilderParallelFor(size_type(height), [&](size_type begin, size_type end, int)
+    {
+        for (int y = int(begin); y < int(end); y++)
+        {
+            float* row = image.ScanLine(y);
+            for (int x = 0; x < width; x++)
+                row[x] = Range(row[x], 0.0f, 1.0f);
+        }
+    }, 16);
+}
+
+}	// namespace pcl
\ No newline at end of file
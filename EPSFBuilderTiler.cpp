@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <limits>
+#include <pcl/Math.h>
+
+#include "EPSFBuilderBackground.h"
+#include "EPSFBuilderCentroider.h"
+#include "EPSFBuilderExtractor.h"
+#include "EPSFBuilderIsolationFilter.h"
+#include "EPSFBuilderParameters.h"
+#include "EPSFBuilderProfiler.h"
+#include "EPSFBuilderTiler.h"
+
+namespace pcl
+{
+
+// Removes the spill file however the extraction ends
+class EPSFBuilderSpillFile : public File
+{
+public:
+    EPSFBuilderSpillFile()
+        : m_path(File::UniqueFileName(File::SystemTempDirectory(), 12, "EPSFBuilder_", ".tmp"))
+    {
+        Create(m_path);
+    }
+
+    ~EPSFBuilderSpillFile()
+    {
+        try
+        {
+            Close();
+            File::Remove(m_path);
+        }
+        catch (...)
+        {
+        }
+    }
+
+private:
+    String m_path;
+};
+
+EPSFBuilderTiler::EPSFBuilderTiler(const Parameters& parameters, size_type memoryBudget)
+    : m_parameters(parameters)
+    , m_memoryBudget(memoryBudget)
+{
+}
+
+void EPSFBuilderTiler::Extract(const ImageVariant& image, EPSFBuilderExtraction& result)
+{
+    if (!image.IsFloatSample() || image.IsComplexSample())
+        throw Error("Tiled processing requires a real floating point image");
+
+    if (image.BitsPerSample() == 32)
+        ExtractImage(static_cast<const Image&>(*image), result);
+    else
+        ExtractImage(static_cast<const DImage&>(*image), result);
+}
+
+int EPSFBuilderTiler::BackgroundMargin() const
+{
+    return EPSFBuilderBackground(m_parameters.layers).Radius();
+}
+
+// A star on the edge of a core is detected as on the whole image when the tile extends twice the
+// radius of the detection kernel beyond its peak, and its cutout needs half the cutout size
+int EPSFBuilderTiler::DetectionMargin() const
+{
+    int kernelRadius = Max(2, int(0.64 * m_parameters.fwhm) + 1);
+    return m_parameters.cutoutSize + 3 * kernelRadius;
+}
+
+int EPSFBuilderTiler::CoreSize(int bytesPerSample) const
+{
+    // The background pass needs the most memory: the tile, its smoothed copy and the buffer of the
+    // separable convolution, or every layer of the starlet transform. Cores are multiples of the
+    // largest scale so that the multiresolution background downsamples every tile on the same grid.
+    int images = (m_parameters.backgroundMode == EPSFBuilderBackgroundMode::Starlet) ? m_parameters.layers + 2 : 3;
+    int side = int(pcl::Sqrt(double(m_memoryBudget) / images / bytesPerSample));
+    int step = 1 << m_parameters.layers;
+    return Max(0, (side - 2 * BackgroundMargin()) / step * step);
+}
+
+template <class P>
+void EPSFBuilderTiler::ExtractImage(const GenericImage<P>& image, EPSFBuilderExtraction& result)
+{
+    typedef typename P::sample sample;
+
+    const int width = image.Width();
+    const int height = image.Height();
+    const int size = m_parameters.cutoutSize;
+    const int backgroundMargin = BackgroundMargin();
+    const int detectionMargin = DetectionMargin();
+
+    const int core = CoreSize(sizeof(sample));
+    if (core < backgroundMargin)
+    {
+        int images = (m_parameters.backgroundMode == EPSFBuilderBackgroundMode::Starlet) ? m_parameters.layers + 2 : 3;
+        double required = double(images) * sizeof(sample) * 9.0 * backgroundMargin * backgroundMargin;
+        throw Error(String().Format("The tile memory budget is too small for this star size, at least %.0f MiB are required", pcl::Ceil(required / 1048576)));
+    }
+
+    const int columns = (width + core - 1) / core;
+    const int rows = (height + core - 1) / core;
+    std::vector<Tile> tiles;
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < columns; c++)
+            tiles.push_back({ c * core, r * core, Min((c + 1) * core, width), Min((r + 1) * core, height) });
+    m_tiles = int(tiles.size());
+
+    // The tile whose core contains a star position; positions off the image belong to the edge tiles
+    auto owner = [&](double x, double y)
+    {
+        int c = Range(int(pcl::Floor(x)), 0, width - 1) / core;
+        int r = Range(int(pcl::Floor(y)), 0, height - 1) / core;
+        return r * columns + c;
+    };
+
+    EPSFBuilderSpillFile spill;
+
+    // Pass 1: background of each tile, clipped as Step 1 does and written to the spill file
+    double low = std::numeric_limits<double>::max();
+    double high = -std::numeric_limits<double>::max();
+    {
+        EPSFBuilderProfiler::Scope scope("tiles: background");
+        EPSFBuilderBackground background(m_parameters.layers);
+        GenericImage<P> tile;
+        tile.EnableParallelProcessing(image.IsParallelProcessingEnabled(), image.MaxProcessors());
+        std::vector<sample> row(core);
+        for (const Tile& t : tiles)
+        {
+            int x0 = Max(0, t.x0 - backgroundMargin);
+            int y0 = Max(0, t.y0 - backgroundMargin);
+            int x1 = Min(width, t.x1 + backgroundMargin);
+            int y1 = Min(height, t.y1 + backgroundMargin);
+            tile.AllocateData(x1 - x0, y1 - y0);
+            for (int y = y0; y < y1; y++)
+                P::Copy(tile.ScanLine(y - y0), image.PixelAddress(x0, y), x1 - x0);
+
+            ImageVariant variant(&tile);
+            background.Subtract(variant, m_parameters.backgroundMode);
+
+            int n = t.x1 - t.x0;
+            for (int y = t.y0; y < t.y1; y++)
+            {
+                const sample* s = tile.PixelAddress(t.x0 - x0, y - y0);
+                for (int x = 0; x < n; x++)
+                {
+                    row[x] = sample(Range(double(s[x]), -0.001, 1.0));
+                    low = Min(low, double(row[x]));
+                    high = Max(high, double(row[x]));
+                }
+                spill.SetPosition(fpos_type((size_type(y) * width + t.x0) * sizeof(sample)));
+                spill.Write(row.data(), fsize_type(n * sizeof(sample)));
+            }
+        }
+    }
+
+    GenericImage<P> tile;
+    tile.EnableParallelProcessing(image.IsParallelProcessingEnabled(), image.MaxProcessors());
+    int x0, y0;
+
+    // Pass 2: candidates centered on each core, then the brightest of the whole image as Step 4 keeps
+    std::vector<EPSFBuilderStarDetector::Star> candidates;
+    {
+        EPSFBuilderProfiler::Scope scope("tiles: star detection");
+        EPSFBuilderStarDetector detector(m_parameters.fwhm, m_parameters.threshold, m_parameters.peakMax, 0);
+        for (size_type t = 0; t < tiles.size(); t++)
+        {
+            ReadTile(spill, width, height, tiles[t], detectionMargin, low, high, tile, x0, y0);
+            ImageVariant variant(&tile);
+            for (EPSFBuilderStarDetector::Star star : detector.Detect(variant))
+            {
+                star.x += x0;
+                star.y += y0;
+                if (owner(star.x, star.y) == int(t))
+                    candidates.push_back(star);
+            }
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const EPSFBuilderStarDetector::Star& a, const EPSFBuilderStarDetector::Star& b)
+    {
+        return a.convolvedPeak > b.convolvedPeak;
+    });
+    int brightest = m_parameters.maxStars * 3;
+    if (brightest > 0 && candidates.size() > size_type(brightest))
+        candidates.resize(brightest);
+    m_candidates = int(candidates.size());
+    if (candidates.empty())
+        throw Error("No stars detected");
+
+    std::vector<int> candidateTile(candidates.size());
+    std::vector<int> tileCandidates(tiles.size(), 0);
+    for (size_type i = 0; i < candidates.size(); i++)
+        tileCandidates[candidateTile[i] = owner(candidates[i].x, candidates[i].y)]++;
+
+    // Pass 3: isolation of the candidates of each core, tested against every candidate of the tile
+    std::vector<uint8> isolated(candidates.size(), 0);
+    {
+        EPSFBuilderProfiler::Scope scope("tiles: isolation filter");
+        EPSFBuilderIsolationFilter filter(size, m_parameters.fwhm, m_parameters.threshold);
+        for (size_type t = 0; t < tiles.size(); t++)
+        {
+            if (tileCandidates[t] == 0)
+                continue;
+            ReadTile(spill, width, height, tiles[t], detectionMargin, low, high, tile, x0, y0);
+            std::vector<EPSFBuilderStarDetector::Star> local;
+            std::vector<size_type> index;
+            for (size_type i = 0; i < candidates.size(); i++)
+            {
+                EPSFBuilderStarDetector::Star star = candidates[i];
+                star.x -= x0;
+                star.y -= y0;
+                if (star.x >= 0 && star.x < tile.Width() && star.y >= 0 && star.y < tile.Height())
+                {
+                    local.push_back(star);
+                    index.push_back(i);
+                }
+            }
+            ImageVariant variant(&tile);
+            for (int k : filter.Filter(local, variant))
+                if (candidateTile[index[k]] == int(t))
+                    isolated[index[k]] = 1;
+        }
+    }
+
+    // The first maxStars isolated stars in order of brightness whose cutout, placed as the extraction
+    // places it, lies within the image
+    std::vector<size_type> selected;
+    m_isolated = 0;
+    for (size_type i = 0; i < candidates.size(); i++)
+        if (isolated[i])
+        {
+            m_isolated++;
+            int cx = int(pcl::Ceil(candidates[i].x - 0.5 * size));
+            int cy = int(pcl::Ceil(candidates[i].y - 0.5 * size));
+            if (cx >= 0 && cy >= 0 && cx + size <= width && cy + size <= height)
+                if (m_parameters.maxStars <= 0 || int(selected.size()) < m_parameters.maxStars)
+                    selected.push_back(i);
+        }
+    if (selected.empty())
+        throw Error("No isolated stars found");
+
+    // Pass 4: extraction of the selected stars of each core
+    const size_type cutoutSize = size_type(size) * size;
+    result = EPSFBuilderExtraction();
+    result.starCount = int(selected.size());
+    result.cutoutWidth = result.cutoutHeight = size;
+    result.starData.resize(selected.size() * cutoutSize);
+    result.starMeta.resize(5 * selected.size());
+    {
+        EPSFBuilderProfiler::Scope scope("tiles: extraction");
+        EPSFBuilderExtractor extractor(size);
+        EPSFBuilderCentroider centroider(m_parameters.centroidMethod, m_parameters.fwhm);
+        for (size_type t = 0; t < tiles.size(); t++)
+        {
+            std::vector<double> positions;
+            std::vector<size_type> slots;
+            for (size_type s = 0; s < selected.size(); s++)
+                if (candidateTile[selected[s]] == int(t))
+                {
+                    positions.push_back(candidates[selected[s]].x);
+                    positions.push_back(candidates[selected[s]].y);
+                    slots.push_back(s);
+                }
+            if (slots.empty())
+                continue;
+
+            ReadTile(spill, width, height, tiles[t], detectionMargin, low, high, tile, x0, y0);
+            for (size_type k = 0; k < positions.size(); k += 2)
+            {
+                positions[k] -= x0;
+                positions[k + 1] -= y0;
+            }
+            // The margin of a tile exceeds half a centroiding box beyond the cutout of a star
+            if (m_parameters.centroidMethod != EPSFBuilderCentroidMethod::Detector)
+                centroider.Refine(ImageVariant(&tile), positions);
+            EPSFBuilderExtraction part;
+            extractor.Extract(ImageVariant(&tile), positions, 0, part);
+            if (part.starCount != int(slots.size()))
+                throw Error("Tiled star extraction: a cutout crosses the edge of its tile");
+
+            for (size_type k = 0; k < slots.size(); k++)
+            {
+                std::copy(part.starData.begin() + k * cutoutSize, part.starData.begin() + (k + 1) * cutoutSize, result.starData.begin() + slots[k] * cutoutSize);
+                const double* from = part.starMeta.data() + 5 * k;
+                double* to = result.starMeta.data() + 5 * slots[k];
+                to[0] = from[0] + x0;
+                to[1] = from[1] + y0;
+                to[2] = from[2] + x0;
+                to[3] = from[3] + y0;
+                to[4] = from[4];
+            }
+        }
+    }
+}
+
+template <class P>
+void EPSFBuilderTiler::ReadTile(File& spill, int width, int height, const Tile& tile, int margin, double low, double high, GenericImage<P>& image, int& x0, int& y0) const
+{
+    typedef typename P::sample sample;
+
+    x0 = Max(0, tile.x0 - margin);
+    y0 = Max(0, tile.y0 - margin);
+    int x1 = Min(width, tile.x1 + margin);
+    int y1 = Min(height, tile.y1 + margin);
+    int n = x1 - x0;
+    double scale = (high > low) ? 1 / (high - low) : 0.0;
+
+    image.AllocateData(n, y1 - y0);
+    for (int y = y0; y < y1; y++)
+    {
+        sample* row = image.ScanLine(y - y0);
+        spill.SetPosition(fpos_type((size_type(y) * width + x0) * sizeof(sample)));
+        spill.Read(row, fsize_type(n * sizeof(sample)));
+        for (int x = 0; x < n; x++)
+            row[x] = sample((row[x] - low) * scale);
+    }
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef __EPSFBuilderTiler_h
+#define __EPSFBuilderTiler_h
+
+#include <vector>
+#include <pcl/File.h>
+#include <pcl/ImageVariant.h>
+
+#include "EPSFBuilderPython.h"
+#include "EPSFBuilderStarDetector.h"
+
+namespace pcl
+{
+
+// Steps 1 to 6 over overlapping tiles, for images too large to be processed as a whole. The image is
+// divided into a grid of cores; every tile is a core plus a margin, and only the stars centered on
+// its core are kept, so the catalogs of adjacent tiles never share a star. The work runs in passes:
+//
+//   1. background removal of each tile, with a margin of EPSFBuilderBackground::Radius(); the cores
+//      are written to a temporary file, and their extremes give the global rescaling of Step 1
+//   2. star detection on each tile read back from that file, with a margin wide enough for the
+//      detection kernel and the cutout of a star; the brightest candidates of all tiles are kept
+//   3. isolation filter of the candidates of each core, against every candidate of the tile
+//   4. extraction of the selected stars of each core
+//
+// Only one tile is held in memory at a time, so peak memory is set by the tile size, which is derived
+// from the memory budget, and not by the size of the image. Except for the multiresolution background,
+// which downsamples each tile on its own grid, the result is the one obtained on the whole image.
+
+class EPSFBuilderTiler
+{
+public:
+    struct Parameters
+    {
+        pcl_enum backgroundMode;
+        int layers;         // of the starlet transform of Step 1
+        double fwhm;
+        double threshold;
+        double peakMax;
+        int maxStars;
+        int cutoutSize;
+        pcl_enum centroidMethod;    // applied to the selected stars before their extraction
+    };
+
+    // memoryBudget is the memory in bytes that may be held by one tile and its work images
+    EPSFBuilderTiler(const Parameters& parameters, size_type memoryBudget);
+
+    // Runs Steps 1 to 6 on the first channel of image, with the native detection and extraction
+    void Extract(const ImageVariant& image, EPSFBuilderExtraction& result);
+
+    // Width and height of the cores, for an image with the given sample size
+    int CoreSize(int bytesPerSample) const;
+
+    int Tiles() const
+    {
+        return m_tiles;
+    }
+
+    int Candidates() const
+    {
+        return m_candidates;
+    }
+
+    int Isolated() const
+    {
+        return m_isolated;
+    }
+
+private:
+    struct Tile
+    {
+        int x0, y0, x1, y1;         // core
+    };
+
+    Parameters m_parameters;
+    size_type m_memoryBudget;
+    int m_tiles = 0;
+    int m_candidates = 0;
+    int m_isolated = 0;
+
+    int BackgroundMargin() const;
+    int DetectionMargin() const;
+
+    template <class P>
+    void ExtractImage(const GenericImage<P>& image, EPSFBuilderExtraction& result);
+
+    // Reads the region of the spill file around a core, rescaled to [0,1]
+    template <class P>
+    void ReadTile(File& spill, int width, int height, const Tile& tile, int margin, double low, double high, GenericImage<P>& image, int& x0, int& y0) const;
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderTiler_h
\ No newline at end of file
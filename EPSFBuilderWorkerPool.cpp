@@ -0,0 +1,424 @@
+#include <cstring>
+#include <pcl/File.h>
+#include <pcl/Thread.h>
+
+#include "EPSFBuilderWorkerPool.h"
+
+namespace pcl
+{
+
+// Worker main loop. A request is one line of key=value pairs naming the input and output segments;
+// the reply is "OK <id> <stars> <cutout width> <cutout height> <ePSF width> <ePSF height>" or
+// "ERR <id> <message>".
+static const char* s_workerScript =
+    "import os\n"
+    "import sys\n"
+    "import traceback\n"
+    "from multiprocessing import shared_memory\n"
+    "\n"
+    "stub = '--stub' in sys.argv[1:]\n"
+    "if not stub:\n"
+    "    import numpy as np\n"
+    "    from astropy.nddata import NDData\n"
+    "    from astropy.table import Table\n"
+    "    from photutils.detection import DAOStarFinder\n"
+    "    from photutils.psf import EPSFBuilder, EPSFStars, extract_stars\n"
+    "\n"
+    "# Replies go to the original stdout, anything printed by the libraries goes to stderr\n"
+    "reply = sys.stdout\n"
+    "sys.stdout = sys.stderr\n"
+    "\n"
+    "def attach(name):\n"
+    "    shm = shared_memory.SharedMemory(name = name)\n"
+    "    if os.name == 'posix':\n"
+    "        try:\n"
+    "            from multiprocessing import resource_tracker\n"
+    "            resource_tracker.unregister(shm._name, 'shared_memory')\n"
+    "        except Exception:\n"
+    "            pass\n"
+    "    return shm\n"
+    "\n"
+    "def run(task, src, dst):\n"
+    "    w, h = int(task['width']), int(task['height'])\n"
+    "    size, max_stars = int(task['size']), int(task['max_stars'])\n"
+    "    n_pos, pos_offset = int(task['n_positions']), int(task['positions_offset'])\n"
+    "    meta_offset, epsf_offset = int(task['meta_offset']), int(task['epsf_offset'])\n"
+    "    data = np.ndarray((h, w), dtype = task['dtype'], buffer = src.buf)\n"
+    "    if task['detect'] == '1':\n"
+    "        daofind = DAOStarFinder(fwhm = float(task['fwhm']), threshold = float(task['threshold']), peakmax = float(task['peakmax']), brightest = int(task['brightest']))\n"
+    "        sources = daofind(data)\n"
+    "        if sources is None:\n"
+    "            raise RuntimeError('No stars detected')\n"
+    "        starpos = np.transpose((sources['xcentroid'], sources['ycentroid']))\n"
+    "    else:\n"
+    "        starpos = np.ndarray((n_pos, 2), dtype = np.float64, buffer = src.buf, offset = pos_offset).copy()\n"
+    "    stars_tbl = Table()\n"
+    "    stars_tbl['x'] = starpos[:, 0]\n"
+    "    stars_tbl['y'] = starpos[:, 1]\n"
+    "    stars = extract_stars(NDData(data = data), stars_tbl, size = size)\n"
+    "    if task['isolate'] == '1':\n"
+    "        daofind = DAOStarFinder(fwhm = float(task['fwhm']), threshold = float(task['threshold']), brightest = 2)\n"
+    "        good_stars = []\n"
+    "        for star in stars.all_stars:\n"
+    "            sources = daofind(star.data)\n"
+    "            if not (sources is None) and (sources['id'].size == 1):\n"
+    "                good_stars.append(star)\n"
+    "        stars = EPSFStars(good_stars)\n"
+    "    n_stars = min(stars.n_stars, max_stars)\n"
+    "    if n_stars < 1:\n"
+    "        raise RuntimeError('No isolated stars found')\n"
+    "    cutout_height, cutout_width = stars.all_stars[0].data.shape\n"
+    "    if cutout_height * cutout_width > size * size:\n"
+    "        raise RuntimeError('Star cutouts larger than the output segment')\n"
+    "    star_data = np.ndarray((n_stars, cutout_height, cutout_width), dtype = np.float64, buffer = dst.buf)\n"
+    "    star_meta = np.ndarray((n_stars, 5), dtype = np.float64, buffer = dst.buf, offset = meta_offset)\n"
+    "    for i in range(n_stars):\n"
+    "        star = stars.all_stars[i]\n"
+    "        star_data[i] = star.data\n"
+    "        star_meta[i] = (star.origin[0], star.origin[1], star.center[0], star.center[1], star.flux)\n"
+    "    del star_data, star_meta\n"
+    "    epsf_height, epsf_width = 0, 0\n"
+    "    if task['fit'] == '1':\n"
+    "        epsf_builder = EPSFBuilder(oversampling = int(task['oversampling']), maxiters = int(task['maxiters']), smoothing_kernel = task['smoothing'])\n"
+    "        epsf, fitted_stars = epsf_builder(stars)\n"
+    "        epsf_height, epsf_width = epsf.data.shape\n"
+    "        if epsf_height * epsf_width > int(task['epsf_capacity']):\n"
+    "            raise RuntimeError('ePSF larger than the output segment')\n"
+    "        np.ndarray((epsf_height, epsf_width), dtype = np.float64, buffer = dst.buf, offset = epsf_offset)[:] = epsf.data\n"
+    "    return n_stars, cutout_width, cutout_height, epsf_width, epsf_height\n"
+    "\n"
+    "def run_stub(task, src, dst):\n"
+    "    # Stand-in for testing the transport without the scientific stack: plain cutouts around the\n"
+    "    # given positions and no ePSF fitting\n"
+    "    if task['detect'] == '1' or task['fit'] == '1':\n"
+    "        raise RuntimeError('The stand-in worker only supports the native detection and fitting engines')\n"
+    "    w, h = int(task['width']), int(task['height'])\n"
+    "    size, max_stars = int(task['size']), int(task['max_stars'])\n"
+    "    n_pos, pos_offset = int(task['n_positions']), int(task['positions_offset'])\n"
+    "    meta_offset = int(task['meta_offset'])\n"
+    "    data = src.buf[:w * h * (4 if task['dtype'] == 'float32' else 8)].cast('f' if task['dtype'] == 'float32' else 'd')\n"
+    "    starpos = src.buf[pos_offset:pos_offset + n_pos * 16].cast('d')\n"
+    "    star_data = dst.buf[:meta_offset].cast('d')\n"
+    "    star_meta = dst.buf[meta_offset:meta_offset + max_stars * 40].cast('d')\n"
+    "    n_stars = 0\n"
+    "    for i in range(n_pos):\n"
+    "        if n_stars == max_stars:\n"
+    "            break\n"
+    "        x, y = starpos[2 * i], starpos[2 * i + 1]\n"
+    "        x0, y0 = int(x + 0.5) - size // 2, int(y + 0.5) - size // 2\n"
+    "        if x0 < 0 or y0 < 0 or x0 + size > w or y0 + size > h:\n"
+    "            continue\n"
+    "        k = n_stars * size * size\n"
+    "        flux = 0.0\n"
+    "        for r in range(size):\n"
+    "            row = (y0 + r) * w + x0\n"
+    "            for c in range(size):\n"
+    "                v = data[row + c]\n"
+    "                star_data[k] = v\n"
+    "                flux += v\n"
+    "                k += 1\n"
+    "        star_meta[5 * n_stars] = x0\n"
+    "        star_meta[5 * n_stars + 1] = y0\n"
+    "        star_meta[5 * n_stars + 2] = x\n"
+    "        star_meta[5 * n_stars + 3] = y\n"
+    "        star_meta[5 * n_stars + 4] = flux\n"
+    "        n_stars += 1\n"
+    "    data.release()\n"
+    "    starpos.release()\n"
+    "    star_data.release()\n"
+    "    star_meta.release()\n"
+    "    if n_stars < 1:\n"
+    "        raise RuntimeError('No isolated stars found')\n"
+    "    return n_stars, size, size, 0, 0\n"
+    "\n"
+    "for line in sys.stdin:\n"
+    "    line = line.strip()\n"
+    "    if not line:\n"
+    "        continue\n"
+    "    task = dict(item.split('=', 1) for item in line.split())\n"
+    "    src = dst = None\n"
+    "    try:\n"
+    "        src = attach(task['input'])\n"
+    "        dst = attach(task['output'])\n"
+    "        result = (run_stub if stub else run)(task, src, dst)\n"
+    "        reply.write('OK %s %d %d %d %d %d\\n' % ((task['id'],) + result))\n"
+    "    except Exception as e:\n"
+    "        traceback.print_exc()\n"
+    "        reply.write('ERR %s %s\\n' % (task.get('id', '-1'), ' '.join(str(e).split()) or type(e).__name__))\n"
+    "    finally:\n"
+    "        for shm in (src, dst):\n"
+    "            if shm is not None:\n"
+    "                try:\n"
+    "                    shm.close()\n"
+    "                except BufferError:\n"
+    "                    pass\n"
+    "    reply.flush()\n";
+
+static EPSFBuilderWorkerPool* s_pool = nullptr;
+
+// The interpreter of the installation that provides pythonDll. On Windows it sits next to the DLL;
+// elsewhere libpythonX.Y in <prefix>/lib belongs to <prefix>/bin/pythonX.Y, and pythonX.Y is looked
+// up in PATH for layouts where it is not there, so that at least the version matches.
+static String PythonExecutable(const String& pythonDll)
+{
+    const String directory = File::ExtractDrive(pythonDll) + File::ExtractDirectory(pythonDll);
+#ifdef __PCL_WINDOWS
+    return directory + "/python.exe";
+#else
+    String name = File::ExtractNameAndSuffix(pythonDll);
+    String version;
+    if (name.StartsWith("libpython"))
+        for (size_type i = 9; i < name.Length() && (name[i] == '.' || (name[i] >= '0' && name[i] <= '9')); i++)
+            version += name[i];
+    while (version.EndsWith('.'))
+        version.DeleteRight(version.Length() - 1);
+    String executable = "python" + (version.IsEmpty() ? String("3") : version);
+    if (!directory.IsEmpty())
+        for (const String& candidate : { directory + "/../bin/" + executable, directory + "/" + executable })
+            if (File::Exists(candidate))
+                return candidate;
+    return executable;
+#endif
+}
+
+EPSFBuilderWorkerPool& EPSFBuilderWorkerPool::Acquire(const String& pythonDll, int workerCount)
+{
+    if (s_pool == nullptr || s_pool->m_pythonDll != pythonDll || s_pool->Size() != workerCount)
+    {
+        if (s_pool != nullptr)
+            delete s_pool, s_pool = nullptr;
+        s_pool = new EPSFBuilderWorkerPool(pythonDll, workerCount);
+    }
+    return *s_pool;
+}
+
+EPSFBuilderWorkerPool::EPSFBuilderWorkerPool(const String& pythonDll, int workerCount)
+    : m_pythonDll(pythonDll)
+    , m_stub(EPSFBuilderStubWorkers())
+{
+    m_pythonExe = PythonExecutable(pythonDll);
+
+    // A private copy of the script for every pool, removed with it
+    m_scriptPath = File::UniqueFileName(File::SystemTempDirectory(), 12, "EPSFBuilderWorker_", ".py");
+    File::WriteTextFile(m_scriptPath, IsoString(s_workerScript));
+
+    // Start all workers now, so that the imports are done by the time the first task arrives
+    try
+    {
+        for (int i = 0; i < workerCount; i++)
+        {
+            m_workers.Add(new Worker);
+            Start(m_workers[i]);
+        }
+    }
+    catch (...)
+    {
+        File::Remove(m_scriptPath);
+        throw;
+    }
+}
+
+EPSFBuilderWorkerPool::~EPSFBuilderWorkerPool()
+{
+    // Workers exit when their standard input is closed
+    for (Worker& worker : m_workers)
+        if (worker.process.IsRunning())
+        {
+            worker.process.CloseStandardInput();
+            if (!worker.process.WaitForFinished(2000))
+                worker.process.Kill();
+        }
+    m_workers.Destroy();
+
+    try
+    {
+        File::Remove(m_scriptPath);
+    }
+    catch (...)
+    {
+    }
+}
+
+void EPSFBuilderWorkerPool::Start(Worker& worker)
+{
+    StringList arguments;
+    arguments << "-u" << m_scriptPath;
+    if (m_stub)
+        arguments << "--stub";
+    worker.reply.Clear();
+    worker.log.Clear();
+    worker.process.Start(m_pythonExe, arguments);
+    if (!worker.process.WaitForStarted())
+        throw Error("Unable to start Python worker: " + m_pythonExe);
+}
+
+void EPSFBuilderWorkerPool::Stop(Worker& worker)
+{
+    if (worker.process.IsRunning())
+    {
+        worker.process.Kill();
+        worker.process.WaitForFinished(2000);
+    }
+    worker.ticket = -1;
+    worker.input.Destroy();
+    worker.output.Destroy();
+}
+
+bool EPSFBuilderWorkerPool::HasIdleWorker() const
+{
+    for (const Worker& worker : m_workers)
+        if (worker.ticket < 0)
+            return true;
+    return false;
+}
+
+int EPSFBuilderWorkerPool::Submit(const EPSFBuilderPythonTask& task, const ImageVariant& image)
+{
+    for (Worker& worker : m_workers)
+        if (worker.ticket < 0)
+        {
+            if (!worker.process.IsRunning())
+                Start(worker);
+
+            // Input segment: the pixels, then the detected positions on an 8-byte boundary
+            size_type imageBytes = image.NumberOfPixels() * image.BytesPerSample();
+            size_type positionsOffset = (imageBytes + 7) & ~size_type(7);
+            worker.input = new EPSFBuilderSharedMemory(positionsOffset + task.positions.size() * sizeof(double));
+            const void* pixels = (image.BitsPerSample() == 32) ? (const void*)static_cast<const Image&>(*image)[0] : (const void*)static_cast<const DImage&>(*image)[0];
+            uint8* input = static_cast<uint8*>(worker.input->Data());
+            ::memcpy(input, pixels, imageBytes);
+            if (!task.positions.empty())
+                ::memcpy(input + positionsOffset, task.positions.data(), task.positions.size() * sizeof(double));
+
+            // Output segment: the cutouts, their metadata and the oversampled ePSF, sized for the
+            // largest possible result. The worker fails the task rather than write past them.
+            size_type cutoutSize = size_type(task.cutoutSize) * task.cutoutSize;
+            size_type epsfSize = task.fit ? size_type(task.cutoutSize * task.oversampling + 1) * (task.cutoutSize * task.oversampling + 1) : 0;
+            worker.maxStars = task.maxStars;
+            worker.cutoutCapacity = cutoutSize;
+            worker.epsfCapacity = epsfSize;
+            worker.metaOffset = task.maxStars * cutoutSize * sizeof(double);
+            worker.epsfOffset = worker.metaOffset + task.maxStars * 5 * sizeof(double);
+            worker.output = new EPSFBuilderSharedMemory(worker.epsfOffset + epsfSize * sizeof(double));
+
+            worker.ticket = m_nextTicket++;
+            IsoString request = IsoString().Format("id=%d input=%s output=%s width=%d height=%d dtype=%s positions_offset=%llu n_positions=%d ",
+                worker.ticket, worker.input->Name().c_str(), worker.output->Name().c_str(), image.Width(), image.Height(),
+                (image.BitsPerSample() == 32) ? "float32" : "float64", (unsigned long long)positionsOffset, int(task.positions.size() / 2));
+            request.AppendFormat("detect=%d fwhm=%.10g threshold=%.10g peakmax=%.10g brightest=%d max_stars=%d size=%d isolate=%d ",
+                task.detect ? 1 : 0, task.fwhm, task.threshold, task.peakMax, task.brightest, task.maxStars, task.cutoutSize, task.isolate ? 1 : 0);
+            request.AppendFormat("fit=%d oversampling=%d maxiters=%d smoothing=%s meta_offset=%llu epsf_offset=%llu epsf_capacity=%llu\n",
+                task.fit ? 1 : 0, task.oversampling, task.maxIterations, task.smoothingKernel,
+                (unsigned long long)worker.metaOffset, (unsigned long long)worker.epsfOffset, (unsigned long long)epsfSize);
+            worker.process.Write(request);
+            return worker.ticket;
+        }
+
+    throw Error("No idle Python worker");
+}
+
+int EPSFBuilderWorkerPool::Poll(Worker& worker, EPSFBuilderExtraction& result, String& errorMessage)
+{
+    // Checked before reading, so that all the output of a finished worker has been received
+    bool running = worker.process.IsRunning();
+
+    ByteArray err = worker.process.StandardError();
+    if (!err.IsEmpty())
+    {
+        worker.log.Append(reinterpret_cast<const char*>(err.Begin()), err.Length());
+        if (worker.log.Length() > 4096)
+            worker.log = worker.log.Right(4096);
+    }
+
+    ByteArray out = worker.process.StandardOutput();
+    if (!out.IsEmpty())
+        worker.reply.Append(reinterpret_cast<const char*>(out.Begin()), out.Length());
+
+    int ticket = worker.ticket;
+    size_type eol = worker.reply.Find('\n');
+    if (eol == IsoString::notFound)
+    {
+        if (running)
+            return -1;
+
+        // The worker crashed; it is restarted with the next submission
+        errorMessage = "Python worker terminated unexpectedly";
+        if (!worker.log.Trimmed().IsEmpty())
+            errorMessage += ": " + String(worker.log.Trimmed());
+        Stop(worker);
+        return ticket;
+    }
+
+    IsoString line = worker.reply.Left(eol).Trimmed();
+    worker.reply.DeleteLeft(eol + 1);
+
+    IsoStringList tokens;
+    line.Break(tokens, ' ', true);
+    if (tokens.Length() == 7 && tokens[0] == "OK" && tokens[1].ToInt() == ticket)
+    {
+        result.starCount = tokens[2].ToInt();
+        result.cutoutWidth = tokens[3].ToInt();
+        result.cutoutHeight = tokens[4].ToInt();
+        result.epsfWidth = tokens[5].ToInt();
+        result.epsfHeight = tokens[6].ToInt();
+
+        // The reply must fit the segments sized by Submit()
+        if (result.starCount < 0 || result.starCount > worker.maxStars ||
+            result.cutoutWidth < 0 || result.cutoutHeight < 0 || size_type(result.cutoutWidth) * result.cutoutHeight > worker.cutoutCapacity ||
+            result.epsfWidth < 0 || result.epsfHeight < 0 || size_type(result.epsfWidth) * result.epsfHeight > worker.epsfCapacity)
+        {
+            errorMessage = "Invalid reply from Python worker: " + String(line);
+            Stop(worker);
+            return ticket;
+        }
+
+        const uint8* output = static_cast<const uint8*>(worker.output->Data());
+        const double* starData = reinterpret_cast<const double*>(output);
+        const double* starMeta = reinterpret_cast<const double*>(output + worker.metaOffset);
+        const double* epsfData = reinterpret_cast<const double*>(output + worker.epsfOffset);
+        result.starData.assign(starData, starData + size_type(result.starCount) * result.cutoutWidth * result.cutoutHeight);
+        result.starMeta.assign(starMeta, starMeta + size_type(result.starCount) * 5);
+        result.epsfData.assign(epsfData, epsfData + size_type(result.epsfWidth) * result.epsfHeight);
+    }
+    else if (tokens.Length() >= 2 && tokens[0] == "ERR")
+    {
+        size_type p = line.Find(' ', 4);
+        errorMessage = (p == IsoString::notFound) ? String("Python worker error") : String(line.Substring(p + 1));
+    }
+    else
+        errorMessage = "Invalid reply from Python worker: " + String(line);
+
+    worker.ticket = -1;
+    worker.log.Clear();
+    worker.input.Destroy();
+    worker.output.Destroy();
+    return ticket;
+}
+
+int EPSFBuilderWorkerPool::WaitForAny(unsigned ms, EPSFBuilderExtraction& result, String& errorMessage)
+{
+    for (unsigned elapsed = 0;; elapsed += 10)
+    {
+        bool busy = false;
+        for (Worker& worker : m_workers)
+            if (worker.ticket >= 0)
+            {
+                busy = true;
+                int ticket = Poll(worker, result, errorMessage);
+                if (ticket >= 0)
+                    return ticket;
+            }
+        if (!busy || elapsed >= ms)
+            return -1;
+        pcl::Sleep(10);
+    }
+}
+
+void EPSFBuilderWorkerPool::Cancel()
+{
+    for (Worker& worker : m_workers)
+        if (worker.ticket >= 0)
+            Stop(worker);
+}
+
+}	// namespace pcl
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef __EPSFBuilderWorkerPool_h
+#define __EPSFBuilderWorkerPool_h
+
+#include <pcl/AutoPointer.h>
+#include <pcl/ExternalProcess.h>
+#include <pcl/ReferenceArray.h>
+
+#include "EPSFBuilderPython.h"
+#include "EPSFBuilderSharedMemory.h"
+
+namespace pcl
+{
+
+// Pool of persistent Python worker processes with the scientific stack preloaded. Each worker runs
+// one EPSFBuilderPythonTask at a time; the image and the results travel through shared memory
+// segments and only a one-line request and reply go through the process pipes. A worker that
+// crashes fails its task and is restarted, the PixInsight process is never affected.
+//
+// The pool must be driven from the main thread.
+
+class EPSFBuilderWorkerPool
+{
+public:
+    // Returns the shared pool, (re)starting it when the configuration changes. The Python
+    // executable is the one of the installation that provides pythonDll. The workers are stand-ins
+    // when EPSFBuilderStubWorkers() is set.
+    static EPSFBuilderWorkerPool& Acquire(const String& pythonDll, int workerCount);
+
+    int Size() const
+    {
+        return int(m_workers.Length());
+    }
+
+    bool HasIdleWorker() const;
+
+    // Copies image to a shared memory segment and sends the task to an idle worker. Returns the
+    // ticket that identifies the task in WaitForAny().
+    int Submit(const EPSFBuilderPythonTask& task, const ImageVariant& image);
+
+    // Waits up to ms milliseconds for a submitted task to finish. Returns its ticket, or -1 if no
+    // task finished. On failure of the task, errorMessage is not empty.
+    int WaitForAny(unsigned ms, EPSFBuilderExtraction& result, String& errorMessage);
+
+    // Kills the workers that are running a task; they are restarted on the next submission
+    void Cancel();
+
+private:
+    struct Worker
+    {
+        ExternalProcess process;
+        int ticket = -1;    // -1 if idle
+        IsoString reply;    // stdout received so far
+        IsoString log;      // tail of stderr, reported if the worker dies
+        AutoPointer<EPSFBuilderSharedMemory> input;
+        AutoPointer<EPSFBuilderSharedMemory> output;
+        size_type metaOffset = 0;
+        size_type epsfOffset = 0;
+        int maxStars = 0;               // capacity of the output segment
+        size_type cutoutCapacity = 0;   // pixels per cutout
+        size_type epsfCapacity = 0;     // ePSF pixels
+    };
+
+    String m_pythonDll;
+    String m_pythonExe;
+    String m_scriptPath;
+    bool m_stub = false;
+    int m_nextTicket = 0;
+    ReferenceArray<Worker> m_workers;
+
+    EPSFBuilderWorkerPool(const String& pythonDll, int workerCount);
+    ~EPSFBuilderWorkerPool();
+
+    void Start(Worker& worker);
+    void Stop(Worker& worker);
+    int Poll(Worker& worker, EPSFBuilderExtraction& result, String& errorMessage);
+};
+
+}	// namespace pcl
+
+#endif	// __EPSFBuilderWorkerPool_h
\ No newline at end of file
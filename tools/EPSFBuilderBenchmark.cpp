@@ -0,0 +1,582 @@
+// Standalone benchmark of the native ePSF pipeline on synthetic star fields with a known PSF. Every
+// stage is timed over several repetitions, the best time is reported together with its throughput,
+// and the ePSF is compared with the true pixel-integrated PSF. The background subtracted by the
+// streaming mode is compared with that of the full starlet transform in both floating point sample
+// types. The candidate list of the native detector is always compared with that of a plain
+// transcription of photutils DAOStarFinder on the background-subtracted field, and with --python
+// also with that of photutils itself, unless EPSFBUILDER_STUB_WORKERS says that the Python
+// installation is a stand-in without the scientific stack; the exit code is 2 if the lists differ
+// by more than --match-radius pixels. make check runs this comparison on a small field.
+//
+//   EPSFBuilderBenchmark [--width=N] [--height=N] [--density=stars per megapixel] [--noise=sigma]
+//                        [--fwhm=pixels] [--seed=N] [--max-stars=N] [--threshold=value]
+//                        [--star-size=pixels] [--oversampling=N] [--iterations=N]
+//                        [--background=starlet|streaming|multiresolution] [--repeat=N]
+//                        [--centroid=moments|marginal-gaussian|iterative-weighted]
+//                        [--python=libpython path] [--match-radius=pixels]
+//
+// Built by linux/g++/makefile with __EPSFBUILDER_STANDALONE; it does not need PixInsight.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <pcl/ImageVariant.h>
+#include <pcl/Math.h>
+#include <pcl/Point.h>
+
+#include "../EPSFBuilderBackground.h"
+#include "../EPSFBuilderCentroider.h"
+#include "../EPSFBuilderExtractor.h"
+#include "../EPSFBuilderFitter.h"
+#include "../EPSFBuilderIsolationFilter.h"
+#include "../EPSFBuilderParameters.h"
+#include "../EPSFBuilderPython.h"
+#include "../EPSFBuilderStarArena.h"
+#include "../EPSFBuilderStarDetector.h"
+#include "../EPSFBuilderSynthetic.h"
+
+using namespace pcl;
+
+struct Options
+{
+    EPSFBuilderSynthetic::Parameters field;
+    int maxStars = 100;
+    double threshold = 0.01;
+    double peakMax = 0.7;
+    int starSize = 45;
+    int oversampling = 2;
+    int iterations = 5;
+    pcl_enum background = EPSFBuilderBackgroundMode::Streaming;
+    pcl_enum centroid = EPSFBuilderCentroidMethod::IterativeWeighted;
+    int repeat = 3;
+    String pythonDll;
+    double matchRadius = 0.1;
+};
+
+static bool Match(const char* arg, const char* name, const char*& value)
+{
+    size_t n = strlen(name);
+    if (strncmp(arg, name, n) != 0 || arg[n] != '=')
+        return false;
+    value = arg + n + 1;
+    return true;
+}
+
+static Options ParseArguments(int argc, char** argv)
+{
+    Options o;
+    for (int i = 1; i < argc; i++)
+    {
+        const char* v;
+        if (Match(argv[i], "--width", v))
+            o.field.width = atoi(v);
+        else if (Match(argv[i], "--height", v))
+            o.field.height = atoi(v);
+        else if (Match(argv[i], "--density", v))
+            o.field.density = atof(v);
+        else if (Match(argv[i], "--noise", v))
+            o.field.noise = atof(v);
+        else if (Match(argv[i], "--fwhm", v))
+            o.field.fwhm = atof(v);
+        else if (Match(argv[i], "--seed", v))
+            o.field.seed = strtoull(v, nullptr, 10);
+        else if (Match(argv[i], "--max-stars", v))
+            o.maxStars = atoi(v);
+        else if (Match(argv[i], "--threshold", v))
+            o.threshold = atof(v);
+        else if (Match(argv[i], "--star-size", v))
+            o.starSize = atoi(v);
+        else if (Match(argv[i], "--oversampling", v))
+            o.oversampling = atoi(v);
+        else if (Match(argv[i], "--iterations", v))
+            o.iterations = atoi(v);
+        else if (Match(argv[i], "--repeat", v))
+            o.repeat = Max(1, atoi(v));
+        else if (Match(argv[i], "--python", v))
+            o.pythonDll = String::UTF8ToUTF16(v);
+        else if (Match(argv[i], "--match-radius", v))
+            o.matchRadius = atof(v);
+        else if (Match(argv[i], "--background", v))
+        {
+            if (strcmp(v, "starlet") == 0)
+                o.background = EPSFBuilderBackgroundMode::Starlet;
+            else if (strcmp(v, "multiresolution") == 0)
+                o.background = EPSFBuilderBackgroundMode::Multiresolution;
+            else if (strcmp(v, "streaming") == 0)
+                o.background = EPSFBuilderBackgroundMode::Streaming;
+            else
+                throw Error("Unknown background mode: " + String(v));
+        }
+        else if (Match(argv[i], "--centroid", v))
+        {
+            if (strcmp(v, "moments") == 0)
+                o.centroid = EPSFBuilderCentroidMethod::Moments;
+            else if (strcmp(v, "marginal-gaussian") == 0)
+                o.centroid = EPSFBuilderCentroidMethod::MarginalGaussian;
+            else if (strcmp(v, "iterative-weighted") == 0)
+                o.centroid = EPSFBuilderCentroidMethod::IterativeWeighted;
+            else
+                throw Error("Unknown centroiding method: " + String(v));
+        }
+        else
+            throw Error("Unknown argument: " + String(argv[i]));
+    }
+    if (o.field.width < 64 || o.field.height < 64)
+        throw Error("The image must be at least 64x64 pixels");
+    return o;
+}
+
+template <class F>
+static double Seconds(const F& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Largest absolute difference between the backgrounds subtracted by the streaming and starlet modes
+// from copies of frame with the sample type of P
+template <class P>
+static double BackgroundDeviation(const Image& frame, int layers)
+{
+    GenericImage<P> streaming, starlet;
+    streaming.DisableParallelProcessing();
+    starlet.DisableParallelProcessing();
+    streaming.Assign(frame);
+    starlet.Assign(frame);
+    ImageVariant streamingImage(&streaming);
+    ImageVariant starletImage(&starlet);
+    EPSFBuilderBackground background(layers);
+    background.Subtract(streamingImage, EPSFBuilderBackgroundMode::Streaming);
+    background.Subtract(starletImage, EPSFBuilderBackgroundMode::Starlet);
+    double deviation = 0;
+    const typename P::sample* a = streaming[0];
+    const typename P::sample* b = starlet[0];
+    for (size_type i = 0, n = streaming.NumberOfPixels(); i < n; i++)
+        deviation = Max(deviation, Abs(double(a[i]) - double(b[i])));
+    return deviation;
+}
+
+// photutils DAOStarFinder transcribed array by array, with none of the optimizations of
+// EPSFBuilderStarDetector: _StarFinderKernel, the zero-padded scipy.ndimage convolution accumulated
+// in double, the maximum filter of find_peaks over the kernel footprint, then the properties and
+// filters of _DAOStarFinderCatalog. Returns the x, y pairs of every candidate, without a brightest
+// limit, in the order of find_peaks.
+static std::vector<double> ReferenceCandidates(const Image& image, double fwhm, double threshold, double peakMax)
+{
+    // _StarFinderKernel with ratio = 1, theta = 0 and sigma_radius = 1.5
+    const double sigma = fwhm * 0.42466090014400953;
+    const double a = 1 / (2 * sigma * sigma);
+    const double c = a;
+    const double f = 1.5 * 1.5 / 2;
+    const int nx = 2 * int(Max(2.0, Sqrt(c * f / (a * c)))) + 1;
+    const int ny = 2 * int(Max(2.0, Sqrt(a * f / (a * c)))) + 1;
+    const int xc = nx / 2;
+    const int yc = ny / 2;
+    std::vector<double> unmasked(size_type(nx) * ny), kernel(size_type(nx) * ny);
+    std::vector<int> mask(size_type(nx) * ny);
+    int npixels = 0;
+    double gaussianSum = 0, gaussian2Sum = 0;
+    for (int y = 0, k = 0; y < ny; y++)
+        for (int x = 0; x < nx; x++, k++)
+        {
+            double ellipticalRadius = a * (x - xc) * (x - xc) + c * (y - yc) * (y - yc);
+            double circularRadius = Sqrt(double((x - xc) * (x - xc) + (y - yc) * (y - yc)));
+            mask[k] = (ellipticalRadius <= f || circularRadius <= 2.0) ? 1 : 0;
+            unmasked[k] = Exp(-ellipticalRadius);
+            double gaussian = unmasked[k] * mask[k];
+            npixels += mask[k];
+            gaussianSum += gaussian;
+            gaussian2Sum += gaussian * gaussian;
+        }
+    const double denom = gaussian2Sum - gaussianSum * gaussianSum / npixels;
+    for (size_type k = 0; k < kernel.size(); k++)
+        kernel[k] = (unmasked[k] * mask[k] - gaussianSum / npixels) / denom * mask[k];
+    const double thresholdEff = threshold / Sqrt(denom);
+
+    const int width = image.Width();
+    const int height = image.Height();
+    const float* data = image[0];
+    auto pixel = [&](const float* p, int x, int y) -> double
+    {
+        return (x >= 0 && x < width && y >= 0 && y < height) ? double(p[size_type(y) * width + x]) : 0.0;
+    };
+
+    // scipy.ndimage.convolve, mode = 'constant': the output has the type of the input
+    std::vector<float> convolved(size_type(width) * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            double sum = 0;
+            for (int ky = 0; ky < ny; ky++)
+                for (int kx = 0; kx < nx; kx++)
+                    sum += kernel[size_type(ky) * nx + kx] * pixel(data, x - (kx - xc), y - (ky - yc));
+            convolved[size_type(y) * width + x] = float(sum);
+        }
+
+    // find_peaks: data == maximum_filter(data, footprint = mask, cval = 0) and data > threshold
+    std::vector<Point> peaks;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            double value = convolved[size_type(y) * width + x];
+            if (!(value > thresholdEff))
+                continue;
+            double maximum = -std::numeric_limits<double>::infinity();
+            for (int ky = 0; ky < ny; ky++)
+                for (int kx = 0; kx < nx; kx++)
+                    if (mask[size_type(ky) * nx + kx])
+                        maximum = Max(maximum, pixel(convolved.data(), x + kx - xc, y + ky - yc));
+            if (value == maximum)
+                peaks.push_back(Point(x, y));
+        }
+
+    // daofind_marginal_fit along one axis of cutout; false where photutils sets NaN
+    auto marginalFit = [&](const std::vector<double>& cutout, bool alongX, double& shift, double& amplitude) -> bool
+    {
+        const int size = alongX ? nx : ny;
+        const int center = alongX ? xc : yc;
+        std::vector<double> kernSum1d(size, 0.0), dataSum1d(size, 0.0);
+        for (int y = 0, k = 0; y < ny; y++)
+            for (int x = 0; x < nx; x++, k++)
+            {
+                // wts, the triangular weights across the axis
+                double wts = alongX ? yc - Abs(y - yc) + 1 : xc - Abs(x - xc) + 1;
+                kernSum1d[alongX ? x : y] += unmasked[k] * wts;
+                dataSum1d[alongX ? x : y] += cutout[k] * wts;
+            }
+        double wtSum = 0, kernSum = 0, kern2Sum = 0, dkernDxSum = 0, dkernDx2Sum = 0, kernDkernDxSum = 0;
+        double dataSum = 0, dataKernSum = 0, dataDkernDxSum = 0, dataDxSum = 0;
+        for (int i = 0; i < size; i++)
+        {
+            double wt = center - Abs(i - center) + 1;
+            double dkernDx = kernSum1d[i] * (center - i);
+            wtSum += wt;
+            kernSum += kernSum1d[i] * wt;
+            kern2Sum += kernSum1d[i] * kernSum1d[i] * wt;
+            dkernDxSum += dkernDx * wt;
+            dkernDx2Sum += dkernDx * dkernDx * wt;
+            kernDkernDxSum += kernSum1d[i] * dkernDx * wt;
+            dataSum += dataSum1d[i] * wt;
+            dataKernSum += dataSum1d[i] * kernSum1d[i] * wt;
+            dataDkernDxSum += dataSum1d[i] * dkernDx * wt;
+            dataDxSum += dataSum1d[i] * (i - center) * wt;
+        }
+        double hxNumer = dataKernSum - dataSum * kernSum / wtSum;
+        double hxDenom = kern2Sum - kernSum * kernSum / wtSum;
+        if (hxNumer <= 0 || hxDenom <= 0)
+            return false;
+        double hx = hxNumer / hxDenom;
+        double sky = (dataSum - hx * kernSum) / wtSum;
+        double dx = sigma * sigma * (hx * kernDkernDxSum + sky * dkernDxSum - dataDkernDxSum) / (hx * dkernDx2Sum);
+        double hsize = size / 2.0;
+        if (Abs(dx) > hsize)
+        {
+            dx = (dataSum != 0) ? dataDxSum / dataSum : 0.0;
+            if (Abs(dx) > hsize)
+                dx = 0;
+        }
+        shift = dx;
+        amplitude = hx;
+        return true;
+    };
+
+    std::vector<double> positions;
+    std::vector<double> cutoutData(size_type(nx) * ny), cutoutConv(size_type(nx) * ny);
+    for (const Point& peak : peaks)
+    {
+        for (int y = 0, k = 0; y < ny; y++)
+            for (int x = 0; x < nx; x++, k++)
+            {
+                cutoutData[k] = pixel(data, peak.x + x - xc, peak.y + y - yc);
+                cutoutConv[k] = pixel(convolved.data(), peak.x + x - xc, peak.y + y - yc);
+            }
+        const int kc = yc * nx + xc;
+        double dataPeak = cutoutData[kc];
+        double convdataPeak = cutoutConv[kc];
+
+        double maskedSum = 0;
+        int nonZero = 0;
+        for (size_type k = 0; k < cutoutData.size(); k++)
+        {
+            maskedSum += cutoutData[k] * mask[k];
+            if (cutoutData[k] != 0)
+                nonZero++;
+        }
+        double sharpness = (dataPeak - (maskedSum - dataPeak) / (npixels - 1)) / convdataPeak;
+
+        // roundness1: the central pixel set to zero, quad1 to quad4 over the whole cutout
+        cutoutConv[kc] = 0;
+        double sum2 = 0, sum4 = 0;
+        for (int y = 0, k = 0; y < ny; y++)
+            for (int x = 0; x < nx; x++, k++)
+            {
+                if (y <= yc && x > xc)
+                    sum2 -= cutoutConv[k];
+                if (y < yc && x <= xc)
+                    sum2 += cutoutConv[k];
+                if (y >= yc && x < xc)
+                    sum2 -= cutoutConv[k];
+                if (y > yc && x >= xc)
+                    sum2 += cutoutConv[k];
+                sum4 += Abs(cutoutConv[k]);
+            }
+        if (sum4 == 0)
+            continue;
+        double roundness1 = 2 * sum2 / sum4;
+
+        double dx, hx, dy, hy;
+        if (!marginalFit(cutoutData, true, dx, hx) || !marginalFit(cutoutData, false, dy, hy))
+            continue;
+        double roundness2 = 2 * (hx - hy) / (hx + hy);
+
+        // apply_filters, with the default inclusive bounds
+        if (nonZero <= 1 || !IsFinite(sharpness) || !IsFinite(roundness2))
+            continue;
+        if (sharpness < 0.2 || sharpness > 1.0 || roundness1 < -1.0 || roundness1 > 1.0 || roundness2 < -1.0 || roundness2 > 1.0)
+            continue;
+        if (dataPeak > peakMax)
+            continue;
+        positions.push_back(peak.x + dx);
+        positions.push_back(peak.y + dy);
+    }
+    return positions;
+}
+
+// Candidates of photutils DAOStarFinder on image, as x,y pairs in the order of its table
+static std::vector<double> PhotutilsCandidates(const Options& o, Image& image, int brightest)
+{
+    EPSFBuilderPython& python = EPSFBuilderPython::Acquire(o.pythonDll);
+    python.ShareBuffer("image_buffer", image[0], image.NumberOfPixels() * sizeof(float), false);
+    IsoString cmd;
+    cmd.Format("data = np.frombuffer(image_buffer, dtype = np.float32).reshape(%d, %d)", image.Height(), image.Width());
+    python.Run(cmd);
+    cmd.Format("daofind = DAOStarFinder(fwhm = %lf, threshold = %lf, peakmax = %lf, brightest = %d)", o.field.fwhm, o.threshold, o.peakMax, brightest);
+    python.Run(cmd);
+    python.Run("sources = daofind(data)");
+    python.Run("n_sources = 0 if sources is None else len(sources)");
+    std::vector<double> positions(size_type(2) * python.GetInt("n_sources"));
+    if (!positions.empty())
+    {
+        python.ShareBuffer("position_buffer", positions.data(), positions.size() * sizeof(double), true);
+        python.Run("np.frombuffer(position_buffer, dtype = np.float64).reshape(n_sources, 2)[:] = np.transpose((sources['xcentroid'], sources['ycentroid']))");
+    }
+    python.Run("for name in ('position_buffer', 'sources', 'daofind'):\n"
+               "    globals().pop(name, None)\n");
+    python.Release();
+    return positions;
+}
+
+// Compares the native candidates with those of reference, each matched at most once to the nearest
+// candidate of the other list within radius. Returns true if every candidate of both lists is matched.
+static bool CompareCandidates(const char* name, const std::vector<EPSFBuilderStarDetector::Star>& native, const std::vector<double>& reference, double radius)
+{
+    const size_type count = reference.size() / 2;
+    std::vector<bool> used(count, false);
+    int matched = 0;
+    double sum2 = 0, maxOffset = 0;
+    for (const EPSFBuilderStarDetector::Star& star : native)
+    {
+        size_type nearest = count;
+        double nearest2 = radius * radius;
+        for (size_type j = 0; j < count; j++)
+            if (!used[j])
+            {
+                double dx = star.x - reference[2 * j];
+                double dy = star.y - reference[2 * j + 1];
+                double d2 = dx * dx + dy * dy;
+                if (d2 <= nearest2)
+                {
+                    nearest2 = d2;
+                    nearest = j;
+                }
+            }
+        if (nearest < count)
+        {
+            used[nearest] = true;
+            matched++;
+            sum2 += nearest2;
+            maxOffset = Max(maxOffset, Sqrt(nearest2));
+        }
+    }
+
+    int missing = int(count) - matched;
+    int extra = int(native.size()) - matched;
+    printf("Detection vs %s: %d native, %d reference, %d matched within %.3f px, %d missing, %d extra\n",
+        name, int(native.size()), int(count), matched, radius, missing, extra);
+    if (matched > 0)
+        printf("Matched candidate offsets: RMS %.6f px, maximum %.6f px\n", Sqrt(sum2 / matched), maxOffset);
+    bool same = missing == 0 && extra == 0;
+    printf("Candidate lists %s\n", same ? "agree" : "DIFFER");
+    return same;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Options o = ParseArguments(argc, argv);
+
+        EPSFBuilderSynthetic field(o.field);
+        Image frame;
+        frame.DisableParallelProcessing();
+        double renderTime = Seconds([&]() { field.Render(frame); });
+        double megapixels = frame.NumberOfPixels() / 1.0e6;
+        printf("Synthetic field: %dx%d, %d stars, FWHM %.2f px, noise %.4f, rendered in %.3f s\n",
+            o.field.width, o.field.height, int(field.Stars().size()), o.field.fwhm, o.field.noise, renderTime);
+        printf("Threads: %u, repetitions: %d\n\n", std::thread::hardware_concurrency(), o.repeat);
+
+        enum { Background, Detection, Isolation, Centroiding, Extraction, Fitting, NumberOfStages };
+        static const char* stageName[NumberOfStages] = { "background", "detection", "isolation", "centroiding", "extraction", "fitting" };
+        double best[NumberOfStages];
+        int items[NumberOfStages] = {};
+        for (double& t : best)
+            t = 1.0e30;
+
+        int layers = int(Log2<double>(o.starSize) + 2.5);
+        int cutoutSize = int(o.starSize * 1.5);
+        std::vector<double> epsf;
+        int epsfSize = 0;
+        int fitIterations = 0;
+        std::vector<EPSFBuilderStarDetector::Star> detected;
+        std::vector<double> centroids;
+        Image subtracted;
+        subtracted.DisableParallelProcessing();
+
+        for (int r = 0; r < o.repeat; r++)
+        {
+            double t[NumberOfStages];
+
+            Image starImage;
+            starImage.DisableParallelProcessing();
+            starImage.Assign(frame);
+            ImageVariant image(&starImage);
+            t[Background] = Seconds([&]() { EPSFBuilderBackground(layers).Remove(image, o.background); });
+
+            std::vector<EPSFBuilderStarDetector::Star> sources;
+            t[Detection] = Seconds([&]() { sources = EPSFBuilderStarDetector(o.field.fwhm, o.threshold, o.peakMax, o.maxStars * 3).Detect(image); });
+
+            std::vector<int> isolated;
+            t[Isolation] = Seconds([&]() { isolated = EPSFBuilderIsolationFilter(cutoutSize, o.field.fwhm, o.threshold).Filter(sources, image, o.maxStars); });
+            if (isolated.empty())
+                throw Error("No isolated stars found");
+
+            // Every candidate is centroided, for the throughput; the pipeline keeps the detector centers
+            std::vector<double> positions;
+            for (const EPSFBuilderStarDetector::Star& source : sources)
+            {
+                positions.push_back(source.x);
+                positions.push_back(source.y);
+            }
+            t[Centroiding] = Seconds([&]() { EPSFBuilderCentroider(o.centroid, o.field.fwhm).Refine(image, positions); });
+
+            std::vector<double> isolatedPositions;
+            for (int i : isolated)
+            {
+                isolatedPositions.push_back(sources[i].x);
+                isolatedPositions.push_back(sources[i].y);
+            }
+            EPSFBuilderStarArena arena;
+            t[Extraction] = Seconds([&]() { EPSFBuilderExtractor(cutoutSize).Extract(image, isolatedPositions, o.maxStars, arena); });
+            std::vector<EPSFBuilderFitter::Star> stars = EPSFBuilderFitter::Stars(arena);
+
+            EPSFBuilderFitter fitter(o.oversampling, EPSFBuilderSmoothingKernel::Quadratic, o.iterations);
+            t[Fitting] = Seconds([&]() { fitter.Build(stars); });
+
+            for (int s = 0; s < NumberOfStages; s++)
+                best[s] = Min(best[s], t[s]);
+            items[Background] = 0;
+            items[Detection] = items[Isolation] = items[Centroiding] = int(sources.size());
+            items[Extraction] = items[Fitting] = int(stars.size());
+            epsf = fitter.Data();
+            epsfSize = fitter.Size();
+            fitIterations = fitter.Iterations();
+            detected = sources;
+            centroids = positions;
+            if (r == o.repeat - 1)
+                subtracted.Assign(starImage);
+        }
+
+        double total = 0;
+        printf("%-12s %10s %10s %12s %8s\n", "Stage", "Time (s)", "MPx/s", "Stars/s", "Stars");
+        for (int s = 0; s < NumberOfStages; s++)
+        {
+            total += best[s];
+            if (items[s] > 0)
+                printf("%-12s %10.4f %10.2f %12.1f %8d\n", stageName[s], best[s], megapixels / best[s], items[s] / best[s], items[s]);
+            else
+                printf("%-12s %10.4f %10.2f %12s %8s\n", stageName[s], best[s], megapixels / best[s], "-", "-");
+        }
+        printf("%-12s %10.4f %10.2f\n\n", "total", total, megapixels / total);
+
+        printf("Background, streaming vs starlet, %d layers, maximum deviation: %.3e (32-bit), %.3e (64-bit)\n\n",
+            layers, BackgroundDeviation<FloatPixelTraits>(frame, layers), BackgroundDeviation<DoublePixelTraits>(frame, layers));
+
+        // Accuracy: both PSFs normalized to a unit peak, within the ePSF support
+        double c = (epsfSize - 1) / 2.0;
+        double epsfPeak = 0, truePeak = field.EffectivePSF(0, 0);
+        for (double v : epsf)
+            epsfPeak = Max(epsfPeak, v);
+        double sum2 = 0, maxError = 0;
+        for (int y = 0, k = 0; y < epsfSize; y++)
+            for (int x = 0; x < epsfSize; x++, k++)
+            {
+                double truth = field.EffectivePSF((x - c) / o.oversampling, (y - c) / o.oversampling) / truePeak;
+                double error = epsf[k] / epsfPeak - truth;
+                sum2 += error * error;
+                maxError = Max(maxError, Abs(error));
+            }
+        printf("ePSF: %dx%d oversampled pixels, %d iteration(s)\n", epsfSize, epsfSize, fitIterations);
+        printf("ePSF error relative to the peak: RMS %.5f, maximum %.5f\n", Sqrt(sum2 / epsf.size()), maxError);
+
+        // Centers: distance to the nearest true star, if within one pixel of the detected center
+        double detector2 = 0, centroid2 = 0;
+        int matched = 0;
+        for (size_type i = 0; i < detected.size(); i++)
+        {
+            const EPSFBuilderSynthetic::Star* nearest = nullptr;
+            double nearest2 = 1;
+            for (const EPSFBuilderSynthetic::Star& star : field.Stars())
+            {
+                double d2 = (star.x - detected[i].x) * (star.x - detected[i].x) + (star.y - detected[i].y) * (star.y - detected[i].y);
+                if (d2 < nearest2)
+                {
+                    nearest2 = d2;
+                    nearest = &star;
+                }
+            }
+            if (nearest != nullptr)
+            {
+                matched++;
+                detector2 += nearest2;
+                centroid2 += (nearest->x - centroids[2 * i]) * (nearest->x - centroids[2 * i]) + (nearest->y - centroids[2 * i + 1]) * (nearest->y - centroids[2 * i + 1]);
+            }
+        }
+        if (matched > 0)
+            printf("Star centers of %d matched stars, RMS error: detector %.4f px, centroider %.4f px\n", matched, Sqrt(detector2 / matched), Sqrt(centroid2 / matched));
+
+        // Every candidate, without the brightest limit, against the transcription of DAOStarFinder
+        printf("\n");
+        std::vector<EPSFBuilderStarDetector::Star> candidates = EPSFBuilderStarDetector(o.field.fwhm, o.threshold, o.peakMax, 0).Detect(ImageVariant(&subtracted));
+        bool agree = CompareCandidates("the DAOStarFinder transcription", candidates, ReferenceCandidates(subtracted, o.field.fwhm, o.threshold, o.peakMax), o.matchRadius);
+
+        if (!o.pythonDll.IsEmpty())
+        {
+            printf("\n");
+            if (EPSFBuilderStubWorkers())
+                printf("Detection vs photutils DAOStarFinder: skipped, EPSFBUILDER_STUB_WORKERS is set\n");
+            else
+                agree = CompareCandidates("photutils DAOStarFinder", detected, PhotutilsCandidates(o, subtracted, o.maxStars * 3), o.matchRadius) && agree;
+        }
+        return agree ? 0 : 2;
+    }
+    catch (const Exception& x)
+    {
+        fprintf(stderr, "*** Error: %s\n", x.Message().ToUTF8().c_str());
+        return 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,709 @@
+// Headless ePSF Builder for render-farm nodes: runs EPSFBuilderPipeline, the processing of the module,
+// on FITS and XISF files without PixInsight, and writes for each input <name>_ePSF.xisf,
+// <name>_ePSF_grid.xisf in grid mode, <name>_stars.csv and, optionally, the mosaic of the extracted
+// stars as <name>_extracted_stars.xisf, the PSF photometry of every detected star as
+// <name>_photometry.csv or <name>_photometry.fits and the deconvolved frame as
+// <name>_deconvolved.xisf. Any number of files is processed in one invocation, sharing
+// the Python interpreter, the detection cache and the ePSF library. The image windows of the module are not
+// created.
+//
+// The options are the process parameters of the module, with their defaults, ranges and elements
+// taken from EPSFBuilderParameters. With the native engines Python is not needed at all. The
+// photutils engines need --python=<libpython>: Python is loaded with dlopen and runs the Python
+// stages in the embedded interpreter.
+//
+// Built by linux/g++/makefile with __EPSFBUILDER_STANDALONE.
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <pcl/AutoPointer.h>
+#include <pcl/File.h>
+#include <pcl/ImageVariant.h>
+#include <pcl/Math.h>
+#include <pcl/XISF.h>
+
+#include "../EPSFBuilderLibrary.h"
+#include "../EPSFBuilderParameters.h"
+#include "../EPSFBuilderPipeline.h"
+#include "../EPSFBuilderProfiler.h"
+
+using namespace pcl;
+
+struct Options
+{
+    EPSFBuilderPipeline::Parameters parameters;
+    String outputDirectory;
+    String traceFile;
+    bool mosaic = false;
+    StringList files;
+};
+
+// A command-line option that sets a process parameter. Its value is validated against the range or
+// the elements of the parameter, and the usage shows its default value.
+struct ParameterOption
+{
+    const char* name;
+    const char* value;      // placeholder in the usage, null for boolean options
+    const char* help;
+    MetaParameter* parameter;
+};
+
+static std::vector<ParameterOption> s_options;
+
+// The process parameters are not owned by a process in the standalone build: they only describe the
+// options
+static void CreateOptions()
+{
+    s_options = {
+        { "max-stars",                "N",   "maximum number of stars",                          new EPSFBuilderMaxStars(nullptr) },
+        { "star-max-peak",            "V",   "peak value above which stars are rejected",        new EPSFBuilderStarMaxPeak(nullptr) },
+        { "star-threshold",           "V",   "detection threshold",                              new EPSFBuilderStarThreshold(nullptr) },
+        { "star-fwhm",                "V",   "FWHM of the stars in pixels",                      new EPSFBuilderStarFWHM(nullptr) },
+        { "detection-engine",         "E",   nullptr,                                            new EPSFBuilderDetectionEngine(nullptr) },
+        { "centroid-method",          "M",   nullptr,                                            new EPSFBuilderCentroidMethod(nullptr) },
+        { "background-mode",          "M",   nullptr,                                            new EPSFBuilderBackgroundMode(nullptr) },
+        { "detection-cache-size",     "MiB", "cache of extracted stars shared by the files",     new EPSFBuilderDetectionCacheSize(nullptr) },
+        { "tile-memory",              "MiB", "memory budget of tiled processing, 0 for whole images", new EPSFBuilderTileMemory(nullptr) },
+        { "star-size",                "N",   "size of the ePSF in pixels",                       new EPSFBuilderStarSize(nullptr) },
+        { "oversampling",             "N",   "ePSF oversampling factor",                         new EPSFBuilderOversampling(nullptr) },
+        { "smoothing-kernel",         "K",   nullptr,                                            new EPSFBuilderSmoothingKernel(nullptr) },
+        { "max-iterations",           "N",   "maximum ePSF iterations",                          new EPSFBuilderMaxIterations(nullptr) },
+        { "fitting-engine",           "E",   nullptr,                                            new EPSFBuilderFittingEngine(nullptr) },
+        { "grid-columns",             "N",   "columns of the PSF grid",                          new EPSFBuilderGridColumns(nullptr) },
+        { "grid-rows",                "N",   "rows of the PSF grid",                             new EPSFBuilderGridRows(nullptr) },
+        { "grid-overlap",             "V",   "overlap of the grid cells",                        new EPSFBuilderGridOverlap(nullptr) },
+        { "photometry",               "F",   "PSF photometry of every detected star",            new EPSFBuilderPhotometryOutput(nullptr) },
+        { "library-time-window",      "H",   "hours between the frame and a reused ePSF",        new EPSFBuilderLibraryTimeWindow(nullptr) },
+        { "library-fwhm-tolerance",   "V",   "pixels between the star FWHMs of a reused ePSF",   new EPSFBuilderLibraryFWHMTolerance(nullptr) },
+        { "deconvolve",               nullptr, "also write the frame deconvolved with the ePSF or the PSF grid", new EPSFBuilderDeconvolve(nullptr) },
+        { "deconvolution-iterations", "N",   "maximum Richardson-Lucy iterations per tile",      new EPSFBuilderDeconvolutionIterations(nullptr) },
+        { "deconvolution-tolerance",  "V",   "relative change that stops a tile, 0 to run every iteration", new EPSFBuilderDeconvolutionTolerance(nullptr) },
+    };
+}
+
+// The field of the pipeline parameters set by a process parameter, as EPSFBuilderInstance::LockParameter()
+static void* ParameterField(EPSFBuilderPipeline::Parameters& p, const MetaParameter* parameter)
+{
+    if (parameter == TheEPSFBuilderMaxStarsParameter)
+        return &p.maxStars;
+    else if (parameter == TheEPSFBuilderStarMaxPeakParameter)
+        return &p.starMaxPeak;
+    else if (parameter == TheEPSFBuilderStarThresholdParameter)
+        return &p.starThreshold;
+    else if (parameter == TheEPSFBuilderStarFWHMParameter)
+        return &p.starFWHM;
+    else if (parameter == TheEPSFBuilderDetectionEngineParameter)
+        return &p.detectionEngine;
+    else if (parameter == TheEPSFBuilderCentroidMethodParameter)
+        return &p.centroidMethod;
+    else if (parameter == TheEPSFBuilderBackgroundModeParameter)
+        return &p.backgroundMode;
+    else if (parameter == TheEPSFBuilderDetectionCacheSizeParameter)
+        return &p.detectionCacheSize;
+    else if (parameter == TheEPSFBuilderTileMemoryParameter)
+        return &p.tileMemory;
+    else if (parameter == TheEPSFBuilderStarSizeParameter)
+        return &p.starSize;
+    else if (parameter == TheEPSFBuilderOversamplingParameter)
+        return &p.oversampling;
+    else if (parameter == TheEPSFBuilderSmoothingKernelParameter)
+        return &p.smoothingKernel;
+    else if (parameter == TheEPSFBuilderMaxIterationsParameter)
+        return &p.maxIterations;
+    else if (parameter == TheEPSFBuilderFittingEngineParameter)
+        return &p.fittingEngine;
+    else if (parameter == TheEPSFBuilderGridColumnsParameter)
+        return &p.gridColumns;
+    else if (parameter == TheEPSFBuilderGridRowsParameter)
+        return &p.gridRows;
+    else if (parameter == TheEPSFBuilderGridOverlapParameter)
+        return &p.gridOverlap;
+    else if (parameter == TheEPSFBuilderPhotometryOutputParameter)
+        return &p.photometryOutput;
+    else if (parameter == TheEPSFBuilderLibraryTimeWindowParameter)
+        return &p.libraryTimeWindow;
+    else if (parameter == TheEPSFBuilderLibraryFWHMToleranceParameter)
+        return &p.libraryFWHMTolerance;
+    else if (parameter == TheEPSFBuilderDeconvolveParameter)
+        return &p.deconvolve;
+    else if (parameter == TheEPSFBuilderDeconvolutionIterationsParameter)
+        return &p.deconvolutionIterations;
+    else if (parameter == TheEPSFBuilderDeconvolutionToleranceParameter)
+        return &p.deconvolutionTolerance;
+    return nullptr;
+}
+
+// The option value of an element id: MarginalGaussian is marginal-gaussian, CSV is csv
+static IsoString OptionValue(const IsoString& elementId)
+{
+    IsoString value;
+    for (size_type i = 0; i < elementId.Length(); i++)
+    {
+        if (i > 0 && isupper(elementId[i]) && islower(elementId[i - 1]))
+            value += '-';
+        value += char(tolower(elementId[i]));
+    }
+    return value;
+}
+
+// The default values of the module, for the options not given
+static void SetDefaults(EPSFBuilderPipeline::Parameters& p)
+{
+    for (const ParameterOption& option : s_options)
+    {
+        void* field = ParameterField(p, option.parameter);
+        if (const MetaEnumeration* e = dynamic_cast<const MetaEnumeration*>(option.parameter))
+            *static_cast<pcl_enum*>(field) = pcl_enum(e->DefaultValueIndex());
+        else if (const MetaBoolean* b = dynamic_cast<const MetaBoolean*>(option.parameter))
+            *static_cast<bool*>(field) = b->DefaultValue();
+        else if (const MetaInteger* i = dynamic_cast<const MetaInteger*>(option.parameter))
+            *static_cast<int*>(field) = int(i->DefaultValue());
+        else if (const MetaReal* r = dynamic_cast<const MetaReal*>(option.parameter))
+            *static_cast<double*>(field) = r->DefaultValue();
+    }
+
+    // Not process parameters of the module, or not available here: the library is enabled by
+    // --library, and the Python stages run in the embedded interpreter
+    p.libraryMode = EPSFBuilderLibraryMode::Disabled;
+    p.pythonWorkers = 0;
+    p.accumulateFrames = false;
+}
+
+static IsoString Usage()
+{
+    IsoString usage =
+        "Usage: epsfbuilder [options] <file> [<file> ...]\n"
+        "\n"
+        "Builds the ePSF of every FITS or XISF file. Options, with the defaults of the module:\n"
+        "\n";
+    auto line = [&](const IsoString& option, const IsoString& help)
+    {
+        usage += "  " + option;
+        for (size_type n = option.Length(); n < 27; n++)
+            usage += ' ';
+        usage += ' ' + help + '\n';
+    };
+
+    for (const ParameterOption& option : s_options)
+    {
+        IsoString name = IsoString("--") + option.name;
+        if (option.value == nullptr)
+        {
+            line(name, option.help);
+            continue;
+        }
+        name += IsoString('=') + option.value;
+        if (const MetaEnumeration* e = dynamic_cast<const MetaEnumeration*>(option.parameter))
+        {
+            IsoString elements;
+            for (size_type i = 0; i < e->NumberOfElements(); i++)
+            {
+                if (i > 0)
+                    elements += '|';
+                elements += OptionValue(e->ElementId(i));
+            }
+            if (option.help != nullptr)
+                elements += IsoString(", ") + option.help;
+            line(name, elements + " (" + OptionValue(e->ElementId(e->DefaultValueIndex())) + ')');
+        }
+        else if (const MetaNumeric* n = dynamic_cast<const MetaNumeric*>(option.parameter))
+            line(name, IsoString(option.help) + IsoString().Format(" (%g, %g-%g)", n->DefaultValue(), n->MinimumValue(), n->MaximumValue()));
+    }
+
+    line("--library=DIR", "store every ePSF in the ePSF library in DIR");
+    line("--library-reuse", "load a matching ePSF from the library instead of building it");
+    line("--python=PATH", "Python shared library, required by the photutils engines");
+    line("--python-workers=N", "accepted for compatibility, the CLI uses the embedded interpreter");
+    line("--output-directory=DIR", "output directory, next to each file if not specified");
+    line("--trace-file=PATH", "Chrome trace of the stage timings");
+    line("--file-list=PATH", "text file with one input file per line");
+    line("--mosaic", "also write the mosaic of the extracted stars");
+    line("--help", "show this help");
+    return usage;
+}
+
+static bool Match(const char* arg, const char* name, const char*& value)
+{
+    size_t n = strlen(name);
+    if (strncmp(arg, name, n) != 0 || arg[n] != '=')
+        return false;
+    value = arg + n + 1;
+    return true;
+}
+
+static double Numeric(const char* name, const char* value, double minValue, double maxValue)
+{
+    char* end;
+    double x = strtod(value, &end);
+    if (end == value || *end != '\0' || x < minValue || x > maxValue)
+        throw Error(String().Format("Invalid value for --%s: ", name) + String(value) + String().Format(" (valid range %g to %g)", minValue, maxValue));
+    return x;
+}
+
+static pcl_enum Enumerated(const char* name, const char* value, const MetaEnumeration* parameter)
+{
+    for (size_type i = 0; i < parameter->NumberOfElements(); i++)
+        if (OptionValue(parameter->ElementId(i)) == value)
+            return pcl_enum(i);
+    throw Error(String().Format("Invalid value for --%s: ", name) + String(value));
+}
+
+// Sets the parameter of option from arg, if arg is that option
+static bool ParseParameter(const char* arg, const ParameterOption& option, EPSFBuilderPipeline::Parameters& p)
+{
+    void* field = ParameterField(p, option.parameter);
+    if (option.value == nullptr)
+    {
+        if (strncmp(arg, "--", 2) != 0 || strcmp(arg + 2, option.name) != 0)
+            return false;
+        *static_cast<bool*>(field) = true;
+        return true;
+    }
+
+    const char* v;
+    if (strncmp(arg, "--", 2) != 0 || !Match(arg + 2, option.name, v))
+        return false;
+    if (const MetaEnumeration* e = dynamic_cast<const MetaEnumeration*>(option.parameter))
+        *static_cast<pcl_enum*>(field) = Enumerated(option.name, v, e);
+    else if (const MetaInteger* i = dynamic_cast<const MetaInteger*>(option.parameter))
+        *static_cast<int*>(field) = int(Numeric(option.name, v, i->MinimumValue(), i->MaximumValue()));
+    else if (const MetaReal* r = dynamic_cast<const MetaReal*>(option.parameter))
+        *static_cast<double*>(field) = Numeric(option.name, v, r->MinimumValue(), r->MaximumValue());
+    return true;
+}
+
+static Options ParseArguments(int argc, char** argv)
+{
+    Options o;
+    EPSFBuilderPipeline::Parameters& p = o.parameters;
+    SetDefaults(p);
+    bool libraryReuse = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const char* a = argv[i];
+        const char* v;
+        bool parsed = false;
+        for (const ParameterOption& option : s_options)
+            if (ParseParameter(a, option, p))
+            {
+                parsed = true;
+                break;
+            }
+        if (parsed)
+            continue;
+
+        if (strcmp(a, "--help") == 0)
+        {
+            fputs(Usage().c_str(), stdout);
+            exit(0);
+        }
+        else if (Match(a, "--library", v))
+            p.libraryDirectory = String::UTF8ToUTF16(v);
+        else if (strcmp(a, "--library-reuse") == 0)
+            libraryReuse = true;
+        else if (Match(a, "--python", v))
+            p.pythonDll = String::UTF8ToUTF16(v);
+        else if (Match(a, "--python-workers", v))
+        {
+            if (Numeric("python-workers", v, 0, 64) > 0)
+                fputs("** Warning: --python-workers is ignored, the command-line runner uses the embedded interpreter\n", stderr);
+        }
+        else if (Match(a, "--output-directory", v))
+            o.outputDirectory = String::UTF8ToUTF16(v);
+        else if (Match(a, "--trace-file", v))
+            o.traceFile = String::UTF8ToUTF16(v);
+        else if (strcmp(a, "--mosaic") == 0)
+            o.mosaic = true;
+        else if (Match(a, "--file-list", v))
+        {
+            for (const IsoString& line : File::ReadLines(String::UTF8ToUTF16(v)))
+            {
+                IsoString path = line.Trimmed();
+                if (!path.IsEmpty())
+                    o.files << path.UTF8ToUTF16();
+            }
+        }
+        else if (a[0] == '-' && a[1] == '-')
+            throw Error("Unknown option: " + String(a));
+        else
+            o.files << String::UTF8ToUTF16(a);
+    }
+
+    if (libraryReuse)
+        p.libraryMode = EPSFBuilderLibraryMode::Reuse;
+    else if (!p.libraryDirectory.IsEmpty())
+        p.libraryMode = EPSFBuilderLibraryMode::Store;
+
+    if (o.files.IsEmpty())
+        throw Error("No input files have been specified");
+    if (p.UsesPython() && p.pythonDll.IsEmpty())
+        throw Error("The photutils engines require the Python library, see --python");
+    String whyNot;
+    if (!p.CanTile(whyNot) || !p.CanMeasureStars(whyNot) || !p.CanUseLibrary(whyNot) || !p.CanDeconvolve(whyNot))
+        throw Error(whyNot);
+    if (!o.outputDirectory.IsEmpty() && !File::DirectoryExists(o.outputDirectory))
+        throw Error("The specified output directory does not exist: " + o.outputDirectory);
+    return o;
+}
+
+// Decodes one row of big-endian FITS samples of type T, read through the unsigned type U of the same
+// size, as f = raw * scale + offset
+template <typename T, typename U, typename S>
+static void DecodeFITSRow(S* f, const uint8* p, int width, double scale, double offset)
+{
+    for (int x = 0; x < width; x++, p += sizeof(T))
+    {
+        U u = 0;
+        for (size_t b = 0; b < sizeof(T); b++)
+            u = U(u << 8) | p[b];
+        T raw;
+        memcpy(&raw, &u, sizeof(T));
+        f[x] = S(raw * scale + offset);
+    }
+}
+
+// The planes of a FITS image, which follow one another, decoded row by row
+template <class P>
+static void DecodeFITSPlanes(GenericImage<P>& image, File& file, int bitpix, double scale, double offset)
+{
+    typedef typename P::sample sample;
+    const int width = image.Width();
+    std::vector<uint8> row(size_type(width) * (Abs(bitpix) / 8));
+    for (int c = 0; c < image.NumberOfChannels(); c++)
+        for (int y = 0; y < image.Height(); y++)
+        {
+            file.Read(row.data(), row.size());
+            sample* f = image.ScanLine(y, c);
+            switch (bitpix)
+            {
+            case 8:   DecodeFITSRow<uint8, uint8>(f, row.data(), width, scale, offset); break;
+            case 16:  DecodeFITSRow<int16, uint16>(f, row.data(), width, scale, offset); break;
+            case 32:  DecodeFITSRow<int32, uint32>(f, row.data(), width, scale, offset); break;
+            case -32: DecodeFITSRow<float, uint32>(f, row.data(), width, scale, offset); break;
+            default:  DecodeFITSRow<double, uint64>(f, row.data(), width, scale, offset); break;
+            }
+        }
+}
+
+// Reads the primary HDU of a FITS file: a monochrome image, or an RGB image of three planes, of any
+// standard sample format, into a 64-bit image for BITPIX -64 and a 32-bit one otherwise, as the
+// module does. Integer samples are mapped to [0,1] from the range of their type, floating point
+// samples are rescaled to [0,1] only if they fall outside it. The first row of the file is the top
+// row of the image. The header cards with a value are returned in keywords; without pixels, only the
+// header is read. Returns the number of channels.
+static int ReadFITS(const String& path, ImageVariant& image, FITSKeywordArray& keywords, bool pixels)
+{
+    File file = File::OpenFileForReading(path);
+
+    int bitpix = 0, naxis = -1;
+    int naxisn[3] = { 1, 1, 1 };
+    double bzero = 0, bscale = 1;
+    bool simple = false, end = false;
+    char block[2880];
+    while (!end)
+    {
+        file.Read(block, sizeof(block));
+        for (int c = 0; c < 36 && !end; c++)
+        {
+            IsoString card(block + 80 * c, 0, 80);
+            IsoString keyword = card.Left(8).Trimmed();
+            if (keyword == "END")
+            {
+                end = true;
+                break;
+            }
+            if (card.Length() < 10 || card[8] != '=')
+                continue;
+            IsoString value = card.Substring(10);
+            if (value.Trimmed().StartsWith('\''))
+            {
+                // String values end at their closing quote and may contain slashes
+                value.Trim();
+                size_type quote = value.Find('\'', 1);
+                keywords << FITSHeaderKeyword(keyword, (quote == String::notFound) ? value : value.Left(quote + 1));
+                continue;
+            }
+            size_type comment = value.Find('/');
+            if (comment != String::notFound)
+                value = value.Left(comment);
+            value.Trim();
+            keywords << FITSHeaderKeyword(keyword, value);
+            value.ReplaceChar('D', 'E');
+            if (keyword == "SIMPLE")
+                simple = value == "T";
+            else if (keyword == "BITPIX")
+                bitpix = value.ToInt();
+            else if (keyword == "NAXIS")
+                naxis = value.ToInt();
+            else if (keyword == "NAXIS1" || keyword == "NAXIS2" || keyword == "NAXIS3")
+                naxisn[keyword[5] - '1'] = value.ToInt();
+            else if (keyword == "BZERO")
+                bzero = value.ToDouble();
+            else if (keyword == "BSCALE")
+                bscale = value.ToDouble();
+        }
+    }
+
+    if (!simple)
+        throw Error(path + ": Not a FITS file.");
+    if (naxis < 2 || naxis > 3 || (naxisn[2] != 1 && naxisn[2] != 3))
+        throw Error(path + ": ePSF Builder can only be executed on grayscale and RGB images.");
+    int channels = naxisn[2];
+    if (!pixels)
+    {
+        file.Close();
+        return channels;
+    }
+    if (bitpix != 8 && bitpix != 16 && bitpix != 32 && bitpix != -32 && bitpix != -64)
+        throw Error(path + String().Format(": Unsupported BITPIX value %d.", bitpix));
+
+    double rawMin = 0, rawMax = 1;
+    if (bitpix == 8)
+        rawMax = 255;
+    else if (bitpix == 16)
+        rawMin = -32768, rawMax = 32767;
+    else if (bitpix == 32)
+        rawMin = -2147483648.0, rawMax = 2147483647.0;
+    double physMin = rawMin * bscale + bzero;
+    double physRange = (rawMax - rawMin) * bscale;
+
+    // Integer samples map physMin..physMin + physRange to [0,1], folded into a single scale and offset
+    double scale = bscale, offset = bzero;
+    if (bitpix > 0)
+    {
+        scale = bscale / physRange;
+        offset = (bzero - physMin) / physRange;
+    }
+
+    image.CreateFloatImage((bitpix == -64) ? 64 : 32);
+    image->DisableParallelProcessing();
+    image.AllocateImage(naxisn[0], naxisn[1], channels, (channels == 3) ? ColorSpace::RGB : ColorSpace::Gray);
+    if (image.BitsPerSample() == 64)
+        DecodeFITSPlanes(static_cast<DImage&>(*image), file, bitpix, scale, offset);
+    else
+        DecodeFITSPlanes(static_cast<Image&>(*image), file, bitpix, scale, offset);
+    file.Close();
+
+    if (bitpix < 0)
+    {
+        double lo = image.MinimumSampleValue();
+        double hi = image.MaximumSampleValue();
+        if (lo < 0 || hi > 1)
+            image.Normalize();
+    }
+    return channels;
+}
+
+// Reads a frame and its FITS keywords, or only the keywords without pixels. Frames are read with
+// parallel processing disabled, see ProcessFrame(). Returns the number of nominal channels of the
+// frame.
+static int ReadFrame(const String& path, ImageVariant& image, FITSKeywordArray& keywords, bool pixels = true)
+{
+    EPSFBuilderProfiler::Scope scope("read frame");
+    String extension = File::ExtractExtension(path).CaseFolded();
+    if (extension == ".xisf")
+    {
+        XISFReader reader;
+        reader.Open(path);
+        if (reader.NumberOfImages() < 1)
+            throw Error(path + ": Empty image file.");
+        reader.SelectImage(0);
+        keywords = reader.ReadFITSKeywords();
+        int channels = (reader.ImageInfo().colorSpace == ColorSpace::Gray) ? 1 : 3;
+        if (pixels)
+        {
+            // The sample type of the file; integer images are read as 32-bit floating point
+            const ImageOptions options = reader.ImageOptions();
+            image.CreateFloatImage((options.ieeefpSampleFormat && options.bitsPerSample == 64) ? 64 : 32);
+            image->DisableParallelProcessing();
+            if (image.BitsPerSample() == 64)
+                reader.ReadImage(static_cast<DImage&>(*image));
+            else
+                reader.ReadImage(static_cast<Image&>(*image));
+        }
+        reader.Close();
+        return channels;
+    }
+    else if (extension == ".fits" || extension == ".fit" || extension == ".fts")
+        return ReadFITS(path, image, keywords, pixels);
+    else
+        throw Error(path + ": Unsupported file format, expected FITS or XISF.");
+}
+
+static void WriteXISF(const String& path, const ImageVariant& image)
+{
+    XISFWriter writer;
+    writer.Create(path, 1);
+    writer.WriteImage(image);
+    writer.Close();
+    printf("%s\n", path.ToUTF8().c_str());
+}
+
+static String OutputBaseName(const String& path, const Options& o)
+{
+    String directory = o.outputDirectory.IsEmpty() ? File::ExtractDrive(path) + File::ExtractDirectory(path) : o.outputDirectory;
+    if (!directory.IsEmpty() && !directory.EndsWith('/'))
+        directory += '/';
+    return directory + File::ExtractName(path);
+}
+
+// The pipeline of the module with its console output on stdout. Without image windows nothing else
+// runs while the ePSF is fitted, so the fit runs on the calling thread.
+class EPSFBuilderCLIPipeline : public EPSFBuilderPipeline
+{
+public:
+    EPSFBuilderCLIPipeline(const Parameters& parameters)
+        : EPSFBuilderPipeline(parameters)
+    {
+    }
+
+protected:
+    void WriteLn(const String& text) const override
+    {
+        printf("%s\n", text.ToUTF8().c_str());
+    }
+};
+
+static void ProcessFrame(const String& path, const Options& o, const EPSFBuilderPipeline& pipeline, EPSFBuilderLibrary* library)
+{
+    EPSFBuilderProfiler::Scope frameScope("frame");
+    const EPSFBuilderPipeline::Parameters& p = pipeline.Settings();
+    String baseName = OutputBaseName(path, o);
+
+    // Standalone builds have no PCL threads: the images of the pipeline inherit the parallel
+    // processing settings of the frame
+    ImageVariant image;
+    FITSKeywordArray keywords;
+
+    // A matching ePSF of the library replaces the whole pipeline, so the pixels are only read for
+    // deconvolution
+    if (p.ReusesLibrary())
+    {
+        int channels = ReadFrame(path, image, keywords, false);
+        ImageVariant epsfImage;
+        int index = pipeline.LoadFromLibrary(*library, pipeline.LibraryEntry(keywords, channels), epsfImage);
+        if (index >= 0)
+        {
+            printf("ePSF loaded from the library: %s\n", library->Entries()[index].fileName.ToUTF8().c_str());
+            WriteXISF(baseName + "_ePSF.xisf", epsfImage);
+            if (p.deconvolve)
+            {
+                ReadFrame(path, image, keywords);
+                ImageVariant deconvolvedImage;
+                pipeline.Deconvolve(deconvolvedImage, image, epsfImage, ImageVariant());
+                WriteXISF(baseName + "_deconvolved.xisf", deconvolvedImage);
+            }
+            return;
+        }
+        printf("No matching ePSF in the library\n");
+    }
+
+    ReadFrame(path, image, keywords);
+    String whyNot;
+    if (!p.CanFitChannels(image.NumberOfNominalChannels(), whyNot))
+        throw Error(path + ": " + whyNot);
+    printf("%dx%d pixels, %d channel(s)\n", image.Width(), image.Height(), image.NumberOfNominalChannels());
+
+    // Steps 1 to 9 and the PSF grid, as in ExecuteOn of the module
+    EPSFBuilderPipeline::StageOutputs outputs;
+    outputs.id = path;
+    pipeline.Build(image, outputs);
+    const ImageVariant& starImage = p.IsTiled() ? image : outputs.starImage;
+
+    // Output files
+    EPSFBuilderProfiler::Scope writeScope("write results");
+    WriteXISF(baseName + "_ePSF.xisf", outputs.epsfImage);
+    if (p.IsGridMode())
+        WriteXISF(baseName + "_ePSF_grid.xisf", outputs.gridImage);
+    EPSFBuilderPipeline::WriteCatalog(baseName + "_stars.csv", outputs.stars);
+    printf("%s (%d stars)\n", (baseName + "_stars.csv").ToUTF8().c_str(), outputs.stars.Count());
+
+    if (p.photometryOutput != EPSFBuilderPhotometryOutput::Disabled)
+        pipeline.MeasureStars(baseName, outputs.fittedImage, starImage, image, outputs.sources);
+
+    if (library != nullptr)
+        pipeline.StoreInLibrary(*library, pipeline.LibraryEntry(keywords, outputs.epsfImage.NumberOfChannels()), outputs.epsfImage, outputs.stars.Count());
+
+    if (p.deconvolve)
+    {
+        ImageVariant deconvolvedImage;
+        pipeline.Deconvolve(deconvolvedImage, image, outputs.epsfImage, outputs.gridImage);
+        WriteXISF(baseName + "_deconvolved.xisf", deconvolvedImage);
+    }
+
+    // The extracted stars, cropped to the ePSF size and tiled row by row as in the module window
+    if (o.mosaic)
+    {
+        int ncols = EPSFBuilderPipeline::MosaicColumns(outputs.stars.Count());
+        int nrows = (outputs.stars.Count() + ncols - 1) / ncols;
+        ImageVariant mosaic;
+        mosaic.CreateFloatImage(32);
+        mosaic->DisableParallelProcessing();
+        mosaic.AllocateImage(ncols * p.starSize, nrows * p.starSize, 1, ColorSpace::Gray);
+        mosaic.Fill(0.0);
+        EPSFBuilderPipeline::TileStars(mosaic, outputs.stars, ncols, p.starSize);
+        WriteXISF(baseName + "_extracted_stars.xisf", mosaic);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CreateOptions();
+
+    Options o;
+    AutoPointer<EPSFBuilderLibrary> library;
+    try
+    {
+        o = ParseArguments(argc, argv);
+        if (o.parameters.libraryMode != EPSFBuilderLibraryMode::Disabled)
+            library = new EPSFBuilderLibrary(o.parameters.libraryDirectory);
+    }
+    catch (const Exception& x)
+    {
+        fprintf(stderr, "*** Error: %s\n\n%s", x.Message().ToUTF8().c_str(), Usage().c_str());
+        return 2;
+    }
+
+    EPSFBuilderCLIPipeline pipeline(o.parameters);
+    EPSFBuilderProfiler profiler;
+    int succeeded = 0;
+    for (size_type i = 0; i < o.files.Length(); i++)
+    {
+        printf("\nFrame %d of %d: %s\n", int(i + 1), int(o.files.Length()), o.files[i].ToUTF8().c_str());
+        try
+        {
+            ProcessFrame(o.files[i], o, pipeline, library.Ptr());
+            succeeded++;
+        }
+        catch (const Exception& x)
+        {
+            fprintf(stderr, "*** Error: %s\n", x.Message().ToUTF8().c_str());
+        }
+        catch (const std::bad_alloc&)
+        {
+            fprintf(stderr, "*** Error: Out of memory processing %s\n", o.files[i].ToUTF8().c_str());
+        }
+        fflush(stdout);
+    }
+
+    printf("\nePSF Builder: %d of %d frame(s) processed successfully\n\n", succeeded, int(o.files.Length()));
+    printf("%s", profiler.Summary().ToUTF8().c_str());
+    if (!o.traceFile.IsEmpty())
+    {
+        try
+        {
+            profiler.WriteTrace(o.traceFile);
+            printf("Trace written to %s\n", o.traceFile.ToUTF8().c_str());
+        }
+        catch (const Exception& x)
+        {
+            fprintf(stderr, "** Warning: %s\n", x.Message().ToUTF8().c_str());
+        }
+    }
+
+    return (succeeded == int(o.files.Length())) ? 0 : 1;
+}
\ No newline at end of file